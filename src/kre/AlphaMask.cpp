@@ -0,0 +1,312 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "AlphaMask.hpp"
+#include "Simd.hpp"
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+namespace KRE
+{
+	namespace
+	{
+		// Size in pixels of a level 0 cell, doubling with each level.
+		const int block_size = 8;
+
+		inline int popcount(uint64_t v)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_popcountll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			return static_cast<int>(__popcnt64(v));
+#else
+			v = v - ((v >> 1) & 0x5555555555555555ULL);
+			v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+			v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+			return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+		}
+
+		// The bits [x1,x2) of the word starting at pixel base.
+		inline uint64_t word_mask(int base, int x1, int x2)
+		{
+			const int lo = std::max(x1 - base, 0);
+			const int hi = std::min(x2 - base, 64);
+			if(lo >= hi) {
+				return 0;
+			}
+			const uint64_t upper = hi == 64 ? ~0ULL : (1ULL << hi) - 1;
+			return upper & (~0ULL << lo);
+		}
+
+		inline int floor_div(int n, int d)
+		{
+			return n >= 0 ? n / d : -((-n + d - 1) / d);
+		}
+
+		// Opaque bits for count (at most 64) 32-bit pixels.
+		uint64_t build_word(const unsigned char* px, int count, uint32_t alpha_mask)
+		{
+			uint64_t res = 0;
+			int n = 0;
+#if defined(KRE_SIMD_AVX2)
+			const __m256i amask = _mm256_set1_epi32(static_cast<int>(alpha_mask));
+			const __m256i zero = _mm256_setzero_si256();
+			for(; n + 8 <= count; n += 8) {
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(px + n * 4));
+				const int transparent = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(v, amask), zero)));
+				res |= static_cast<uint64_t>(~transparent & 0xff) << n;
+			}
+#elif defined(KRE_SIMD_SSE2)
+			const __m128i amask = _mm_set1_epi32(static_cast<int>(alpha_mask));
+			const __m128i zero = _mm_setzero_si128();
+			for(; n + 4 <= count; n += 4) {
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + n * 4));
+				const int transparent = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, amask), zero)));
+				res |= static_cast<uint64_t>(~transparent & 0xf) << n;
+			}
+#endif
+			for(; n != count; ++n) {
+				uint32_t v;
+				memcpy(&v, px + n * 4, 4);
+				if(v & alpha_mask) {
+					res |= 1ULL << n;
+				}
+			}
+			return res;
+		}
+	}
+
+	AlphaMask::BitGrid::BitGrid(int w, int h)
+		: width(w),
+		  height(h),
+		  words_per_row((w + 63) / 64),
+		  bits(words_per_row * h, 0)
+	{
+	}
+
+	uint64_t AlphaMask::BitGrid::extract(int x, int y) const
+	{
+		const uint64_t* row = &bits[y * words_per_row];
+		const int w = floor_div(x, 64);
+		const int offset = x - w * 64;
+		const uint64_t lo = w >= 0 && w < words_per_row ? row[w] : 0;
+		if(offset == 0) {
+			return lo;
+		}
+		const uint64_t hi = w + 1 >= 0 && w + 1 < words_per_row ? row[w + 1] : 0;
+		return (lo >> offset) | (hi << (64 - offset));
+	}
+
+	bool AlphaMask::BitGrid::any(int x1, int y1, int x2, int y2) const
+	{
+		const int w1 = x1 / 64;
+		const int w2 = (x2 - 1) / 64;
+		for(int y = y1; y != y2; ++y) {
+			const uint64_t* row = &bits[y * words_per_row];
+			for(int w = w1; w <= w2; ++w) {
+				if(row[w] & word_mask(w * 64, x1, x2)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	int AlphaMask::BitGrid::count(int x1, int y1, int x2, int y2) const
+	{
+		const int w1 = x1 / 64;
+		const int w2 = (x2 - 1) / 64;
+		int res = 0;
+		for(int y = y1; y != y2; ++y) {
+			const uint64_t* row = &bits[y * words_per_row];
+			for(int w = w1; w <= w2; ++w) {
+				res += popcount(row[w] & word_mask(w * 64, x1, x2));
+			}
+		}
+		return res;
+	}
+
+	AlphaMask::AlphaMask(int width, int height, bool opaque)
+		: pixels_(width, height)
+	{
+		if(opaque) {
+			for(int y = 0; y != height; ++y) {
+				uint64_t* row = &pixels_.bits[y * pixels_.words_per_row];
+				for(int w = 0; w != pixels_.words_per_row; ++w) {
+					row[w] = word_mask(w * 64, 0, width);
+				}
+			}
+		}
+		buildHierarchy();
+	}
+
+	AlphaMaskPtr AlphaMask::create(const void* pixels, int width, int height, int row_pitch, uint32_t alpha_mask)
+	{
+		auto res = std::make_shared<AlphaMask>(width, height);
+		BitGrid& grid = res->pixels_;
+		for(int y = 0; y != height; ++y) {
+			const unsigned char* row = static_cast<const unsigned char*>(pixels) + y * row_pitch;
+			uint64_t* out = &grid.bits[y * grid.words_per_row];
+			for(int w = 0; w != grid.words_per_row; ++w) {
+				out[w] = build_word(row + w * 64 * 4, std::min(64, width - w * 64), alpha_mask);
+			}
+		}
+		res->buildHierarchy();
+		return res;
+	}
+
+	AlphaMaskPtr AlphaMask::createOpaque(int width, int height)
+	{
+		return std::make_shared<AlphaMask>(width, height, true);
+	}
+
+	void AlphaMask::setOpaque(int x, int y, bool opaque)
+	{
+		uint64_t& word = pixels_.bits[y * pixels_.words_per_row + (x >> 6)];
+		if(opaque) {
+			word |= 1ULL << (x & 63);
+		} else {
+			word &= ~(1ULL << (x & 63));
+		}
+		// The hierarchy may now say a block is empty when it isn't.
+		levels_.clear();
+	}
+
+	void AlphaMask::buildHierarchy()
+	{
+		levels_.clear();
+		if(width() == 0 || height() == 0) {
+			return;
+		}
+
+		// Level 0, the rows of each block are or'd together then every byte that has a bit set 
+		// becomes a bit.
+		BitGrid level0((width() + block_size - 1) / block_size, (height() + block_size - 1) / block_size);
+		std::vector<uint64_t> combined(pixels_.words_per_row);
+		for(int by = 0; by != level0.height; ++by) {
+			std::fill(combined.begin(), combined.end(), 0);
+			const int y_end = std::min(height(), (by + 1) * block_size);
+			for(int y = by * block_size; y != y_end; ++y) {
+				const uint64_t* row = getRow(y);
+				for(int w = 0; w != pixels_.words_per_row; ++w) {
+					combined[w] |= row[w];
+				}
+			}
+			uint64_t* out = &level0.bits[by * level0.words_per_row];
+			for(int w = 0; w != pixels_.words_per_row; ++w) {
+				for(int b = 0; combined[w] != 0 && b != 8; ++b) {
+					if((combined[w] >> (b * 8)) & 0xff) {
+						const int bx = w * 8 + b;
+						out[bx >> 6] |= 1ULL << (bx & 63);
+					}
+				}
+			}
+		}
+		levels_.emplace_back(std::move(level0));
+
+		while(levels_.back().width > 1 || levels_.back().height > 1) {
+			const BitGrid& prev = levels_.back();
+			BitGrid next((prev.width + 1) / 2, (prev.height + 1) / 2);
+			for(int y = 0; y != prev.height; ++y) {
+				const uint64_t* row = &prev.bits[y * prev.words_per_row];
+				uint64_t* out = &next.bits[(y / 2) * next.words_per_row];
+				for(int w = 0; w != prev.words_per_row; ++w) {
+					for(uint64_t v = row[w]; v != 0; v &= v - 1) {
+						const int x = (w * 64 + popcount((v & (~v + 1)) - 1)) / 2;
+						out[x >> 6] |= 1ULL << (x & 63);
+					}
+				}
+			}
+			levels_.emplace_back(std::move(next));
+		}
+	}
+
+	bool AlphaMask::clip(const rect& r, int* x1, int* y1, int* x2, int* y2) const
+	{
+		*x1 = std::max(r.x1(), 0);
+		*y1 = std::max(r.y1(), 0);
+		*x2 = std::min(r.x2(), width());
+		*y2 = std::min(r.y2(), height());
+		return *x1 < *x2 && *y1 < *y2;
+	}
+
+	bool AlphaMask::anyOpaque(const rect& r) const
+	{
+		int x1, y1, x2, y2;
+		if(!clip(r, &x1, &y1, &x2, &y2)) {
+			return false;
+		}
+		for(int n = static_cast<int>(levels_.size()) - 1; n >= 0; --n) {
+			const int cell = block_size << n;
+			if(!levels_[n].any(x1 / cell, y1 / cell, (x2 - 1) / cell + 1, (y2 - 1) / cell + 1)) {
+				return false;
+			}
+		}
+		return pixels_.any(x1, y1, x2, y2);
+	}
+
+	int AlphaMask::countOpaque(const rect& r) const
+	{
+		int x1, y1, x2, y2;
+		if(!clip(r, &x1, &y1, &x2, &y2)) {
+			return 0;
+		}
+		return pixels_.count(x1, y1, x2, y2);
+	}
+
+	bool AlphaMask::collides(const AlphaMask& other, int x, int y) const
+	{
+		const rect overlap(x, y, other.width(), other.height());
+		int x1, y1, x2, y2;
+		if(!clip(overlap, &x1, &y1, &x2, &y2)) {
+			return false;
+		}
+		if(!anyOpaque(rect(x1, y1, x2 - x1, y2 - y1)) || !other.anyOpaque(rect(x1 - x, y1 - y, x2 - x1, y2 - y1))) {
+			return false;
+		}
+		for(int py = y1; py != y2; ++py) {
+			for(int px = x1; px < x2; px += 64) {
+				const uint64_t mask = x2 - px >= 64 ? ~0ULL : (1ULL << (x2 - px)) - 1;
+				if(pixels_.extract(px, py) & other.pixels_.extract(px - x, py - y) & mask) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	size_t AlphaMask::getBytes() const
+	{
+		size_t res = sizeof(AlphaMask) + pixels_.bits.size() * sizeof(uint64_t);
+		for(auto& level : levels_) {
+			res += level.bits.size() * sizeof(uint64_t);
+		}
+		return res;
+	}
+}
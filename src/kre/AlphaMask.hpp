@@ -0,0 +1,96 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace KRE
+{
+	class AlphaMask;
+	typedef std::shared_ptr<AlphaMask> AlphaMaskPtr;
+
+	// One bit per pixel, set for pixels that aren't fully transparent, packed into 64-bit words with
+	// each row starting on a new word. Over the pixels sits a pyramid of coarser grids, level 0 has a bit
+	// per 8x8 block that is set if any pixel in it is opaque and each level after that halves the
+	// resolution, so queries over empty areas are answered without touching the pixel bits.
+	class AlphaMask
+	{
+	public:
+		AlphaMask(int width, int height, bool opaque=false);
+
+		// Builds the mask from 32-bit pixels, a pixel is transparent if (pixel & alpha_mask) == 0.
+		static AlphaMaskPtr create(const void* pixels, int width, int height, int row_pitch, uint32_t alpha_mask);
+		// A mask where every pixel is opaque, for surfaces without alpha.
+		static AlphaMaskPtr createOpaque(int width, int height);
+
+		int width() const { return pixels_.width; }
+		int height() const { return pixels_.height; }
+
+		bool isAlpha(int x, int y) const { return !pixels_.get(x, y); }
+		bool isOpaque(int x, int y) const { return pixels_.get(x, y); }
+		// Edits the pixel bits, call buildHierarchy() when done.
+		void setOpaque(int x, int y, bool opaque);
+		void buildHierarchy();
+
+		// True if any pixel inside r (clipped to the mask) is opaque.
+		bool anyOpaque(const rect& r) const;
+		// Counts the opaque pixels inside r.
+		int countOpaque(const rect& r) const;
+		// True if an opaque pixel of this mask overlaps an opaque pixel of other, where other's top-left
+		// corner is placed at (x,y) in this mask's coordinates.
+		bool collides(const AlphaMask& other, int x, int y) const;
+
+		// Row y of the pixel bits, bit n of word w is pixel w*64+n.
+		const uint64_t* getRow(int y) const { return &pixels_.bits[y * pixels_.words_per_row]; }
+		int getWordsPerRow() const { return pixels_.words_per_row; }
+		int getLevelCount() const { return static_cast<int>(levels_.size()); }
+
+		size_t getBytes() const;
+	private:
+		struct BitGrid
+		{
+			BitGrid() : width(0), height(0), words_per_row(0) {}
+			BitGrid(int w, int h);
+			bool get(int x, int y) const { return (bits[y * words_per_row + (x >> 6)] >> (x & 63)) & 1; }
+			// The 64 bits starting at x in row y, bits past the end of the row are zero.
+			uint64_t extract(int x, int y) const;
+			// Whether any bit in [x1,x2) x [y1,y2) is set, the area must lie inside the grid.
+			bool any(int x1, int y1, int x2, int y2) const;
+			int count(int x1, int y1, int x2, int y2) const;
+			int width;
+			int height;
+			int words_per_row;
+			std::vector<uint64_t> bits;
+		};
+		// Clips r to the mask, returns false if nothing is left.
+		bool clip(const rect& r, int* x1, int* y1, int* x2, int* y2) const;
+
+		BitGrid pixels_;
+		std::vector<BitGrid> levels_;
+	};
+}
@@ -162,6 +162,9 @@ namespace KRE
 		bool isEnabled() const { return enabled_; }
 
 		virtual AttributeBasePtr clone() = 0;
+		// Client side copy of the data, if one is kept.
+		virtual const void* getData() const { return nullptr; }
+		virtual std::size_t getDataSize() const { return 0; }
 		void setParent(std::weak_ptr<AttributeSet> attrset) { parent_ = attrset; }
 		AttributeSetPtr getParent() const;
 	private:
@@ -280,6 +283,12 @@ namespace KRE
 		AttributeBasePtr clone() override {
 			return std::make_shared<Attribute<T, Container>>(*this);
 		}
+		const void* getData() const override {
+			return elements_.empty() ? nullptr : &elements_[0];
+		}
+		std::size_t getDataSize() const override {
+			return elements_.size() * sizeof(T);
+		}
 	private:
 		void handleAttachHardwareBuffer() override {
 			// This just makes sure that if we add any elements
@@ -21,7 +21,10 @@
 	   distribution.
 */
 
+#include <algorithm>
+
 #include "AttributeSetOGL.hpp"
+#include "profile_timer.hpp"
 
 namespace KRE
 {
@@ -80,12 +83,15 @@ namespace KRE
 
 	void HardwareAttributeOGL::update(const void* value, ptrdiff_t offset, size_t size)
 	{
+		PROFILE_COUNTER_ADD(BYTES_UPLOADED, size);
 		glBindBuffer(GL_ARRAY_BUFFER, buffer_id_);
 		if(offset == 0) {
-			// this is a minor optimisation.
-			glBufferData(GL_ARRAY_BUFFER, size, 0, access_pattern_);
+			// Orphan the old store rather than writing into it while it may still be in use.
+			// Its size is kept when the new data fits, so the driver can recycle the 
+			// allocation for data that is streamed every frame.
+			size_ = std::max(size_, size);
+			glBufferData(GL_ARRAY_BUFFER, size_, 0, access_pattern_);
 			glBufferSubData(GL_ARRAY_BUFFER, 0, size, value);
-			size_ = size;
 		} else {
 			if(size_ == 0) {
 				glBufferData(GL_ARRAY_BUFFER, size+offset, 0, access_pattern_);
@@ -164,5 +170,6 @@ namespace KRE
 	{
 		IndexManager im(index_buffer_id_);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, getTotalArraySize(), getIndexData(), GL_STATIC_DRAW);
+		PROFILE_COUNTER_ADD(BYTES_UPLOADED, getTotalArraySize());
 	}
 }
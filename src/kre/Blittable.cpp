@@ -32,7 +32,8 @@ namespace KRE
 		  centre_offset_(),
 		  changed_(false),
 		  horizontal_mirrored_(false),
-		  vertical_mirrored_(false)
+		  vertical_mirrored_(false),
+		  is_quad_(false)
 	{
 		init();
 	}
@@ -43,7 +44,8 @@ namespace KRE
 		  centre_offset_(),
 		  changed_(true),
 		  horizontal_mirrored_(false),
-		  vertical_mirrored_(false)
+		  vertical_mirrored_(false),
+		  is_quad_(false)
 	{
 		setTexture(tex);
 		init();
@@ -55,7 +57,8 @@ namespace KRE
 		  centre_offset_(),
 		  changed_(true),
 		  horizontal_mirrored_(false),
-		  vertical_mirrored_(false)
+		  vertical_mirrored_(false),
+		  is_quad_(false)
 	{
 		init();
 	}
@@ -85,49 +88,78 @@ namespace KRE
 				draw_rect_ = rectf(0.0f, 0.0f, static_cast<float>(getTexture()->surfaceWidth()), static_cast<float>(getTexture()->surfaceHeight()));
 			}
 
-			float offs_x = 0.0f;
-			float offs_y = 0.0f;
-			switch(centre_) {
-				case Centre::MIDDLE:		
-					offs_x = -draw_rect_.w()/2.0f;
-					offs_y = -draw_rect_.h()/2.0f;
-					break;
-				case Centre::TOP_LEFT: break;
-				case Centre::TOP_RIGHT:
-					offs_x = -draw_rect_.w();
-					offs_y = 0;
-					break;
-				case Centre::BOTTOM_LEFT:
-					offs_x = 0;
-					offs_y = -draw_rect_.h();
-					break;
-				case Centre::BOTTOM_RIGHT:
-					offs_x = -draw_rect_.w();
-					offs_y = -draw_rect_.h();
-					break;
-				case Centre::MANUAL:
-					offs_x = centre_offset_.x;
-					offs_y = centre_offset_.y;
-					break;
-			}
-
-			const float vx1 = (vertical_mirrored_ ? draw_rect_.x2() : draw_rect_.x()) + offs_x;
-			const float vy1 = (horizontal_mirrored_ ? draw_rect_.y2() : draw_rect_.y()) + offs_y;
-			const float vx2 = (vertical_mirrored_ ? draw_rect_.x() : draw_rect_.x2()) + offs_x;
-			const float vy2 = (horizontal_mirrored_ ? draw_rect_.y() : draw_rect_.y2()) + offs_y;
+			glm::vec2 v1, v2;
+			getVertexCorners(draw_rect_, &v1, &v2);
 
 			const rectf& r = getTexture()->getSourceRectNormalised();
 
 			std::vector<vertex_texcoord> vertices;
-			vertices.emplace_back(glm::vec2(vx1,vy1), glm::vec2(r.x(),r.y()));
-			vertices.emplace_back(glm::vec2(vx2,vy1), glm::vec2(r.x2(),r.y()));
-			vertices.emplace_back(glm::vec2(vx1,vy2), glm::vec2(r.x(),r.y2()));
-			vertices.emplace_back(glm::vec2(vx2,vy2), glm::vec2(r.x2(),r.y2()));
+			vertices.emplace_back(glm::vec2(v1.x,v1.y), glm::vec2(r.x(),r.y()));
+			vertices.emplace_back(glm::vec2(v2.x,v1.y), glm::vec2(r.x2(),r.y()));
+			vertices.emplace_back(glm::vec2(v1.x,v2.y), glm::vec2(r.x(),r.y2()));
+			vertices.emplace_back(glm::vec2(v2.x,v2.y), glm::vec2(r.x2(),r.y2()));
 			getAttributeSet().back()->setCount(vertices.size());
 			attribs_->update(&vertices);
+			is_quad_ = true;
 		}
 	}
 
+	void Blittable::getVertexCorners(const rectf& rect, glm::vec2* v1, glm::vec2* v2) const
+	{
+		float offs_x = 0.0f;
+		float offs_y = 0.0f;
+		switch(centre_) {
+			case Centre::MIDDLE:		
+				offs_x = -rect.w()/2.0f;
+				offs_y = -rect.h()/2.0f;
+				break;
+			case Centre::TOP_LEFT: break;
+			case Centre::TOP_RIGHT:
+				offs_x = -rect.w();
+				offs_y = 0;
+				break;
+			case Centre::BOTTOM_LEFT:
+				offs_x = 0;
+				offs_y = -rect.h();
+				break;
+			case Centre::BOTTOM_RIGHT:
+				offs_x = -rect.w();
+				offs_y = -rect.h();
+				break;
+			case Centre::MANUAL:
+				offs_x = centre_offset_.x;
+				offs_y = centre_offset_.y;
+				break;
+		}
+
+		v1->x = (vertical_mirrored_ ? rect.x2() : rect.x()) + offs_x;
+		v1->y = (horizontal_mirrored_ ? rect.y2() : rect.y()) + offs_y;
+		v2->x = (vertical_mirrored_ ? rect.x() : rect.x2()) + offs_x;
+		v2->y = (horizontal_mirrored_ ? rect.y() : rect.y2()) + offs_y;
+	}
+
+	RenderBounds Blittable::getBounds() const
+	{
+		RenderBounds bounds = SceneObject::getBounds();
+		// Vertices from update() aren't tied to the draw rect.
+		if(bounds.type != RenderBounds::Type::NONE || (!is_quad_ && attribs_->size() > 0)) {
+			return bounds;
+		}
+		rectf rect = draw_rect_;
+		if(rect.w() == 0 || rect.h() == 0) {
+			if(getTexture() == nullptr) {
+				return bounds;
+			}
+			rect = rectf(0.0f, 0.0f, static_cast<float>(getTexture()->surfaceWidth()), static_cast<float>(getTexture()->surfaceHeight()));
+		}
+		glm::vec2 v1, v2;
+		getVertexCorners(rect, &v1, &v2);
+		bounds.type = RenderBounds::Type::BOX;
+		bounds.min = glm::vec3(std::min(v1.x, v2.x), std::min(v1.y, v2.y), 0.0f);
+		bounds.max = glm::vec3(std::max(v1.x, v2.x), std::max(v1.y, v2.y), 0.0f);
+		return bounds;
+	}
+
 	void Blittable::setCentre(Centre c)
 	{
 		centre_  = c;
@@ -138,6 +170,15 @@ namespace KRE
 	void Blittable::update(std::vector<vertex_texcoord>* queue)
 	{
 		attribs_->update(queue);
+		is_quad_ = false;
+	}
+
+	const vertex_texcoord* Blittable::getQuadVertices() const
+	{
+		if(!is_quad_ || attribs_->size() != 4 || getAttributeSet().back()->getDrawMode() != DrawMode::TRIANGLE_STRIP) {
+			return nullptr;
+		}
+		return &*attribs_->begin();
 	}
 
 	void Blittable::setDrawMode(DrawMode mode)
@@ -70,11 +70,16 @@ namespace KRE
 		void setDrawMode(DrawMode mode);
 		void setMirrorHoriz(bool mirrorh) { horizontal_mirrored_ = mirrorh; changed_ = true; }
 		void setMirrorVert(bool mirrorv) { vertical_mirrored_ = mirrorv; changed_ = true; }
+		const vertex_texcoord* getQuadVertices() const override;
+		// Unless set explicitly, the bounds are the box covered by the draw rect.
+		RenderBounds getBounds() const override;
 	protected:
 		void setChanged() const { changed_ = true; }
 	private:
 		void init();
 		virtual void onTextureChanged() override { changed_ = true; }
+		// Vertex positions of the quad corners, with the centre offset applied.
+		void getVertexCorners(const rectf& r, glm::vec2* v1, glm::vec2* v2) const;
 
 		std::shared_ptr<Attribute<vertex_texcoord>> attribs_;
 		rectf draw_rect_;
@@ -83,5 +88,7 @@ namespace KRE
 		mutable bool changed_;
 		bool horizontal_mirrored_;
 		bool vertical_mirrored_;
+		// False when the vertices were set by update() rather than from the draw rect.
+		bool is_quad_;
 	};
 }
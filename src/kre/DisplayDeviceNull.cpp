@@ -0,0 +1,961 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#include "asserts.hpp"
+#include "CameraObject.hpp"
+#include "Canvas.hpp"
+#include "ClipScope.hpp"
+#include "ColorScope.hpp"
+#include "DisplayDeviceNull.hpp"
+#include "Effects.hpp"
+#include "ModelMatrixScope.hpp"
+#include "profile_timer.hpp"
+#include "RenderTarget.hpp"
+#include "Scissor.hpp"
+#include "StencilScope.hpp"
+#include "Texture.hpp"
+#include "WindowManager.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		static DisplayDeviceRegistrar<DisplayDeviceNull> null_register("null");
+
+		NullDeviceStats& current_stats()
+		{
+			static NullDeviceStats res;
+			return res;
+		}
+
+		std::vector<NullDeviceCommand>& current_commands()
+		{
+			static std::vector<NullDeviceCommand> res;
+			return res;
+		}
+
+		bool& is_recording()
+		{
+			static bool res = false;
+			return res;
+		}
+
+		void record(const NullDeviceCommand& cmd)
+		{
+			if(is_recording()) {
+				current_commands().emplace_back(cmd);
+			}
+		}
+
+		CameraPtr& get_default_camera()
+		{
+			static CameraPtr res = nullptr;
+			return res;
+		}
+
+		rect& get_current_viewport()
+		{
+			static rect res;
+			return res;
+		}
+
+		// The state the device would have bound, to count changes against.
+		const ShaderProgram*& get_current_shader()
+		{
+			static const ShaderProgram* res = nullptr;
+			return res;
+		}
+
+		const Texture*& get_current_texture()
+		{
+			static const Texture* res = nullptr;
+			return res;
+		}
+
+		const RenderTarget*& get_current_render_target()
+		{
+			static const RenderTarget* res = nullptr;
+			return res;
+		}
+
+		bool& get_current_depth_enable()
+		{
+			static bool res = false;
+			return res;
+		}
+
+		struct BlendState
+		{
+			BlendState() : enabled(true), mode(), eqn() {}
+			bool enabled;
+			BlendMode mode;
+			BlendEquation eqn;
+		};
+
+		bool operator!=(const BlendState& lhs, const BlendState& rhs)
+		{
+			return lhs.enabled != rhs.enabled || lhs.mode != rhs.mode || lhs.eqn != rhs.eqn;
+		}
+
+		BlendState& get_current_blend_state()
+		{
+			static BlendState res;
+			return res;
+		}
+
+		// Blending as the OpenGL device would leave it, settings on the value override the ones given.
+		BlendState apply_blend_state(BlendState bs, const ScopeableValue& sv)
+		{
+			if(sv.isBlendStateSet()) {
+				bs.enabled = sv.isBlendEnabled();
+			}
+			if(sv.isBlendModeSet()) {
+				bs.mode = sv.getBlendMode();
+			}
+			if(sv.isBlendEquationSet()) {
+				bs.eqn = sv.getBlendEquation();
+			}
+			return bs;
+		}
+
+		int bytes_per_pixel(PixelFormat::PF fmt)
+		{
+			switch(fmt) {
+				case PixelFormat::PF::PIXELFORMAT_INDEX1LSB:
+				case PixelFormat::PF::PIXELFORMAT_INDEX1MSB:
+				case PixelFormat::PF::PIXELFORMAT_INDEX4LSB:
+				case PixelFormat::PF::PIXELFORMAT_INDEX4MSB:
+				case PixelFormat::PF::PIXELFORMAT_INDEX8:
+				case PixelFormat::PF::PIXELFORMAT_RGB332:
+				case PixelFormat::PF::PIXELFORMAT_YV12:
+				case PixelFormat::PF::PIXELFORMAT_IYUV:
+				case PixelFormat::PF::PIXELFORMAT_R8:
+					return 1;
+				case PixelFormat::PF::PIXELFORMAT_RGB444:
+				case PixelFormat::PF::PIXELFORMAT_RGB555:
+				case PixelFormat::PF::PIXELFORMAT_BGR555:
+				case PixelFormat::PF::PIXELFORMAT_ARGB4444:
+				case PixelFormat::PF::PIXELFORMAT_RGBA4444:
+				case PixelFormat::PF::PIXELFORMAT_ABGR4444:
+				case PixelFormat::PF::PIXELFORMAT_BGRA4444:
+				case PixelFormat::PF::PIXELFORMAT_ARGB1555:
+				case PixelFormat::PF::PIXELFORMAT_RGBA5551:
+				case PixelFormat::PF::PIXELFORMAT_ABGR1555:
+				case PixelFormat::PF::PIXELFORMAT_BGRA5551:
+				case PixelFormat::PF::PIXELFORMAT_RGB565:
+				case PixelFormat::PF::PIXELFORMAT_BGR565:
+				case PixelFormat::PF::PIXELFORMAT_YUY2:
+				case PixelFormat::PF::PIXELFORMAT_UYVY:
+				case PixelFormat::PF::PIXELFORMAT_YVYU:
+					return 2;
+				case PixelFormat::PF::PIXELFORMAT_RGB24:
+				case PixelFormat::PF::PIXELFORMAT_BGR24:
+					return 3;
+				default: break;
+			}
+			return 4;
+		}
+
+		class NullHardwareAttribute : public HardwareAttributeImpl
+		{
+		public:
+			NullHardwareAttribute(AttributeBase* parent) : HardwareAttributeImpl(parent) {}
+			void update(const void* value, ptrdiff_t offset, size_t size) override {
+				current_stats().buffer_bytes_uploaded += size;
+				HardwareAttributeImpl::update(value, offset, size);
+			}
+			HardwareAttributePtr create(AttributeBase* parent) override {
+				return std::make_shared<NullHardwareAttribute>(parent);
+			}
+		};
+
+		class NullAttributeSet : public AttributeSet
+		{
+		public:
+			NullAttributeSet(bool indexed, bool instanced) : AttributeSet(indexed, instanced) {}
+			bool isHardwareBacked() const override { return true; }
+			AttributeSetPtr clone() override {
+				return std::make_shared<NullAttributeSet>(*this);
+			}
+		private:
+			void handleIndexUpdate() override {
+				current_stats().buffer_bytes_uploaded += getTotalArraySize();
+			}
+		};
+
+		unsigned& next_texture_id()
+		{
+			static unsigned res = 1;
+			return res;
+		}
+
+		class NullTexture : public Texture
+		{
+		public:
+			explicit NullTexture(const variant& node, const std::vector<SurfacePtr>& surfaces)
+				: Texture(node, surfaces)
+			{
+				create();
+			}
+			explicit NullTexture(const std::vector<SurfacePtr>& surfaces, TextureType type, int mipmap_levels)
+				: Texture(surfaces, type, mipmap_levels)
+			{
+				create();
+			}
+			explicit NullTexture(int count, int width, int height, int depth, PixelFormat::PF fmt, TextureType type)
+				: Texture(count, width, height, depth, fmt, type)
+			{
+				create();
+			}
+			NullTexture(const NullTexture& other)
+				: Texture(other),
+				  ids_(other.ids_),
+				  bytes_per_pixel_(other.bytes_per_pixel_)
+			{
+			}
+
+			void init(int n) override {
+				auto surf = getSurface(n);
+				if(surf != nullptr) {
+					current_stats().texture_bytes_uploaded += surf->height() * surf->rowPitch();
+				}
+			}
+			void bind(int binding_point) override {
+				if(get_current_texture() != this) {
+					++current_stats().state_changes.texture;
+					get_current_texture() = this;
+				}
+			}
+			unsigned id(int n) const override { return ids_[n]; }
+
+			void update(int n, int x, int width, void* pixels) override {
+				uploaded(n, width);
+			}
+			void update(int n, int x, int y, int width, int height, const void* pixels) override {
+				uploaded(n, width * height);
+			}
+			void update2D(int n, int x, int y, int width, int height, int stride, const void* pixels) override {
+				uploaded(n, width * height);
+			}
+			void updateYUV(int x, int y, int width, int height, const std::vector<int>& stride, const std::vector<void*>& pixels) override {
+				for(int n = 0; n != static_cast<int>(stride.size()); ++n) {
+					current_stats().texture_bytes_uploaded += stride[n] * (n == 0 ? height : height / 2);
+				}
+			}
+			void update(int n, int x, int y, int z, int width, int height, int depth, void* pixels) override {
+				uploaded(n, width * height * depth);
+			}
+
+			// Nothing is ever drawn into a texture, so this is a blank surface of the right size.
+			SurfacePtr extractTextureToSurface(int n) const override {
+				return Surface::create(actualWidth(n), actualHeight(n), PixelFormat::PF::PIXELFORMAT_ARGB8888);
+			}
+
+			const unsigned char* colorAt(int x, int y) const override { return nullptr; }
+
+			TexturePtr clone() override {
+				return std::make_shared<NullTexture>(*this);
+			}
+		private:
+			void create() {
+				for(int n = 0; n != getTextureCount(); ++n) {
+					ids_.emplace_back(next_texture_id()++);
+					auto surf = getSurface(n);
+					bytes_per_pixel_.emplace_back(surf != nullptr ? surf->bytesPerPixel() : bytes_per_pixel(getPixelFormat(n)));
+					init(n);
+				}
+				clearSurfaces();
+			}
+			void uploaded(int n, int pixels) {
+				current_stats().texture_bytes_uploaded += pixels * bytes_per_pixel_[n];
+			}
+			void rebuild() override {}
+			void handleAddPalette(int index, const SurfacePtr& palette) override {}
+			void handleSurfaceLoaded(int n) override {
+				bytes_per_pixel_[n] = getSurface(n)->bytesPerPixel();
+				init(n);
+				clearSurfaces();
+			}
+
+			std::vector<unsigned> ids_;
+			std::vector<int> bytes_per_pixel_;
+		};
+
+		class NullRenderTarget : public RenderTarget
+		{
+		public:
+			explicit NullRenderTarget(int width, int height, int color_plane_count, bool depth, bool stencil, bool use_multi_sampling, int multi_samples)
+				: RenderTarget(width, height, color_plane_count, depth, stencil, use_multi_sampling, multi_samples)
+			{
+				on_create();
+			}
+			explicit NullRenderTarget(const variant& node)
+				: RenderTarget(node)
+			{
+				on_create();
+			}
+			NullRenderTarget(const NullRenderTarget& other)
+				: RenderTarget(other)
+			{
+			}
+		private:
+			void handleCreate() override {
+				setTexture(Texture::createTextureArray(getColorPlanes(), width(), height(), PixelFormat::PF::PIXELFORMAT_RGBA8888, TextureType::TEXTURE_2D));
+			}
+			void handleApply(const rect& r) const override {
+				if(get_current_render_target() != this) {
+					++current_stats().state_changes.render_target;
+					get_current_render_target() = this;
+				}
+			}
+			void handleUnapply() const override {
+				if(get_current_render_target() != nullptr) {
+					++current_stats().state_changes.render_target;
+					get_current_render_target() = nullptr;
+				}
+			}
+			void handleClear() const override {
+				++current_stats().clears;
+				record(NullDeviceCommand(NullDeviceCommand::Type::CLEAR));
+			}
+			void handleSizeChange(int width, int height) override {
+				handleCreate();
+			}
+			RenderTargetPtr handleClone() override {
+				return std::make_shared<NullRenderTarget>(*this);
+			}
+			std::vector<uint8_t> handleReadPixels() const override {
+				record(NullDeviceCommand(NullDeviceCommand::Type::READ_PIXELS));
+				return std::vector<uint8_t>(width() * height() * 4);
+			}
+			SurfacePtr handleReadToSurface(SurfacePtr s) const override {
+				record(NullDeviceCommand(NullDeviceCommand::Type::READ_PIXELS));
+				if(s == nullptr) {
+					s = Surface::create(width(), height(), PixelFormat::PF::PIXELFORMAT_ARGB8888);
+				}
+				return s;
+			}
+		};
+
+		class NullShaderProgram : public ShaderProgram
+		{
+		public:
+			enum {
+				COLOR_UNIFORM,
+				LINE_WIDTH_UNIFORM,
+				MV_UNIFORM,
+				P_UNIFORM,
+				MVP_UNIFORM,
+				TEX_MAP_UNIFORM,
+				DISCARD_UNIFORM,
+			};
+			enum {
+				COLOR_ATTRIBUTE,
+				VERTEX_ATTRIBUTE,
+				TEXCOORD_ATTRIBUTE,
+				NORMAL_ATTRIBUTE,
+			};
+			NullShaderProgram(const std::string& name, const variant& node) : ShaderProgram(name, node) {}
+
+			void makeActive() override {
+				if(get_current_shader() != this) {
+					++current_stats().state_changes.shader;
+					get_current_shader() = this;
+				}
+			}
+			void applyAttribute(AttributeBasePtr attr) override {}
+			void cleanUpAfterDraw() override {}
+
+			int getAttributeOrDie(const std::string& attr) const override { return getAttribute(attr); }
+			int getUniformOrDie(const std::string& attr) const override { return getUniform(attr); }
+			// Any name is valid, each one gets its own location.
+			int getAttribute(const std::string& attr) const override { return lookup(&attributes_, attr); }
+			int getUniform(const std::string& attr) const override { return lookup(&uniforms_, attr); }
+
+			std::vector<std::string> getAllUniforms() const override {
+				std::vector<std::string> res;
+				for(auto& u : uniforms_) {
+					res.emplace_back(u.first);
+				}
+				return res;
+			}
+
+			void setUniformMapping(const std::vector<std::pair<std::string, std::string>>& mapping) override {}
+			void setAttributeMapping(const std::vector<std::pair<std::string, std::string>>& mapping) override {}
+
+			void setUniformValue(int uid, const int) const override {}
+			void setUniformValue(int uid, const float) const override {}
+			void setUniformValue(int uid, const float*) const override {}
+			void setUniformValue(int uid, const int*) const override {}
+			void setUniformValue(int uid, const void*) const override {}
+			void setUniformFromVariant(int uid, const variant& value) const override {}
+
+			void setAttributeValue(int aid, const int) const override {}
+			void setAttributeValue(int aid, const float) const override {}
+			void setAttributeValue(int aid, const float*) const override {}
+			void setAttributeValue(int aid, const int*) const override {}
+			void setAttributeValue(int aid, const void*) const override {}
+			void setAttributeValue(int aid, const unsigned char*) const override {}
+			void setAttributeFromVariant(int uid, const variant& value) const override {}
+
+			void configureActives(AttributeSetPtr attrset) override {}
+			void configureAttribute(AttributeBasePtr attr) override {}
+			void configureUniforms(UniformBufferBase& uniforms) override {}
+
+			int getColorUniform() const override { return COLOR_UNIFORM; }
+			int getLineWidthUniform() const override { return LINE_WIDTH_UNIFORM; }
+			int getMvUniform() const override { return MV_UNIFORM; }
+			int getPUniform() const override { return P_UNIFORM; }
+			int getMvpUniform() const override { return MVP_UNIFORM; }
+			int getTexMapUniform() const override { return TEX_MAP_UNIFORM; }
+			int getDiscardUniform() const override { return DISCARD_UNIFORM; }
+
+			int getColorAttribute() const override { return COLOR_ATTRIBUTE; }
+			int getVertexAttribute() const override { return VERTEX_ATTRIBUTE; }
+			int getTexcoordAttribute() const override { return TEXCOORD_ATTRIBUTE; }
+			int getNormalAttribute() const override { return NORMAL_ATTRIBUTE; }
+
+			void setUniformsForTexture(const TexturePtr& tex) const override {
+				if(tex) {
+					tex->bind();
+				}
+			}
+
+			ShaderProgramPtr clone() override {
+				return std::make_shared<NullShaderProgram>(*this);
+			}
+		private:
+			static int lookup(std::map<std::string, int>* actives, const std::string& name) {
+				auto it = actives->find(name);
+				if(it == actives->end()) {
+					it = actives->emplace(name, static_cast<int>(actives->size())).first;
+				}
+				return it->second;
+			}
+			mutable std::map<std::string, int> uniforms_;
+			mutable std::map<std::string, int> attributes_;
+		};
+
+		std::map<std::string, ShaderProgramPtr>& get_shader_factory()
+		{
+			static std::map<std::string, ShaderProgramPtr> res;
+			return res;
+		}
+
+		ShaderProgramPtr get_shader(const std::string& name, const variant& node)
+		{
+			auto& sf = get_shader_factory();
+			auto it = sf.find(name);
+			if(it == sf.end()) {
+				it = sf.emplace(name, std::make_shared<NullShaderProgram>(name, node)).first;
+			}
+			return it->second;
+		}
+
+		class NullCanvas : public Canvas
+		{
+		public:
+			NullCanvas() {}
+			void blitTexture(const TexturePtr& tex, const rect& src, float rotation, const rect& dst, const Color& color, CanvasBlitFlags flags) const override { draw(tex, 4); }
+			void blitTexture(const TexturePtr& tex, const std::vector<vertex_texcoord>& vtc, float rotation, const Color& color) override { draw(tex, vtc.size()); }
+			void drawSolidRect(const rect& r, const Color& fill_color, const Color& stroke_color, float rotate) const override { draw(nullptr, 8); }
+			void drawSolidRect(const rect& r, const Color& fill_color, float rotate) const override { draw(nullptr, 4); }
+			void drawHollowRect(const rect& r, const Color& stroke_color, float rotate) const override { draw(nullptr, 4); }
+			void drawLine(const point& p1, const point& p2, const Color& color) const override { draw(nullptr, 2); }
+			void drawLines(const std::vector<glm::vec2>& varray, float line_width, const Color& color) const override { draw(nullptr, varray.size()); }
+			void drawLines(const std::vector<glm::vec2>& varray, float line_width, const std::vector<glm::u8vec4>& carray) const override { draw(nullptr, varray.size()); }
+			void drawLineStrip(const std::vector<glm::vec2>& points, float line_width, const Color& color) const override { draw(nullptr, points.size()); }
+			void drawLineLoop(const std::vector<glm::vec2>& varray, float line_width, const Color& color) const override { draw(nullptr, varray.size()); }
+			void drawLine(const pointf& p1, const pointf& p2, const Color& color) const override { draw(nullptr, 2); }
+			void drawPolygon(const std::vector<glm::vec2>& points, const Color& color) const override { draw(nullptr, points.size()); }
+			void drawSolidCircle(const point& centre, float radius, const Color& color) const override { draw(nullptr, 0); }
+			void drawSolidCircle(const point& centre, float radius, const std::vector<glm::u8vec4>& color) const override { draw(nullptr, 0); }
+			void drawSolidCircle(const pointf& centre, float radius, const Color& color) const override { draw(nullptr, 0); }
+			void drawSolidCircle(const pointf& centre, float radius, const std::vector<glm::u8vec4>& color) const override { draw(nullptr, 0); }
+			void drawHollowCircle(const point& centre, float outer_radius, float inner_radius, const Color& color) const override { draw(nullptr, 0); }
+			void drawHollowCircle(const pointf& centre, float outer_radius, float inner_radius, const Color& color) const override { draw(nullptr, 0); }
+			void drawPoints(const std::vector<glm::vec2>& points, float radius, const Color& color) const override { draw(nullptr, points.size()); }
+		private:
+			DISALLOW_COPY_AND_ASSIGN(NullCanvas);
+			void handleDimensionsChanged() override {}
+			void draw(const TexturePtr& tex, size_t count) const {
+				++current_stats().canvas_draws;
+				current_stats().vertices += static_cast<int>(count);
+				NullDeviceCommand cmd(NullDeviceCommand::Type::CANVAS_DRAW);
+				cmd.shader = getCurrentShader().get();
+				cmd.texture = tex.get();
+				cmd.render_target = get_current_render_target();
+				cmd.count = static_cast<int>(count);
+				record(cmd);
+			}
+		};
+
+		class NullClipScope : public ClipScope
+		{
+		public:
+			explicit NullClipScope(const rect& r) : ClipScope(r) {}
+			void apply(const CameraPtr& cam) const override {}
+			void clear() const override {}
+		};
+
+		class NullClipShapeScope : public ClipShapeScope
+		{
+		public:
+			explicit NullClipShapeScope(const RenderablePtr& r) : ClipShapeScope(r) {}
+			void apply(const CameraPtr& cam) const override {
+				// The shape still gets drawn into the stencil buffer.
+				DisplayDevice::getCurrent()->render(getRenderable().get());
+			}
+			void clear() const override {}
+		};
+
+		class NullStencilScope : public StencilScope
+		{
+		public:
+			explicit NullStencilScope(const StencilSettings& settings) : StencilScope(settings) {}
+		private:
+			void handleUpdatedMask() override {}
+			void handleUpdatedSettings() override {}
+		};
+
+		class NullScissor : public Scissor
+		{
+		public:
+			explicit NullScissor(const rect& area) : Scissor(area) {}
+			void apply() override {}
+			void clear() override {}
+		};
+
+		class NullBlendEquationImpl : public BlendEquationImplBase
+		{
+		public:
+			void apply(const BlendEquation& eqn) const override {}
+			void clear(const BlendEquation& eqn) const override {}
+		};
+	}
+
+	std::ostream& operator<<(std::ostream& os, const NullDeviceStats& stats)
+	{
+		os << "draws: " << stats.draws
+			<< ", vertices: " << stats.vertices
+			<< ", clears: " << stats.clears
+			<< ", canvas draws: " << stats.canvas_draws
+			<< ", state changes: " << stats.state_changes.total()
+			<< " (render target: " << stats.state_changes.render_target
+			<< ", shader: " << stats.state_changes.shader
+			<< ", texture: " << stats.state_changes.texture
+			<< ", blend: " << stats.state_changes.blend
+			<< ", depth: " << stats.state_changes.depth << ")"
+			<< ", buffer bytes: " << stats.buffer_bytes_uploaded
+			<< ", texture bytes: " << stats.texture_bytes_uploaded;
+		return os;
+	}
+
+	DisplayDeviceNull::DisplayDeviceNull(WindowPtr wnd)
+		: DisplayDevice(wnd),
+		  frame_stats_(),
+		  frame_commands_(),
+		  frame_count_(0)
+	{
+	}
+
+	DisplayDeviceNull::~DisplayDeviceNull()
+	{
+	}
+
+	void DisplayDeviceNull::init(int width, int height)
+	{
+		get_current_viewport() = rect(0, 0, width, height);
+		// Matches the initial state of the OpenGL device.
+		get_current_blend_state() = BlendState();
+		get_current_depth_enable() = false;
+		get_shader_factory().clear();
+		get_shader("default", variant());
+	}
+
+	void DisplayDeviceNull::printDeviceInfo()
+	{
+		LOG_INFO("Null display device, nothing will be drawn.");
+	}
+
+	int DisplayDeviceNull::queryParameteri(DisplayDeviceParameters param)
+	{
+		switch (param)
+		{
+		case DisplayDeviceParameters::MAX_TEXTURE_UNITS:	return 16;
+		default: break;
+		}
+		ASSERT_LOG(false, "Invalid Parameter requested: " << static_cast<int>(param));
+		return -1;
+	}
+
+	void DisplayDeviceNull::setRecording(bool en)
+	{
+		is_recording() = en;
+		if(!en) {
+			current_commands().clear();
+		}
+	}
+
+	bool DisplayDeviceNull::isRecording() const
+	{
+		return is_recording();
+	}
+
+	void DisplayDeviceNull::clearTextures()
+	{
+	}
+
+	void DisplayDeviceNull::clear(ClearFlags clr)
+	{
+		++current_stats().clears;
+		record(NullDeviceCommand(NullDeviceCommand::Type::CLEAR));
+	}
+
+	void DisplayDeviceNull::setClearColor(float r, float g, float b, float a) const
+	{
+	}
+
+	void DisplayDeviceNull::setClearColor(const Color& color) const
+	{
+	}
+
+	void DisplayDeviceNull::swap()
+	{
+		frame_stats_ = current_stats();
+		current_stats() = NullDeviceStats();
+		frame_commands_.swap(current_commands());
+		current_commands().clear();
+		++frame_count_;
+	}
+
+	ShaderProgramPtr DisplayDeviceNull::getDefaultShader()
+	{
+		return get_shader("default", variant());
+	}
+
+	CameraPtr DisplayDeviceNull::setDefaultCamera(const CameraPtr& cam)
+	{
+		auto old_cam = get_default_camera();
+		get_default_camera() = cam;
+		return old_cam;
+	}
+
+	CameraPtr DisplayDeviceNull::getDefaultCamera() const
+	{
+		return get_default_camera();
+	}
+
+	// Follows the same steps as DisplayDeviceOpenGL::render() so the CPU side costs are comparable.
+	void DisplayDeviceNull::render(const Renderable* r) const
+	{
+		if(!r->isEnabled()) {
+			return;
+		}
+
+		if(r->hasClipSettings()) {
+			render(r->getStencilMask().get());
+		}
+
+		auto shader = r->getShader();
+		shader->makeActive();
+
+		const BlendState renderable_blend = apply_blend_state(BlendState(), *r);
+
+		const bool depth_enable = r->isDepthEnableStateSet() && r->isDepthEnabled();
+		if(get_current_depth_enable() != depth_enable) {
+			++current_stats().state_changes.depth;
+			get_current_depth_enable() = depth_enable;
+		}
+
+		glm::mat4 pmat(1.0f);
+		glm::mat4 vmat(1.0f);
+		if(r->getCamera()) {
+			pmat = r->getCamera()->getProjectionMat();
+			vmat = r->getCamera()->getViewMat();
+		} else if(get_default_camera() != nullptr) {
+			pmat = get_default_camera()->getProjectionMat();
+			vmat = get_default_camera()->getViewMat();
+		}
+
+		if(r->getRenderTarget()) {
+			r->getRenderTarget()->apply();
+		}
+
+		glm::mat4 pvmat(1.0f);
+		if(is_global_model_matrix_valid() && !r->ignoreGlobalModelMatrix()) {
+			pvmat = pmat * vmat * get_global_model_matrix() * r->getModelMatrix();
+		} else {
+			pvmat = pmat * vmat * r->getModelMatrix();
+		}
+		shader->setUniformValue(shader->getMvpUniform(), glm::value_ptr(pvmat));
+
+		if(r->isColorSet()) {
+			shader->setUniformValue(shader->getColorUniform(), r->getColor().asFloatVector());
+		} else {
+			shader->setUniformValue(shader->getColorUniform(), ColorScope::getCurrentColor().asFloatVector());
+		}
+
+		shader->setUniformsForTexture(r->getTexture());
+
+		auto uniform_draw_fn = shader->getUniformDrawFunction();
+		if(uniform_draw_fn) {
+			uniform_draw_fn(shader);
+		}
+
+		for(auto& as : r->getAttributeSet()) {
+			if(!as->isEnabled()) {
+				continue;
+			}
+			const int count = static_cast<int>(as->isMultiDrawEnabled() ? as->getMultiDrawCount() : as->getCount());
+			if(count <= 0) {
+				continue;
+			}
+
+			const BlendState blend = apply_blend_state(renderable_blend, *as);
+			if(get_current_blend_state() != blend) {
+				++current_stats().state_changes.blend;
+				get_current_blend_state() = blend;
+			}
+
+			// Client side arrays get copied to the GPU for every draw.
+			if(!as->isHardwareBacked()) {
+				for(auto& attr : as->getAttributes()) {
+					if(attr->isEnabled() && !attr->getAttrDesc().empty()) {
+						current_stats().buffer_bytes_uploaded += count * attr->getAttrDesc().front().getStride();
+					}
+				}
+				if(as->isIndexed()) {
+					current_stats().buffer_bytes_uploaded += as->getTotalArraySize();
+				}
+			}
+
+			NullDeviceCommand cmd(NullDeviceCommand::Type::DRAW);
+			cmd.shader = shader.get();
+			cmd.texture = r->getTexture().get();
+			cmd.render_target = get_current_render_target();
+			cmd.draw_mode = as->getDrawMode();
+			cmd.count = count;
+			cmd.instances = as->isInstanced() ? as->getInstanceCount() : 1;
+			record(cmd);
+
+			++current_stats().draws;
+			PROFILE_COUNTER_ADD(DRAW_CALLS, 1);
+			current_stats().vertices += cmd.count * cmd.instances;
+		}
+
+		if(r->getRenderTarget()) {
+			r->getRenderTarget()->unapply();
+		}
+	}
+
+	ScissorPtr DisplayDeviceNull::getScissor(const rect& r)
+	{
+		return ScissorPtr(new NullScissor(r));
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTexture(const SurfacePtr& surface, const variant& node)
+	{
+		std::vector<SurfacePtr> surfaces;
+		if(surface != nullptr) {
+			surfaces.emplace_back(surface);
+		}
+		return std::make_shared<NullTexture>(node, surfaces);
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTexture(const SurfacePtr& surface, TextureType type, int mipmap_levels)
+	{
+		std::vector<SurfacePtr> surfaces(1, surface);
+		return std::make_shared<NullTexture>(surfaces, type, mipmap_levels);
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTexture1D(int width, PixelFormat::PF fmt)
+	{
+		return std::make_shared<NullTexture>(1, width, 0, 0, fmt, TextureType::TEXTURE_1D);
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTexture2D(int width, int height, PixelFormat::PF fmt)
+	{
+		const int count = fmt == PixelFormat::PF::PIXELFORMAT_YV12 ? 3 : 1;
+		return std::make_shared<NullTexture>(count, width, height, 0, fmt, TextureType::TEXTURE_2D);
+	}
+	
+	TexturePtr DisplayDeviceNull::handleCreateTexture3D(int width, int height, int depth, PixelFormat::PF fmt)
+	{
+		return std::make_shared<NullTexture>(1, width, height, depth, fmt, TextureType::TEXTURE_3D);
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTextureArray(int count, int width, int height, PixelFormat::PF fmt, TextureType type)
+	{
+		return std::make_shared<NullTexture>(count, width, height, 0, fmt, type);
+	}
+
+	TexturePtr DisplayDeviceNull::handleCreateTextureArray(const std::vector<SurfacePtr>& surfaces, const variant& node)
+	{
+		return std::make_shared<NullTexture>(node, surfaces);
+	}
+
+	RenderTargetPtr DisplayDeviceNull::handleCreateRenderTarget(int width, int height, 
+			int color_plane_count, 
+			bool depth, 
+			bool stencil, 
+			bool use_multi_sampling, 
+			int multi_samples)
+	{
+		return std::make_shared<NullRenderTarget>(width, height, color_plane_count, depth, stencil, use_multi_sampling, multi_samples);
+	}
+
+	RenderTargetPtr DisplayDeviceNull::handleCreateRenderTarget(const variant& node)
+	{
+		return std::make_shared<NullRenderTarget>(node);
+	}
+
+	AttributeSetPtr DisplayDeviceNull::handleCreateAttributeSet(bool indexed, bool instanced)
+	{
+		return std::make_shared<NullAttributeSet>(indexed, instanced);
+	}
+
+	HardwareAttributePtr DisplayDeviceNull::handleCreateAttribute(AttributeBase* parent)
+	{
+		return std::make_shared<NullHardwareAttribute>(parent);
+	}
+
+	CanvasPtr DisplayDeviceNull::getCanvas()
+	{
+		static CanvasPtr res = CanvasPtr(new NullCanvas());
+		return res;
+	}
+
+	ClipScopePtr DisplayDeviceNull::createClipScope(const rect& r)
+	{
+		return ClipScopePtr(new NullClipScope(r));
+	}
+
+	ClipShapeScopePtr DisplayDeviceNull::createClipShapeScope(const RenderablePtr& r)
+	{
+		return ClipShapeScopePtr(new NullClipShapeScope(r));
+	}
+
+	StencilScopePtr DisplayDeviceNull::createStencilScope(const StencilSettings& settings)
+	{
+		return StencilScopePtr(new NullStencilScope(settings));
+	}
+
+	BlendEquationImplBasePtr DisplayDeviceNull::getBlendEquationImpl()
+	{
+		return BlendEquationImplBasePtr(new NullBlendEquationImpl());
+	}
+
+	void DisplayDeviceNull::setViewPort(int x, int y, int width, int height)
+	{
+		setViewPort(rect(x, y, width, height));
+	}
+
+	void DisplayDeviceNull::setViewPort(const rect& vp)
+	{
+		if(get_current_viewport() != vp && vp.w() != 0 && vp.h() != 0) {
+			get_current_viewport() = vp;
+			record(NullDeviceCommand(NullDeviceCommand::Type::SET_VIEWPORT));
+		}
+	}
+
+	const rect& DisplayDeviceNull::getViewPort() const 
+	{
+		return get_current_viewport();
+	}
+	
+	bool DisplayDeviceNull::doCheckForFeature(DisplayDeviceCapabilties cap)
+	{
+		switch(cap) {
+		case DisplayDeviceCapabilties::NPOT_TEXTURES:
+		case DisplayDeviceCapabilties::BLEND_EQUATION_SEPERATE:
+		case DisplayDeviceCapabilties::RENDER_TO_TEXTURE:
+		case DisplayDeviceCapabilties::SHADERS:
+			return true;
+		case DisplayDeviceCapabilties::UNIFORM_BUFFERS:
+			return false;
+		}
+		return false;
+	}
+
+	void DisplayDeviceNull::loadShadersFromVariant(const variant& node) 
+	{
+		if(node.has_key("instances") && node["instances"].is_list()) {
+			for(auto instance : node["instances"].as_list()) {
+				getShaderProgram(instance);
+			}
+		} else {
+			getShaderProgram(node);
+		}
+	}
+
+	ShaderProgramPtr DisplayDeviceNull::getShaderProgram(const std::string& name)
+	{
+		return get_shader(name, variant());
+	}
+
+	ShaderProgramPtr DisplayDeviceNull::getShaderProgram(const variant& node)
+	{
+		if(node.is_string()) {
+			return get_shader(node.as_string(), variant());
+		}
+		ASSERT_LOG(node.has_key("name"), "Shader definitions need a 'name' attribute: " << node.to_debug_string());
+		return get_shader(node["name"].as_string(), node);
+	}
+
+	ShaderProgramPtr DisplayDeviceNull::createShader(const std::string& name, 
+		const std::vector<ShaderData>& shader_data, 
+		const std::vector<ActiveMapping>& uniform_map,
+		const std::vector<ActiveMapping>& attribute_map)
+	{
+		return get_shader(name, variant());
+	}
+
+	ShaderProgramPtr DisplayDeviceNull::createGaussianShader(int radius) 
+	{
+		std::stringstream ss;
+		ss << "gaussian_" << radius;
+		return get_shader(ss.str(), variant());
+	}
+
+	void DisplayDeviceNull::doBlitTexture(const TexturePtr& tex, int dstx, int dsty, int dstw, int dsth, float rotation, int srcx, int srcy, int srcw, int srch)
+	{
+		ASSERT_LOG(false, "DisplayDevice::doBlitTexture deprecated");
+	}
+
+	bool DisplayDeviceNull::handleReadPixels(int x, int y, unsigned width, unsigned height, ReadFormat fmt, AttrFormat type, void* data, int stride)
+	{
+		record(NullDeviceCommand(NullDeviceCommand::Type::READ_PIXELS));
+		std::memset(data, 0, height * stride);
+		return true;
+	}
+
+	EffectPtr DisplayDeviceNull::createEffect(const variant& node)
+	{
+		return EffectPtr();
+	}
+}
@@ -0,0 +1,185 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "AttributeSet.hpp"
+#include "DisplayDevice.hpp"
+#include "RenderQueue.hpp"
+
+namespace KRE
+{
+	struct NullDeviceCommand
+	{
+		enum class Type {
+			CLEAR,
+			DRAW,
+			CANVAS_DRAW,
+			SET_VIEWPORT,
+			READ_PIXELS,
+		};
+		explicit NullDeviceCommand(Type t) 
+			: type(t), 
+			  shader(nullptr), 
+			  texture(nullptr), 
+			  render_target(nullptr), 
+			  draw_mode(DrawMode::TRIANGLES), 
+			  count(0), 
+			  instances(1) 
+		{
+		}
+		Type type;
+		// Only for telling state apart, these aren't guaranteed to be valid after the frame.
+		const ShaderProgram* shader;
+		const Texture* texture;
+		const RenderTarget* render_target;
+		DrawMode draw_mode;
+		// Number of vertices or indices drawn.
+		int count;
+		int instances;
+	};
+
+	struct NullDeviceStats
+	{
+		NullDeviceStats() 
+			: draws(0), 
+			  vertices(0), 
+			  clears(0), 
+			  canvas_draws(0), 
+			  state_changes(), 
+			  buffer_bytes_uploaded(0), 
+			  texture_bytes_uploaded(0) 
+		{
+		}
+		int draws;
+		int vertices;
+		int clears;
+		int canvas_draws;
+		StateChangeCounts state_changes;
+		// Bytes written to attribute buffers, including client side arrays read at draw time.
+		size_t buffer_bytes_uploaded;
+		size_t texture_bytes_uploaded;
+	};
+
+	std::ostream& operator<<(std::ostream& os, const NullDeviceStats& stats);
+
+	// A display device that draws nothing. Textures, shaders, attribute buffers and render 
+	// targets are plain CPU objects and everything sent to the device is counted, and 
+	// optionally recorded, per frame. Frames end at swap(). Lets the render path be timed
+	// and checked on machines without a GPU, use "null" as the renderer hint.
+	class DisplayDeviceNull : public DisplayDevice
+	{
+	public:
+		explicit DisplayDeviceNull(WindowPtr wnd);
+		~DisplayDeviceNull();
+
+		DisplayDeviceId ID() const override { return DISPLAY_DEVICE_NULL; }
+
+		void swap() override;
+		void clear(ClearFlags clr) override;
+
+		void setClearColor(float r, float g, float b, float a) const override;
+		void setClearColor(const Color& color) const override;
+
+		void render(const Renderable* r) const override;
+
+		CameraPtr setDefaultCamera(const CameraPtr& cam) override;
+		CameraPtr getDefaultCamera() const override;
+
+		CanvasPtr getCanvas() override;
+		ClipScopePtr createClipScope(const rect& r) override;
+		ClipShapeScopePtr createClipShapeScope(const RenderablePtr& r) override;
+		StencilScopePtr createStencilScope(const StencilSettings& settings) override;
+		ScissorPtr getScissor(const rect& r) override;
+
+		void clearTextures() override;
+
+		EffectPtr createEffect(const variant& node) override;
+
+		void loadShadersFromVariant(const variant& node) override;
+		ShaderProgramPtr getShaderProgram(const std::string& name) override;
+		ShaderProgramPtr getShaderProgram(const variant& node) override;
+		ShaderProgramPtr getDefaultShader() override;
+		ShaderProgramPtr createShader(const std::string& name, 
+			const std::vector<ShaderData>& shader_data, 
+			const std::vector<ActiveMapping>& uniform_map,
+			const std::vector<ActiveMapping>& attribute_map) override;
+		ShaderProgramPtr createGaussianShader(int radius) override;
+
+		BlendEquationImplBasePtr getBlendEquationImpl() override;
+
+		void init(int width, int height) override;
+		void printDeviceInfo() override;
+
+		int queryParameteri(DisplayDeviceParameters param) override;
+
+		void setViewPort(const rect& vp) override;
+		void setViewPort(int x, int y, int width, int height) override;
+		const rect& getViewPort() const override;
+
+		// Statistics and commands of the last complete frame.
+		const NullDeviceStats& getFrameStats() const { return frame_stats_; }
+		const std::vector<NullDeviceCommand>& getFrameCommands() const { return frame_commands_; }
+		int getFrameCount() const { return frame_count_; }
+
+		// Commands are only kept while recording, statistics always are.
+		void setRecording(bool en);
+		bool isRecording() const;
+	private:
+		DisplayDeviceNull();
+		DisplayDeviceNull(const DisplayDeviceNull&);
+
+		AttributeSetPtr handleCreateAttributeSet(bool indexed, bool instanced) override;
+		HardwareAttributePtr handleCreateAttribute(AttributeBase* parent) override;
+
+		RenderTargetPtr handleCreateRenderTarget(int width, int height, 
+			int color_plane_count, 
+			bool depth, 
+			bool stencil, 
+			bool use_multi_sampling, 
+			int multi_samples) override;
+		RenderTargetPtr handleCreateRenderTarget(const variant& node) override;
+		void doBlitTexture(const TexturePtr& tex, int dstx, int dsty, int dstw, int dsth, float rotation, int srcx, int srcy, int srcw, int srch) override;
+
+		bool doCheckForFeature(DisplayDeviceCapabilties cap) override;
+
+		TexturePtr handleCreateTexture(const SurfacePtr& surface, TextureType type, int mipmap_levels) override;
+		TexturePtr handleCreateTexture(const SurfacePtr& surface, const variant& node) override;
+
+		TexturePtr handleCreateTexture1D(int width, PixelFormat::PF fmt) override;
+		TexturePtr handleCreateTexture2D(int width, int height, PixelFormat::PF fmt) override;
+		TexturePtr handleCreateTexture3D(int width, int height, int depth, PixelFormat::PF fmt) override;
+
+		TexturePtr handleCreateTextureArray(int count, int width, int height, PixelFormat::PF fmt, TextureType type) override;
+		TexturePtr handleCreateTextureArray(const std::vector<SurfacePtr>& surfaces, const variant& node) override;
+
+		bool handleReadPixels(int x, int y, unsigned width, unsigned height, ReadFormat fmt, AttrFormat type, void* data, int stride) override;
+
+		NullDeviceStats frame_stats_;
+		std::vector<NullDeviceCommand> frame_commands_;
+		int frame_count_;
+	};
+}
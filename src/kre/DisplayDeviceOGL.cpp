@@ -41,6 +41,7 @@
 #include "FboOGL.hpp"
 #include "LightObject.hpp"
 #include "ModelMatrixScope.hpp"
+#include "profile_timer.hpp"
 #include "ScissorOGL.hpp"
 #include "ShadersOGL.hpp"
 #include "StencilScopeOGL.hpp"
@@ -429,6 +430,7 @@ namespace KRE
 				}
 			}
 
+			PROFILE_COUNTER_ADD(DRAW_CALLS, 1);
 			if(as->isInstanced()) {
 				if(as->isIndexed()) {
 					as->bindIndex();
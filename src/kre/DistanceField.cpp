@@ -0,0 +1,139 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "asserts.hpp"
+#include "DistanceField.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		const float edt_infinity = 1e20f;
+
+		// Exact 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher), reads n
+		// values of f and writes d. v and z are scratch space for n and n+1 values.
+		void distance_transform_1d(const float* f, float* d, int n, int* v, float* z)
+		{
+			int k = 0;
+			v[0] = 0;
+			z[0] = -edt_infinity;
+			z[1] = edt_infinity;
+			for(int q = 1; q < n; ++q) {
+				// Finite values are far smaller than edt_infinity so s never drops to z[0].
+				float s;
+				for(;;) {
+					const int r = v[k];
+					s = ((f[q] + static_cast<float>(q * q)) - (f[r] + static_cast<float>(r * r))) / static_cast<float>(2 * (q - r));
+					if(s > z[k]) {
+						break;
+					}
+					--k;
+				}
+				++k;
+				v[k] = q;
+				z[k] = s;
+				z[k + 1] = edt_infinity;
+			}
+			k = 0;
+			for(int q = 0; q < n; ++q) {
+				while(z[k + 1] < static_cast<float>(q)) {
+					++k;
+				}
+				const int r = v[k];
+				d[q] = static_cast<float>((q - r) * (q - r)) + f[r];
+			}
+		}
+
+		// In place 2D transform, rows first then columns.
+		void distance_transform_2d(std::vector<float>* grid, int width, int height)
+		{
+			const int n = std::max(width, height);
+			std::vector<float> f(n), d(n), z(n + 1);
+			std::vector<int> v(n);
+			float* g = grid->data();
+			for(int y = 0; y != height; ++y) {
+				std::copy(g + y * width, g + (y + 1) * width, f.begin());
+				distance_transform_1d(f.data(), g + y * width, width, v.data(), z.data());
+			}
+			for(int x = 0; x != width; ++x) {
+				for(int y = 0; y != height; ++y) {
+					f[y] = g[y * width + x];
+				}
+				distance_transform_1d(f.data(), d.data(), height, v.data(), z.data());
+				for(int y = 0; y != height; ++y) {
+					g[y * width + x] = d[y];
+				}
+			}
+		}
+	}
+
+	void coverage_to_distance_field(const unsigned char* coverage, int width, int height, int upscale, int spread, unsigned char* field)
+	{
+		ASSERT_LOG(upscale > 0 && spread > 0, "coverage_to_distance_field: upscale and spread must be positive.");
+		ASSERT_LOG(width % upscale == 0 && height % upscale == 0, "coverage_to_distance_field: " << width << "x" << height << " isn't a multiple of " << upscale);
+		if(width <= 0 || height <= 0) {
+			return;
+		}
+
+		// Squared distance from every source pixel to the nearest pixel inside the shape, and
+		// to the nearest one outside it.
+		const int size = width * height;
+		std::vector<float> to_inside(size), to_outside(size);
+		for(int n = 0; n != size; ++n) {
+			const bool inside = coverage[n] >= 128;
+			to_inside[n] = inside ? 0.0f : edt_infinity;
+			to_outside[n] = inside ? edt_infinity : 0.0f;
+		}
+		distance_transform_2d(&to_inside, width, height);
+		distance_transform_2d(&to_outside, width, height);
+
+		// Signed distance to the outline in source pixels, positive outside. Pixel centres lie
+		// half a pixel from the edge between an inside and an outside pixel.
+		std::vector<float> signed_dist(size);
+		for(int n = 0; n != size; ++n) {
+			signed_dist[n] = to_inside[n] > 0.0f ? std::sqrt(to_inside[n]) - 0.5f : 0.5f - std::sqrt(to_outside[n]);
+		}
+
+		// Sample at the centre of each field pixel's block of source pixels.
+		const int field_width = width / upscale;
+		const int field_height = height / upscale;
+		const int lo = (upscale - 1) / 2;
+		const int hi = upscale / 2;
+		const float scale = 1.0f / (upscale * spread * 2.0f);
+		for(int fy = 0; fy != field_height; ++fy) {
+			const float* row_lo = &signed_dist[(fy * upscale + lo) * width];
+			const float* row_hi = &signed_dist[(fy * upscale + hi) * width];
+			for(int fx = 0; fx != field_width; ++fx) {
+				const int x_lo = fx * upscale + lo;
+				const int x_hi = fx * upscale + hi;
+				const float dist = (row_lo[x_lo] + row_lo[x_hi] + row_hi[x_lo] + row_hi[x_hi]) * 0.25f;
+				const float value = std::min(1.0f, std::max(0.0f, 0.5f - dist * scale));
+				field[fy * field_width + fx] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+			}
+		}
+	}
+}
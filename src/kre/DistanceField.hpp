@@ -0,0 +1,35 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+namespace KRE
+{
+	// Builds an 8-bit signed distance field from a coverage bitmap drawn upscale times larger
+	// than the field, each field pixel covering upscale x upscale source pixels. The outline
+	// maps to 128, values reach 255 spread field pixels inside it and 0 spread pixels outside.
+	// width and height must be multiples of upscale and field hold (width/upscale) * 
+	// (height/upscale) bytes. Leave spread * upscale empty source pixels around the shape so
+	// the field has room to fall off. Safe to call from several threads at once.
+	void coverage_to_distance_field(const unsigned char* coverage, int width, int height, int upscale, int spread, unsigned char* field);
+}
@@ -21,6 +21,7 @@
 	   distribution.
 */
 
+#include <chrono>
 #include <map>
 
 #include <cairo.h>
@@ -109,24 +110,78 @@ namespace KRE
 			return res;
 		}
 
+		uint64_t hash_bytes(const void* data, size_t size, uint64_t hash)
+		{
+			// 64-bit FNV-1a
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			for(size_t n = 0; n != size; ++n) {
+				hash ^= p[n];
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		// The hash is worked out once, so lookups only compare the strings on a hash match.
 		struct CacheKey 
 		{
+			CacheKey(const std::string& t, const Color& c, int sz, const std::string& fn)
+				: text(t),
+				  color(c),
+				  font_size(sz),
+				  font_name(fn),
+				  hash(14695981039346656037ULL)
+			{
+				const uint32_t rgba = color.asRGBA();
+				const uint64_t lengths = (static_cast<uint64_t>(text.size()) << 32) | font_name.size();
+				hash = hash_bytes(text.data(), text.size(), hash);
+				hash = hash_bytes(font_name.data(), font_name.size(), hash);
+				hash = hash_bytes(&rgba, sizeof(rgba), hash);
+				hash = hash_bytes(&font_size, sizeof(font_size), hash);
+				hash = hash_bytes(&lengths, sizeof(lengths), hash);
+			}
+			bool operator==(const CacheKey& k) const {
+				return hash == k.hash && font_size == k.font_size && color == k.color && text == k.text && font_name == k.font_name;
+			}
+
 			std::string text;
 			Color color;
 			int font_size;
 			std::string font_name;
+			uint64_t hash;
+		};
+
+		struct CacheKeyHash
+		{
+			size_t operator()(const CacheKey& k) const { return static_cast<size_t>(k.hash); }
+		};
 
-			bool operator<(const CacheKey& k) const {
-				return text < k.text || (text == k.text && color < k.color)
-					|| (text == k.text && color == k.color && font_size < k.font_size)
-					|| (text == k.text && color == k.color && font_size == k.font_size && font_name < k.font_name);
-		}	
+		struct CachedText
+		{
+			TexturePtr texture;
+			std::chrono::steady_clock::time_point last_use;
 		};
 
-		typedef std::map<CacheKey, TexturePtr> RenderCache;
+		size_t texture_bytes(const CacheKey& key, const CachedText& ct)
+		{
+			size_t res = 0;
+			if(ct.texture != nullptr) {
+				for(int n = 0; n != ct.texture->getTextureCount(); ++n) {
+					res += static_cast<size_t>(ct.texture->actualWidth(n)) * ct.texture->actualHeight(n) * 4;
+				}
+			}
+			return res;
+		}
+
+		TextCacheLimits& get_render_cache_limits()
+		{
+			static TextCacheLimits res;
+			return res;
+		}
+
+		typedef LruCache<CacheKey, CachedText, CacheKeyHash> RenderCache;
 		RenderCache& get_render_cache()
 		{
-			static RenderCache res;
+			static RenderCache res(get_render_cache_limits().max_entries, get_render_cache_limits().max_bytes, texture_bytes);
 			return res;
 		}
 
@@ -171,14 +226,44 @@ namespace KRE
 		if(!cache) {
 			return doRenderText(text, color, size, font_name);
 		}
-		CacheKey key = {text, color, size, font_name};
-		auto it = get_render_cache().find(key);
-		if(it == get_render_cache().end()) {
-			TexturePtr t = doRenderText(text, color, size, font_name);
-			get_render_cache()[key] = t;
-			return t;
+		RenderCache& render_cache = get_render_cache();
+		const auto now = std::chrono::steady_clock::now();
+		const unsigned ttl_ms = get_render_cache_limits().ttl_ms;
+		if(ttl_ms != 0) {
+			// Entries are ordered by last use, so the expired ones are all at the cold end.
+			render_cache.evictWhile([now, ttl_ms](const CacheKey& key, const CachedText& ct) {
+				return now - ct.last_use > std::chrono::milliseconds(ttl_ms);
+			});
 		}
-		return it->second;
+		const CacheKey key(text, color, size, font_name);
+		CachedText* cached = render_cache.get(key);
+		if(cached != nullptr) {
+			cached->last_use = now;
+			return cached->texture;
+		}
+		CachedText ct = { doRenderText(text, color, size, font_name), now };
+		return render_cache.put(key, std::move(ct)).texture;
+	}
+
+	void Font::setRenderCacheLimits(const TextCacheLimits& limits)
+	{
+		get_render_cache_limits() = limits;
+		get_render_cache().setLimits(limits.max_entries, limits.max_bytes);
+	}
+
+	const TextCacheLimits& Font::getRenderCacheLimits()
+	{
+		return get_render_cache_limits();
+	}
+
+	const LruCacheStats& Font::getRenderCacheStats()
+	{
+		return get_render_cache().getStats();
+	}
+
+	void Font::clearRenderCache()
+	{
+		get_render_cache().clear();
 	}
 
 	void Font::getTextSize(const std::string& text, int* width, int* height, int size, const std::string& font_name) const
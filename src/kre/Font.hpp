@@ -25,6 +25,7 @@
 
 #include <exception>
 
+#include "LruCache.hpp"
 #include "Texture.hpp"
 #include "Util.hpp"
 
@@ -40,6 +41,17 @@ namespace KRE
 
 	typedef std::map<std::string, std::string> font_path_cache;
 
+	// Bounds on the textures kept by Font::renderText. A limit of zero means unbounded.
+	struct TextCacheLimits
+	{
+		TextCacheLimits() : max_entries(2048), max_bytes(32 * 1024 * 1024), ttl_ms(0) {}
+		size_t max_entries;
+		// Texture memory, counted at 4 bytes per texel.
+		size_t max_bytes;
+		// Textures not asked for in this many milliseconds are dropped, 0 keeps them until evicted.
+		unsigned ttl_ms;
+	};
+
 	class Font
 	{
 	public:
@@ -56,6 +68,11 @@ namespace KRE
 		static std::vector<std::string> getAvailableFonts();
 		static int charWidth(int size, const std::string& fn="");
 		static int charHeight(int size, const std::string& fn="");
+		// Evicted textures stay alive for as long as callers still hold them.
+		static void setRenderCacheLimits(const TextCacheLimits& limits);
+		static const TextCacheLimits& getRenderCacheLimits();
+		static const LruCacheStats& getRenderCacheStats();
+		static void clearRenderCache();
 	protected:
 		Font();
 	private:
@@ -24,6 +24,7 @@
 #include "DisplayDevice.hpp"
 #include "FontDriver.hpp"
 #include "FontImpl.hpp"
+#include "GlyphAtlas.hpp"
 #include "Shaders.hpp"
 
 namespace KRE
@@ -52,11 +53,15 @@ namespace KRE
 
 		struct CacheKey
 		{
-			CacheKey(const std::string& fn, float sz) : font_name(fn), size(sz) {}
+			CacheKey(const std::string& fn, float sz, GlyphRendering gr) : font_name(fn), size(sz), rendering(gr) {}
 			std::string font_name;
 			float size;
+			GlyphRendering rendering;
 			bool operator<(const CacheKey& other) const {
-				return font_name == other.font_name ? size < other.size : font_name < other.font_name;
+				if(font_name != other.font_name) {
+					return font_name < other.font_name;
+				}
+				return size == other.size ? rendering < other.rendering : size < other.size;
 			}
 		};
 
@@ -67,6 +72,24 @@ namespace KRE
 			return res;
 		}
 
+		FontCacheLimits& get_cache_limits()
+		{
+			static FontCacheLimits res;
+			return res;
+		}
+
+		unsigned& get_frame()
+		{
+			static unsigned res = 0;
+			return res;
+		}
+
+		GlyphRendering& get_glyph_rendering()
+		{
+			static GlyphRendering res = GlyphRendering::COVERAGE;
+			return res;
+		}
+
 		// Returns a list of what we consider 'common' codepoints
 		// these generally consist of the 7-bit ASCII characters.
 		// and the unicode replacement character 0xfffd
@@ -170,7 +193,8 @@ namespace KRE
 			throw FontError2(ss.str());
 		}
 
-		auto it = get_font_cache().find(CacheKey(font_path, size));
+		const CacheKey key(font_path, size, get_glyph_rendering());
+		auto it = get_font_cache().find(key);
 		if(it != get_font_cache().end()) {
 			return it->second;
 		}
@@ -190,7 +214,7 @@ namespace KRE
 		ASSERT_LOG(fnt_impl != nullptr, "No font implementation.");
 		// N.B. After this call fnt_impl is moved into the FontHandle object and while no longer be valid.
 		auto fh = std::make_shared<FontHandle>(std::move(fnt_impl), selected_font, font_path, size, color, init_texture);
-		get_font_cache()[CacheKey(font_path, size)] = fh;
+		get_font_cache()[key] = fh;
 		return fh;
 	}
 
@@ -199,15 +223,45 @@ namespace KRE
 		return get_common_glyphs();
 	}
 
+	void FontDriver::setCacheLimits(const FontCacheLimits& limits)
+	{
+		get_cache_limits() = limits;
+	}
+
+	const FontCacheLimits& FontDriver::getCacheLimits()
+	{
+		return get_cache_limits();
+	}
+
+	void FontDriver::setGlyphRendering(GlyphRendering mode)
+	{
+		get_glyph_rendering() = mode;
+	}
+
+	GlyphRendering FontDriver::getGlyphRendering()
+	{
+		return get_glyph_rendering();
+	}
+
+	void FontDriver::nextFrame()
+	{
+		++get_frame();
+	}
+
+	unsigned FontDriver::getFrame()
+	{
+		return get_frame();
+	}
+
 	FontRenderable::FontRenderable() 
 		: SceneObject("font-renderable"),
 		  attribs_(nullptr),
 		  width_(0),
 		  height_(0),
-		  color_(nullptr)
+		  color_(nullptr),
+		  distance_field_(false)
 	{
-		ShaderProgramPtr shader = ShaderProgram::getProgram("font_shader")->clone();
-		setShader(shader);
+		setFontShader();
 		auto as = DisplayDevice::createAttributeSet();
 		attribs_.reset(new Attribute<font_coord>(AccessFreqHint::DYNAMIC, AccessTypeHint::DRAW));
 		attribs_->addAttributeDesc(AttributeDesc(AttrType::POSITION, 2, AttrFormat::FLOAT, false, sizeof(font_coord), offsetof(font_coord, vtx)));
@@ -218,7 +272,12 @@ namespace KRE
 		as->clearBlendMode();
 
 		addAttributeSet(as);
+	}
 
+	void FontRenderable::setFontShader()
+	{
+		ShaderProgramPtr shader = ShaderProgram::getProgram(distance_field_ ? "font_sdf_shader" : "font_shader")->clone();
+		setShader(shader);
 		int u_ignore_alpha = shader->getUniform("ignore_alpha");
 		int a_color_attr = shader->getAttribute("a_color");
 		shader->setUniformDrawFunction([u_ignore_alpha, a_color_attr](ShaderProgramPtr shader) {
@@ -228,6 +287,14 @@ namespace KRE
 		});				
 	}
 
+	void FontRenderable::setDistanceField(bool distance_field)
+	{
+		if(distance_field_ != distance_field) {
+			distance_field_ = distance_field;
+			setFontShader();
+		}
+	}
+
 	void FontRenderable::preRender(const WindowPtr& wnd)
 	{
 		//ASSERT_LOG(color_ != nullptr, "Color pointer was null.");
@@ -259,10 +326,10 @@ namespace KRE
 		  width_(0),
 		  height_(0),
 		  color_(nullptr),
-		  vertices_per_color_(6)
+		  vertices_per_color_(6),
+		  distance_field_(false)
 	{
-		ShaderProgramPtr shader = ShaderProgram::getProgram("font_shader");
-		setShader(shader);
+		setFontShader();
 		auto as = DisplayDevice::createAttributeSet();
 		attribs_.reset(new Attribute<font_coord>(AccessFreqHint::STATIC, AccessTypeHint::DRAW));
 		attribs_->addAttributeDesc(AttributeDesc(AttrType::POSITION, 2, AttrFormat::FLOAT, false, sizeof(font_coord), offsetof(font_coord, vtx)));
@@ -278,13 +345,26 @@ namespace KRE
 		as->clearBlendMode();
 
 		addAttributeSet(as);
+	}
 
+	void ColoredFontRenderable::setFontShader()
+	{
+		ShaderProgramPtr shader = ShaderProgram::getProgram(distance_field_ ? "font_sdf_shader" : "font_shader");
+		setShader(shader);
 		int u_ignore_alpha = shader->getUniform("ignore_alpha");
 		shader->setUniformDrawFunction([u_ignore_alpha](ShaderProgramPtr shader) {
 			shader->setUniformValue(u_ignore_alpha, 0);
 		});				
 	}
 
+	void ColoredFontRenderable::setDistanceField(bool distance_field)
+	{
+		if(distance_field_ != distance_field) {
+			distance_field_ = distance_field;
+			setFontShader();
+		}
+	}
+
 	void ColoredFontRenderable::preRender(const WindowPtr& wnd)
 	{
 		//ASSERT_LOG(color_ != nullptr, "Color pointer was null.");
@@ -381,7 +461,7 @@ namespace KRE
 		return impl_->getBaseline();
 	}
 
-	const std::vector<point>& FontHandle::getGlyphPath(const std::string& text)
+	std::vector<point> FontHandle::getGlyphPath(const std::string& text)
 	{
 		return impl_->getGlyphPath(text);
 	}
@@ -428,4 +508,14 @@ namespace KRE
 	{
 		return impl_->getLineGap();
 	}
+
+	GlyphAtlasStats FontHandle::getAtlasStats() const
+	{
+		return GlyphAtlas::get().getStats();
+	}
+
+	const LruCacheStats& FontHandle::getLayoutCacheStats() const
+	{
+		return impl_->glyph_path_cache_.getStats();
+	}
 }
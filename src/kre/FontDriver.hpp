@@ -30,6 +30,7 @@
 
 #include "geometry.hpp"
 #include "AttributeSet.hpp"
+#include "LruCache.hpp"
 #include "Color.hpp"
 #include "RenderFwd.hpp"
 #include "SceneObject.hpp"
@@ -51,6 +52,47 @@ namespace KRE
 		glm::vec2 tc;
 	};
 
+	// Counters describing the glyph atlas shared by all fonts. Glyph and area figures refer
+	// to the page glyphs are currently being added to, the rest cover the whole run.
+	struct GlyphAtlasStats
+	{
+		GlyphAtlasStats() : pages(0), glyphs(0), used_area(0), page_area(0), uploads(0), upload_bytes(0), hits(0), misses(0), evictions(0) {}
+		float getOccupancy() const { return page_area > 0 ? static_cast<float>(used_area) / page_area : 0.0f; }
+		float getHitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+		int pages;
+		int glyphs;
+		long long used_area;
+		long long page_area;
+		long long uploads;
+		long long upload_bytes;
+		// Glyph lookups that found the glyph already in the atlas vs. ones that had to rasterise it.
+		long long hits;
+		long long misses;
+		// Glyphs dropped because they hadn't been used recently when the atlas was rebuilt.
+		long long evictions;
+	};
+
+	// Bounds on the font caches.
+	struct FontCacheLimits
+	{
+		FontCacheLimits() : layout_entries(4096), layout_bytes(4 * 1024 * 1024), glyph_idle_frames(600) {}
+		// Maximum number of laid out strings per font and the memory they may take, applied
+		// to fonts created after the limits are set.
+		size_t layout_entries;
+		size_t layout_bytes;
+		// When the shared atlas fills up the next page only keeps the glyphs used within this many frames.
+		unsigned glyph_idle_frames;
+	};
+
+	// How glyphs are stored in the atlas.
+	enum class GlyphRendering {
+		// Coverage bitmaps, rasterised separately for every font size.
+		COVERAGE,
+		// Signed distance fields rasterised once per font, font_sdf_shader scales them to any
+		// size. Only the stb provider has them, others fall back to coverage.
+		DISTANCE_FIELD,
+	};
+
 	class FontRenderable : public SceneObject
 	{
 	public:
@@ -63,12 +105,17 @@ namespace KRE
 		void setHeight(int height) { height_ = height; }
 		void setColorPointer(const ColorPtr& color);
 		void preRender(const WindowPtr& wnd) override;
+		// Switches between font_shader and font_sdf_shader.
+		void setDistanceField(bool distance_field);
+		bool isDistanceField() const { return distance_field_; }
 	private:
+		void setFontShader();
 		std::shared_ptr<Attribute<font_coord>> attribs_;
 		// intrinsic width and height when rendered, in pixels.
 		int width_;
 		int height_;
 		ColorPtr color_;
+		bool distance_field_;
 	};
 	typedef std::shared_ptr<FontRenderable> FontRenderablePtr;
 
@@ -86,7 +133,11 @@ namespace KRE
 		void preRender(const WindowPtr& wnd) override;
 		void updateColors(const std::vector<Color>& colors);
 		void setVerticesPerColor(int n) { vertices_per_color_ = n; }
+		// Switches between font_shader and font_sdf_shader.
+		void setDistanceField(bool distance_field);
+		bool isDistanceField() const { return distance_field_; }
 	private:
+		void setFontShader();
 		std::shared_ptr<Attribute<font_coord>> attribs_;
 		std::shared_ptr<Attribute<glm::u8vec4>> color_attrib_;
 		// intrinsic width and height when rendered, in pixels.
@@ -94,6 +145,7 @@ namespace KRE
 		int height_;
 		ColorPtr color_;
 		int vertices_per_color_;
+		bool distance_field_;
 	};
 	typedef std::shared_ptr<ColoredFontRenderable> ColoredFontRenderablePtr;
 
@@ -116,12 +168,15 @@ namespace KRE
 		rect getBoundingBox(const std::string& text);
 		FontRenderablePtr createRenderableFromPath(FontRenderablePtr r, const std::string& text, const std::vector<point>& path);
 		ColoredFontRenderablePtr createColoredRenderableFromPath(ColoredFontRenderablePtr r, const std::string& text, const std::vector<point>& path, const std::vector<KRE::Color>& colors);
-		const std::vector<point>& getGlyphPath(const std::string& text);
+		// Returns a copy, the cached layout may be evicted by later calls.
+		std::vector<point> getGlyphPath(const std::string& text);
 		int calculateCharAdvance(char32_t cp);
 		int getScaleFactor() const { return 65536; }
 		std::vector<unsigned> getGlyphs(const std::string& text);
 		void* getRawFontHandle();
 		float getLineGap() const;
+		GlyphAtlasStats getAtlasStats() const;
+		const LruCacheStats& getLayoutCacheStats() const;
 		// Simple interface to render a string of text.
 		FontRenderablePtr renderText(FontRenderablePtr r, const std::string& text);
 	private:
@@ -140,6 +195,14 @@ namespace KRE
 		static void setAvailableFonts(const font_path_cache& font_map);
 		//static TexturePtr renderText(const std::string& text, ...);
 		static const std::vector<char32_t>& getCommonGlyphs();
+		static void setCacheLimits(const FontCacheLimits& limits);
+		static const FontCacheLimits& getCacheLimits();
+		// Applies to font handles created afterwards.
+		static void setGlyphRendering(GlyphRendering mode);
+		static GlyphRendering getGlyphRendering();
+		// Frame counter used to age glyphs, advanced once per presented frame.
+		static void nextFrame();
+		static unsigned getFrame();
 	private:
 		FontDriver();
 	};
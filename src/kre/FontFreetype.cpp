@@ -41,6 +41,7 @@
 
 #include "DisplayDevice.hpp"
 #include "FontImpl.hpp"
+#include "GlyphAtlas.hpp"
 #include "SceneObject.hpp"
 #include "Shaders.hpp"
 
@@ -51,9 +52,6 @@ namespace KRE
 	namespace
 	{
 		const int default_dpi = 96;
-		const int surface_width = 2048;
-		const int surface_height = 2048;
-
 
 		FT_Library& get_ft_library()
 		{
@@ -68,13 +66,9 @@ namespace KRE
 
 	struct GlyphInfo
 	{
-		// X co-ordinate of top-left corner of glyph in texture.
-		unsigned short tex_x;
-		// Y co-ordinate of top-left corner of glyph in texture.
-		unsigned short tex_y;
-		// Width of glyph in texture.
+		// Width of glyph bitmap.
 		unsigned short width;
-		// Height of glyph in texture.
+		// Height of glyph bitmap.
 		unsigned short height;
 		// X advance (i.e. distance to start of next glyph on X axis)
 		long advance_x;
@@ -93,15 +87,11 @@ namespace KRE
 			: FontHandle::Impl(fnt_name, fnt_path, size, color, init_texture),
 			  face_(nullptr),
 			  font_load_flags_(FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT),
-			  font_texture_(),
-			  next_font_x_(0),
-			  next_font_y_(0),
-			  last_line_height_(0),
-			  all_glyphs_added_(false),
 			  bounding_height_(0),
 			  glyph_info_(),
 			  line_gap_(0),
-			  baseline_(0)
+			  baseline_(0),
+			  atlas_face_(0)
 		{
 			// XXX starting off with a basic way of rendering glyphs.
 			// It'd be better to render all the glyphs to a texture,
@@ -135,25 +125,21 @@ namespace KRE
 			FT_Load_Glyph(face_, glyph_index, font_load_flags_);
 			baseline_ = face_->glyph->metrics.horiBearingY * 1024;
 
-			if(init_texture) {
-				// This is an empirical fudge that just adds all the glyphs in the
-				// font to the texture on the caveat that they will fit.
-				float px_sz = size / 72.0f * default_dpi;
-				if((surface_width / px_sz) * (surface_height / px_sz) > face_->num_glyphs) {
-					addAllGlyphsToTexture();
-				} else {
-					addGlyphsToTexture(FontDriver::getCommonGlyphs());
-				}
+			atlas_face_ = GlyphAtlas::get().addFace([this](char32_t cp, GlyphBitmap* bitmap) { rasterise(cp, bitmap); });
 
-				for(const auto& gi : glyph_info_) {
-					if(gi.second.height > bounding_height_) {
-						bounding_height_ = gi.second.height;
+			if(init_texture) {
+				// Glyphs go into the shared atlas as they are drawn, only their metrics are needed here.
+				for(char32_t cp : FontDriver::getCommonGlyphs()) {
+					const GlyphInfo* gi = loadGlyphInfo(cp);
+					if(gi != nullptr && gi->height > bounding_height_) {
+						bounding_height_ = gi->height;
 					}
 				}
 			}
 		}
 		~FreetypeImpl() 
 		{
+			GlyphAtlas::get().removeFace(atlas_face_);
 			if(face_) {
 				FT_Done_Face(face_);
 				face_ = nullptr;
@@ -207,13 +193,13 @@ namespace KRE
 			return res;
 		}
 
-		const std::vector<point>& getGlyphPath(const std::string& text) override
+		std::vector<point> getGlyphPath(const std::string& text) override
 		{
-			auto it = glyph_path_cache_.find(text);
-			if(it != glyph_path_cache_.end()) {
-				return it->second;
+			auto cached = glyph_path_cache_.get(text);
+			if(cached != nullptr) {
+				return *cached;
 			}
-			std::vector<point>& path = glyph_path_cache_[text];
+			std::vector<point> path;
 
 			FT_Vector pen = { 0, 0 };
 			FT_Error error;
@@ -251,7 +237,7 @@ namespace KRE
 			}
 			// pushing back the end point so we know where the next letter starts.
 			path.emplace_back(pen.x, pen.y);
-			return path;
+			return glyph_path_cache_.put(text, std::move(path));
 		}
 		
 		// text is a utf-8 string, path is expected to have at least has many data points as there
@@ -259,50 +245,48 @@ namespace KRE
 		// N.B. the origin of the Renderable object created is the baseline of the font
 		FontRenderablePtr createRenderableFromPath(FontRenderablePtr font_renderable, const std::string& text, const std::vector<point>& path) override
 		{
-			auto cp_string = utils::utf8_to_codepoint(text);
-			int glyphs_in_text = 0;
-			std::vector<char32_t> glyphs_to_add;
-			for(char32_t cp : cp_string) {
-				++glyphs_in_text;
-				auto it = glyph_info_.find(cp);
-				if(it == glyph_info_.end()) {
-					glyphs_to_add.emplace_back(cp);
-				}
-			}
-			if(!glyphs_to_add.empty()) {
-				addGlyphsToTexture(glyphs_to_add);
-			}
+			auto cp_str = utils::utf8_to_codepoint(text);
+			std::vector<char32_t> cp_string(cp_str.begin(), cp_str.end());
+			// Glyphs the font can't provide are drawn as the replacement character.
+			cp_string.emplace_back(0xfffd);
+			GlyphAtlas::get().addGlyphs(atlas_face_, cp_string);
+			cp_string.pop_back();
+			const TexturePtr& font_texture = GlyphAtlas::get().getTexture();
 			
 			if(font_renderable == nullptr) {
 				font_renderable = std::make_shared<FontRenderable>();
-				font_renderable->setTexture(font_texture_);
+				font_renderable->setTexture(font_texture);
+			} else if(font_renderable->getTexture() != font_texture) {
+				font_renderable->setTexture(font_texture);
 			}
 
 			int width = 0;
 			int height = 0;
 
 			std::vector<font_coord> coords;
-			coords.reserve(glyphs_in_text * 6);
+			coords.reserve(cp_string.size() * 6);
 			int n = 0;
 			for(char32_t cp : cp_string) {
 				ASSERT_LOG(n < static_cast<int>(path.size()), "Insufficient points were supplied to create a path from the string '" << text << "'");
 				auto& pt =path[n];
 				auto it = glyph_info_.find(cp);
-				if(it == glyph_info_.end()) {
+				const GlyphAtlas::Slot* slot = GlyphAtlas::get().find(atlas_face_, cp);
+				if(it == glyph_info_.end() || slot == nullptr) {
 					it = glyph_info_.find(0xfffd);
-					if(it == glyph_info_.end()) {
+					slot = GlyphAtlas::get().find(atlas_face_, 0xfffd);
+					if(it == glyph_info_.end() || slot == nullptr) {
 						continue;
 					}
 				}
-				GlyphInfo& gi = it->second;
+				const GlyphInfo& gi = it->second;
 				
 				width += gi.width;
 				height = std::max(height, static_cast<int>(gi.height));
 
-				const float u1 = font_texture_->getTextureCoordW(0, gi.tex_x);
-				const float v1 = font_texture_->getTextureCoordH(0, gi.tex_y);
-				const float u2 = font_texture_->getTextureCoordW(0, gi.tex_x + gi.width);
-				const float v2 = font_texture_->getTextureCoordH(0, gi.tex_y + gi.height);
+				const float u1 = font_texture->getTextureCoordW(0, slot->x);
+				const float v1 = font_texture->getTextureCoordH(0, slot->y);
+				const float u2 = font_texture->getTextureCoordW(0, slot->x + slot->w);
+				const float v2 = font_texture->getTextureCoordH(0, slot->y + slot->h);
 
 				const float x1 = static_cast<float>(pt.x) / 65536.0f;
 				const float y1 = static_cast<float>(pt.y) / 65536.0f - gi.bearing_y/64.0f;
@@ -350,87 +334,72 @@ namespace KRE
 			return slot->linearHoriAdvance;
 		}
 
-		// Adds all the glyphs in the font to the texture.
-		// Assumes you've calculated that they'll all fit.
-		void addAllGlyphsToTexture()
+		void addGlyphsToTexture(const std::vector<char32_t>& glyphs) override 
 		{
-			std::vector<char32_t> glyphs;
-			FT_UInt ndx;
-			char32_t cp = FT_Get_First_Char(face_, &ndx);
-			while(ndx != 0) {
-				glyphs.emplace_back(cp);
-				cp = FT_Get_Next_Char(face_, cp, &ndx);
+			GlyphAtlas::get().addGlyphs(atlas_face_, glyphs);
+		}
+
+		void* getRawFontHandle() override
+		{
+			return face_;
+		}
+		float getLineGap() const override
+		{
+			return line_gap_;
+		}
+	private:
+		// Loads the glyph into face_->glyph and records its metrics, nullptr if the font
+		// doesn't have it.
+		const GlyphInfo* loadGlyphInfo(char32_t cp)
+		{
+			FT_Error error;
+			if((error = FT_Load_Char(face_, cp, font_load_flags_/*&~FT_LOAD_RENDER*/)) != 0) {
+				LOG_ERROR("Font '" << fnt_ << "' does not contain glyph for: " << utils::codepoint_to_utf8(cp));
+				glyph_info_.erase(cp);
+				return nullptr;
 			}
-			addGlyphsToTexture(glyphs);
-			all_glyphs_added_ = true;
+			FT_GlyphSlot slot = face_->glyph;
+			GlyphInfo& gi = glyph_info_[cp];
+			gi.width = static_cast<unsigned short>(slot->bitmap.width);
+			gi.height = static_cast<unsigned short>(slot->bitmap.rows);
+			gi.advance_x = slot->linearHoriAdvance;
+			gi.advance_y = 0;
+			gi.bearing_x = slot->metrics.horiBearingX;
+			gi.bearing_y = slot->metrics.horiBearingY;
+			return &gi;
 		}
 
-		void addGlyphsToTexture(const std::vector<char32_t>& glyphs) override 
+		void rasterise(char32_t cp, GlyphBitmap* bitmap)
 		{
 			/*const FT_Matrix shear = { // xx xy || yx yy
 				1 << 16, static_cast<int>(13566.0f/size_),
 				0,       1<< 16,
 			};*/
-
-			if(font_texture_ == nullptr) {
-				// XXX if slot->bitmap.pixel_mode == FT_PIXEL_MODE_LCD then allocate a RGBA surface
-				font_texture_ = Texture::createTexture2D(surface_width, surface_height, PixelFormat::PF::PIXELFORMAT_R8);
-				font_texture_->setUnpackAlignment(0, 1);
-				next_font_x_ = next_font_y_ = 0;
+			if(loadGlyphInfo(cp) == nullptr) {
+				return;
 			}
-			FT_Error error;
 			FT_GlyphSlot slot = face_->glyph;
-			// use a simple packing algorithm.
-			for(auto& cp : glyphs) {
-				if(glyph_info_.find(cp) != glyph_info_.end()) {
-					continue;
-				}
-				if((error = FT_Load_Char(face_, cp, font_load_flags_/*&~FT_LOAD_RENDER*/)) != 0) {
-					LOG_ERROR("Font '" << fnt_ << "' does not contain glyph for: " << utils::codepoint_to_utf8(cp));
-					continue;
-				}
-				//FT_Outline_Transform(&slot->outline, &shear);
-				//FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
-				if(slot->bitmap.buffer == nullptr) {
-					continue;
-				}
-
-				GlyphInfo& gi = glyph_info_[cp];
-				gi.width = static_cast<unsigned short>(slot->metrics.width/64);
-				gi.height = static_cast<unsigned short>(slot->metrics.height/64);
-				gi.advance_x = slot->linearHoriAdvance;
-				gi.advance_y = 0;
-				gi.bearing_x = slot->metrics.horiBearingX;
-				gi.bearing_y = slot->metrics.horiBearingY;
-				last_line_height_ = std::max(last_line_height_, gi.height);
-				if(gi.width + next_font_x_ > surface_width) {
-					next_font_x_ = 0;
-					next_font_y_ += last_line_height_;
-					ASSERT_LOG(next_font_y_ < surface_height, "This font would exceed to maximum surface size. " 
-						<< surface_width << "x" << surface_height << ", number of glyphs: " << glyph_info_.size());
-				}
-				gi.tex_x = next_font_x_;
-				gi.tex_y = next_font_y_;
-
+			//FT_Outline_Transform(&slot->outline, &shear);
+			//FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+			if(slot->bitmap.buffer == nullptr) {
+				return;
+			}
+			const int width = slot->bitmap.width;
+			const int height = slot->bitmap.rows;
+			bitmap->width = width;
+			bitmap->height = height;
+			bitmap->pixels.resize(width * height);
+			for(int y = 0; y != height; ++y) {
+				const unsigned char* src = slot->bitmap.buffer + y * slot->bitmap.pitch;
+				unsigned char* dst = &bitmap->pixels[y * width];
 				switch(slot->bitmap.pixel_mode) {
-					case FT_PIXEL_MODE_MONO: {
-						const int pixel_count = slot->bitmap.pitch * slot->bitmap.rows;
-						std::vector<uint8_t> pixels(pixel_count, 0);
-						for(int n = 0; n != pixel_count; n += 8) {
-							pixels[n+0] = (slot->bitmap.buffer[n] & 128) ? 255 : 0;
-							pixels[n+1] = (slot->bitmap.buffer[n] &  64) ? 255 : 0;
-							pixels[n+2] = (slot->bitmap.buffer[n] &  32) ? 255 : 0;
-							pixels[n+3] = (slot->bitmap.buffer[n] &  16) ? 255 : 0;
-							pixels[n+4] = (slot->bitmap.buffer[n] &   8) ? 255 : 0;
-							pixels[n+5] = (slot->bitmap.buffer[n] &   4) ? 255 : 0;
-							pixels[n+6] = (slot->bitmap.buffer[n] &   2) ? 255 : 0;
-							pixels[n+7] = (slot->bitmap.buffer[n] &   1) ? 255 : 0;
+					case FT_PIXEL_MODE_MONO:
+						for(int x = 0; x != width; ++x) {
+							dst[x] = (src[x >> 3] & (128 >> (x & 7))) ? 255 : 0;
 						}
-						font_texture_->update2D(0, next_font_x_, next_font_y_, gi.width, gi.height, slot->bitmap.pitch, &pixels[0]);
 						break;
-					}
 					case FT_PIXEL_MODE_GRAY:
-						font_texture_->update2D(0, next_font_x_, next_font_y_, gi.width, gi.height, slot->bitmap.pitch, slot->bitmap.buffer);
+						std::memcpy(dst, src, width);
 						break;
 					case FT_PIXEL_MODE_LCD:
 					case FT_PIXEL_MODE_GRAY2:
@@ -441,31 +410,18 @@ namespace KRE
 						ASSERT_LOG(false, "Unhandled font pixel mode: " << slot->bitmap.pixel_mode);
 						break;
 				}
-				next_font_x_ += gi.width;
 			}
 		}
-		void* getRawFontHandle() override
-		{
-			return face_;
-		}
-		float getLineGap() const override
-		{
-			return line_gap_;
-		}
-	private:
+
 		FT_Face face_;
 		int font_load_flags_;
-		TexturePtr font_texture_;
-		int next_font_x_;
-		int next_font_y_;
-		unsigned short last_line_height_;
-		bool all_glyphs_added_;
 		int bounding_height_;
 		// XXX see what is practically faster using a sorted list and binary search
 		// or this map. Also a vector would have better locality.
 		std::map<char32_t, GlyphInfo> glyph_info_;
 		float line_gap_;
 		int baseline_;
+		int atlas_face_;
 	};
 
 
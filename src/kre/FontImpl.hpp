@@ -37,7 +37,7 @@ namespace KRE
 			  color_(color),
 			  has_kerning_(false),
 			  x_height_(0),
-			  glyph_path_cache_()
+			  glyph_path_cache_(FontDriver::getCacheLimits().layout_entries, FontDriver::getCacheLimits().layout_bytes, &layout_bytes)
 		{
 		}
 		virtual ~Impl() {}
@@ -46,7 +46,7 @@ namespace KRE
 		virtual int getBoundingHeight() = 0;
 		virtual void getBoundingBox(const std::string& str, long* w, long* h) = 0;
 		virtual std::vector<unsigned> getGlyphs(const std::string& text) = 0;
-		virtual const std::vector<point>& getGlyphPath(const std::string& text) = 0;
+		virtual std::vector<point> getGlyphPath(const std::string& text) = 0;
 		virtual FontRenderablePtr createRenderableFromPath(FontRenderablePtr font_renderable, const std::string& text, const std::vector<point>& path) = 0;
 		virtual ColoredFontRenderablePtr createColoredRenderableFromPath(ColoredFontRenderablePtr r, const std::string& text, const std::vector<point>& path, const std::vector<KRE::Color>& colors) = 0;
 		virtual long calculateCharAdvance(char32_t cp) = 0;
@@ -54,13 +54,18 @@ namespace KRE
 		virtual void* getRawFontHandle() = 0;
 		virtual float getLineGap() const = 0;
 	protected:
+		static size_t layout_bytes(const std::string& text, const std::vector<point>& path)
+		{
+			return sizeof(std::string) + text.capacity() + sizeof(std::vector<point>) + path.capacity() * sizeof(point);
+		}
 		std::string fnt_;
 		std::string fnt_path_;
 		float size_;
 		Color color_;
 		bool has_kerning_;
 		float x_height_;
-		std::map<std::string, std::vector<point>> glyph_path_cache_;
+		// Laid out strings, get rid of the least recently used ones once the limits are hit.
+		LruCache<std::string, std::vector<point>> glyph_path_cache_;
 		friend class FontHandle;
 	};
 }
@@ -21,10 +21,16 @@
 	   distribution.
 */
 
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
 #include "filesystem.hpp"
 
+#include "DistanceField.hpp"
 #include "FontDriver.hpp"
 #include "FontImpl.hpp"
+#include "GlyphAtlas.hpp"
 #include "utf8_to_codepoint.hpp"
 
 #define STBTT_STATIC
@@ -39,23 +45,137 @@ namespace KRE
 	namespace
 	{
 		const int default_dpi = 96;
-		const int surface_width = 2048;
-		const int surface_height = 2048;
+
+		// Distance field glyphs are rendered at this pixel height, with outlines computed at
+		// distance_field_upscale times the resolution and fields reaching distance_field_spread
+		// pixels either side of the outline.
+		const float distance_field_height = 48.0f;
+		const int distance_field_upscale = 4;
+		const int distance_field_spread = 6;
+
+		int floor_div(int a, int b)
+		{
+			return a >= 0 ? a / b : -((b - 1 - a) / b);
+		}
 	}
 
-	// Implication of non-overlapping ranges.
-	struct UnicodeRange
+	// Signed distance field glyphs of one font, shared by the handles of that font at every
+	// size. They go in the atlas as a single concurrent face.
+	class DistanceFieldFace
 	{
-		UnicodeRange() : first(0), last(0) {}
-		explicit UnicodeRange(char32_t cp) : first(cp), last(cp) {}
-		explicit UnicodeRange(char32_t f, char32_t l) : first(f), last(l) {}
-		char32_t first;
-		char32_t last;
-		int size() const { return last - first + 1; }
-		bool operator()(const UnicodeRange& lhs, const UnicodeRange& rhs) const 
+	public:
+		// Where the field sits relative to the pen, in distance field pixels.
+		struct Box
+		{
+			int glyph;
+			int width;
+			int height;
+			int xoff;
+			int yoff;
+		};
+
+		explicit DistanceFieldFace(const std::string& fnt_path)
+			: font_handle_(),
+			  font_data_(sys::read_file(fnt_path)),
+			  scale_(1.0f),
+			  boxes_(),
+			  face_(0)
 		{
-			return lhs.last < rhs.first;
+			stbtt_InitFont(&font_handle_, reinterpret_cast<const unsigned char*>(font_data_.c_str()), 0);
+			scale_ = stbtt_ScaleForPixelHeight(&font_handle_, distance_field_height);
+			face_ = GlyphAtlas::get().addFace([this](char32_t cp, GlyphBitmap* bitmap) { rasterise(cp, bitmap); }, true);
 		}
+
+		~DistanceFieldFace()
+		{
+			GlyphAtlas::get().removeFace(face_);
+		}
+
+		static std::shared_ptr<DistanceFieldFace> get(const std::string& fnt_path)
+		{
+			static std::map<std::string, std::weak_ptr<DistanceFieldFace>> faces;
+			auto res = faces[fnt_path].lock();
+			if(res == nullptr) {
+				res = std::make_shared<DistanceFieldFace>(fnt_path);
+				faces[fnt_path] = res;
+			}
+			return res;
+		}
+
+		int getFace() const { return face_; }
+		float getScale() const { return scale_; }
+
+		const Box& getBox(char32_t cp)
+		{
+			auto it = boxes_.find(cp);
+			if(it == boxes_.end()) {
+				it = boxes_.insert(std::make_pair(cp, calculateBox(cp))).first;
+			}
+			return it->second;
+		}
+	private:
+		// The upscaled outline is aligned so every field pixel covers whole source pixels.
+		Box calculateBox(char32_t cp) const
+		{
+			Box box = { stbtt_FindGlyphIndex(&font_handle_, cp), 0, 0, 0, 0 };
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBox(&font_handle_, box.glyph, scale_ * distance_field_upscale, scale_ * distance_field_upscale, &x0, &y0, &x1, &y1);
+			if(x1 <= x0 || y1 <= y0) {
+				return box;
+			}
+			const int fx0 = floor_div(x0, distance_field_upscale);
+			const int fy0 = floor_div(y0, distance_field_upscale);
+			box.width = floor_div(x1 + distance_field_upscale - 1, distance_field_upscale) - fx0 + 2 * distance_field_spread;
+			box.height = floor_div(y1 + distance_field_upscale - 1, distance_field_upscale) - fy0 + 2 * distance_field_spread;
+			box.xoff = fx0 - distance_field_spread;
+			box.yoff = fy0 - distance_field_spread;
+			return box;
+		}
+
+		// Called from worker threads, so only reads the font.
+		void rasterise(char32_t cp, GlyphBitmap* bitmap) const
+		{
+			const Box box = calculateBox(cp);
+			bitmap->width = box.width;
+			bitmap->height = box.height;
+			bitmap->pixels.assign(box.width * box.height, 0);
+			if(box.width <= 0 || box.height <= 0) {
+				return;
+			}
+			const float scale = scale_ * distance_field_upscale;
+			int x0, y0, x1, y1;
+			stbtt_GetGlyphBitmapBox(&font_handle_, box.glyph, scale, scale, &x0, &y0, &x1, &y1);
+			const int width = box.width * distance_field_upscale;
+			const int height = box.height * distance_field_upscale;
+			std::vector<unsigned char> coverage(width * height, 0);
+			const int left = x0 - box.xoff * distance_field_upscale;
+			const int top = y0 - box.yoff * distance_field_upscale;
+			stbtt_MakeGlyphBitmapSubpixel(&font_handle_, &coverage[top * width + left], x1 - x0, y1 - y0, width, scale, scale, 0, 0, box.glyph);
+			coverage_to_distance_field(coverage.data(), width, height, distance_field_upscale, distance_field_spread, bitmap->pixels.data());
+		}
+
+		stbtt_fontinfo font_handle_;
+		std::string font_data_;
+		float scale_;
+		std::unordered_map<char32_t, Box> boxes_;
+		int face_;
+
+		DistanceFieldFace(const DistanceFieldFace&);
+		void operator=(const DistanceFieldFace&);
+	};
+
+	// Placement of a glyph's bitmap relative to the pen, as stb_truetype's packer computes it.
+	struct GlyphMetrics
+	{
+		int glyph;
+		// Size of the bitmap in (oversampled) pixels.
+		int width;
+		int height;
+		float xoff;
+		float yoff;
+		float xoff2;
+		float yoff2;
+		float xadvance;
 	};
 
 	class stb_impl : public FontHandle::Impl, public AlignedAllocator16
@@ -69,12 +189,14 @@ namespace KRE
 			  descent_(0),
 			  line_gap_(0),
 			  baseline_(0),
+			  bounding_height_(0),
 			  scale_(1.0f),
 			  font_size_(default_dpi * size / 72.0f),
-			  pc_(),
-			  packed_char_(),
-			  pixels_(),
-			  font_texture_()
+			  pack_scale_(1.0f),
+			  oversample_(1),
+			  metrics_(),
+			  face_(0),
+			  distance_field_()
 		{
 			// Read font data and initialise
 			font_data_ = sys::read_file(fnt_path);
@@ -101,30 +223,30 @@ namespace KRE
 				;
 			LOG_DEBUG(debug_ss.str());
 
-			pixels_.resize(surface_width * surface_height);
-			stbtt_PackBegin(&pc_, pixels_.data(), surface_width, surface_height, 0, 1, nullptr);
-			if(init_texture) {
-				font_texture_ = Texture::createTexture2D(surface_width, surface_height, PixelFormat::PF::PIXELFORMAT_R8);
-				font_texture_->setUnpackAlignment(0, 1);
-				font_texture_->setFiltering(0, Texture::Filtering::LINEAR, Texture::Filtering::LINEAR, Texture::Filtering::NONE);
-				addGlyphsToTexture(FontDriver::getCommonGlyphs());
+			pack_scale_ = stbtt_ScaleForPixelHeight(&font_handle_, font_size_);
+			if(font_size_ < 20.0f) {
+				oversample_ = 2;
+			}
+			if(FontDriver::getGlyphRendering() == GlyphRendering::DISTANCE_FIELD) {
+				distance_field_ = DistanceFieldFace::get(fnt_path);
+				face_ = distance_field_->getFace();
+			} else {
+				face_ = GlyphAtlas::get().addFace([this](char32_t cp, GlyphBitmap* bitmap) { rasterise(cp, bitmap); });
+			}
 
+			if(init_texture) {
 				// Calculate maximum bounding box height of all the common glyphs.
-				for(const auto& range : packed_char_) {
-					for(char32_t cp = range.first.first; cp != range.first.last + 1; ++cp) {
-						const stbtt_packedchar *b = range.second.data() + cp - range.first.first;
-						const int char_height = b->y1 - b->y0;
-						if(char_height > bounding_height_) {
-							bounding_height_ = char_height;
-						}
-					}
+				for(char32_t cp : FontDriver::getCommonGlyphs()) {
+					bounding_height_ = std::max(bounding_height_, getMetrics(cp).height);
 				}
 			}
 		}
 
 		~stb_impl() 
 		{
-			stbtt_PackEnd(&pc_);
+			if(distance_field_ == nullptr) {
+				GlyphAtlas::get().removeFace(face_);
+			}
 		}
 
 		int getDescender() override
@@ -148,14 +270,13 @@ namespace KRE
 			ASSERT_LOG(h != nullptr, "getBoundingBox: height was null.");
 			*w = 0;
 			*h = 0;
-			glyphTraverse(str, [w, h](stbtt_packedchar* b) {
-				auto char_width = b->x1 - b->x0;
-				auto char_height = b->y1 - b->y0;
-				*w += char_width;
-				if(*h < char_height) {
-					*h = char_height;
+			for(char32_t cp : utils::utf8_to_codepoint(str)) {
+				const GlyphMetrics& m = getMetrics(cp);
+				*w += m.width;
+				if(*h < m.height) {
+					*h = m.height;
 				}
-			});
+			}
 		}
 
 		std::vector<unsigned> getGlyphs(const std::string& text) override		
@@ -167,135 +288,67 @@ namespace KRE
 			return res;
 		}
 
-
-		void glyphTraverse(const std::string& text, std::function<void(stbtt_packedchar*)> fn)
+		std::vector<point> getGlyphPath(const std::string& text) override
 		{
-			auto cp_str = utils::utf8_to_codepoint(text);
-
-			std::vector<char32_t> glyphs_to_add;
-			for(char32_t cp : cp_str) {
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					glyphs_to_add.emplace_back(cp);
-				}
-			}
-			if(!glyphs_to_add.empty()) {
-				addGlyphsToTexture(glyphs_to_add);
-			}
-
-			for(char32_t cp : cp_str) {
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					cp = 0xfffd;
-					it = packed_char_.find(UnicodeRange(0xfffd));
-					if(it == packed_char_.end()) {
-						continue;
-					}
-				}
-				
-				stbtt_packedchar* b = it->second.data() + cp - it->first.first;
-				fn(b);
-			}
-		}
-
-		const std::vector<point>& getGlyphPath(const std::string& text) override
-		{
-			auto it = glyph_path_cache_.find(text);
-			if(it != glyph_path_cache_.end()) {
-				return it->second;
-			}
-			std::vector<point>& path = glyph_path_cache_[text];
-
-			auto cp_str = utils::utf8_to_codepoint(text);
-
-			std::vector<char32_t> glyphs_to_add;
-			for(char32_t cp : cp_str) {
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					glyphs_to_add.emplace_back(cp);
-				}
-			}
-			if(!glyphs_to_add.empty()) {
-				addGlyphsToTexture(glyphs_to_add);
+			auto cached = glyph_path_cache_.get(text);
+			if(cached != nullptr) {
+				return *cached;
 			}
+			std::vector<point> path;
 
 			point pen;
-			for(char32_t cp : cp_str) {
+			for(char32_t cp : utils::utf8_to_codepoint(text)) {
 				path.emplace_back(pen);
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					cp = 0xfffd;
-					it = packed_char_.find(UnicodeRange(0xfffd));
-					if(it == packed_char_.end()) {
-						continue;
-					}
-				}
-				
-				stbtt_packedchar *b = it->second.data() + cp - it->first.first;
-				pen.x += static_cast<int>(b->xadvance * 65536.0f);
+				pen.x += static_cast<int>(getMetrics(cp).xadvance * 65536.0f);
 			}
 			path.emplace_back(pen);
 
-			return path;
+			return glyph_path_cache_.put(text, std::move(path));
 		}
 
 		FontRenderablePtr createRenderableFromPath(FontRenderablePtr font_renderable, const std::string& text, const std::vector<point>& path) override
 		{			
-			auto cp_string = utils::utf8_to_codepoint(text);
-			int glyphs_in_text = 0;
-			std::vector<char32_t> glyphs_to_add;
-			for(char32_t cp : cp_string) {
-				++glyphs_in_text;
-
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					glyphs_to_add.emplace_back(cp);
-				}
-			}
-			if(!glyphs_to_add.empty()) {
-				addGlyphsToTexture(glyphs_to_add);
-			}
+			const std::vector<char32_t> cp_string = addTextGlyphs(text);
+			const TexturePtr& font_texture = GlyphAtlas::get().getTexture();
 			
 			if(font_renderable == nullptr) {
 				font_renderable = std::make_shared<FontRenderable>();
-				font_renderable->setTexture(font_texture_);
+				font_renderable->setTexture(font_texture);
 			} else {
 				font_renderable->clear();
+				if(font_renderable->getTexture() != font_texture) {
+					font_renderable->setTexture(font_texture);
+				}
 			}
+			font_renderable->setDistanceField(distance_field_ != nullptr);
 
 			int width = font_renderable->getWidth();
 			int height = font_renderable->getHeight();
 			int max_height = 0;
 
 			std::vector<font_coord> coords;
-			coords.reserve(glyphs_in_text * 6);
+			coords.reserve(cp_string.size() * 6);
 			int n = 0;
 			for(char32_t cp : cp_string) {
 				ASSERT_LOG(n < static_cast<int>(path.size()), "Insufficient points were supplied to create a path from the string '" << text << "'");
 				auto& pt =path[n];
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					it = packed_char_.find(UnicodeRange(0xfffd));
-					if(it == packed_char_.end()) {
-						continue;
-					}
+				const GlyphAtlas::Slot* slot = GlyphAtlas::get().find(face_, cp);
+				if(slot == nullptr) {
+					continue;
 				}
-
-				stbtt_packedchar *b = it->second.data() + cp - it->first.first;
+				const GlyphMetrics& b = getMetrics(cp);
 
 				//width += pt.x >> 16;
-				//width += static_cast<int>(b->xoff2 - b->xoff);
-				max_height = std::max(max_height, static_cast<int>(b->yoff2 - b->yoff));
-
-				const float u1 = font_texture_->getTextureCoordW(0, b->x0);
-				const float v1 = font_texture_->getTextureCoordH(0, b->y0);
-				const float u2 = font_texture_->getTextureCoordW(0, b->x1);
-				const float v2 = font_texture_->getTextureCoordH(0, b->y1);
-
-				const float x1 = static_cast<float>(pt.x) / 65536.0f + b->xoff;
-				const float y1 = static_cast<float>(pt.y) / 65536.0f + b->yoff;
-				const float x2 = x1 + b->xoff2 - b->xoff;
-				const float y2 = y1 + b->yoff2 - b->yoff;
+				//width += static_cast<int>(b.xoff2 - b.xoff);
+				max_height = std::max(max_height, static_cast<int>(b.yoff2 - b.yoff));
+
+				const float u1 = font_texture->getTextureCoordW(0, slot->x);
+				const float v1 = font_texture->getTextureCoordH(0, slot->y);
+				const float u2 = font_texture->getTextureCoordW(0, slot->x + slot->w);
+				const float v2 = font_texture->getTextureCoordH(0, slot->y + slot->h);
+
+				float x1, y1, x2, y2;
+				getGlyphQuad(cp, pt, &x1, &y1, &x2, &y2);
 				coords.emplace_back(glm::vec2(x1, y2), glm::vec2(u1, v2));
 				coords.emplace_back(glm::vec2(x1, y1), glm::vec2(u1, v1));
 				coords.emplace_back(glm::vec2(x2, y1), glm::vec2(u2, v1));
@@ -316,60 +369,45 @@ namespace KRE
 
 		ColoredFontRenderablePtr createColoredRenderableFromPath(ColoredFontRenderablePtr font_renderable, const std::string& text, const std::vector<point>& path, const std::vector<KRE::Color>& colors) override
 		{
-			auto cp_string = utils::utf8_to_codepoint(text);
-			int glyphs_in_text = 0;
-			std::vector<char32_t> glyphs_to_add;
-			for(char32_t cp : cp_string) {
-				++glyphs_in_text;
-
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					glyphs_to_add.emplace_back(cp);
-				}
-			}
-			if(!glyphs_to_add.empty()) {
-				addGlyphsToTexture(glyphs_to_add);
-			}
-			ASSERT_LOG(glyphs_in_text == colors.size(), "Not enough/Too many colors for the text.");
+			const std::vector<char32_t> cp_string = addTextGlyphs(text);
+			const TexturePtr& font_texture = GlyphAtlas::get().getTexture();
+			ASSERT_LOG(cp_string.size() == colors.size(), "Not enough/Too many colors for the text.");
 			
 			if(font_renderable == nullptr) {
 				font_renderable = std::make_shared<ColoredFontRenderable>();
-				font_renderable->setTexture(font_texture_);
+				font_renderable->setTexture(font_texture);
+			} else if(font_renderable->getTexture() != font_texture) {
+				font_renderable->setTexture(font_texture);
 			}
+			font_renderable->setDistanceField(distance_field_ != nullptr);
 
 			int width = font_renderable->getWidth();
 			int height = font_renderable->getHeight();
 			int max_height = 0;
 
 			std::vector<font_coord> coords;
-			coords.reserve(glyphs_in_text * 6);
+			coords.reserve(cp_string.size() * 6);
 			int n = 0;
 			for(char32_t cp : cp_string) {
 				ASSERT_LOG(n < static_cast<int>(path.size()), "Insufficient points were supplied to create a path from the string '" << text << "'");
 				auto& pt =path[n];
-				auto it = packed_char_.find(UnicodeRange(cp));
-				if(it == packed_char_.end()) {
-					it = packed_char_.find(UnicodeRange(0xfffd));
-					if(it == packed_char_.end()) {
-						continue;
-					}
+				const GlyphAtlas::Slot* slot = GlyphAtlas::get().find(face_, cp);
+				if(slot == nullptr) {
+					continue;
 				}
-
-				stbtt_packedchar *b = it->second.data() + cp - it->first.first;
+				const GlyphMetrics& b = getMetrics(cp);
 
 				//width += pt.x >> 16;
-				//width += static_cast<int>(b->xoff2 - b->xoff);
-				max_height = std::max(max_height, static_cast<int>(b->yoff2 - b->yoff));
-
-				const float u1 = font_texture_->getTextureCoordW(0, b->x0);
-				const float v1 = font_texture_->getTextureCoordH(0, b->y0);
-				const float u2 = font_texture_->getTextureCoordW(0, b->x1);
-				const float v2 = font_texture_->getTextureCoordH(0, b->y1);
-
-				const float x1 = static_cast<float>(pt.x) / 65536.0f + b->xoff;
-				const float y1 = static_cast<float>(pt.y) / 65536.0f + b->yoff;
-				const float x2 = x1 + b->xoff2 - b->xoff;
-				const float y2 = static_cast<float>(pt.y) / 65536.0f + b->yoff2;
+				//width += static_cast<int>(b.xoff2 - b.xoff);
+				max_height = std::max(max_height, static_cast<int>(b.yoff2 - b.yoff));
+
+				const float u1 = font_texture->getTextureCoordW(0, slot->x);
+				const float v1 = font_texture->getTextureCoordH(0, slot->y);
+				const float u2 = font_texture->getTextureCoordW(0, slot->x + slot->w);
+				const float v2 = font_texture->getTextureCoordH(0, slot->y + slot->h);
+
+				float x1, y1, x2, y2;
+				getGlyphQuad(cp, pt, &x1, &y1, &x2, &y2);
 				coords.emplace_back(glm::vec2(x1, y2), glm::vec2(u1, v2));
 				coords.emplace_back(glm::vec2(x1, y1), glm::vec2(u1, v1));
 				coords.emplace_back(glm::vec2(x2, y1), glm::vec2(u2, v1));
@@ -396,15 +434,7 @@ namespace KRE
 			//int bearing = 0;
 			//stbtt_GetCodepointHMetrics(&font_handle_, cp, &advance, &bearing);
 			//return static_cast<int>(advance * scale_ * 65536.0f);
-			auto it = packed_char_.find(UnicodeRange(cp));
-			if(it == packed_char_.end()) {
-				int advance = 0;
-				int bearing = 0;
-				stbtt_GetCodepointHMetrics(&font_handle_, cp, &advance, &bearing);
-				return static_cast<int>(advance * scale_ * 65536.0f);
-			}		
-			stbtt_packedchar *b = it->second.data() + cp - it->first.first;
-			return static_cast<int>(b->xadvance * 65536.0f);
+			return static_cast<int>(getMetrics(cp).xadvance * 65536.0f);
 		}
 
 		void addGlyphsToTexture(const std::vector<char32_t>& codepoints) override
@@ -413,49 +443,7 @@ namespace KRE
 				LOG_WARN("stb_impl::addGlyphsToTexture: no codepoints.");
 				return;
 			}
-			int old_size = packed_char_.size();
-			auto ttf_buffer = reinterpret_cast<const unsigned char*>(font_data_.c_str());
-			if(font_size_ < 20.0f) {
-				stbtt_PackSetOversampling(&pc_, 2, 2);
-			}
-			
-			std::vector<stbtt_pack_range> ranges;
-			char32_t last_cp = codepoints.front();
-			char32_t first_cp = codepoints.front();
-			int num_chars = 1;
-			for(auto it = codepoints.begin() + 1; it != codepoints.end(); ++it) {
-				char32_t cp = *it;
-				if(cp == last_cp+1) {
-					++num_chars;
-				} else {
-					auto& packed_data = packed_char_[UnicodeRange(first_cp, first_cp+num_chars-1)];
-					packed_data.resize(num_chars);
-
-					stbtt_pack_range range;
-					range.num_chars_in_range          = num_chars;
-					range.chardata_for_range          = packed_data.data();
-					range.font_size                   = font_size_;
-					range.first_unicode_char_in_range = first_cp;
-					ranges.emplace_back(range);
-
-					num_chars = 1;
-					first_cp = cp;					
-				}
-				last_cp = cp;
-			}
-			auto& packed_data = packed_char_[UnicodeRange(first_cp, first_cp+num_chars-1)];
-			packed_data.resize(num_chars);
-
-			stbtt_pack_range range;
-			range.num_chars_in_range          = num_chars;
-			range.chardata_for_range          = packed_data.data();
-			range.font_size                   = font_size_;
-			range.first_unicode_char_in_range = first_cp;
-			ranges.emplace_back(range);
-
-			stbtt_PackFontRanges(&pc_, ttf_buffer, 0, ranges.data(), ranges.size());
-
-			font_texture_->update2D(0, 0, 0, surface_width, surface_height, surface_width, pixels_.data());
+			GlyphAtlas::get().addGlyphs(face_, codepoints);
 		}
 
 		void* getRawFontHandle() override
@@ -468,6 +456,78 @@ namespace KRE
 			return line_gap_;
 		}
 	private:
+		std::vector<char32_t> addTextGlyphs(const std::string& text)
+		{
+			auto cp_str = utils::utf8_to_codepoint(text);
+			std::vector<char32_t> res(cp_str.begin(), cp_str.end());
+			GlyphAtlas::get().addGlyphs(face_, res);
+			return res;
+		}
+
+		// Same placement stbtt_PackFontRanges would give the glyph, the bitmap is padded by
+		// oversample-1 pixels for the prefilter.
+		const GlyphMetrics& getMetrics(char32_t cp)
+		{
+			auto it = metrics_.find(cp);
+			if(it != metrics_.end()) {
+				return it->second;
+			}
+			GlyphMetrics& m = metrics_[cp];
+			const float recip = 1.0f / oversample_;
+			const float sub = stbtt__oversample_shift(oversample_);
+			int advance, lsb, x0, y0, x1, y1;
+			m.glyph = stbtt_FindGlyphIndex(&font_handle_, cp);
+			stbtt_GetGlyphHMetrics(&font_handle_, m.glyph, &advance, &lsb);
+			stbtt_GetGlyphBitmapBox(&font_handle_, m.glyph, pack_scale_ * oversample_, pack_scale_ * oversample_, &x0, &y0, &x1, &y1);
+			m.width = x1 - x0 + oversample_ - 1;
+			m.height = y1 - y0 + oversample_ - 1;
+			m.xadvance = pack_scale_ * advance;
+			m.xoff = x0 * recip + sub;
+			m.yoff = y0 * recip + sub;
+			m.xoff2 = (x0 + m.width) * recip + sub;
+			m.yoff2 = (y0 + m.height) * recip + sub;
+			return m;
+		}
+
+		// Rectangle the glyph's atlas slot is drawn to with the pen at pt. Distance field glyphs
+		// are scaled from their own size.
+		void getGlyphQuad(char32_t cp, const point& pt, float* x1, float* y1, float* x2, float* y2)
+		{
+			const float pen_x = static_cast<float>(pt.x) / 65536.0f;
+			const float pen_y = static_cast<float>(pt.y) / 65536.0f;
+			if(distance_field_ != nullptr) {
+				const DistanceFieldFace::Box& box = distance_field_->getBox(cp);
+				const float scale = pack_scale_ / distance_field_->getScale();
+				*x1 = pen_x + box.xoff * scale;
+				*y1 = pen_y + box.yoff * scale;
+				*x2 = *x1 + box.width * scale;
+				*y2 = *y1 + box.height * scale;
+				return;
+			}
+			const GlyphMetrics& b = getMetrics(cp);
+			*x1 = pen_x + b.xoff;
+			*y1 = pen_y + b.yoff;
+			*x2 = *x1 + b.xoff2 - b.xoff;
+			*y2 = *y1 + b.yoff2 - b.yoff;
+		}
+
+		void rasterise(char32_t cp, GlyphBitmap* bitmap)
+		{
+			const GlyphMetrics& m = getMetrics(cp);
+			bitmap->width = m.width;
+			bitmap->height = m.height;
+			bitmap->pixels.assign(m.width * m.height, 0);
+			if(m.width <= 0 || m.height <= 0) {
+				return;
+			}
+			unsigned char* pixels = bitmap->pixels.data();
+			stbtt_MakeGlyphBitmapSubpixel(&font_handle_, pixels, m.width - oversample_ + 1, m.height - oversample_ + 1, m.width, pack_scale_ * oversample_, pack_scale_ * oversample_, 0, 0, m.glyph);
+			if(oversample_ > 1) {
+				stbtt__h_prefilter(pixels, m.width, m.height, m.width, oversample_);
+				stbtt__v_prefilter(pixels, m.width, m.height, m.width, oversample_);
+			}
+		}
+
 		stbtt_fontinfo font_handle_;
 		std::string font_data_;
 		int ascent_;
@@ -477,10 +537,13 @@ namespace KRE
 		float scale_;
 		float font_size_;
 		float line_gap_;
-		stbtt_pack_context pc_;
-		std::map<UnicodeRange, std::vector<stbtt_packedchar>, UnicodeRange> packed_char_;
-		std::vector<unsigned char> pixels_;
-		TexturePtr font_texture_;
+		// Scale and oversampling the glyph bitmaps are rendered at.
+		float pack_scale_;
+		int oversample_;
+		std::unordered_map<char32_t, GlyphMetrics> metrics_;
+		int face_;
+		// Set when glyphs are drawn from distance fields, face_ then belongs to it.
+		std::shared_ptr<DistanceFieldFace> distance_field_;
 	};
 
 	FontDriverRegistrar stb_font_impl("stb", [](const std::string& fnt_name, const std::string& fnt_path, float size, const Color& color, bool init_texture){ 
@@ -147,6 +147,20 @@ namespace KRE
 		return true;
 	}
 
+	// Returns false only if the box is completely outside one of the planes. Only the corner 
+	// furthest along each plane's normal needs testing.
+	bool Frustum::isBoxInside(const glm::vec3& mn, const glm::vec3& mx) const
+	{
+		for(int n = NEAR_PLANE; n < MAX_PLANES; ++n) {
+			const glm::vec4& p = planes_[n];
+			const glm::vec4 corner(p.x >= 0.0f ? mx.x : mn.x, p.y >= 0.0f ? mx.y : mn.y, p.z >= 0.0f ? mx.z : mn.z, 1.0f);
+			if(glm::dot(p, corner) < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
 	// Returns >0 if cube is inside the frustum
 	// Returns <0 if cube is outside frustum
 	// Returns 0 if cube intersects.
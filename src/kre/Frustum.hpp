@@ -42,6 +42,8 @@ namespace KRE
 		bool isPointInside(const glm::vec3& pt) const;
 		bool isCircleInside(const glm::vec3& pt, float radius) const;
 		bool isCubeInside(const glm::vec3& pt, float xlen, float ylen, float zlen) const;
+		// Axis-aligned box given by its minimum and maximum corners.
+		bool isBoxInside(const glm::vec3& mn, const glm::vec3& mx) const;
 		
 		int doesCircleIntersect(const glm::vec3& pt, float radius) const;
 		int doesCubeIntersect(const glm::vec3& pt, float xlen, float ylen, float zlen) const;
@@ -752,6 +752,9 @@ namespace KRE
 		bool ShaderProgram::link(const std::vector<Shader>& shader_programs)
 		{
 			if(object_) {
+				if(get_current_active_shader() == object_) {
+					get_current_active_shader() = 0;
+				}
 				glDeleteProgram(object_);
 				object_ = 0;
 			}
@@ -834,9 +837,9 @@ namespace KRE
 
 		void ShaderProgram::makeActive()
 		{
-			//if(get_current_active_shader() == object_) {
-			//	return;
-			//}
+			if(get_current_active_shader() == object_) {
+				return;
+			}
 			glUseProgram(object_);
 			get_current_active_shader() = object_;
 		}
@@ -1202,6 +1205,7 @@ namespace KRE
 		void ShaderProgram::setActives()
 		{
 			glUseProgram(object_);
+			get_current_active_shader() = object_;
 			// Cache some frequently used uniforms.
 			u_mvp_ = getUniform("mvp_matrix");
 			u_mv_ = getUniform("mv_matrix");
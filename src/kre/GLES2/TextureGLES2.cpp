@@ -237,7 +237,7 @@ namespace KRE
 
 	void TextureGLESv2::handleAddPalette(int index, const SurfacePtr& palette)
 	{
-		//profile::manager pman("handleAddPalette");
+		PROFILE_ZONE("GLESv2Texture::handleAddPalette");
 		ASSERT_LOG(is_yuv_planar_ == false, "Can't create a palette for a YUV surface.");
 		ASSERT_LOG(index < maximum_palette_variations, "index of (" << index << ") exceeds the maximum soft palette limit: " << maximum_palette_variations);
 
@@ -282,7 +282,9 @@ namespace KRE
 				ASSERT_LOG(td.palette.size() < 256, "Can't convert surface to palettized version. Too many colors in source image > 256");
 			});
 			surf->writePixels(&new_pixels[0], static_cast<int>(new_pixels.size()));
-			surf->setAlphaMap(getSurface(0)->getAlphaMap());
+			if(getSurface(0)->hasAlphaMap()) {
+				surf->setAlphaMap(getSurface(0)->getAlphaMap());
+			}
 
 			//LOG_DEBUG("adding palette '" << palette->getName() << "' to: " << getSurface(0)->getName() << ". " << td.color_index_map.size() << " colors in map");
 
@@ -638,6 +640,14 @@ namespace KRE
 		}
 	}
 
+	void TextureGLESv2::handleSurfaceLoaded(int n)
+	{
+		texture_data_[n] = TextureData();
+		texture_data_[n].surface_format = getSurface(n)->getPixelFormat()->getFormat();
+		createTexture(n);
+		init(n);
+	}
+
 	const unsigned char* TextureGLESv2::colorAt(int x, int y) const 
 	{
 		if(getFrontSurface() == nullptr) {
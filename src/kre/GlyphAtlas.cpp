@@ -0,0 +1,311 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "asserts.hpp"
+#include "GlyphAtlas.hpp"
+#include "WorkerPool.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		const int page_width = 2048;
+		const int page_height = 2048;
+		// Empty pixels kept to the right of and below every glyph so linear filtering
+		// doesn't pick up its neighbours.
+		const int glyph_padding = 1;
+	}
+
+	GlyphAtlas& GlyphAtlas::get()
+	{
+		// Never destroyed, fonts held in static caches unregister from it at exit and the
+		// textures shouldn't outlive the display device anyway.
+		static GlyphAtlas* res = new GlyphAtlas();
+		return *res;
+	}
+
+	GlyphAtlas::GlyphAtlas()
+		: faces_(),
+		  next_face_(1),
+		  slots_(),
+		  packer_(),
+		  pixels_(),
+		  dirty_(),
+		  staging_(),
+		  texture_(),
+		  pages_(0),
+		  uploads_(0),
+		  upload_bytes_(0),
+		  hits_(0),
+		  misses_(0),
+		  evictions_(0)
+	{
+	}
+
+	int GlyphAtlas::addFace(rasterise_fn fn, bool concurrent)
+	{
+		ASSERT_LOG(fn != nullptr, "GlyphAtlas::addFace: no rasterise function given.");
+		const int face = next_face_++;
+		faces_[face].fn = fn;
+		faces_[face].concurrent = concurrent;
+		return face;
+	}
+
+	void GlyphAtlas::removeFace(int face)
+	{
+		faces_.erase(face);
+		for(auto it = slots_.begin(); it != slots_.end(); ) {
+			if(static_cast<int>(it->first >> 32) == face) {
+				it = slots_.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	void GlyphAtlas::addGlyphs(int face, const std::vector<char32_t>& codepoints)
+	{
+		ASSERT_LOG(faces_.find(face) != faces_.end(), "GlyphAtlas::addGlyphs: unknown face " << face);
+		if(texture_ == nullptr) {
+			beginPage();
+		}
+		const unsigned frame = FontDriver::getFrame() + 1;
+		// Glyphs kept from a full page, with when they were last used.
+		std::vector<std::pair<unsigned, uint64_t>> carried;
+		bitmap_map bitmaps;
+		for(int attempt = 0; attempt != 2; ++attempt) {
+			std::vector<uint64_t> missing;
+			for(char32_t cp : codepoints) {
+				const uint64_t key = make_key(face, cp);
+				auto it = slots_.find(key);
+				if(it == slots_.end()) {
+					missing.emplace_back(key);
+				} else {
+					it->second.last_use = frame;
+				}
+			}
+			if(attempt == 0) {
+				misses_ += missing.size();
+				hits_ += codepoints.size() - missing.size();
+			}
+			if(missing.empty()) {
+				break;
+			}
+			std::sort(missing.begin(), missing.end());
+			missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+			rasterise(missing, &bitmaps);
+			bool page_full = false;
+			for(auto key : missing) {
+				if(!place(key, bitmaps[key], frame)) {
+					page_full = true;
+					break;
+				}
+			}
+			if(!page_full || attempt != 0) {
+				break;
+			}
+
+			// Start over on a new page. The whole string has to come from one texture, so
+			// its glyphs are placed first on the next pass, then whatever else was used
+			// recently is carried over, newest first and at most half a page of it so the
+			// new page doesn't fill straight back up when the working set is too large.
+			const unsigned idle_frames = FontDriver::getCacheLimits().glyph_idle_frames;
+			std::vector<std::pair<unsigned, uint64_t>> recent;
+			for(auto& slot : slots_) {
+				if(frame - slot.second.last_use <= idle_frames) {
+					recent.emplace_back(slot.second.last_use, slot.first);
+				}
+			}
+			std::sort(recent.begin(), recent.end(), [](const std::pair<unsigned, uint64_t>& a, const std::pair<unsigned, uint64_t>& b) {
+				return a.first > b.first;
+			});
+			long long carried_area = 0;
+			for(auto& r : recent) {
+				const Slot& slot = slots_[r.second];
+				carried_area += static_cast<long long>(slot.w + glyph_padding) * (slot.h + glyph_padding);
+				if(carried_area > static_cast<long long>(page_width) * page_height / 2) {
+					break;
+				}
+				carried.emplace_back(r);
+			}
+			evictions_ += slots_.size() - carried.size();
+			LOG_DEBUG("GlyphAtlas: page " << pages_ << " is full (" << slots_.size() << " glyphs), starting a new page with " << carried.size() << " recently used glyphs.");
+			beginPage();
+		}
+
+		// Carried glyphs keep their last use, only the ones in this string count as used now,
+		// so glyphs that stop being drawn still age out across several page changes.
+		std::vector<uint64_t> carried_keys;
+		for(auto& c : carried) {
+			carried_keys.emplace_back(c.second);
+		}
+		rasterise(carried_keys, &bitmaps);
+		for(auto it = carried.begin(); it != carried.end(); ++it) {
+			if(slots_.find(it->second) == slots_.end() && !place(it->second, bitmaps[it->second], it->first)) {
+				evictions_ += carried.end() - it;
+				break;
+			}
+		}
+		uploadDirty();
+	}
+
+	const GlyphAtlas::Slot* GlyphAtlas::find(int face, char32_t cp) const
+	{
+		auto it = slots_.find(make_key(face, cp));
+		return it != slots_.end() ? &it->second : nullptr;
+	}
+
+	GlyphAtlasStats GlyphAtlas::getStats() const
+	{
+		GlyphAtlasStats stats;
+		stats.pages = pages_;
+		stats.glyphs = static_cast<int>(slots_.size());
+		stats.used_area = packer_ != nullptr ? packer_->getUsedArea() : 0;
+		stats.page_area = static_cast<long long>(page_width) * page_height;
+		stats.uploads = uploads_;
+		stats.upload_bytes = upload_bytes_;
+		stats.hits = hits_;
+		stats.misses = misses_;
+		stats.evictions = evictions_;
+		return stats;
+	}
+
+	void GlyphAtlas::beginPage()
+	{
+		uploadDirty();
+		slots_.clear();
+		packer_.reset(new RectPacker(page_width, page_height));
+		pixels_.assign(page_width * page_height, 0);
+		texture_ = Texture::createTexture2D(page_width, page_height, PixelFormat::PF::PIXELFORMAT_R8);
+		texture_->setUnpackAlignment(0, 1);
+		texture_->setFiltering(0, Texture::Filtering::LINEAR, Texture::Filtering::LINEAR, Texture::Filtering::NONE);
+		// Clear the texture once so padding and unused space never hold garbage, after
+		// this only the rectangles glyphs are drawn into get uploaded.
+		texture_->update2D(0, 0, 0, page_width, page_height, page_width, pixels_.data());
+		++pages_;
+	}
+
+	void GlyphAtlas::rasterise(const std::vector<uint64_t>& keys, bitmap_map* bitmaps)
+	{
+		struct Job
+		{
+			const rasterise_fn* fn;
+			char32_t cp;
+			GlyphBitmap* bitmap;
+		};
+		std::vector<Job> jobs;
+		for(auto key : keys) {
+			auto face = faces_.find(static_cast<int>(key >> 32));
+			if(face == faces_.end() || bitmaps->find(key) != bitmaps->end()) {
+				continue;
+			}
+			// References into the map stay valid as it grows.
+			Job job = { &face->second.fn, static_cast<char32_t>(key & 0xffffffff), &(*bitmaps)[key] };
+			if(face->second.concurrent) {
+				jobs.emplace_back(job);
+			} else {
+				(*job.fn)(job.cp, job.bitmap);
+			}
+		}
+		if(!jobs.empty()) {
+			WorkerPool::getDefault().parallelFor(jobs.size(), [&jobs](std::size_t n) {
+				(*jobs[n].fn)(jobs[n].cp, jobs[n].bitmap);
+			});
+		}
+	}
+
+	bool GlyphAtlas::place(uint64_t key, const GlyphBitmap& bitmap, unsigned last_use)
+	{
+		if(faces_.find(static_cast<int>(key >> 32)) == faces_.end()) {
+			return true;
+		}
+		ASSERT_LOG(static_cast<int>(bitmap.pixels.size()) >= bitmap.width * bitmap.height, "GlyphAtlas: glyph bitmap is smaller than its size.");
+
+		rect area;
+		int width = bitmap.width;
+		int height = bitmap.height;
+		if(width + glyph_padding > page_width || height + glyph_padding > page_height) {
+			LOG_WARN("GlyphAtlas: glyph " << static_cast<unsigned>(key & 0xffffffff) << " is too large for a " << page_width << "x" << page_height << " page.");
+			width = height = 0;
+		}
+		if(width > 0 && height > 0) {
+			if(!packer_->insert(width + glyph_padding, height + glyph_padding, &area)) {
+				return false;
+			}
+			for(int y = 0; y != height; ++y) {
+				std::memcpy(&pixels_[(area.y() + y) * page_width + area.x()], &bitmap.pixels[y * width], width);
+			}
+			dirty_.emplace_back(area.x(), area.y(), width, height);
+		}
+
+		Slot& slot = slots_[key];
+		slot.x = static_cast<unsigned short>(area.x());
+		slot.y = static_cast<unsigned short>(area.y());
+		slot.w = static_cast<unsigned short>(width);
+		slot.h = static_cast<unsigned short>(height);
+		slot.last_use = last_use;
+		return true;
+	}
+
+	// Scattered rectangles are sent one at a time, otherwise a single upload of their
+	// union is cheaper.
+	void GlyphAtlas::uploadDirty()
+	{
+		if(dirty_.empty()) {
+			return;
+		}
+		int x1 = page_width, y1 = page_height, x2 = 0, y2 = 0;
+		long long dirty_area = 0;
+		for(auto& r : dirty_) {
+			x1 = std::min(x1, r.x1());
+			y1 = std::min(y1, r.y1());
+			x2 = std::max(x2, r.x2());
+			y2 = std::max(y2, r.y2());
+			dirty_area += r.w() * r.h();
+		}
+		if(dirty_area * 2 >= static_cast<long long>(x2 - x1) * (y2 - y1)) {
+			uploadRect(rect(x1, y1, x2 - x1, y2 - y1));
+		} else {
+			for(auto& r : dirty_) {
+				uploadRect(r);
+			}
+		}
+		dirty_.clear();
+	}
+
+	void GlyphAtlas::uploadRect(const rect& r)
+	{
+		// update2D expects tightly packed rows.
+		staging_.resize(r.w() * r.h());
+		for(int y = 0; y != r.h(); ++y) {
+			std::memcpy(&staging_[y * r.w()], &pixels_[(r.y() + y) * page_width + r.x()], r.w());
+		}
+		texture_->update2D(0, r.x(), r.y(), r.w(), r.h(), r.w(), staging_.data());
+		++uploads_;
+		upload_bytes_ += r.w() * r.h();
+	}
+}
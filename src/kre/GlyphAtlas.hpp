@@ -0,0 +1,120 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "FontDriver.hpp"
+#include "RectPacker.hpp"
+
+namespace KRE
+{
+	// 8-bit coverage bitmap of a single glyph with tightly packed rows.
+	struct GlyphBitmap
+	{
+		GlyphBitmap() : width(0), height(0), pixels() {}
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Process wide R8 glyph atlas shared by all fonts and sizes, so that text in different
+	// fonts can be drawn from the same texture. Glyphs are keyed by (face, codepoint) where a
+	// face is a font at a particular size, registered with a function that rasterises its
+	// glyphs. Only the current page is kept. When it fills up a new page is started and the
+	// glyphs used recently are rasterised onto it again, the rest are evicted. Renderables
+	// built from an older page keep that page's texture alive.
+	class GlyphAtlas
+	{
+	public:
+		struct Slot
+		{
+			unsigned short x;
+			unsigned short y;
+			unsigned short w;
+			unsigned short h;
+			// Frame (plus one) the glyph was last asked for.
+			unsigned last_use;
+		};
+		typedef std::function<void(char32_t cp, GlyphBitmap* bitmap)> rasterise_fn;
+
+		static GlyphAtlas& get();
+
+		// A concurrent face's function may be called from several worker threads at once,
+		// its glyphs are then rasterised in parallel.
+		int addFace(rasterise_fn fn, bool concurrent=false);
+		void removeFace(int face);
+
+		// Makes sure all the codepoints are on the current page and marks them as used this
+		// frame. Afterwards they can all be drawn with getTexture().
+		void addGlyphs(int face, const std::vector<char32_t>& codepoints);
+		// Position of the glyph on the current page, nullptr if it isn't on it.
+		const Slot* find(int face, char32_t cp) const;
+
+		const TexturePtr& getTexture() const { return texture_; }
+		int getPageCount() const { return pages_; }
+		GlyphAtlasStats getStats() const;
+	private:
+		GlyphAtlas();
+
+		struct Face
+		{
+			rasterise_fn fn;
+			bool concurrent;
+		};
+		typedef std::unordered_map<uint64_t, GlyphBitmap> bitmap_map;
+
+		static uint64_t make_key(int face, char32_t cp) { return (static_cast<uint64_t>(face) << 32) | cp; }
+
+		void beginPage();
+		// Adds bitmaps for any of the keys not already in the map.
+		void rasterise(const std::vector<uint64_t>& keys, bitmap_map* bitmaps);
+		// Copies a glyph onto the current page, returns false if there is no room for it.
+		bool place(uint64_t key, const GlyphBitmap& bitmap, unsigned last_use);
+		void uploadDirty();
+		void uploadRect(const rect& r);
+
+		std::unordered_map<int, Face> faces_;
+		int next_face_;
+		std::unordered_map<uint64_t, Slot> slots_;
+		std::unique_ptr<RectPacker> packer_;
+		std::vector<unsigned char> pixels_;
+		std::vector<rect> dirty_;
+		std::vector<unsigned char> staging_;
+		TexturePtr texture_;
+		int pages_;
+		long long uploads_;
+		long long upload_bytes_;
+		long long hits_;
+		long long misses_;
+		long long evictions_;
+
+		GlyphAtlas(const GlyphAtlas&);
+		void operator=(const GlyphAtlas&);
+	};
+}
@@ -0,0 +1,172 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+namespace KRE
+{
+	struct LruCacheStats
+	{
+		LruCacheStats() : entries(0), bytes(0), hits(0), misses(0), evictions(0) {}
+		float getHitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+		size_t entries;
+		size_t bytes;
+		unsigned long long hits;
+		unsigned long long misses;
+		unsigned long long evictions;
+	};
+
+	// Least recently used cache bounded by entry count and, if a size function is given,
+	// by the total bytes reported for its entries. A limit of zero means unbounded.
+	// Pointers and references to values remain valid until that entry is evicted.
+	template<typename Key, typename Value, typename Hash=std::hash<Key>>
+	class LruCache
+	{
+	public:
+		typedef std::function<size_t(const Key&, const Value&)> size_fn;
+
+		explicit LruCache(size_t max_entries=0, size_t max_bytes=0, size_fn fn=size_fn())
+			: max_entries_(max_entries),
+			  max_bytes_(max_bytes),
+			  size_fn_(fn),
+			  entries_(),
+			  index_(),
+			  stats_()
+		{
+		}
+
+		// Returns the cached value and marks it as most recently used, nullptr if absent.
+		Value* get(const Key& key)
+		{
+			auto it = index_.find(key);
+			if(it == index_.end()) {
+				++stats_.misses;
+				return nullptr;
+			}
+			++stats_.hits;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return &it->second->value;
+		}
+
+		// Inserts or replaces the value for key, then evicts from the cold end until the
+		// cache is back inside its limits. The new entry itself is never evicted.
+		Value& put(const Key& key, Value value)
+		{
+			auto it = index_.find(key);
+			if(it != index_.end()) {
+				stats_.bytes -= it->second->bytes;
+				entries_.erase(it->second);
+				index_.erase(it);
+			}
+			entries_.emplace_front(key, std::move(value));
+			Entry& e = entries_.front();
+			e.bytes = size_fn_ ? size_fn_(e.key, e.value) : 0;
+			stats_.bytes += e.bytes;
+			index_.emplace(key, entries_.begin());
+			trim();
+			stats_.entries = entries_.size();
+			return e.value;
+		}
+
+		void erase(const Key& key)
+		{
+			auto it = index_.find(key);
+			if(it != index_.end()) {
+				stats_.bytes -= it->second->bytes;
+				entries_.erase(it->second);
+				index_.erase(it);
+				stats_.entries = entries_.size();
+			}
+		}
+
+		// Evicts from the cold end for as long as pred(key, value) holds, returns the number
+		// of entries removed. Used to expire entries that have been idle for too long.
+		template<typename Pred>
+		size_t evictWhile(Pred pred)
+		{
+			size_t count = 0;
+			while(!entries_.empty() && pred(entries_.back().key, entries_.back().value)) {
+				Entry& e = entries_.back();
+				stats_.bytes -= e.bytes;
+				index_.erase(e.key);
+				entries_.pop_back();
+				++stats_.evictions;
+				++count;
+			}
+			stats_.entries = entries_.size();
+			return count;
+		}
+
+		void setLimits(size_t max_entries, size_t max_bytes)
+		{
+			max_entries_ = max_entries;
+			max_bytes_ = max_bytes;
+			trim();
+			stats_.entries = entries_.size();
+		}
+
+		void clear()
+		{
+			entries_.clear();
+			index_.clear();
+			stats_.entries = 0;
+			stats_.bytes = 0;
+		}
+
+		size_t size() const { return entries_.size(); }
+		bool empty() const { return entries_.empty(); }
+		const LruCacheStats& getStats() const { return stats_; }
+	private:
+		struct Entry
+		{
+			Entry(const Key& k, Value&& v) : key(k), value(std::move(v)), bytes(0) {}
+			Key key;
+			Value value;
+			size_t bytes;
+		};
+
+		void trim()
+		{
+			while(entries_.size() > 1
+				&& ((max_entries_ != 0 && entries_.size() > max_entries_) || (max_bytes_ != 0 && stats_.bytes > max_bytes_))) {
+				Entry& e = entries_.back();
+				stats_.bytes -= e.bytes;
+				index_.erase(e.key);
+				entries_.pop_back();
+				++stats_.evictions;
+			}
+		}
+
+		size_t max_entries_;
+		size_t max_bytes_;
+		size_fn size_fn_;
+		std::list<Entry> entries_;
+		std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+		LruCacheStats stats_;
+	};
+}
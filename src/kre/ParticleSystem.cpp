@@ -21,6 +21,8 @@
 	   distribution.
 */
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <chrono>
 
@@ -28,10 +30,13 @@
 #include "ParticleSystemAffectors.hpp"
 #include "ParticleSystemParameters.hpp"
 #include "ParticleSystemEmitters.hpp"
+#include "ParticleSystemKernels.hpp"
+#include "profile_timer.hpp"
 #include "SceneGraph.hpp"
 #include "Shaders.hpp"
 #include "spline.hpp"
 #include "WindowManager.hpp"
+#include "WorkerPool.hpp"
 #include "variant_utils.hpp"
 
 namespace KRE
@@ -42,7 +47,10 @@ namespace KRE
 		{
 			SceneNodeRegistrar<ParticleSystemContainer> psc_register("particle_system_container");
 
-			std::default_random_engine& get_rng_engine() 
+			// kernels::expand_quads() writes vertices in this layout.
+			static_assert(sizeof(vertex_texture_color3) == 24, "vertex_texture_color3 must be tightly packed");
+
+			std::default_random_engine& get_global_rng_engine() 
 			{
 				static std::unique_ptr<std::default_random_engine> res;
 				if(res == nullptr) {
@@ -51,6 +59,54 @@ namespace KRE
 				}
 				return *res;
 			}
+
+			// Generator belonging to the technique being processed on this thread.
+			KRE_THREAD_LOCAL std::default_random_engine* current_rng_engine = nullptr;
+
+			std::default_random_engine& get_rng_engine() 
+			{
+				return current_rng_engine != nullptr ? *current_rng_engine : get_global_rng_engine();
+			}
+
+			struct RngEngineScope
+			{
+				explicit RngEngineScope(std::default_random_engine& engine) : previous_(current_rng_engine) {
+					current_rng_engine = &engine;
+				}
+				~RngEngineScope() {
+					current_rng_engine = previous_;
+				}
+				std::default_random_engine* previous_;
+			};
+
+			std::uint32_t generate_seed()
+			{
+				return static_cast<std::uint32_t>(get_rng_engine()());
+			}
+
+			std::atomic<std::size_t>& get_bytes_streamed()
+			{
+				static std::atomic<std::size_t> res(0);
+				return res;
+			}
+
+			// Two triangles per quad, matching the corner order from kernels::expand_quads().
+			template<typename T>
+			std::vector<T> make_quad_indices(std::size_t quads)
+			{
+				std::vector<T> indices;
+				indices.reserve(quads * 6);
+				for(std::size_t n = 0; n != quads; ++n) {
+					const T base = static_cast<T>(n * 4);
+					indices.emplace_back(base);
+					indices.emplace_back(base + 1);
+					indices.emplace_back(base + 2);
+					indices.emplace_back(base + 2);
+					indices.emplace_back(base + 1);
+					indices.emplace_back(base + 3);
+				}
+				return indices;
+			}
 		}
 
 		void init_physics_parameters(PhysicsParameters& pp)
@@ -66,12 +122,152 @@ namespace KRE
 
 		}
 
+		void ParticlePool::reserve(std::size_t n)
+		{
+			position.reserve(n);
+			direction.reserve(n);
+			velocity.reserve(n);
+			time_to_live.reserve(n);
+			color.reserve(n);
+			dimensions.reserve(n);
+			mass.reserve(n);
+			orientation.reserve(n);
+			initial_direction.reserve(n);
+			initial_time_to_live.reserve(n);
+			initial_color.reserve(n);
+			initial_dimensions.reserve(n);
+			emitter_id.reserve(n);
+		}
+
+		void ParticlePool::clear()
+		{
+			position.clear();
+			direction.clear();
+			velocity.clear();
+			time_to_live.clear();
+			color.clear();
+			dimensions.clear();
+			mass.clear();
+			orientation.clear();
+			initial_direction.clear();
+			initial_time_to_live.clear();
+			initial_color.clear();
+			initial_dimensions.clear();
+			emitter_id.clear();
+		}
+
+		std::size_t ParticlePool::emit(const PhysicsParameters& pp, int id)
+		{
+			position.emplace_back(pp.position);
+			direction.emplace_back(pp.direction);
+			velocity.emplace_back(pp.velocity);
+			time_to_live.emplace_back(pp.time_to_live);
+			color.emplace_back(pp.color);
+			dimensions.emplace_back(pp.dimensions);
+			mass.emplace_back(pp.mass);
+			orientation.emplace_back(pp.orientation);
+			initial_direction.emplace_back(pp.direction);
+			initial_time_to_live.emplace_back(pp.time_to_live);
+			initial_color.emplace_back(pp.color);
+			initial_dimensions.emplace_back(pp.dimensions);
+			emitter_id.emplace_back(static_cast<std::uint8_t>(id));
+			return size() - 1;
+		}
+
+		std::size_t ParticlePool::emit(const Particle& p)
+		{
+			position.emplace_back(p.current.position);
+			direction.emplace_back(p.current.direction);
+			velocity.emplace_back(p.current.velocity);
+			time_to_live.emplace_back(p.current.time_to_live);
+			color.emplace_back(p.current.color);
+			dimensions.emplace_back(p.current.dimensions);
+			mass.emplace_back(p.current.mass);
+			orientation.emplace_back(p.current.orientation);
+			initial_direction.emplace_back(p.initial.direction);
+			initial_time_to_live.emplace_back(p.initial.time_to_live);
+			initial_color.emplace_back(p.initial.color);
+			initial_dimensions.emplace_back(p.initial.dimensions);
+			emitter_id.emplace_back(static_cast<std::uint8_t>(p.emitted_by != nullptr ? p.emitted_by->getEmitterId() : 0));
+			return size() - 1;
+		}
+
+		void ParticlePool::store(std::size_t n, Particle& p) const
+		{
+			ASSERT_LOG(n < size(), "Particle index out of range: " << n << " >= " << size());
+			p.current.position = position[n];
+			p.current.direction = direction[n];
+			p.current.velocity = velocity[n];
+			p.current.time_to_live = time_to_live[n];
+			p.current.color = color[n];
+			p.current.dimensions = dimensions[n];
+			p.current.mass = mass[n];
+			p.current.orientation = orientation[n];
+		}
+
+		void ParticlePool::kill(std::size_t n)
+		{
+			ASSERT_LOG(n < size(), "Particle index out of range: " << n << " >= " << size());
+			const std::size_t last = size() - 1;
+			if(n != last) {
+				position[n] = position[last];
+				direction[n] = direction[last];
+				velocity[n] = velocity[last];
+				time_to_live[n] = time_to_live[last];
+				color[n] = color[last];
+				dimensions[n] = dimensions[last];
+				mass[n] = mass[last];
+				orientation[n] = orientation[last];
+				initial_direction[n] = initial_direction[last];
+				initial_time_to_live[n] = initial_time_to_live[last];
+				initial_color[n] = initial_color[last];
+				initial_dimensions[n] = initial_dimensions[last];
+				emitter_id[n] = emitter_id[last];
+			}
+			position.pop_back();
+			direction.pop_back();
+			velocity.pop_back();
+			time_to_live.pop_back();
+			color.pop_back();
+			dimensions.pop_back();
+			mass.pop_back();
+			orientation.pop_back();
+			initial_direction.pop_back();
+			initial_time_to_live.pop_back();
+			initial_color.pop_back();
+			initial_dimensions.pop_back();
+			emitter_id.pop_back();
+		}
+
+		std::size_t ParticlePool::killExpired()
+		{
+			std::size_t killed = 0;
+			std::size_t n = kernels::find_expired(time_to_live.data(), 0, size());
+			while(n < size()) {
+				// The particle swapped into slot n needs checking as well, so search again from n.
+				kill(n);
+				++killed;
+				n = kernels::find_expired(time_to_live.data(), n, size());
+			}
+			return killed;
+		}
+
 		float get_random_float(float min, float max)
 		{
 			std::uniform_real_distribution<float> gen(min, max);
 			return gen(get_rng_engine());
 		}
 
+		void set_random_seed(std::uint32_t seed)
+		{
+			get_global_rng_engine().seed(seed);
+		}
+
+		std::size_t get_and_reset_bytes_streamed()
+		{
+			return get_bytes_streamed().exchange(0);
+		}
+
 		std::ostream& operator<<(std::ostream& os, const glm::vec3& v)
 		{
 			os << "[" << v.x << "," << v.y << "," << v.z << "]";
@@ -257,6 +453,13 @@ namespace KRE
 
 		void ParticleSystem::update(float dt)
 		{
+			if(active_techniques_.size() > 1 && getParentGraph()->isParallelProcess()) {
+				// Techniques only touch their own state, so can be processed in any order.
+				WorkerPool::getDefault().parallelFor(active_techniques_.size(), [this, dt](std::size_t n) {
+					active_techniques_[n]->emitProcess(dt);
+				});
+				return;
+			}
 			for(auto t : active_techniques_) {
 				t->emitProcess(dt);
 			}
@@ -293,6 +496,8 @@ namespace KRE
 		Technique::Technique(std::weak_ptr<ParticleSystemContainer> parent, const variant& node)
 			: SceneObject(node),
 			  EmitObject(parent, node), 
+			  index_capacity_(0),
+			  bytes_streamed_(0),
 			  default_particle_width_(node["default_particle_width"].as_float(1.0f)),
 			  default_particle_height_(node["default_particle_height"].as_float(1.0f)),
 			  default_particle_depth_(node["default_particle_depth"].as_float(1.0f)),
@@ -305,9 +510,13 @@ namespace KRE
 			  active_emitters_(),
 			  active_affectors_(),
 			  active_particles_(),
+			  emitter_particles_(),
 			  child_emitters_(),
 			  child_affectors_(),
-			  parent_particle_system_()
+			  parent_particle_system_(),
+			  seed_(node.has_key("seed") ? static_cast<std::uint32_t>(node["seed"].as_int()) : generate_seed()),
+			  explicit_seed_(node.has_key("seed")),
+			  rng_(seed_)
 		{
 			ASSERT_LOG(node.has_key("visual_particle_quota"), "'Technique' must have 'visual_particle_quota' attribute.");
 			//ASSERT_LOG(node.has_key("renderer"), "'Technique' must have 'renderer' attribute.");
@@ -394,6 +603,8 @@ namespace KRE
 		Technique::Technique(const Technique& tq) 
 			: SceneObject(tq),
 			  EmitObject(tq),
+			  index_capacity_(0),
+			  bytes_streamed_(0),
 			  default_particle_width_(tq.default_particle_width_),
 			  default_particle_height_(tq.default_particle_height_),
 			  default_particle_depth_(tq.default_particle_depth_),
@@ -402,7 +613,10 @@ namespace KRE
 			  affector_quota_(tq.affector_quota_),
 			  technique_quota_(tq.technique_quota_),
 			  system_quota_(tq.system_quota_),
-			  parent_particle_system_(tq.parent_particle_system_)
+			  parent_particle_system_(tq.parent_particle_system_),
+			  seed_(tq.explicit_seed_ ? tq.seed_ : generate_seed()),
+			  explicit_seed_(tq.explicit_seed_),
+			  rng_(seed_)
 		{
 			setShader(ShaderProgram::getProgram("vtc_shader"));
 
@@ -419,72 +633,83 @@ namespace KRE
 			parent_particle_system_ = parent;
 		}
 
+		void Technique::setSeed(std::uint32_t seed)
+		{
+			seed_ = seed;
+			explicit_seed_ = true;
+			rng_.seed(seed);
+		}
+
+		int Technique::lookupEmitterId(const std::string& name)
+		{
+			auto it = std::find(emitter_names_.begin(), emitter_names_.end(), name);
+			if(it != emitter_names_.end()) {
+				return static_cast<int>(it - emitter_names_.begin()) + 1;
+			}
+			// Affectors keep a 64-bit mask of excluded emitter id's.
+			ASSERT_LOG(emitter_names_.size() < 63, "Too many distinct emitter names in technique: " << getName());
+			emitter_names_.emplace_back(name);
+			return static_cast<int>(emitter_names_.size());
+		}
+
 		void Technique::handleEmitProcess(float t)
 		{
+			PROFILE_ZONE("Technique::handleEmitProcess");
+			RngEngineScope rng_scope(rng_);
+
 			// run objects
 			std::vector<EmitterPtr> active_emitters = active_emitters_;
 			for(auto e : active_emitters) {
 				e->emitProcess(t);
 			}
 
+			// Mirror the emitters into a pool so affectors have a single representation to work with.
+			emitter_particles_.clear();
+			for(auto& e : active_emitters_) {
+				emitter_particles_.emit(*e);
+			}
+
 			for(auto a : active_affectors_) {
 				a->emitProcess(t);
 			}
 
+			const float scale = getParticleSystem()->getScaleVelocity() * t;
+			const float max_velocity = max_velocity_ ? *max_velocity_ : 0.0f;
+
 			// Decrement the ttl on particles
-			for(auto& p : active_particles_) {
-				p.current.time_to_live -= t;
-			}
+			kernels::decrement_ttl(active_particles_.time_to_live.data(), active_particles_.size(), t);
+			kernels::decrement_ttl(emitter_particles_.time_to_live.data(), emitter_particles_.size(), t);
 
-			for(auto& e : active_emitters_) {
-				e->current.time_to_live -= t;
+			// Kill end-of-life particles
+			active_particles_.killExpired();
+
+			kernels::integrate(emitter_particles_.position.data(), 
+				emitter_particles_.direction.data(), 
+				emitter_particles_.velocity.data(), 
+				emitter_particles_.size(), 
+				scale, 
+				max_velocity_ != nullptr, 
+				max_velocity);
+
+			// Copy the updated state back to the emitters.
+			for(std::size_t n = 0; n != emitter_particles_.size(); ++n) {
+				emitter_particles_.store(n, *active_emitters_[n]);
 			}
 
-			// Kill end-of-life particles
-			active_particles_.erase(std::remove_if(active_particles_.begin(), active_particles_.end(),
-				[](decltype(active_particles_[0]) p){return p.current.time_to_live < 0.0f;}), 
-				active_particles_.end());
 			// Kill end-of-life emitters
 			active_emitters_.erase(std::remove_if(active_emitters_.begin(), active_emitters_.end(),
 				[](decltype(active_emitters_[0]) e){return e->current.time_to_live < 0.0f;}), 
 				active_emitters_.end());
-			//active_affectors_.erase(std::remove_if(active_affectors_.begin(), active_affectors_.end(),
-			//	[](decltype(active_affectors_[0]) e){return e->current.time_to_live < 0.0f;}), 
-			//	active_affectors_.end());
-
-
-			for(auto& e : active_emitters_) {
-				if(max_velocity_ && e->current.velocity*glm::length(e->current.direction) > *max_velocity_) {
-					e->current.direction *= *max_velocity_ / glm::length(e->current.direction);
-				}
-				e->current.position += e->current.direction * e->current.velocity * getParticleSystem()->getScaleVelocity() * t;
-				//std::cerr << *e << std::endl;
-			}
-
-			/*for(auto a : active_affectors_) {
-				if(max_velocity_ && a->current.velocity*glm::length(a->current.direction) > *max_velocity_) {
-					a->current.direction *= *max_velocity_ / glm::length(a->current.direction);
-				}
-				a->current.position += a->current.direction * getParticleSystem()->getScaleVelocity() * static_cast<float>(t);
-				//std::cerr << *a << std::endl;
-			}*/
+			emitter_particles_.clear();
 
 			// update particle positions
-			for(auto& p : active_particles_) {
-				if(max_velocity_ && p.current.velocity*glm::length(p.current.direction) > *max_velocity_) {
-					p.current.direction *= *max_velocity_ / glm::length(p.current.direction);
-				}
-
-				p.current.position += p.current.direction * p.current.velocity * getParticleSystem()->getScaleVelocity() * t;
-
-				//std::cerr << p << std::endl;
-			}
-			//if(active_particles_.size() > 0) {
-			//	std::cerr << active_particles_[0] << std::endl;
-			//}
-
-			//std::cerr << "XXX: " << name() << " Active Particle Count: " << active_particles_.size() << std::endl;
-			//std::cerr << "XXX: " << name() << " Active Emitter Count: " << active_emitters_.size() << std::endl;
+			kernels::integrate(active_particles_.position.data(), 
+				active_particles_.direction.data(), 
+				active_particles_.velocity.data(), 
+				active_particles_.size(), 
+				scale, 
+				max_velocity_ != nullptr, 
+				max_velocity);
 		}
 
 		void Technique::initAttributes()
@@ -499,8 +724,10 @@ namespace KRE
 			setShader(ShaderProgram::getProgram("vtc_shader"));
 
 			//auto as = DisplayDevice::createAttributeSet(true, false ,true);
-			auto as = DisplayDevice::createAttributeSet(true, false, false);
+			auto as = DisplayDevice::createAttributeSet(true, true, false);
 			as->setDrawMode(DrawMode::TRIANGLES);
+			particle_as_ = as;
+			index_capacity_ = 0;
 
 			arv_ = std::make_shared<Attribute<vertex_texture_color3>>(AccessFreqHint::DYNAMIC);
 			arv_->addAttributeDesc(AttributeDesc(AttrType::POSITION, 3, AttrFormat::FLOAT, false, sizeof(vertex_texture_color3), offsetof(vertex_texture_color3, vertex)));
@@ -513,33 +740,51 @@ namespace KRE
 
 		void Technique::preRender(const WindowPtr& wnd)
 		{
-			if(active_particles_.size() == 0) {
+			PROFILE_ZONE("Technique::preRender");
+			const std::size_t count = active_particles_.size();
+			PROFILE_COUNTER_ADD(PARTICLES, count);
+			if(count == 0) {
 				arv_->clear();
 				Renderable::disable();
+				bytes_streamed_ = 0;
 				return;
 			}
 			Renderable::enable();
-			//LOG_DEBUG("Technique::preRender, particle count: " << active_particles_.size());
-			std::vector<vertex_texture_color3> vtc;
-			vtc.reserve(active_particles_.size() * 6);
-			for(auto& p : active_particles_) {
-				/*vtc.emplace_back(glm::vec3(p.current.position.x,p.current.position.y,p.current.position.z), glm::vec2(0.0f,0.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x,p.current.position.y+p.current.dimensions.y,p.current.position.z), glm::vec2(0.0f,1.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x,p.current.position.y,p.current.position.z), glm::vec2(1.0f,0.0f), p.current.color);
-
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x,p.current.position.y,p.current.position.z), glm::vec2(1.0f,0.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x,p.current.position.y+p.current.dimensions.y,p.current.position.z), glm::vec2(0.0f,1.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x,p.current.position.y+p.current.dimensions.y,p.current.position.z), glm::vec2(1.0f,1.0f), p.current.color);*/
-
-				vtc.emplace_back(glm::vec3(p.current.position.x-p.current.dimensions.x/2,p.current.position.y-p.current.dimensions.y/2,p.current.position.z), glm::vec2(0.0f,0.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x-p.current.dimensions.x/2,p.current.position.y+p.current.dimensions.y/2,p.current.position.z), glm::vec2(0.0f,1.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x/2,p.current.position.y-p.current.dimensions.y/2,p.current.position.z), glm::vec2(1.0f,0.0f), p.current.color);
-
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x/2,p.current.position.y-p.current.dimensions.y/2,p.current.position.z), glm::vec2(1.0f,0.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x-p.current.dimensions.x/2,p.current.position.y+p.current.dimensions.y/2,p.current.position.z), glm::vec2(0.0f,1.0f), p.current.color);
-				vtc.emplace_back(glm::vec3(p.current.position.x+p.current.dimensions.x/2,p.current.position.y+p.current.dimensions.y/2,p.current.position.z), glm::vec2(1.0f,1.0f), p.current.color);
+			//LOG_DEBUG("Technique::preRender, particle count: " << count);
+
+			std::size_t bytes = 0;
+			if(count > index_capacity_) {
+				// The indices never change for a given number of particles, so are only 
+				// re-sent when we grow past what the current buffer covers.
+				std::size_t capacity = std::max(index_capacity_, static_cast<std::size_t>(std::max(particle_quota_, 1)));
+				while(capacity < count) {
+					capacity *= 2;
+				}
+				if(capacity * 4 <= 65536) {
+					auto indices = make_quad_indices<uint16_t>(capacity);
+					bytes += indices.size() * sizeof(uint16_t);
+					particle_as_->updateIndicies(&indices);
+				} else {
+					auto indices = make_quad_indices<uint32_t>(capacity);
+					bytes += indices.size() * sizeof(uint32_t);
+					particle_as_->updateIndicies(&indices);
+				}
+				index_capacity_ = capacity;
 			}
-			arv_->update(&vtc);
+
+			vertices_.resize(count * 4);
+			kernels::expand_quads(active_particles_.position.data(), 
+				active_particles_.dimensions.data(), 
+				active_particles_.color.data(), 
+				count, 
+				vertices_.data());
+			bytes += vertices_.size() * sizeof(vertex_texture_color3);
+			arv_->update(&vertices_);
+			// update() sets the count to the number of vertices, we want the number of indices.
+			particle_as_->setCount(count * 6);
+
+			bytes_streamed_ = bytes;
+			get_bytes_streamed() += bytes;
 		}
 
 		void Technique::postRender(const WindowPtr& wnd)
@@ -613,8 +858,15 @@ namespace KRE
 			return ps;
 		}
 
+		bool ParticleSystemContainer::canProcessConcurrently() const
+		{
+			// Particle systems don't reference anything outside of their container while processing.
+			return true;
+		}
+
 		void ParticleSystemContainer::process(float delta_time)
 		{
+			PROFILE_ZONE("ParticleSystemContainer::process");
 			//LOG_DEBUG("ParticleSystemContainer::Process: " << delta_time);
 			for(auto ps : active_particle_systems_) {
 				ps->emitProcess(delta_time);
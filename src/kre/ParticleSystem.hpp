@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <sstream>
@@ -45,6 +46,7 @@ namespace KRE
 
 		struct vertex_texture_color3
 		{
+			vertex_texture_color3() {}
 			vertex_texture_color3(const glm::vec3& v, const glm::vec2& t, const glm::u8vec4& c)
 				: vertex(v), texcoord(t), color(c) {}
 			glm::vec3 vertex;
@@ -83,6 +85,54 @@ namespace KRE
 			Emitter* emitted_by;
 		};
 
+		// Structure-of-arrays storage for particles. Each attribute is held in its own
+		// contiguous stream so a pass that only touches one or two attributes doesn't have
+		// to walk every full Particle. Killing a particle moves the last particle into the
+		// vacated slot, so the order of particles is not preserved.
+		struct ParticlePool
+		{
+			std::size_t size() const { return time_to_live.size(); }
+			bool empty() const { return time_to_live.empty(); }
+			void reserve(std::size_t n);
+			void clear();
+			// Adds a particle whose current values are set from the initial values, returns its index.
+			std::size_t emit(const PhysicsParameters& pp, int id);
+			// Adds a copy of the current and initial values of p, returns its index.
+			std::size_t emit(const Particle& p);
+			// Copies the current values of particle n back into p.
+			void store(std::size_t n, Particle& p) const;
+			void kill(std::size_t n);
+			// Removes all particles whose time to live has run out, returns the number removed.
+			std::size_t killExpired();
+
+			// current values
+			std::vector<glm::vec3> position;
+			std::vector<glm::vec3> direction;
+			std::vector<float> velocity;
+			std::vector<float> time_to_live;
+			std::vector<color_vector> color;
+			std::vector<glm::vec3> dimensions;
+			std::vector<float> mass;
+			std::vector<glm::quat> orientation;
+			// initial values, these aren't changed after the particle is emitted.
+			std::vector<glm::vec3> initial_direction;
+			std::vector<float> initial_time_to_live;
+			std::vector<color_vector> initial_color;
+			std::vector<glm::vec3> initial_dimensions;
+			// Identifier of the emitter that emitted the particle, see Technique::lookupEmitterId()
+			std::vector<std::uint8_t> emitter_id;
+		};
+
+		// A contiguous run of particles [first, last) in a pool.
+		struct ParticleRange
+		{
+			ParticleRange(ParticlePool& p, std::size_t f, std::size_t l) : particles(p), first(f), last(l) {}
+			std::size_t size() const { return last - first; }
+			ParticlePool& particles;
+			std::size_t first;
+			std::size_t last;
+		};
+
 		// General class for emitter objects which encapsulate and exposes physical parameters
 		// Used as a base class for everything that is not 
 		class EmitObject : public Particle
@@ -125,7 +175,7 @@ namespace KRE
 			explicit Technique(std::weak_ptr<ParticleSystemContainer> parent, const variant& node);
 			Technique(const Technique& tq);
 
-			int getParticleCount() const { return active_particles_.size(); };
+			int getParticleCount() const { return static_cast<int>(active_particles_.size()); };
 			int getQuota() const { return particle_quota_; }
 			int getEmitterQuota() const { return emitter_quota_; }
 			int getSystemQuota() const { return system_quota_; }
@@ -134,12 +184,20 @@ namespace KRE
 			glm::vec3 getDefaultDimensions() const { return glm::vec3(default_particle_width_, default_particle_height_, default_particle_depth_); }
 			ParticleSystemPtr getParticleSystem() const;
 			void setParent(std::weak_ptr<ParticleSystem> parent);
+			// Returns a small integer identifier for the emitter name given, allocating a new one 
+			// if the name hasn't been seen before. Zero is reserved for particles not emitted by 
+			// any emitter.
+			int lookupEmitterId(const std::string& name);
 			// Direct access here for *speed* reasons.
-			std::vector<Particle>& getActiveParticles() { return active_particles_; }
+			ParticlePool& getActiveParticles() { return active_particles_; }
 			std::vector<EmitterPtr>& getActiveEmitters() { return active_emitters_; }
+			// Physical state of the active emitters, valid while affectors are being processed.
+			ParticlePool& getEmitterParticles() { return emitter_particles_; }
 			std::vector<AffectorPtr>& getActiveAffectors() { return active_affectors_; }
 			void preRender(const WindowPtr& wnd) override;
 			void postRender(const WindowPtr& wnd) override;
+			// Bytes of vertex and index data sent to the display device by the last preRender().
+			std::size_t getBytesStreamed() const { return bytes_streamed_; }
 
 			void setDefaultWidth(float w) { default_particle_width_ = w; }
 			void setDefaultHeight(float h) { default_particle_height_ = h; }
@@ -147,6 +205,12 @@ namespace KRE
 
 			void setParticleQuota(int q) { particle_quota_ = q; }
 
+			// Each technique has its own random number generator, so that the results don't depend
+			// on the order techniques are processed in. Unless set explicitly the seed is drawn
+			// from the generator given to set_random_seed().
+			void setSeed(std::uint32_t seed);
+			std::uint32_t getSeed() const { return seed_; }
+
 			bool hasMaxVelocity() const { return max_velocity_ != nullptr; }
 			float getMaxVelocity() const { return *max_velocity_; }
 			void setMaxVelocity(float mv) { max_velocity_.reset(new float(mv)); }
@@ -160,6 +224,13 @@ namespace KRE
 			void handleEmitProcess(float t) override;
 
 			std::shared_ptr<Attribute<vertex_texture_color3>> arv_;
+			AttributeSetPtr particle_as_;
+			// Four vertices per particle, swapped with the attribute's storage each frame so 
+			// neither is reallocated once they are large enough.
+			std::vector<vertex_texture_color3> vertices_;
+			// Number of particles the index buffer has quads for.
+			std::size_t index_capacity_;
+			std::size_t bytes_streamed_;
 
 			float default_particle_width_;
 			float default_particle_height_;
@@ -180,11 +251,20 @@ namespace KRE
 			std::vector<AffectorPtr> child_affectors_;
 
 			// List of particles currently active.
-			std::vector<Particle> active_particles_;
+			ParticlePool active_particles_;
+			// Mirror of the physical state of active_emitters_ that affectors operate on.
+			ParticlePool emitter_particles_;
 
 			// Parent particle system
 			std::weak_ptr<ParticleSystem> parent_particle_system_;
 
+			// Emitter names, indexed by emitter id - 1.
+			std::vector<std::string> emitter_names_;
+
+			std::uint32_t seed_;
+			bool explicit_seed_;
+			std::default_random_engine rng_;
+
 			Technique() = delete;
 		};
 
@@ -263,6 +343,7 @@ namespace KRE
 			std::vector<EmitterPtr> cloneEmitters();
 			std::vector<AffectorPtr> cloneAffectors();
 
+			bool canProcessConcurrently() const override;
 			void process(float delta_time) override;
 
 			static ParticleSystemContainerPtr create(std::weak_ptr<SceneGraph> sg, const variant& node);
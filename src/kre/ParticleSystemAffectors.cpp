@@ -74,6 +74,7 @@ namespace KRE
 			  position_(0.0f), 
 			  scale_(1.0f),
 			  excluded_emitters_(),
+			  excluded_mask_(1),
 			  technique_(),
 			  node_()
 		{
@@ -85,6 +86,7 @@ namespace KRE
 			  mass_(float(node["mass_affector"].as_float(1.0f))),
 			  position_(0.0f), 
 			  scale_(1.0f),
+			  excluded_mask_(1),
 			  node_(node)
 		{
 			if(node.has_key("position")) {
@@ -113,18 +115,27 @@ namespace KRE
 		void Affector::handleEmitProcess(float t) 
 		{
 			auto tq = getTechnique();
-			for(auto& e : tq->getActiveEmitters()) {
-				if(e->emitted_by != nullptr) {
-					if(!isEmitterExcluded(e->emitted_by->getName())) {
-						internalApply(*e,t);
-					}
+			applyToParticles(tq->getEmitterParticles(), t);
+			applyToParticles(tq->getActiveParticles(), t);
+		}
+
+		void Affector::applyToParticles(ParticlePool& particles, float t)
+		{
+			const std::size_t count = particles.size();
+			const std::uint8_t* ids = particles.emitter_id.data();
+			std::size_t first = 0;
+			while(first < count) {
+				while(first < count && (excluded_mask_ >> ids[first]) & 1) {
+					++first;
 				}
-			}
-			for(auto& p : tq->getActiveParticles()) {
-				ASSERT_LOG(p.emitted_by != nullptr, "p.emitted_by is null");
-				if(!isEmitterExcluded(p.emitted_by->getName())) {
-					internalApply(p,t);
+				std::size_t last = first;
+				while(last < count && !((excluded_mask_ >> ids[last]) & 1)) {
+					++last;
 				}
+				if(first != last) {
+					applyBatch(ParticleRange(particles, first, last), t);
+				}
+				first = last;
 			}
 		}
 
@@ -133,6 +144,39 @@ namespace KRE
 			return std::find(excluded_emitters_.begin(), excluded_emitters_.end(), name) != excluded_emitters_.end();
 		}
 
+		const float* Affector::sampleOverLifetime(const ParameterPtr& p, const ParticleRange& range)
+		{
+			const std::size_t count = range.size();
+			sample_times_.resize(count);
+			sample_values_.resize(count);
+			const float* ttl = range.particles.time_to_live.data() + range.first;
+			const float* initial_ttl = range.particles.initial_time_to_live.data() + range.first;
+			for(std::size_t n = 0; n != count; ++n) {
+				sample_times_[n] = 1.0f - ttl[n] / initial_ttl[n];
+			}
+			p->getValues(sample_times_.data(), sample_values_.data(), count);
+			return sample_values_.data();
+		}
+
+		void Affector::setParentTechnique(std::weak_ptr<Technique> tq)
+		{
+			technique_ = tq;
+			updateExcludedMask();
+		}
+
+		void Affector::updateExcludedMask()
+		{
+			// Particles with an id of zero weren't emitted by an emitter and are never affected.
+			excluded_mask_ = 1;
+			auto tq = technique_.lock();
+			if(tq == nullptr) {
+				return;
+			}
+			for(auto& e : excluded_emitters_) {
+				excluded_mask_ |= std::uint64_t(1) << tq->lookupEmitterId(e);
+			}
+		}
+
 		AffectorPtr Affector::factory(std::weak_ptr<ParticleSystemContainer> parent, AffectorType type)
 		{
 			switch (type)
@@ -299,30 +343,37 @@ namespace KRE
 			}
 		}
 
-		void TimeColorAffector::internalApply(Particle& p, float t)
+		void TimeColorAffector::applyBatch(const ParticleRange& range, float t)
 		{
 			if(tc_data_.empty()) {
 				return;
 			}
-			glm::vec4 c;
-			float ttl_percentage = 1.0f - p.current.time_to_live / p.initial.time_to_live;
-			auto it1 = find_nearest_color(ttl_percentage);
-			auto it2 = it1 + 1;
-			if(it2 != tc_data_.end()) {
-				c = it1->second + ((it2->second - it1->second) * ((ttl_percentage - it1->first)/(it2->first - it1->first)));
-			} else {
-				c = it1->second;
-			}
-			if(operation_ == ColourOperation::COLOR_OP_SET) {
-				p.current.color = color_vector(color_vector::value_type(c.r*255.0f), 
-					color_vector::value_type(c.g*255.0f), 
-					color_vector::value_type(c.b*255.0f), 
-					color_vector::value_type(c.a*255.0f));
-			} else {
-				p.current.color = color_vector(color_vector::value_type(c.r*p.initial.color.r), 
-					color_vector::value_type(c.g*p.initial.color.g), 
-					color_vector::value_type(c.b*p.initial.color.b), 
-					color_vector::value_type(c.a*p.initial.color.a));
+			ParticlePool& particles = range.particles;
+			const float* ttl = particles.time_to_live.data();
+			const float* initial_ttl = particles.initial_time_to_live.data();
+			const color_vector* initial_color = particles.initial_color.data();
+			color_vector* color = particles.color.data();
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				glm::vec4 c;
+				float ttl_percentage = 1.0f - ttl[n] / initial_ttl[n];
+				auto it1 = find_nearest_color(ttl_percentage);
+				auto it2 = it1 + 1;
+				if(it2 != tc_data_.end()) {
+					c = it1->second + ((it2->second - it1->second) * ((ttl_percentage - it1->first)/(it2->first - it1->first)));
+				} else {
+					c = it1->second;
+				}
+				if(operation_ == ColourOperation::COLOR_OP_SET) {
+					color[n] = color_vector(color_vector::value_type(c.r*255.0f), 
+						color_vector::value_type(c.g*255.0f), 
+						color_vector::value_type(c.b*255.0f), 
+						color_vector::value_type(c.a*255.0f));
+				} else {
+					color[n] = color_vector(color_vector::value_type(c.r*initial_color[n].r), 
+						color_vector::value_type(c.g*initial_color[n].g), 
+						color_vector::value_type(c.b*initial_color[n].b), 
+						color_vector::value_type(c.a*initial_color[n].a));
+				}
 			}
 		}
 
@@ -364,13 +415,12 @@ namespace KRE
 			}
 		}
 
-		void JetAffector::internalApply(Particle& p, float t)
+		void JetAffector::applyBatch(const ParticleRange& range, float t)
 		{
-			float scale = t * acceleration_->getValue(1.0f - p.current.time_to_live/p.initial.time_to_live);
-			if(p.current.direction.x == 0 && p.current.direction.y == 0 && p.current.direction.z == 0) {
-				p.current.direction += p.initial.direction * scale;
-			} else {
-				p.current.direction += p.initial.direction * scale;
+			ParticlePool& particles = range.particles;
+			const float* acceleration = sampleOverLifetime(acceleration_, range);
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				particles.direction[n] += particles.initial_direction[n] * (t * acceleration[n - range.first]);
 			}
 		}
 
@@ -401,13 +451,17 @@ namespace KRE
 			}
 		}
 
-		void VortexAffector::internalApply(Particle& p, float t)
+		void VortexAffector::applyBatch(const ParticleRange& range, float t)
 		{
-			glm::vec3 local = p.current.position - getPosition();
+			// The rotation only depends on the system time, so is the same for every particle.
 			float spd = rotation_speed_->getValue(getTechnique()->getParticleSystem()->getElapsedTime());
-			glm::quat rotation = glm::angleAxis(glm::radians(spd), rotation_axis_);
-			p.current.position = getPosition() + rotation * local;
-			p.current.direction = rotation * p.current.direction;
+			const glm::quat rotation = glm::angleAxis(glm::radians(spd), rotation_axis_);
+			const glm::vec3& centre = getPosition();
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				particles.position[n] = centre + rotation * (particles.position[n] - centre);
+				particles.direction[n] = rotation * particles.direction[n];
+			}
 		}
 
 		GravityAffector::GravityAffector(std::weak_ptr<ParticleSystemContainer> parent)
@@ -432,13 +486,18 @@ namespace KRE
 			}
 		}
 
-		void GravityAffector::internalApply(Particle& p, float t)
+		void GravityAffector::applyBatch(const ParticleRange& range, float t)
 		{
-			glm::vec3 d = getPosition() - p.current.position;
-			float len_sqr = sqrt(d.x*d.x + d.y*d.y + d.z*d.z);
-			if(len_sqr > 0) {
-				float force = (gravity_->getValue(t) * p.current.mass * getMass()) / len_sqr;
-				p.current.direction += (force * t) * d;
+			const glm::vec3& centre = getPosition();
+			const float affector_mass = getMass();
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				glm::vec3 d = centre - particles.position[n];
+				float len_sqr = sqrt(d.x*d.x + d.y*d.y + d.z*d.z);
+				if(len_sqr > 0) {
+					float force = (gravity_->getValue(t) * particles.mass[n] * affector_mass) / len_sqr;
+					particles.direction[n] += (force * t) * d;
+				}
 			}
 		}
 
@@ -480,54 +539,47 @@ namespace KRE
 			}
 		}
 
-		float ScaleAffector::calculateScale(ParameterPtr s, const Particle& p)
+		void ScaleAffector::applyScale(const ParameterPtr& s, const ParticleRange& range, const glm::bvec3& axes)
 		{
-			float scale;
+			// Either one value for the whole batch or one per particle depending on its age.
+			const float* per_particle = nullptr;
+			float system_scale = 0.0f;
 			if(since_system_start_) {
-				scale = s->getValue(getTechnique()->getParticleSystem()->getElapsedTime());
+				system_scale = s->getValue(getTechnique()->getParticleSystem()->getElapsedTime());
 			} else {
-				scale = s->getValue(1.0f - p.current.time_to_live / p.initial.time_to_live);
+				per_particle = sampleOverLifetime(s, range);
+			}
+
+			const glm::vec3& affector_scale = getScale();
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				const float calc_scale = per_particle != nullptr ? per_particle[n - range.first] : system_scale;
+				const glm::vec3& initial_dimensions = particles.initial_dimensions[n];
+				glm::vec3& dimensions = particles.dimensions[n];
+				for(int axis = 0; axis != 3; ++axis) {
+					if(axes[axis]) {
+						const float value = initial_dimensions[axis] * calc_scale * affector_scale[axis];
+						if(value > 0) {
+							dimensions[axis] = value;
+						}
+					}
+				}
 			}
-			return scale;
 		}
 
-		void ScaleAffector::internalApply(Particle& p, float t)
+		void ScaleAffector::applyBatch(const ParticleRange& range, float t)
 		{
 			if(scale_xyz_) {
-				float calc_scale = calculateScale(scale_xyz_, p);
-				float value = p.initial.dimensions.x * calc_scale * getScale().x;
-				if(value > 0) {
-					p.current.dimensions.x = value;
-				}
-				value = p.initial.dimensions.y * calc_scale * getScale().y;
-				if(value > 0) {
-					p.current.dimensions.y = value;
-				}
-				value = p.initial.dimensions.z * calc_scale * getScale().z;
-				if(value > 0) {
-					p.current.dimensions.z = value;
-				}
+				applyScale(scale_xyz_, range, glm::bvec3(true, true, true));
 			} else {
 				if(scale_x_) {
-					float calc_scale = calculateScale(scale_x_, p);
-					float value = p.initial.dimensions.x * calc_scale * getScale().x;
-					if(value > 0) {
-						p.current.dimensions.x = value;
-					}
+					applyScale(scale_x_, range, glm::bvec3(true, false, false));
 				}
 				if(scale_y_) {
-					float calc_scale = calculateScale(scale_y_, p);
-					float value = p.initial.dimensions.x * calc_scale * getScale().y;
-					if(value > 0) {
-						p.current.dimensions.y = value;
-					}
+					applyScale(scale_y_, range, glm::bvec3(false, true, false));
 				}
 				if(scale_z_) {
-					float calc_scale = calculateScale(scale_z_, p);
-					float value = p.initial.dimensions.z * calc_scale * getScale().z;
-					if(value > 0) {
-						p.current.dimensions.z = value;
-					}
+					applyScale(scale_z_, range, glm::bvec3(false, false, true));
 				}
 			}
 		}
@@ -558,17 +610,20 @@ namespace KRE
 			direction_ = variant_to_vec3(node["direction"]);
 		}
 
-		void LinearForceAffector::internalApply(Particle& p, float t) 
+		void LinearForceAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			float scale = t * force_->getValue(1.0f - p.current.time_to_live/p.initial.time_to_live);
-			p.current.position += direction_*scale;
+			ParticlePool& particles = range.particles;
+			const float* force = sampleOverLifetime(force_, range);
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				particles.position[n] += direction_ * (t * force[n - range.first]);
+			}
 		}
 
 		ParticleFollowerAffector::ParticleFollowerAffector(std::weak_ptr<ParticleSystemContainer> parent)
 			: Affector(parent, AffectorType::PARTICLE_FOLLOWER),
 			  min_distance_(0.0f),
 			  max_distance_(std::numeric_limits<float>::max()),
-			  prev_particle_()
+			  prev_particle_(0)
 		{
 		}
 
@@ -576,7 +631,7 @@ namespace KRE
 			: Affector(parent, node, AffectorType::PARTICLE_FOLLOWER),
 			  min_distance_(node["min_distance"].as_float(1.0f)),
 			  max_distance_(node["max_distance"].as_float(std::numeric_limits<float>::max())),
-			  prev_particle_()
+			  prev_particle_(0)
 		{
 			init(node);
 		}
@@ -587,37 +642,39 @@ namespace KRE
 
 		void ParticleFollowerAffector::handleEmitProcess(float t) 
 		{
-			std::vector<Particle>& particles = getTechnique()->getActiveParticles();
+			ParticlePool& particles = getTechnique()->getActiveParticles();
 			// keeps particles following wihin [min_distance, max_distance]
 			if(particles.size() < 1) {
 				return;
 			}
-			prev_particle_ = particles.begin();
-			for(auto p = particles.begin(); p != particles.end(); ++p) {
-				internalApply(*p, t);
-				prev_particle_ = p;
-			}
+			applyBatch(ParticleRange(particles, 0, particles.size()), t);
 		}
 
-		void ParticleFollowerAffector::internalApply(Particle& p, float t) 
+		void ParticleFollowerAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			auto distance = glm::length(p.current.position - prev_particle_->current.position);
-			if(distance > min_distance_ && distance < max_distance_) {
-				p.current.position = prev_particle_->current.position + (min_distance_/distance)*(p.current.position-prev_particle_->current.position);
+			glm::vec3* position = range.particles.position.data();
+			prev_particle_ = range.first;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				const glm::vec3& prev_position = position[prev_particle_];
+				auto distance = glm::length(position[n] - prev_position);
+				if(distance > min_distance_ && distance < max_distance_) {
+					position[n] = prev_position + (min_distance_/distance)*(position[n]-prev_position);
+				}
+				prev_particle_ = n;
 			}
 		}
 
 		AlignAffector::AlignAffector(std::weak_ptr<ParticleSystemContainer> parent) 
 			: Affector(parent, AffectorType::ALIGN), 
 			  resize_(false),
-			  prev_particle_()
+			  prev_particle_(0)
 		{
 		}
 
 		AlignAffector::AlignAffector(std::weak_ptr<ParticleSystemContainer> parent, const variant& node) 
 			: Affector(parent, node, AffectorType::ALIGN), 
 			  resize_(false),
-			  prev_particle_() 
+			  prev_particle_(0) 
 		{
 			init(node);
 		}
@@ -627,44 +684,45 @@ namespace KRE
 			resize_ = (node["resize"].as_bool(false));
 		}
 
-		void AlignAffector::internalApply(Particle& p, float t) 
+		void AlignAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			glm::vec3 distance = prev_particle_->current.position - p.current.position;
-			if(resize_) {
-				p.current.dimensions.y = glm::length(distance);
-			}
-			if(std::abs(glm::length(distance)) > 1e-12) {
-				distance = glm::normalize(distance);
+			ParticlePool& particles = range.particles;
+			prev_particle_ = range.first;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				glm::vec3 distance = particles.position[prev_particle_] - particles.position[n];
+				if(resize_) {
+					particles.dimensions[n].y = glm::length(distance);
+				}
+				if(std::abs(glm::length(distance)) > 1e-12) {
+					distance = glm::normalize(distance);
+				}
+				particles.orientation[n].x = distance.x;
+				particles.orientation[n].y = distance.y;
+				particles.orientation[n].z = distance.z;
+				prev_particle_ = n;
 			}
-			p.current.orientation.x = distance.x;
-			p.current.orientation.y = distance.y;
-			p.current.orientation.z = distance.z;
 		}
 
 		void AlignAffector::handleEmitProcess(float t) 
 		{
-			std::vector<Particle>& particles = getTechnique()->getActiveParticles();
+			ParticlePool& particles = getTechnique()->getActiveParticles();
 			if(particles.size() < 1) {
 				return;
 			}
-			prev_particle_ = particles.begin();				
-			for(auto p = particles.begin(); p != particles.end(); ++p) {
-				internalApply(*p, t);
-				prev_particle_ = p;
-			}
+			applyBatch(ParticleRange(particles, 0, particles.size()), t);
 		}
 
 		FlockCenteringAffector::FlockCenteringAffector(std::weak_ptr<ParticleSystemContainer> parent) 
 			: Affector(parent, AffectorType::FLOCK_CENTERING), 
 			  average_(0.0f),
-			  prev_particle_()
+			  prev_particle_(0)
 		{
 		}
 
 		FlockCenteringAffector::FlockCenteringAffector(std::weak_ptr<ParticleSystemContainer> parent, const variant& node) 
 			: Affector(parent, node, AffectorType::FLOCK_CENTERING), 
 		 	  average_(0.0f),
-			  prev_particle_()
+			  prev_particle_(0)
 		{
 			init(node);
 		}
@@ -673,29 +731,28 @@ namespace KRE
 		{
 		}
 
-		void FlockCenteringAffector::internalApply(Particle& p, float t) 
+		void FlockCenteringAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			p.current.direction = (average_ - p.current.position) * t;
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				particles.direction[n] = (average_ - particles.position[n]) * t;
+			}
 		}
 
 		void FlockCenteringAffector::handleEmitProcess(float t) 
 		{
-			std::vector<Particle>& particles = getTechnique()->getActiveParticles();
+			ParticlePool& particles = getTechnique()->getActiveParticles();
 			if(particles.size() < 1) {
 				return;
 			}
 			auto count = particles.size();
 			glm::vec3 sum(0.0f);
-			for(const auto& p : particles) {
-				sum += p.current.position;
+			for(const auto& pos : particles.position) {
+				sum += pos;
 			}
 			average_ /= static_cast<float>(count);
 
-			prev_particle_ = particles.begin();				
-			for(auto p = particles.begin(); p != particles.end(); ++p) {
-				internalApply(*p, t);
-				prev_particle_ = p;
-			}
+			applyBatch(ParticleRange(particles, 0, particles.size()), t);
 		}
 
 		BlackHoleAffector::BlackHoleAffector(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -736,17 +793,21 @@ namespace KRE
 			Affector::handleEmitProcess(t);
 		}
 
-		void BlackHoleAffector::internalApply(Particle& p, float t) 
+		void BlackHoleAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			glm::vec3 diff = getPosition() - p.current.position;
-			float len = glm::length(diff);
-			if(len > wvelocity_) {
-				diff *= wvelocity_/len;
-			} else {
-				p.current.time_to_live = 0;
-			}
+			const glm::vec3& centre = getPosition();
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				glm::vec3 diff = centre - particles.position[n];
+				float len = glm::length(diff);
+				if(len > wvelocity_) {
+					diff *= wvelocity_/len;
+				} else {
+					particles.time_to_live[n] = 0;
+				}
 
-			p.current.position += diff;
+				particles.position[n] += diff;
+			}
 		}
 
 		PathFollowerAffector::PathFollowerAffector(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -797,13 +858,18 @@ namespace KRE
 			spl_.reset(new geometry::spline3d<float>(points_));
 		}
 
-		void PathFollowerAffector::internalApply(Particle& p, float t) 
+		void PathFollowerAffector::applyBatch(const ParticleRange& range, float t) 
 		{
-			const float time_fraction = p.current.time_to_live / p.initial.time_to_live;
-			const float time_fraction_next = (p.current.time_to_live + t) > p.initial.time_to_live 
-				? 1.0f 
-				: (p.current.time_to_live + t) / p.initial.time_to_live;
-			p.current.position += spl_->interpolate(time_fraction_next) - spl_->interpolate(time_fraction);
+			ParticlePool& particles = range.particles;
+			for(std::size_t n = range.first; n != range.last; ++n) {
+				const float ttl = particles.time_to_live[n];
+				const float initial_ttl = particles.initial_time_to_live[n];
+				const float time_fraction = ttl / initial_ttl;
+				const float time_fraction_next = (ttl + t) > initial_ttl 
+					? 1.0f 
+					: (ttl + t) / initial_ttl;
+				particles.position[n] += spl_->interpolate(time_fraction_next) - spl_->interpolate(time_fraction);
+			}
 		}
 
 		void PathFollowerAffector::handleEmitProcess(float t) 
@@ -811,16 +877,11 @@ namespace KRE
 			if(spl_ == nullptr) {
 				return;
 			}
-			std::vector<Particle>& particles = getTechnique()->getActiveParticles();
+			ParticlePool& particles = getTechnique()->getActiveParticles();
 			if(particles.size() < 1) {
 				return;
 			}
-
-			prev_particle_ = particles.begin();				
-			for(auto& p = particles.begin(); p != particles.end(); ++p) {
-				internalApply(*p, t);
-				prev_particle_ = p;
-			}
+			applyBatch(ParticleRange(particles, 0, particles.size()), t);
 		}
 
 		RandomiserAffector::RandomiserAffector(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -859,47 +920,40 @@ namespace KRE
 			last_update_time_[0] = last_update_time_[1] = 0.0f;
 		}
 
-		void RandomiserAffector::internalApply(Particle& p, float t)
+		void RandomiserAffector::applyBatch(const ParticleRange& range, float t)
 		{
+			ParticlePool& particles = range.particles;
 			if(random_direction_) {
 				// change direction per update
-				p.current.direction += glm::vec3(get_random_float(-max_deviation_.x, max_deviation_.x),
-					get_random_float(-max_deviation_.y, max_deviation_.y),
-					get_random_float(-max_deviation_.z, max_deviation_.z));
+				for(std::size_t n = range.first; n != range.last; ++n) {
+					particles.direction[n] += glm::vec3(get_random_float(-max_deviation_.x, max_deviation_.x),
+						get_random_float(-max_deviation_.y, max_deviation_.y),
+						get_random_float(-max_deviation_.z, max_deviation_.z));
+				}
 			} else {
 				// change position per update.
-				p.current.position += getScale() * glm::vec3(get_random_float(-max_deviation_.x, max_deviation_.x),
-					get_random_float(-max_deviation_.y, max_deviation_.y),
-					get_random_float(-max_deviation_.z, max_deviation_.z));
-			}
-		}
-
-		void RandomiserAffector::handle_apply(std::vector<Particle>& particles, float t)
-		{
-			last_update_time_[0] += t;
-			if(last_update_time_[0] > time_step_) {
-				last_update_time_[0] -= time_step_;
-				for(auto& p : particles) {
-					internalApply(p, t);
+				const glm::vec3& scale = getScale();
+				for(std::size_t n = range.first; n != range.last; ++n) {
+					particles.position[n] += scale * glm::vec3(get_random_float(-max_deviation_.x, max_deviation_.x),
+						get_random_float(-max_deviation_.y, max_deviation_.y),
+						get_random_float(-max_deviation_.z, max_deviation_.z));
 				}
 			}
 		}
 
-		void RandomiserAffector::handle_apply(std::vector<EmitterPtr>& objs, float t) 
+		void RandomiserAffector::handle_apply(ParticlePool& particles, float& last_update_time, float t)
 		{
-			last_update_time_[1] += t;
-			if(last_update_time_[1] > time_step_) {
-				last_update_time_[1] -= time_step_;
-				for(auto e : objs) {
-					internalApply(*e, t);
-				}
+			last_update_time += t;
+			if(last_update_time > time_step_) {
+				last_update_time -= time_step_;
+				applyToParticles(particles, t);
 			}
 		}
 		
 		void RandomiserAffector::handleProcess(float t) 
 		{
-			handle_apply(getTechnique()->getActiveParticles(), t);
-			handle_apply(getTechnique()->getActiveEmitters(), t);
+			handle_apply(getTechnique()->getActiveParticles(), last_update_time_[0], t);
+			handle_apply(getTechnique()->getEmitterParticles(), last_update_time_[1], t);
 		}
 
 		SineForceAffector::SineForceAffector(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -969,12 +1023,17 @@ namespace KRE
 			Affector::handleEmitProcess(t);
 		}
 
-		void SineForceAffector::internalApply(Particle& p, float t)
+		void SineForceAffector::applyBatch(const ParticleRange& range, float t)
 		{
+			glm::vec3* direction = range.particles.direction.data();
 			if(fa_ == ForceApplication::FA_ADD) {
-				p.current.direction += scale_vector_;
+				for(std::size_t n = range.first; n != range.last; ++n) {
+					direction[n] += scale_vector_;
+				}
 			} else {
-				p.current.direction = (p.current.direction + force_vector_) / 2.0f;
+				for(std::size_t n = range.first; n != range.last; ++n) {
+					direction[n] = (direction[n] + force_vector_) / 2.0f;
+				}
 			}
 		}
 
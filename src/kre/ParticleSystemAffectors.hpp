@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include "ParticleSystemFwd.hpp"
 #include "spline3d.hpp"
 
@@ -56,7 +58,7 @@ namespace KRE
 			virtual AffectorPtr clone() const = 0;
 
 			TechniquePtr getTechnique() const;
-			void setParentTechnique(std::weak_ptr<Technique> tq) { technique_ = tq; }
+			void setParentTechnique(std::weak_ptr<Technique> tq);
 
 			AffectorType getType() const { return type_; }
 
@@ -69,13 +71,14 @@ namespace KRE
 
 			const std::vector<std::string>& getExcludedEmitters() const { return excluded_emitters_; }
 			bool isEmitterExcluded(const std::string& name) const;
-			void addExcludedEmitter(const std::string& e) { excluded_emitters_.emplace_back(e); }
-			void clearExcludedEmitters() { excluded_emitters_.clear(); }
+			void addExcludedEmitter(const std::string& e) { excluded_emitters_.emplace_back(e); updateExcludedMask(); }
+			void clearExcludedEmitters() { excluded_emitters_.clear(); updateExcludedMask(); }
 			void removeExcludedEmitter(const std::string& e) {
 				excluded_emitters_.erase(std::remove_if(excluded_emitters_.begin(), excluded_emitters_.end(), 
 					[&e](const std::string& emitter){ 
 					return e == emitter; 
 				}), excluded_emitters_.end());
+				updateExcludedMask();
 			}
 
 			const variant& node() const { return node_; }
@@ -85,15 +88,25 @@ namespace KRE
 			static AffectorPtr factory(std::weak_ptr<ParticleSystemContainer> parent, AffectorType type);
 		protected:
 			virtual void handleEmitProcess(float t) override;
+			// Calls applyBatch() on each run of particles that weren't emitted by an excluded emitter.
+			void applyToParticles(ParticlePool& particles, float t);
+			// Evaluates p at the normalised age of every particle in range, result n is for particle range.first + n.
+			const float* sampleOverLifetime(const ParameterPtr& p, const ParticleRange& range);
 		private:
 			virtual void init(const variant& node) = 0;
-			virtual void internalApply(Particle& p, float t) = 0;
+			virtual void applyBatch(const ParticleRange& range, float t) = 0;
+			void updateExcludedMask();
 
 			AffectorType type_;
 			float mass_;
 			glm::vec3 position_;
 			glm::vec3 scale_;
 			std::vector<std::string> excluded_emitters_;
+			// Bit n is set if particles with emitter id n are left alone, resolved from 
+			// excluded_emitters_ when the technique is set.
+			std::uint64_t excluded_mask_;
+			std::vector<float> sample_times_;
+			std::vector<float> sample_values_;
 			std::weak_ptr<Technique> technique_;
 			variant node_;
 
@@ -122,7 +135,7 @@ namespace KRE
 			void setTimeColorData(const std::vector<tc_pair>& tc) { tc_data_ = tc; sort_tc_data(); }
 			void removeTimeColorEntry(const tc_pair& f);
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<TimeColorAffector>(*this);
 			}
@@ -145,7 +158,7 @@ namespace KRE
 
 			const ParameterPtr& getAcceleration() const { return acceleration_; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<JetAffector>(*this);
 			}
@@ -163,7 +176,7 @@ namespace KRE
 
 			const ParameterPtr& getGravity() const { return gravity_; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<GravityAffector>(*this);
 			}
@@ -183,7 +196,7 @@ namespace KRE
 			const glm::vec3& getDirection() const { return direction_; }
 			void setDirection(const glm::vec3& d) { direction_ = d; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<LinearForceAffector>(*this);
 			}
@@ -207,7 +220,7 @@ namespace KRE
 			bool getSinceSystemStart() const { return since_system_start_; }
 			void setSinceSystemStart(bool f) { since_system_start_ = f; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<ScaleAffector>(*this);
 			}
@@ -217,7 +230,7 @@ namespace KRE
 			ParameterPtr scale_z_;
 			ParameterPtr scale_xyz_;
 			bool since_system_start_;
-			float calculateScale(ParameterPtr s, const Particle& p);
+			void applyScale(const ParameterPtr& s, const ParticleRange& range, const glm::bvec3& axes);
 			ScaleAffector() = delete;
 		};
 
@@ -232,7 +245,7 @@ namespace KRE
 			void setRotationAxis(const glm::vec3& axis) { rotation_axis_ = axis; }
 			const ParameterPtr& getRotationSpeed() const { return rotation_speed_; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<VortexAffector>(*this);
 			}
@@ -265,7 +278,7 @@ namespace KRE
 			}
 		private:
 			void handleEmitProcess(float t) override;
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<ParticleFollowerAffector>(*this);
 			}
@@ -273,7 +286,7 @@ namespace KRE
 			float min_distance_;
 			float max_distance_;
 			// working variables
-			std::vector<Particle>::iterator prev_particle_;
+			std::size_t prev_particle_;
 			ParticleFollowerAffector() = delete;
 		};
 
@@ -287,14 +300,14 @@ namespace KRE
 			bool getResizeable() const { return resize_; }
 			void setResizeable(bool r) { resize_ = r; }
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			void handleEmitProcess(float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<AlignAffector>(*this);
 			}
 		
 			bool resize_;			
-			std::vector<Particle>::iterator prev_particle_;
+			std::size_t prev_particle_;
 			AlignAffector() = delete;
 		};
 
@@ -305,14 +318,14 @@ namespace KRE
 			explicit FlockCenteringAffector(std::weak_ptr<ParticleSystemContainer> parent, const variant& node);
 			void init(const variant& node) override;
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			void handleEmitProcess(float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<FlockCenteringAffector>(*this);
 			}
 		
 			glm::vec3 average_;
-			std::vector<Particle>::iterator prev_particle_;
+			std::size_t prev_particle_;
 			FlockCenteringAffector() = delete;
 		};
 
@@ -327,7 +340,7 @@ namespace KRE
 			const ParameterPtr& getAcceleration() const { return acceleration_; }
 		private:
 			void handleEmitProcess(float t) override;
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<BlackHoleAffector>(*this);
 			}
@@ -351,7 +364,7 @@ namespace KRE
 			void addPoint(const glm::vec3& p);
 			void setPoints(const std::vector<glm::vec3>& points);
 		private:
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			void handleEmitProcess(float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<PathFollowerAffector>(*this);
@@ -360,7 +373,7 @@ namespace KRE
 			std::vector<glm::vec3> points_;
 			// working variables.
 			std::shared_ptr<geometry::spline3d<float>> spl_;
-			std::vector<Particle>::iterator prev_particle_;
+			std::size_t prev_particle_;
 			PathFollowerAffector() = delete;
 		};
 
@@ -379,9 +392,8 @@ namespace KRE
 			float getTimeStep() const { return time_step_; }
 			void setTimeStep(float step) { time_step_ = step; }
 		private:
-			void internalApply(Particle& p, float t) override;
-			void handle_apply(std::vector<Particle>& particles, float t);
-			void handle_apply(std::vector<EmitterPtr>& objs, float t);
+			void applyBatch(const ParticleRange& range, float t) override;
+			void handle_apply(ParticlePool& particles, float& last_update_time, float t);
 			virtual void handleProcess(float t);
 			AffectorPtr clone() const override {
 				return std::make_shared<RandomiserAffector>(*this);
@@ -423,7 +435,7 @@ namespace KRE
 
 		private:
 			void handleEmitProcess(float t) override;
-			void internalApply(Particle& p, float t) override;
+			void applyBatch(const ParticleRange& range, float t) override;
 			AffectorPtr clone() const override {
 				return std::make_shared<SineForceAffector>(*this);
 			}
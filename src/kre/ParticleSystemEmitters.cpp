@@ -35,6 +35,7 @@ namespace KRE
 	{
 		Emitter::Emitter(std::weak_ptr<ParticleSystemContainer> parent, const variant& node, EmitterType type)
 			: EmitObject(parent, node), 
+			  emitter_id_(0),
 			  type_(type),
 			  emission_fraction_(0.0f),
 			  force_emission_(node["force_emission"].as_bool(false)),
@@ -154,6 +155,7 @@ namespace KRE
 		Emitter::Emitter(std::weak_ptr<ParticleSystemContainer> parent, EmitterType type)
 			: EmitObject(parent), 
 			  technique_(),
+			  emitter_id_(0),
 			  type_(type),
 			  emission_rate_(new Parameter(10.0f)),
 			  time_to_live_(new Parameter(4.0f)),
@@ -196,6 +198,7 @@ namespace KRE
 
 		Emitter::Emitter(const Emitter& e)
 			: EmitObject(e),
+			  emitter_id_(0),
 			  type_(e.type_),
 			  emission_rate_(e.emission_rate_),
 			  time_to_live_(e.time_to_live_),
@@ -265,10 +268,9 @@ namespace KRE
 		void Emitter::visualEmitProcess(float t)
 		{
 			auto tq = getTechnique();
-			std::vector<Particle>& particles = tq->getActiveParticles();
-			std::vector<Particle>::iterator start;
+			ParticlePool& particles = tq->getActiveParticles();
 
-			int cnt = calculateParticlesToEmit(t, particles_remaining_, particles.size());
+			int cnt = calculateParticlesToEmit(t, particles_remaining_, static_cast<int>(particles.size()));
 			if(duration_) {
 				particles_remaining_ -= cnt;
 				if(particles_remaining_ <= 0) {
@@ -278,24 +280,18 @@ namespace KRE
 
 			//LOG_DEBUG(name() << " emits " << cnt << " particles, " << particles_remaining_ << " remain. active_particles=" << particles.size() << ", t=" << getTechnique()->getParticleSystem()->getElapsedTime());
 
-			// XXX: techincally this shouldn't be needed as we reserve the default quota upon initialising
-			// the particle list. We could hit some pathological case where we allocate particles past
-			// the quota (since it isn't enforced yet). This saves us from start from being invalidated
-			// if push_back were to cause a reallocation.
-			auto last_index = particles.size();
-			particles.resize(particles.size() + cnt);
-			//start = particles.end();
-			for(int n = 0; n != cnt; ++n) {
-				Particle p;
-				initParticle(p, t);
-				particles[n+last_index] = p;
+			if(cnt <= 0) {
+				return;
 			}
-
-			start = particles.begin() + last_index;
-			for(auto it = start; it != particles.end(); ++it) {
-				internalCreate(*it, t);
+			// We reserve the default quota upon initialising the particle pool, this just guards against
+			// pathological cases where we emit past the quota (since it isn't enforced yet).
+			particles.reserve(particles.size() + cnt);
+			for(int n = 0; n != cnt; ++n) {
+				PhysicsParameters pp;
+				initParticle(pp, t);
+				internalCreate(pp, t);
+				particles.emit(pp, emitter_id_);
 			}
-			setParticleStartingValues(start, particles.end());
 		}
 
 		void Emitter::emitterEmitProcess(float t)
@@ -320,9 +316,10 @@ namespace KRE
 			for(int i = 0; i < cnt; ++i) {
 				EmitterPtr spawned_child = container->cloneEmitter(emits_name_);	
 				spawned_child->init(getTechnique());
-				initParticle(*spawned_child, t);
-				internalCreate(*spawned_child, t);
-				memcpy(&spawned_child->current, &spawned_child->initial, sizeof(spawned_child->current));
+				initParticle(spawned_child->initial, t);
+				internalCreate(spawned_child->initial, t);
+				spawned_child->current = spawned_child->initial;
+				spawned_child->emitted_by = this;
 				tq->getActiveEmitters().push_back(spawned_child);
 			}
 		}
@@ -392,51 +389,35 @@ namespace KRE
 			return cnt;
 		}
 
-		void Emitter::createParticles(std::vector<Particle>& particles, 
-			std::vector<Particle>::iterator& start, 
-			std::vector<Particle>::iterator& end, 
-			float t)
-		{
-		}
-
-		void Emitter::setParticleStartingValues(const std::vector<Particle>::iterator& start, const std::vector<Particle>::iterator& end)
-		{
-			for(auto p = start; p != end; ++p) {
-				memcpy(&p->current, &p->initial, sizeof(p->current));
-			}
-		}
-
-		void Emitter::initParticle(Particle& p, float t)
+		void Emitter::initParticle(PhysicsParameters& pp, float t)
 		{
 			auto ps = getTechnique()->getParticleSystem();
-			init_physics_parameters(p.initial);
-			init_physics_parameters(p.current);
-			p.initial.position = current.position;
-			p.initial.color = getColor();
-			p.initial.time_to_live = time_to_live_->getValue(ps->getElapsedTime());
-			p.initial.velocity = velocity_->getValue(ps->getElapsedTime());
-			p.initial.mass = mass_->getValue(ps->getElapsedTime());
-			p.initial.dimensions = getTechnique()->getDefaultDimensions();
+			init_physics_parameters(pp);
+			pp.position = current.position;
+			pp.color = getColor();
+			pp.time_to_live = time_to_live_->getValue(ps->getElapsedTime());
+			pp.velocity = velocity_->getValue(ps->getElapsedTime());
+			pp.mass = mass_->getValue(ps->getElapsedTime());
+			pp.dimensions = getTechnique()->getDefaultDimensions();
 			if(particle_width_ != nullptr) {
-				p.initial.dimensions.x = particle_width_->getValue(t);
+				pp.dimensions.x = particle_width_->getValue(t);
 			}
 			if(particle_height_ != nullptr) {
-				p.initial.dimensions.y = particle_height_->getValue(t);
+				pp.dimensions.y = particle_height_->getValue(t);
 			}
 			if(particle_depth_ != nullptr) {
-				p.initial.dimensions.z = particle_depth_->getValue(t);
+				pp.dimensions.z = particle_depth_->getValue(t);
 			}
-			p.initial.dimensions.x *= scale_.x;
-			p.initial.dimensions.y *= scale_.y;
-			p.initial.dimensions.z *= scale_.z;
+			pp.dimensions.x *= scale_.x;
+			pp.dimensions.y *= scale_.y;
+			pp.dimensions.z *= scale_.z;
 			if(orientation_range_) {
-				p.initial.orientation = glm::slerp(orientation_range_->first, orientation_range_->second, get_random_float(0.0f,1.0f));
+				pp.orientation = glm::slerp(orientation_range_->first, orientation_range_->second, get_random_float(0.0f,1.0f));
 			} else {
-				p.initial.orientation = current.orientation;
+				pp.orientation = current.orientation;
 			}
-			p.initial.direction = getInitialDirection();
-			//std::cerr << "initial direction: " << p.initial.direction << " vel = " << p.initial.velocity << "\n";
-			p.emitted_by = this;
+			pp.direction = getInitialDirection();
+			//std::cerr << "initial direction: " << pp.direction << " vel = " << pp.velocity << "\n";
 		}
 
 		int Emitter::getEmittedParticleCountPerCycle(float t)
@@ -508,6 +489,7 @@ namespace KRE
 		void Emitter::init(std::weak_ptr<Technique> tq)
 		{
 			technique_ = tq;
+			emitter_id_ = getTechnique()->lookupEmitterId(getName());
 			calculateQuota();
 		}
 
@@ -567,7 +549,7 @@ namespace KRE
 			  circle_random_(false)
 		{
 		}
-		void CircleEmitter::internalCreate(Particle& p, float t)
+		void CircleEmitter::internalCreate(PhysicsParameters& pp, float t)
 		{
 			float angle = 0.0f;
 			if(circle_random_) {
@@ -577,8 +559,8 @@ namespace KRE
 			}
 
 			const float r = circle_radius_->getValue();
-			p.initial.position.x += r * sin(angle + circle_angle_);
-			p.initial.position.y += r * cos(angle + circle_angle_);
+			pp.position.x += r * sin(angle + circle_angle_);
+			pp.position.y += r * cos(angle + circle_angle_);
 		}
 
 		BoxEmitter::BoxEmitter(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -602,11 +584,11 @@ namespace KRE
 			}
 		}
 
-		void BoxEmitter::internalCreate(Particle& p, float t) 
+		void BoxEmitter::internalCreate(PhysicsParameters& pp, float t) 
 		{
-			p.initial.position.x += get_random_float(0.0f, box_dimensions_.x) - box_dimensions_.x/2;
-			p.initial.position.y += get_random_float(0.0f, box_dimensions_.y) - box_dimensions_.y/2;
-			p.initial.position.z += get_random_float(0.0f, box_dimensions_.z) - box_dimensions_.z/2;
+			pp.position.x += get_random_float(0.0f, box_dimensions_.x) - box_dimensions_.x/2;
+			pp.position.y += get_random_float(0.0f, box_dimensions_.y) - box_dimensions_.y/2;
+			pp.position.z += get_random_float(0.0f, box_dimensions_.z) - box_dimensions_.z/2;
 		}
 
 		LineEmitter::LineEmitter(std::weak_ptr<ParticleSystemContainer> parent) 
@@ -637,7 +619,7 @@ namespace KRE
 			// XXX line_end_ ?
 		}
 
-		void LineEmitter::internalCreate(Particle& p, float t)
+		void LineEmitter::internalCreate(PhysicsParameters& pp, float t)
 		{
 			// XXX todo
 		}
@@ -652,7 +634,7 @@ namespace KRE
 		{
 		}
 
-		void PointEmitter::internalCreate(Particle& p, float t) 
+		void PointEmitter::internalCreate(PhysicsParameters& pp, float t) 
 		{
 			// intentionally does nothing.
 		}
@@ -674,14 +656,14 @@ namespace KRE
 			}
 		}
 
-		void SphereSurfaceEmitter::internalCreate(Particle& p, float t) 
+		void SphereSurfaceEmitter::internalCreate(PhysicsParameters& pp, float t) 
 		{
 			float theta = get_random_float(0, 2.0f * static_cast<float>(M_PI));
 			float phi = acos(get_random_float(-1.0f, 1.0f));
 			float r = radius_->getValue(t);
-			p.initial.position.x += r * sin(phi) * cos(theta);
-			p.initial.position.y += r * sin(phi) * sin(theta);
-			p.initial.position.z += r * cos(phi);
+			pp.position.x += r * sin(phi) * cos(theta);
+			pp.position.y += r * sin(phi) * sin(theta);
+			pp.position.z += r * cos(phi);
 		}
 
 	}
@@ -61,6 +61,8 @@ namespace KRE
 			color_vector getColor() const;
 			TechniquePtr getTechnique() const;
 			void init(std::weak_ptr<Technique> tq);
+			// Identifier of this emitters name within its technique, valid after init() is called.
+			int getEmitterId() const { return emitter_id_; }
 
 			void setEmissionRate(variant node);
 
@@ -91,7 +93,7 @@ namespace KRE
 			static EmitterPtr factory(std::weak_ptr<ParticleSystemContainer> parent, const variant& node);
 			static EmitterPtr factory(std::weak_ptr<ParticleSystemContainer> parent, EmitterType type);
 		protected:
-			virtual void internalCreate(Particle& p, float t) = 0;
+			virtual void internalCreate(PhysicsParameters& pp, float t) = 0;
 			virtual bool durationExpired() override { return can_be_deleted_; }
 		private:
 			virtual void handleEmitProcess(float t) override;
@@ -100,6 +102,7 @@ namespace KRE
 			void visualEmitProcess(float t);
 			void emitterEmitProcess(float t);
 			std::weak_ptr<Technique> technique_;
+			int emitter_id_;
 
 			EmitterType type_;
 
@@ -127,9 +130,7 @@ namespace KRE
 			EmitsType emits_type_;
 			std::string emits_name_;
 
-			void initParticle(Particle& p, float t);
-			void setParticleStartingValues(const std::vector<Particle>::iterator& start, const std::vector<Particle>::iterator& end);
-			void createParticles(std::vector<Particle>& particles, std::vector<Particle>::iterator& start, std::vector<Particle>::iterator& end, float t);
+			void initParticle(PhysicsParameters& pp, float t);
 			int calculateParticlesToEmit(float t, int quota, int current_size);
 			void calculateQuota();
 
@@ -167,7 +168,7 @@ namespace KRE
 			bool isRandomLocation() const { return circle_random_; }
 			void setRandomLocation(bool f) { circle_random_ = f; }
 		private:
-			void internalCreate(Particle& p, float t) override;
+			void internalCreate(PhysicsParameters& pp, float t) override;
 			virtual EmitterPtr clone() override {
 				return std::make_shared<CircleEmitter>(*this);
 			}
@@ -189,7 +190,7 @@ namespace KRE
 			void setDimensions(float x, float y, float z) { box_dimensions_ = glm::vec3(x, y, z); }
 			void setDimensions(float* v) { box_dimensions_ = glm::vec3(v[0], v[1], v[2]); }
 		protected:
-			void internalCreate(Particle& p, float t) override;
+			void internalCreate(PhysicsParameters& pp, float t) override;
 			virtual EmitterPtr clone() override {
 				return std::make_shared<BoxEmitter>(*this);
 			}
@@ -211,7 +212,7 @@ namespace KRE
 			float getMaxIncrement() const { return max_increment_; }
 			void setMaxIncrement(float maxc) { max_increment_ = maxc; }
 		private:
-			void internalCreate(Particle& p, float t) override;
+			void internalCreate(PhysicsParameters& pp, float t) override;
 			EmitterPtr clone() override {
 				return std::make_shared<LineEmitter>(*this);
 			}
@@ -229,7 +230,7 @@ namespace KRE
 			explicit PointEmitter(std::weak_ptr<ParticleSystemContainer> parent);
 			explicit PointEmitter(std::weak_ptr<ParticleSystemContainer> parent, const variant& node);
 		protected:
-			void internalCreate(Particle& p, float t) override;
+			void internalCreate(PhysicsParameters& pp, float t) override;
 			EmitterPtr clone() override {
 				return std::make_shared<PointEmitter>(*this);
 			}
@@ -245,7 +246,7 @@ namespace KRE
 
 			const ParameterPtr& getRadius() const { return radius_; }
 		protected:
-			void internalCreate(Particle& p, float t) override;
+			void internalCreate(PhysicsParameters& pp, float t) override;
 			EmitterPtr clone() override {
 				return std::make_shared<SphereSurfaceEmitter>(*this);
 			}
@@ -24,6 +24,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -37,6 +39,10 @@ namespace KRE
 {
 	namespace Particles
 	{
+		struct PhysicsParameters;
+		struct Particle;
+		struct ParticlePool;
+		struct ParticleRange;
 		class EmitObject;
 		typedef std::shared_ptr<EmitObject> EmitObjectPtr;
 		class ParticleSystemContainer;
@@ -52,6 +58,12 @@ namespace KRE
 		class Affector;
 		typedef std::shared_ptr<Affector> AffectorPtr;
 
+		// Uses the generator of the technique currently being processed on this thread if there
+		// is one, otherwise the global generator.
 		float get_random_float(float min = 0.0f, float max = 1.0f);
+		// Re-seeds the global generator, which seeds techniques that weren't given a seed.
+		void set_random_seed(std::uint32_t seed);
+		// Bytes of particle vertex and index data sent to the display device since the last call.
+		std::size_t get_and_reset_bytes_streamed();
 	}
 }
@@ -0,0 +1,322 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <cstring>
+
+#include "ParticleSystemKernels.hpp"
+#include "Simd.hpp"
+
+namespace KRE
+{
+	namespace Particles
+	{
+		namespace kernels
+		{
+			// The vector kernels treat the glm::vec3 streams as flat arrays of floats.
+			static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be tightly packed");
+
+			namespace
+			{
+				int first_set_bit(int mask)
+				{
+					int n = 0;
+					while((mask & 1) == 0) {
+						mask >>= 1;
+						++n;
+					}
+					return n;
+				}
+
+#if defined(KRE_SIMD_AVX)
+				// Four interleaved vec3's per 128-bit lane are held in three registers as
+				//   r0 = x0 y0 z0 x1, r1 = y1 z1 x2 y2, r2 = z2 x3 y3 z3
+				// these turn a per-particle value k0..k3 into something that lines up with them.
+				inline __m256 expand0(__m256 k) { return _mm256_shuffle_ps(k, k, _MM_SHUFFLE(1,0,0,0)); }
+				inline __m256 expand1(__m256 k) { return _mm256_shuffle_ps(k, k, _MM_SHUFFLE(2,2,1,1)); }
+				inline __m256 expand2(__m256 k) { return _mm256_shuffle_ps(k, k, _MM_SHUFFLE(3,3,3,2)); }
+
+				inline __m256 length(__m256 r0, __m256 r1, __m256 r2)
+				{
+					const __m256 xy = _mm256_shuffle_ps(r1, r2, _MM_SHUFFLE(2,1,3,2));
+					const __m256 yz = _mm256_shuffle_ps(r0, r1, _MM_SHUFFLE(1,0,2,1));
+					const __m256 x = _mm256_shuffle_ps(r0, xy, _MM_SHUFFLE(2,0,3,0));
+					const __m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3,1,2,0));
+					const __m256 z = _mm256_shuffle_ps(yz, r2, _MM_SHUFFLE(3,0,3,1));
+					return _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+				}
+
+				// Loads eight vec3's so that each 128-bit lane holds four of them, in the 
+				// layout described above.
+				inline void load_vec3x8(const float* p, __m256& r0, __m256& r1, __m256& r2)
+				{
+					const __m256 a = _mm256_loadu_ps(p);
+					const __m256 b = _mm256_loadu_ps(p + 8);
+					const __m256 c = _mm256_loadu_ps(p + 16);
+					r0 = _mm256_permute2f128_ps(a, b, 0x30);
+					r1 = _mm256_permute2f128_ps(a, c, 0x21);
+					r2 = _mm256_permute2f128_ps(b, c, 0x30);
+				}
+
+				inline void store_vec3x8(float* p, __m256 r0, __m256 r1, __m256 r2)
+				{
+					_mm256_storeu_ps(p, _mm256_permute2f128_ps(r0, r1, 0x20));
+					_mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(r2, r0, 0x30));
+					_mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(r1, r2, 0x31));
+				}
+#elif defined(KRE_SIMD_SSE2)
+				// Four interleaved vec3's are held in three registers as
+				//   r0 = x0 y0 z0 x1, r1 = y1 z1 x2 y2, r2 = z2 x3 y3 z3
+				// these turn a per-particle value k0..k3 into something that lines up with them.
+				inline __m128 expand0(__m128 k) { return _mm_shuffle_ps(k, k, _MM_SHUFFLE(1,0,0,0)); }
+				inline __m128 expand1(__m128 k) { return _mm_shuffle_ps(k, k, _MM_SHUFFLE(2,2,1,1)); }
+				inline __m128 expand2(__m128 k) { return _mm_shuffle_ps(k, k, _MM_SHUFFLE(3,3,3,2)); }
+
+				inline __m128 length(__m128 r0, __m128 r1, __m128 r2)
+				{
+					const __m128 xy = _mm_shuffle_ps(r1, r2, _MM_SHUFFLE(2,1,3,2));
+					const __m128 yz = _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(1,0,2,1));
+					const __m128 x = _mm_shuffle_ps(r0, xy, _MM_SHUFFLE(2,0,3,0));
+					const __m128 y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3,1,2,0));
+					const __m128 z = _mm_shuffle_ps(yz, r2, _MM_SHUFFLE(3,0,3,1));
+					return _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+				}
+#endif
+			}
+
+			void decrement_ttl_scalar(float* ttl, std::size_t count, float t)
+			{
+				for(std::size_t n = 0; n != count; ++n) {
+					ttl[n] -= t;
+				}
+			}
+
+			std::size_t find_expired_scalar(const float* ttl, std::size_t start, std::size_t count)
+			{
+				for(std::size_t n = start; n < count; ++n) {
+					if(ttl[n] < 0.0f) {
+						return n;
+					}
+				}
+				return count;
+			}
+
+			void integrate_scalar(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity)
+			{
+				for(std::size_t n = 0; n != count; ++n) {
+					if(clamp) {
+						const float len = glm::length(direction[n]);
+						if(velocity[n] * len > max_velocity) {
+							direction[n] *= max_velocity / len;
+						}
+					}
+					position[n] += direction[n] * (velocity[n] * scale);
+				}
+			}
+
+			void expand_quads_scalar(const glm::vec3* position, const glm::vec3* dimensions, const glm::tvec4<unsigned char>* color, std::size_t count, void* out)
+			{
+				float* v = static_cast<float*>(out);
+				for(std::size_t n = 0; n != count; ++n, v += 24) {
+					const float l = position[n].x - dimensions[n].x / 2.0f;
+					const float r = position[n].x + dimensions[n].x / 2.0f;
+					const float b = position[n].y - dimensions[n].y / 2.0f;
+					const float t = position[n].y + dimensions[n].y / 2.0f;
+					const float z = position[n].z;
+					const float corners[4][4] = {
+						{ l, b, 0.0f, 0.0f },
+						{ l, t, 0.0f, 1.0f },
+						{ r, b, 1.0f, 0.0f },
+						{ r, t, 1.0f, 1.0f },
+					};
+					for(int c = 0; c != 4; ++c) {
+						v[c*6+0] = corners[c][0];
+						v[c*6+1] = corners[c][1];
+						v[c*6+2] = z;
+						v[c*6+3] = corners[c][2];
+						v[c*6+4] = corners[c][3];
+						std::memcpy(&v[c*6+5], &color[n], sizeof(float));
+					}
+				}
+			}
+
+#if defined(KRE_SIMD_AVX) || defined(KRE_SIMD_SSE2)
+			void expand_quads(const glm::vec3* position, const glm::vec3* dimensions, const glm::tvec4<unsigned char>* color, std::size_t count, void* out)
+			{
+				// Half the dimensions, negated for the bottom-left corner.
+				const __m128 half = _mm_setr_ps(-0.5f, -0.5f, 0.5f, 0.5f);
+				float* v = static_cast<float*>(out);
+				for(std::size_t n = 0; n != count; ++n, v += 24) {
+					const glm::vec3& p = position[n];
+					const glm::vec3& d = dimensions[n];
+					float c;
+					std::memcpy(&c, &color[n], sizeof(float));
+					// lbrt = left, bottom, right, top
+					const __m128 lbrt = _mm_add_ps(_mm_setr_ps(p.x, p.y, p.x, p.y), _mm_mul_ps(_mm_setr_ps(d.x, d.y, d.x, d.y), half));
+					const __m128 zc01 = _mm_setr_ps(p.z, c, 0.0f, 1.0f);
+					// The four vertices are 24 consecutive floats: l b z 0 | 0 c l t | z 0 1 c | r b z 1 | 0 c r t | z 1 1 c
+					_mm_storeu_ps(v, _mm_shuffle_ps(lbrt, zc01, _MM_SHUFFLE(2,0,1,0)));
+					_mm_storeu_ps(v + 4, _mm_shuffle_ps(zc01, lbrt, _MM_SHUFFLE(3,0,1,2)));
+					_mm_storeu_ps(v + 8, _mm_shuffle_ps(zc01, zc01, _MM_SHUFFLE(1,3,2,0)));
+					_mm_storeu_ps(v + 12, _mm_shuffle_ps(lbrt, zc01, _MM_SHUFFLE(3,0,1,2)));
+					_mm_storeu_ps(v + 16, _mm_shuffle_ps(zc01, lbrt, _MM_SHUFFLE(3,2,1,2)));
+					_mm_storeu_ps(v + 20, _mm_shuffle_ps(zc01, zc01, _MM_SHUFFLE(1,3,3,0)));
+				}
+			}
+#else
+			void expand_quads(const glm::vec3* position, const glm::vec3* dimensions, const glm::tvec4<unsigned char>* color, std::size_t count, void* out)
+			{
+				expand_quads_scalar(position, dimensions, color, count, out);
+			}
+#endif
+
+#if defined(KRE_SIMD_AVX)
+			void decrement_ttl(float* ttl, std::size_t count, float t)
+			{
+				const __m256 vt = _mm256_set1_ps(t);
+				std::size_t n = 0;
+				for(; n + 8 <= count; n += 8) {
+					_mm256_storeu_ps(ttl + n, _mm256_sub_ps(_mm256_loadu_ps(ttl + n), vt));
+				}
+				decrement_ttl_scalar(ttl + n, count - n, t);
+			}
+
+			std::size_t find_expired(const float* ttl, std::size_t start, std::size_t count)
+			{
+				const __m256 zero = _mm256_setzero_ps();
+				std::size_t n = start;
+				for(; n + 8 <= count; n += 8) {
+					const int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(ttl + n), zero, _CMP_LT_OQ));
+					if(mask != 0) {
+						return n + first_set_bit(mask);
+					}
+				}
+				return find_expired_scalar(ttl, n, count);
+			}
+
+			void integrate(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity)
+			{
+				float* pos = reinterpret_cast<float*>(position);
+				float* dir = reinterpret_cast<float*>(direction);
+				const __m256 vscale = _mm256_set1_ps(scale);
+				const __m256 vmax = _mm256_set1_ps(max_velocity);
+				const __m256 one = _mm256_set1_ps(1.0f);
+				std::size_t n = 0;
+				for(; n + 8 <= count; n += 8) {
+					__m256 d0, d1, d2;
+					load_vec3x8(dir + n * 3, d0, d1, d2);
+					const __m256 v = _mm256_loadu_ps(velocity + n);
+					if(clamp) {
+						const __m256 len = length(d0, d1, d2);
+						const __m256 mask = _mm256_cmp_ps(_mm256_mul_ps(v, len), vmax, _CMP_GT_OQ);
+						const __m256 s = _mm256_blendv_ps(one, _mm256_div_ps(vmax, len), mask);
+						d0 = _mm256_mul_ps(d0, expand0(s));
+						d1 = _mm256_mul_ps(d1, expand1(s));
+						d2 = _mm256_mul_ps(d2, expand2(s));
+						store_vec3x8(dir + n * 3, d0, d1, d2);
+					}
+					const __m256 k = _mm256_mul_ps(v, vscale);
+					__m256 p0, p1, p2;
+					load_vec3x8(pos + n * 3, p0, p1, p2);
+					p0 = _mm256_add_ps(p0, _mm256_mul_ps(d0, expand0(k)));
+					p1 = _mm256_add_ps(p1, _mm256_mul_ps(d1, expand1(k)));
+					p2 = _mm256_add_ps(p2, _mm256_mul_ps(d2, expand2(k)));
+					store_vec3x8(pos + n * 3, p0, p1, p2);
+				}
+				integrate_scalar(position + n, direction + n, velocity + n, count - n, scale, clamp, max_velocity);
+			}
+#elif defined(KRE_SIMD_SSE2)
+			void decrement_ttl(float* ttl, std::size_t count, float t)
+			{
+				const __m128 vt = _mm_set1_ps(t);
+				std::size_t n = 0;
+				for(; n + 4 <= count; n += 4) {
+					_mm_storeu_ps(ttl + n, _mm_sub_ps(_mm_loadu_ps(ttl + n), vt));
+				}
+				decrement_ttl_scalar(ttl + n, count - n, t);
+			}
+
+			std::size_t find_expired(const float* ttl, std::size_t start, std::size_t count)
+			{
+				const __m128 zero = _mm_setzero_ps();
+				std::size_t n = start;
+				for(; n + 4 <= count; n += 4) {
+					const int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(ttl + n), zero));
+					if(mask != 0) {
+						return n + first_set_bit(mask);
+					}
+				}
+				return find_expired_scalar(ttl, n, count);
+			}
+
+			void integrate(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity)
+			{
+				float* pos = reinterpret_cast<float*>(position);
+				float* dir = reinterpret_cast<float*>(direction);
+				const __m128 vscale = _mm_set1_ps(scale);
+				const __m128 vmax = _mm_set1_ps(max_velocity);
+				const __m128 one = _mm_set1_ps(1.0f);
+				std::size_t n = 0;
+				for(; n + 4 <= count; n += 4) {
+					float* d = dir + n * 3;
+					float* p = pos + n * 3;
+					__m128 d0 = _mm_loadu_ps(d);
+					__m128 d1 = _mm_loadu_ps(d + 4);
+					__m128 d2 = _mm_loadu_ps(d + 8);
+					const __m128 v = _mm_loadu_ps(velocity + n);
+					if(clamp) {
+						const __m128 len = length(d0, d1, d2);
+						const __m128 mask = _mm_cmpgt_ps(_mm_mul_ps(v, len), vmax);
+						const __m128 s = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(vmax, len)), _mm_andnot_ps(mask, one));
+						d0 = _mm_mul_ps(d0, expand0(s));
+						d1 = _mm_mul_ps(d1, expand1(s));
+						d2 = _mm_mul_ps(d2, expand2(s));
+						_mm_storeu_ps(d, d0);
+						_mm_storeu_ps(d + 4, d1);
+						_mm_storeu_ps(d + 8, d2);
+					}
+					const __m128 k = _mm_mul_ps(v, vscale);
+					_mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(d0, expand0(k))));
+					_mm_storeu_ps(p + 4, _mm_add_ps(_mm_loadu_ps(p + 4), _mm_mul_ps(d1, expand1(k))));
+					_mm_storeu_ps(p + 8, _mm_add_ps(_mm_loadu_ps(p + 8), _mm_mul_ps(d2, expand2(k))));
+				}
+				integrate_scalar(position + n, direction + n, velocity + n, count - n, scale, clamp, max_velocity);
+			}
+#else
+			void decrement_ttl(float* ttl, std::size_t count, float t)
+			{
+				decrement_ttl_scalar(ttl, count, t);
+			}
+
+			std::size_t find_expired(const float* ttl, std::size_t start, std::size_t count)
+			{
+				return find_expired_scalar(ttl, start, count);
+			}
+
+			void integrate(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity)
+			{
+				integrate_scalar(position, direction, velocity, count, scale, clamp, max_velocity);
+			}
+#endif
+		}
+	}
+}
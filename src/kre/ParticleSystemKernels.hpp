@@ -0,0 +1,59 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace KRE
+{
+	namespace Particles
+	{
+		// Batch kernels run over whole particle streams, as stored in a ParticlePool. 
+		// The SSE versions are used whenever the compiler targets SSE2 (always the case
+		// on x86-64), the AVX versions when building with AVX enabled (i.e. -mavx).
+		// The *_scalar versions are always available and act as the reference 
+		// implementation.
+		namespace kernels
+		{
+			// ttl[n] -= t
+			void decrement_ttl(float* ttl, std::size_t count, float t);
+			// Returns the index of the first ttl[n] < 0 at or after start, or count if there is none.
+			std::size_t find_expired(const float* ttl, std::size_t start, std::size_t count);
+			// if(clamp && velocity[n]*|direction[n]| > max_velocity) direction[n] *= max_velocity/|direction[n]|
+			// position[n] += direction[n] * velocity[n] * scale
+			void integrate(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity);
+
+			// Writes four vertices per particle to out, for the corners (-x,-y), (-x,+y), (+x,-y), (+x,+y)
+			// of a quad the size of the particle centred on it. Each vertex is laid out as 
+			// {vec3 position, vec2 texcoord, u8vec4 color}, i.e. 24 bytes.
+			void expand_quads(const glm::vec3* position, const glm::vec3* dimensions, const glm::tvec4<unsigned char>* color, std::size_t count, void* out);
+
+			void decrement_ttl_scalar(float* ttl, std::size_t count, float t);
+			std::size_t find_expired_scalar(const float* ttl, std::size_t start, std::size_t count);
+			void integrate_scalar(glm::vec3* position, glm::vec3* direction, const float* velocity, std::size_t count, float scale, bool clamp, float max_velocity);
+			void expand_quads_scalar(const glm::vec3* position, const glm::vec3* dimensions, const glm::tvec4<unsigned char>* color, std::size_t count, void* out);
+		}
+	}
+}
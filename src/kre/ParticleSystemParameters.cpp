@@ -21,6 +21,8 @@
 	   distribution.
 */
 
+#include <algorithm>
+
 #include "asserts.hpp"
 #include "ParticleSystemParameters.hpp"
 
@@ -60,6 +62,22 @@ namespace KRE
 				}
 				return --it;
 			}
+
+			// Number of samples taken across the control points of curved parameters.
+			const int curve_lut_size = 256;
+		}
+
+		Parameter::Parameter(InterpolationType it, const geometry::control_point_vector& cps) 
+			: type_(it == InterpolationType::LINEAR ? ParameterType::CURVED_LINEAR : ParameterType::CURVED_SPLINE), 
+			  fixed_(), 
+			  random_(), 
+			  oscillate_(),
+			  curved_(cps), 
+			  lut_start_(0.0f),
+			  lut_end_(0.0f),
+			  lut_scale_(0.0f)
+		{
+			bakeCurve();
 		}
 
 
@@ -135,6 +153,58 @@ namespace KRE
 		{
 		}
 
+		void Parameter::bakeCurve()
+		{
+			lut_.clear();
+			spline_.reset();
+			if((type_ != ParameterType::CURVED_LINEAR && type_ != ParameterType::CURVED_SPLINE) 
+				|| curved_.control_points.size() < 2) {
+				return;
+			}
+			if(type_ == ParameterType::CURVED_SPLINE) {
+				// http://en.wikipedia.org/wiki/Spline_interpolation
+				spline_.reset(new geometry::spline(curved_.control_points));
+			}
+			lut_start_ = static_cast<float>(curved_.control_points.front().first);
+			lut_end_ = static_cast<float>(curved_.control_points.back().first);
+			if(lut_end_ <= lut_start_) {
+				return;
+			}
+			lut_scale_ = (curve_lut_size - 1) / (lut_end_ - lut_start_);
+			lut_.resize(curve_lut_size);
+			for(int n = 0; n != curve_lut_size; ++n) {
+				lut_[n] = evaluateCurveExact(lut_start_ + n / lut_scale_);
+			}
+		}
+
+		float Parameter::evaluateCurveExact(float t) const
+		{
+			if(type_ == ParameterType::CURVED_SPLINE) {
+				return static_cast<float>(spline_->interpolate(t));
+			}
+			auto it = find_closest_point(curved_.control_points, t);
+			auto it2 = it + 1;
+			if(it2 == curved_.control_points.end()) {
+				return static_cast<float>(it->second);
+			}
+			// linear interpolate, see http://en.wikipedia.org/wiki/Linear_interpolation
+			return static_cast<float>(it->second + (it2->second - it->second) * (t - it->first) / (it2->first - it->first));
+		}
+
+		float Parameter::evaluateCurve(float t) const
+		{
+			if(curved_.control_points.size() < 2) {
+				return 0.0f;
+			}
+			if(lut_.empty() || !(t >= lut_start_ && t < lut_end_)) {
+				return evaluateCurveExact(t);
+			}
+			const float x = (t - lut_start_) * lut_scale_;
+			const int n = std::min(static_cast<int>(x), curve_lut_size - 2);
+			const float f = x - n;
+			return lut_[n] + (lut_[n+1] - lut_[n]) * f;
+		}
+
 		float Parameter::getValue(float t)
 		{
 			switch(type_) {
@@ -144,27 +214,10 @@ namespace KRE
 				case ParameterType::RANDOM:
 					return get_random_float(random_.min_value, random_.max_value);
 
-				case ParameterType::CURVED_LINEAR: {
-					if(curved_.control_points.size() < 2) {
-						return 0.0f;
-					}
-					auto it = find_closest_point(curved_.control_points, t);
-					auto it2 = it + 1;
-					if(it2 == curved_.control_points.end()) {
-						return static_cast<float>(it2->second);
-					} else {
-						// linear interpolate, see http://en.wikipedia.org/wiki/Linear_interpolation
-						return static_cast<float>(it->second + (it2->second - it->second) * (t - it->first) / (it2->first - it->first));
-					}
-				}
-				case ParameterType::CURVED_SPLINE: {
-					if(curved_.control_points.size() < 2) {
-						return 0.0f;
-					}
-					// http://en.wikipedia.org/wiki/Spline_interpolation
-					geometry::spline spl(curved_.control_points);
-					return static_cast<float>(spl.interpolate(t));
-				}
+				case ParameterType::CURVED_LINEAR:
+				case ParameterType::CURVED_SPLINE:
+					return evaluateCurve(t);
+
 				case ParameterType::OSCILLATE:
 					if(oscillate_.osc_type == WaveType::SINE) {
 						return static_cast<float>(oscillate_.base + oscillate_.amplitude * sin(2*M_PI*oscillate_.frequency*t + oscillate_.phase));
@@ -177,5 +230,27 @@ namespace KRE
 			}
 			return 0.0f;
 		}
+
+		void Parameter::getValues(const float* t, float* out, std::size_t count)
+		{
+			switch(type_) {
+				case ParameterType::FIXED:
+					std::fill(out, out + count, fixed_.value);
+					break;
+
+				case ParameterType::CURVED_LINEAR:
+				case ParameterType::CURVED_SPLINE:
+					for(std::size_t n = 0; n != count; ++n) {
+						out[n] = evaluateCurve(t[n]);
+					}
+					break;
+
+				default:
+					for(std::size_t n = 0; n != count; ++n) {
+						out[n] = getValue(t[n]);
+					}
+					break;
+			}
+		}
 	}
 }
@@ -107,16 +107,21 @@ namespace KRE
 		class Parameter
 		{
 		public:
-			explicit Parameter(float value) : type_(ParameterType::FIXED), fixed_(value), random_(), curved_(), oscillate_() {}
-			explicit Parameter(float minvalue, float maxvalue) : type_(ParameterType::RANDOM), fixed_(), random_(minvalue, maxvalue), curved_(), oscillate_() {}
-			explicit Parameter(InterpolationType it, const geometry::control_point_vector& cps) : type_(it == InterpolationType::LINEAR ? ParameterType::CURVED_LINEAR : ParameterType::CURVED_SPLINE), fixed_(), random_(), curved_(cps), oscillate_() {}
-			explicit Parameter(WaveType ot, float f, float ph, float bas, float ampl) : type_(ParameterType::OSCILLATE), fixed_(), random_(), curved_(), oscillate_(ot, f, ph, bas, ampl) {}
+			explicit Parameter(float value) : type_(ParameterType::FIXED), fixed_(value), random_(), oscillate_(), curved_(), lut_start_(0.0f), lut_end_(0.0f), lut_scale_(0.0f) {}
+			explicit Parameter(float minvalue, float maxvalue) : type_(ParameterType::RANDOM), fixed_(), random_(minvalue, maxvalue), oscillate_(), curved_(), lut_start_(0.0f), lut_end_(0.0f), lut_scale_(0.0f) {}
+			explicit Parameter(InterpolationType it, const geometry::control_point_vector& cps);
+			explicit Parameter(WaveType ot, float f, float ph, float bas, float ampl) : type_(ParameterType::OSCILLATE), fixed_(), random_(), oscillate_(ot, f, ph, bas, ampl), curved_(), lut_start_(0.0f), lut_end_(0.0f), lut_scale_(0.0f) {}
 			virtual ~Parameter();
 
 			float getValue(float t=1.0f);
+			// Evaluates the parameter at count times, the same as calling getValue() on each in turn.
+			void getValues(const float* t, float* out, std::size_t count);
 			static ParameterPtr factory(const variant& node);
 
-			void setType(ParameterType type) { type_ = type; }
+			void setType(ParameterType type) { 
+				type_ = type; 
+				bakeCurve();
+			}
 			ParameterType getType() const { return type_; }
 
 			void getFixedValue(FixedParams* value) const { *value = fixed_; }
@@ -135,6 +140,7 @@ namespace KRE
 			void setControlPoints(InterpolationType it, const CurvedParams& cp) {
 				type_ = it == InterpolationType::LINEAR ? ParameterType::CURVED_LINEAR : ParameterType::CURVED_SPLINE;
 				curved_ = cp;
+				bakeCurve();
 			}
 			void setOscillation(const OscillationParams& op) {
 				type_ = ParameterType::OSCILLATE;
@@ -154,6 +160,18 @@ namespace KRE
 			// curved, linear & spline
 			CurvedParams curved_;
 
+			// Curves are sampled into a table when the control points are set, so evaluating 
+			// them is a lookup and a lerp. Times outside the control points fall back to 
+			// the exact calculation.
+			void bakeCurve();
+			float evaluateCurve(float t) const;
+			float evaluateCurveExact(float t) const;
+			std::vector<float> lut_;
+			float lut_start_;
+			float lut_end_;
+			float lut_scale_;
+			std::unique_ptr<geometry::spline> spline_;
+
 			Parameter() = delete;
 			Parameter(const Parameter&) = delete;
 		};
@@ -0,0 +1,619 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "PixelKernels.hpp"
+#include "Simd.hpp"
+
+namespace KRE
+{
+	namespace pixel_kernels
+	{
+		namespace
+		{
+			enum { RED, GREEN, BLUE, ALPHA };
+
+			// Where each channel lives in the value read from a pixel. 24-bit pixels are read as
+			// b0 | b1 << 8 | b2 << 16, the others as native 8, 16 or 32-bit values. Missing channels have no bits.
+			struct Layout
+			{
+				int bytes;
+				int shift[4];
+				int bits[4];
+			};
+
+			bool get_layout(PixelFormat::PF fmt, Layout* layout)
+			{
+				static const Layout rgba8888 = { 4, { 24, 16,  8,  0 }, { 8, 8, 8, 8 } };
+				static const Layout argb8888 = { 4, { 16,  8,  0, 24 }, { 8, 8, 8, 8 } };
+				static const Layout bgra8888 = { 4, {  8, 16, 24,  0 }, { 8, 8, 8, 8 } };
+				static const Layout abgr8888 = { 4, {  0,  8, 16, 24 }, { 8, 8, 8, 8 } };
+				static const Layout rgbx8888 = { 4, { 24, 16,  8,  0 }, { 8, 8, 8, 0 } };
+				static const Layout bgrx8888 = { 4, {  8, 16, 24,  0 }, { 8, 8, 8, 0 } };
+				static const Layout xrgb8888 = { 4, { 16,  8,  0,  0 }, { 8, 8, 8, 0 } };
+				static const Layout xbgr8888 = { 4, {  0,  8, 16,  0 }, { 8, 8, 8, 0 } };
+				static const Layout rgb24    = { 3, {  0,  8, 16,  0 }, { 8, 8, 8, 0 } };
+				static const Layout bgr24    = { 3, { 16,  8,  0,  0 }, { 8, 8, 8, 0 } };
+				static const Layout rgb565   = { 2, { 11,  5,  0,  0 }, { 5, 6, 5, 0 } };
+				static const Layout bgr565   = { 2, {  0,  5, 11,  0 }, { 5, 6, 5, 0 } };
+				static const Layout rgba4444 = { 2, { 12,  8,  4,  0 }, { 4, 4, 4, 4 } };
+				static const Layout argb4444 = { 2, {  8,  4,  0, 12 }, { 4, 4, 4, 4 } };
+				static const Layout abgr4444 = { 2, {  0,  4,  8, 12 }, { 4, 4, 4, 4 } };
+				static const Layout bgra4444 = { 2, {  4,  8, 12,  0 }, { 4, 4, 4, 4 } };
+				static const Layout rgba5551 = { 2, { 11,  6,  1,  0 }, { 5, 5, 5, 1 } };
+				static const Layout argb1555 = { 2, { 10,  5,  0, 15 }, { 5, 5, 5, 1 } };
+				static const Layout abgr1555 = { 2, {  0,  5, 10, 15 }, { 5, 5, 5, 1 } };
+				static const Layout bgra5551 = { 2, {  1,  6, 11,  0 }, { 5, 5, 5, 1 } };
+				static const Layout rgb555   = { 2, { 10,  5,  0,  0 }, { 5, 5, 5, 0 } };
+				static const Layout bgr555   = { 2, {  0,  5, 10,  0 }, { 5, 5, 5, 0 } };
+				static const Layout rgb444   = { 2, {  8,  4,  0,  0 }, { 4, 4, 4, 0 } };
+				static const Layout rgb332   = { 1, {  5,  2,  0,  0 }, { 3, 3, 2, 0 } };
+				switch(fmt) {
+					case PixelFormat::PF::PIXELFORMAT_RGBA8888:	*layout = rgba8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_ARGB8888:	*layout = argb8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGRA8888:	*layout = bgra8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_ABGR8888:	*layout = abgr8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGBX8888:	*layout = rgbx8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGRX8888:	*layout = bgrx8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB888:
+					case PixelFormat::PF::PIXELFORMAT_XRGB8888:	*layout = xrgb8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGR888:	*layout = xbgr8888; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB24:		*layout = rgb24; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGR24:		*layout = bgr24; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB565:	*layout = rgb565; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGR565:	*layout = bgr565; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGBA4444:	*layout = rgba4444; return true;
+					case PixelFormat::PF::PIXELFORMAT_ARGB4444:	*layout = argb4444; return true;
+					case PixelFormat::PF::PIXELFORMAT_ABGR4444:	*layout = abgr4444; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGRA4444:	*layout = bgra4444; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGBA5551:	*layout = rgba5551; return true;
+					case PixelFormat::PF::PIXELFORMAT_ARGB1555:	*layout = argb1555; return true;
+					case PixelFormat::PF::PIXELFORMAT_ABGR1555:	*layout = abgr1555; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGRA5551:	*layout = bgra5551; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB555:	*layout = rgb555; return true;
+					case PixelFormat::PF::PIXELFORMAT_BGR555:	*layout = bgr555; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB444:	*layout = rgb444; return true;
+					case PixelFormat::PF::PIXELFORMAT_RGB332:	*layout = rgb332; return true;
+					default: break;
+				}
+				return false;
+			}
+
+			const int bayer4[4][4] = {
+				{  0,  8,  2, 10 },
+				{ 12,  4, 14,  6 },
+				{  3, 11,  1,  9 },
+				{ 15,  7, 13,  5 },
+			};
+
+			// expand_table()[bits][v] scales a value with the given number of bits to the range 0-255.
+			struct ExpandTable
+			{
+				ExpandTable() {
+					for(int bits = 1; bits <= 8; ++bits) {
+						const int mx = (1 << bits) - 1;
+						for(int v = 0; v <= mx; ++v) {
+							values[bits][v] = static_cast<unsigned char>((v * 255 + mx / 2) / mx);
+						}
+					}
+				}
+				const unsigned char* operator[](int bits) const { return values[bits]; }
+				unsigned char values[9][256];
+			};
+
+			const ExpandTable& expand_table()
+			{
+				static ExpandTable res;
+				return res;
+			}
+
+			inline uint32_t load_pixel(const unsigned char* p, int bytes)
+			{
+				switch(bytes) {
+					case 4: { uint32_t v; memcpy(&v, p, 4); return v; }
+					case 3: return p[0] | (p[1] << 8) | (p[2] << 16);
+					case 2: { uint16_t v; memcpy(&v, p, 2); return v; }
+					default: break;
+				}
+				return p[0];
+			}
+
+			inline void store_pixel(unsigned char* p, int bytes, uint32_t v)
+			{
+				switch(bytes) {
+					case 4: memcpy(p, &v, 4); break;
+					case 3: p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; p[2] = (v >> 16) & 0xff; break;
+					case 2: { const uint16_t v16 = static_cast<uint16_t>(v); memcpy(p, &v16, 2); break; }
+					default: p[0] = static_cast<unsigned char>(v); break;
+				}
+			}
+
+			// Amount added to a channel, before it is truncated to bits, to dither it.
+			inline int dither_step(int bits)
+			{
+				return 1 << (8 - bits);
+			}
+
+			// x is the position of the first pixel in the row, so the dither pattern lines up.
+			void convert_row_scalar(const Layout& from, const Layout& to, bool dither, const unsigned char* src, unsigned char* dst, int width, int x, int y)
+			{
+				const ExpandTable& expand = expand_table();
+				int channel_dither[4];
+				for(int ch = 0; ch != 4; ++ch) {
+					channel_dither[ch] = dither && to.bits[ch] > 0 && to.bits[ch] < from.bits[ch] ? dither_step(to.bits[ch]) : 0;
+				}
+				const int* bayer_row = bayer4[y & 3];
+				for(int n = 0; n != width; ++n, ++x, src += from.bytes, dst += to.bytes) {
+					const uint32_t v = load_pixel(src, from.bytes);
+					uint32_t out = 0;
+					for(int ch = 0; ch != 4; ++ch) {
+						if(to.bits[ch] == 0) {
+							continue;
+						}
+						int c = 255;
+						if(from.bits[ch] != 0) {
+							c = (v >> from.shift[ch]) & ((1 << from.bits[ch]) - 1);
+							c = expand[from.bits[ch]][c];
+						}
+						if(channel_dither[ch] != 0) {
+							c = std::min(255, c + ((bayer_row[x & 3] * channel_dither[ch]) >> 4));
+						}
+						out |= static_cast<uint32_t>(c >> (8 - to.bits[ch])) << to.shift[ch];
+					}
+					store_pixel(dst, to.bytes, out);
+				}
+			}
+
+			inline bool get_alpha_format(PixelFormat::PF fmt, Layout* layout)
+			{
+				return get_layout(fmt, layout) && layout->bytes == 4 && layout->bits[ALPHA] == 8;
+			}
+
+			struct AlphaTest
+			{
+				uint32_t mask;
+				int shift;
+				int threshold;
+				bool operator()(const unsigned char* px) const {
+					uint32_t v;
+					memcpy(&v, px, 4);
+					return static_cast<int>((v & mask) >> shift) > threshold;
+				}
+			};
+
+			// Index of the first (or last) pixel in [from,to) that passes the test, -1 if there is none.
+			typedef int (*FindOpaqueFn)(const unsigned char* row, int from, int to, const AlphaTest& test);
+
+			int find_first_scalar(const unsigned char* row, int from, int to, const AlphaTest& test)
+			{
+				for(int x = from; x < to; ++x) {
+					if(test(row + x * 4)) {
+						return x;
+					}
+				}
+				return -1;
+			}
+
+			int find_last_scalar(const unsigned char* row, int from, int to, const AlphaTest& test)
+			{
+				for(int x = to - 1; x >= from; --x) {
+					if(test(row + x * 4)) {
+						return x;
+					}
+				}
+				return -1;
+			}
+
+			bool find_opaque_bounds(const unsigned char* pixels, int pitch, int width, int height, const AlphaTest& test, 
+				FindOpaqueFn find_first, FindOpaqueFn find_last, int* x1, int* y1, int* x2, int* y2)
+			{
+				int top = 0, left = -1;
+				for(; top != height && left < 0; ++top) {
+					left = find_first(pixels + top * pitch, 0, width, test);
+				}
+				if(left < 0) {
+					return false;
+				}
+				--top;
+				int bottom = height - 1, right = -1;
+				for(; bottom >= top && right < 0; --bottom) {
+					right = find_last(pixels + bottom * pitch, 0, width, test);
+				}
+				++bottom;
+				// Only pixels left of the left edge or right of the right edge found so far can move them.
+				for(int y = top; y <= bottom; ++y) {
+					const unsigned char* row = pixels + y * pitch;
+					const int l = find_first(row, 0, left, test);
+					if(l >= 0) {
+						left = l;
+					}
+					const int r = find_last(row, right + 1, width, test);
+					if(r >= 0) {
+						right = r;
+					}
+				}
+				*x1 = left;
+				*y1 = top;
+				*x2 = right + 1;
+				*y2 = bottom + 1;
+				return true;
+			}
+
+			void premultiply_row_scalar(const Layout& layout, unsigned char* pixels, int width)
+			{
+				for(int n = 0; n != width; ++n, pixels += 4) {
+					uint32_t v;
+					memcpy(&v, pixels, 4);
+					const uint32_t a = (v >> layout.shift[ALPHA]) & 0xff;
+					uint32_t out = a << layout.shift[ALPHA];
+					for(int ch = RED; ch != ALPHA; ++ch) {
+						const uint32_t t = ((v >> layout.shift[ch]) & 0xff) * a + 128;
+						out |= ((t + (t >> 8)) >> 8) << layout.shift[ch];
+					}
+					memcpy(pixels, &out, 4);
+				}
+			}
+		}
+
+		bool can_convert(PixelFormat::PF from, PixelFormat::PF to)
+		{
+			Layout lf, lt;
+			return get_layout(from, &lf) && get_layout(to, &lt);
+		}
+
+		bool convert_scalar(const void* src, int src_pitch, PixelFormat::PF from, void* dst, int dst_pitch, PixelFormat::PF to, int width, int height, bool dither)
+		{
+			Layout lf, lt;
+			if(!get_layout(from, &lf) || !get_layout(to, &lt)) {
+				return false;
+			}
+			for(int y = 0; y != height; ++y) {
+				convert_row_scalar(lf, lt, dither, 
+					static_cast<const unsigned char*>(src) + y * src_pitch, 
+					static_cast<unsigned char*>(dst) + y * dst_pitch, width, 0, y);
+			}
+			return true;
+		}
+
+		bool premultiply_alpha_scalar(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height)
+		{
+			Layout layout;
+			if(!get_alpha_format(fmt, &layout)) {
+				return false;
+			}
+			for(int y = 0; y != height; ++y) {
+				premultiply_row_scalar(layout, static_cast<unsigned char*>(pixels) + y * pitch, width);
+			}
+			return true;
+		}
+
+		bool opaque_bounds_scalar(const void* pixels, int pitch, int width, int height, uint32_t alpha_mask, int alpha_shift, int threshold, int* x1, int* y1, int* x2, int* y2)
+		{
+			const AlphaTest test = { alpha_mask, alpha_shift, threshold };
+			return find_opaque_bounds(static_cast<const unsigned char*>(pixels), pitch, width, height, test, find_first_scalar, find_last_scalar, x1, y1, x2, y2);
+		}
+
+		bool unpremultiply_alpha(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height)
+		{
+			Layout layout;
+			if(!get_alpha_format(fmt, &layout)) {
+				return false;
+			}
+			// c * 255 / a in 16.16 fixed point.
+			uint32_t recip[256];
+			recip[0] = 0;
+			for(int a = 1; a != 256; ++a) {
+				recip[a] = ((255u << 16) + a / 2) / a;
+			}
+			for(int y = 0; y != height; ++y) {
+				unsigned char* p = static_cast<unsigned char*>(pixels) + y * pitch;
+				for(int x = 0; x != width; ++x, p += 4) {
+					uint32_t v;
+					memcpy(&v, p, 4);
+					const uint32_t a = (v >> layout.shift[ALPHA]) & 0xff;
+					if(a == 255) {
+						continue;
+					}
+					uint32_t out = a << layout.shift[ALPHA];
+					for(int ch = RED; ch != ALPHA; ++ch) {
+						const uint32_t c = ((v >> layout.shift[ch]) & 0xff) * recip[a] + 0x8000;
+						out |= std::min<uint32_t>(255, c >> 16) << layout.shift[ch];
+					}
+					memcpy(p, &out, 4);
+				}
+			}
+			return true;
+		}
+
+#if defined(KRE_SIMD_AVX2) || defined(KRE_SIMD_SSE2)
+		namespace
+		{
+#if defined(KRE_SIMD_AVX2)
+			typedef __m256i Vec;
+			const int lanes = 8;
+			inline Vec load(const unsigned char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+			inline void store(unsigned char* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+			inline Vec set1(int n) { return _mm256_set1_epi32(n); }
+			inline Vec zero() { return _mm256_setzero_si256(); }
+			inline Vec and_(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+			inline Vec or_(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+			inline Vec add32(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+			inline Vec srl(Vec a, __m128i n) { return _mm256_srl_epi32(a, n); }
+			inline Vec sll(Vec a, __m128i n) { return _mm256_sll_epi32(a, n); }
+			inline Vec srli8(Vec a) { return _mm256_srli_epi32(a, 8); }
+			inline Vec min16(Vec a, Vec b) { return _mm256_min_epi16(a, b); }
+			inline int movemask_gt32(Vec a, Vec b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b))); }
+			inline Vec mul16(Vec a, Vec b) { return _mm256_mullo_epi16(a, b); }
+			// The bayer row repeated across the lanes.
+			inline Vec dither_row(const int* row, int step) 
+			{ 
+				return _mm256_setr_epi32(row[0] * step >> 4, row[1] * step >> 4, row[2] * step >> 4, row[3] * step >> 4,
+					row[0] * step >> 4, row[1] * step >> 4, row[2] * step >> 4, row[3] * step >> 4);
+			}
+			// Packs 32-bit lanes holding 16-bit values.
+			inline void store16(unsigned char* p, Vec v)
+			{
+				const __m256i bias = _mm256_set1_epi32(0x8000);
+				__m256i packed = _mm256_packs_epi32(_mm256_sub_epi32(v, bias), _mm256_sub_epi32(v, bias));
+				packed = _mm256_add_epi16(_mm256_permute4x64_epi64(packed, 0x08), _mm256_set1_epi16(-0x8000));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+			}
+#else
+			typedef __m128i Vec;
+			const int lanes = 4;
+			inline Vec load(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+			inline void store(unsigned char* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+			inline Vec set1(int n) { return _mm_set1_epi32(n); }
+			inline Vec zero() { return _mm_setzero_si128(); }
+			inline Vec and_(Vec a, Vec b) { return _mm_and_si128(a, b); }
+			inline Vec or_(Vec a, Vec b) { return _mm_or_si128(a, b); }
+			inline Vec add32(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+			inline Vec srl(Vec a, __m128i n) { return _mm_srl_epi32(a, n); }
+			inline Vec sll(Vec a, __m128i n) { return _mm_sll_epi32(a, n); }
+			inline Vec srli8(Vec a) { return _mm_srli_epi32(a, 8); }
+			inline Vec min16(Vec a, Vec b) { return _mm_min_epi16(a, b); }
+			inline int movemask_gt32(Vec a, Vec b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, b))); }
+			inline Vec mul16(Vec a, Vec b) { return _mm_mullo_epi16(a, b); }
+			inline Vec dither_row(const int* row, int step) 
+			{ 
+				return _mm_setr_epi32(row[0] * step >> 4, row[1] * step >> 4, row[2] * step >> 4, row[3] * step >> 4);
+			}
+			inline void store16(unsigned char* p, Vec v)
+			{
+				const __m128i bias = _mm_set1_epi32(0x8000);
+				__m128i packed = _mm_packs_epi32(_mm_sub_epi32(v, bias), _mm_sub_epi32(v, bias));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_add_epi16(packed, _mm_set1_epi16(-0x8000)));
+			}
+#endif
+
+			// Converts from a 32-bit format to a 16 or 32-bit one, a vector of pixels at a time. Every channel
+			// is moved to its own lane, dithered and truncated, then shifted into place.
+			void convert_rows_vector(const Layout& from, const Layout& to, bool dither, const unsigned char* src, int src_pitch, unsigned char* dst, int dst_pitch, int width, int height)
+			{
+				const Vec mask = set1(0xff);
+				__m128i src_shift[4], dst_shift[4], truncate[4];
+				int step[4];
+				for(int ch = 0; ch != 4; ++ch) {
+					src_shift[ch] = _mm_cvtsi32_si128(from.shift[ch]);
+					dst_shift[ch] = _mm_cvtsi32_si128(to.shift[ch]);
+					truncate[ch] = _mm_cvtsi32_si128(8 - to.bits[ch]);
+					step[ch] = dither && to.bits[ch] > 0 && to.bits[ch] < from.bits[ch] ? dither_step(to.bits[ch]) : 0;
+				}
+				const int vector_width = width - width % lanes;
+				for(int y = 0; y != height; ++y) {
+					Vec dither_add[4];
+					for(int ch = 0; ch != 4; ++ch) {
+						dither_add[ch] = step[ch] != 0 ? dither_row(bayer4[y & 3], step[ch]) : zero();
+					}
+					const unsigned char* s = src + y * src_pitch;
+					unsigned char* d = dst + y * dst_pitch;
+					for(int x = 0; x != vector_width; x += lanes) {
+						const Vec v = load(s + x * 4);
+						Vec out = zero();
+						for(int ch = 0; ch != 4; ++ch) {
+							if(to.bits[ch] == 0) {
+								continue;
+							}
+							Vec c = from.bits[ch] != 0 ? and_(srl(v, src_shift[ch]), mask) : mask;
+							if(step[ch] != 0) {
+								// Lanes are at most 0x1ff, so a 16-bit min is enough.
+								c = min16(add32(c, dither_add[ch]), mask);
+							}
+							out = or_(out, sll(srl(c, truncate[ch]), dst_shift[ch]));
+						}
+						if(to.bytes == 4) {
+							store(d + x * 4, out);
+						} else {
+							store16(d + x * 2, out);
+						}
+					}
+					convert_row_scalar(from, to, dither, s + vector_width * 4, d + vector_width * to.bytes, width - vector_width, vector_width, y);
+				}
+			}
+
+			// Bit n is set if pixel n of the vector passes the test.
+			inline int opaque_lanes(const unsigned char* px, const AlphaTest& test)
+			{
+				const Vec alpha = srl(and_(load(px), set1(static_cast<int>(test.mask))), _mm_cvtsi32_si128(test.shift));
+				return movemask_gt32(alpha, set1(test.threshold));
+			}
+
+			int find_first_vector(const unsigned char* row, int from, int to, const AlphaTest& test)
+			{
+				int x = from;
+				for(; x + lanes <= to; x += lanes) {
+					const int bits = opaque_lanes(row + x * 4, test);
+					if(bits != 0) {
+						int n = 0;
+						while(!(bits & (1 << n))) {
+							++n;
+						}
+						return x + n;
+					}
+				}
+				return find_first_scalar(row, x, to, test);
+			}
+
+			int find_last_vector(const unsigned char* row, int from, int to, const AlphaTest& test)
+			{
+				int x = to - lanes;
+				for(; x >= from; x -= lanes) {
+					const int bits = opaque_lanes(row + x * 4, test);
+					if(bits != 0) {
+						int n = lanes - 1;
+						while(!(bits & (1 << n))) {
+							--n;
+						}
+						return x + n;
+					}
+				}
+				return find_last_scalar(row, from, x + lanes, test);
+			}
+
+#if defined(KRE_SIMD_AVX2)
+			// Conversions between 24 and 32-bit formats with 8-bit channels only move bytes around, 
+			// which is a single shuffle per lane.
+			bool convert_rows_shuffle(const Layout& from, const Layout& to, const unsigned char* src, int src_pitch, unsigned char* dst, int dst_pitch, int width, int height)
+			{
+				if((from.bytes != 4 && from.bytes != 3) || to.bytes != 4) {
+					return false;
+				}
+				char shuffle[16];
+				char fill[16];
+				for(int n = 0; n != 16; ++n) {
+					shuffle[n] = -128;
+					fill[n] = 0;
+				}
+				for(int ch = 0; ch != 4; ++ch) {
+					if(to.bits[ch] == 0) {
+						continue;
+					}
+					if(to.bits[ch] != 8 || (from.bits[ch] != 0 && from.bits[ch] != 8)) {
+						return false;
+					}
+					for(int px = 0; px != 4; ++px) {
+						if(from.bits[ch] == 0) {
+							fill[px * 4 + to.shift[ch] / 8] = -1;
+						} else {
+							shuffle[px * 4 + to.shift[ch] / 8] = static_cast<char>(px * from.bytes + from.shift[ch] / 8);
+						}
+					}
+				}
+				const __m256i vshuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle)));
+				const __m256i vfill = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(fill)));
+				// Each lane is loaded with 16 bytes for 4 pixels, for 24-bit pixels that reads past the 
+				// end of the 8 pixels, which the last 2 pixels of the row are left to the scalar kernel for.
+				const int vector_width = std::max(0, from.bytes == 3 ? width - 2 : width);
+				const int end = vector_width - vector_width % 8;
+				for(int y = 0; y != height; ++y) {
+					const unsigned char* s = src + y * src_pitch;
+					unsigned char* d = dst + y * dst_pitch;
+					for(int x = 0; x != end; x += 8) {
+						const unsigned char* p = s + x * from.bytes;
+						const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), 
+							_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4 * from.bytes)), 1);
+						_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(v, vshuffle), vfill));
+					}
+					convert_row_scalar(from, to, false, s + end * from.bytes, d + end * 4, width - end, end, y);
+				}
+				return true;
+			}
+#endif
+		}
+
+		bool convert(const void* src, int src_pitch, PixelFormat::PF from, void* dst, int dst_pitch, PixelFormat::PF to, int width, int height, bool dither)
+		{
+			Layout lf, lt;
+			if(!get_layout(from, &lf) || !get_layout(to, &lt)) {
+				return false;
+			}
+			const unsigned char* s = static_cast<const unsigned char*>(src);
+			unsigned char* d = static_cast<unsigned char*>(dst);
+#if defined(KRE_SIMD_AVX2)
+			if(convert_rows_shuffle(lf, lt, s, src_pitch, d, dst_pitch, width, height)) {
+				return true;
+			}
+#endif
+			if(lf.bytes == 4 && (lt.bytes == 4 || lt.bytes == 2)) {
+				convert_rows_vector(lf, lt, dither, s, src_pitch, d, dst_pitch, width, height);
+				return true;
+			}
+			return convert_scalar(src, src_pitch, from, dst, dst_pitch, to, width, height, dither);
+		}
+
+		bool premultiply_alpha(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height)
+		{
+			Layout layout;
+			if(!get_alpha_format(fmt, &layout)) {
+				return false;
+			}
+			const Vec mask = set1(0xff);
+			const Vec round = set1(128);
+			__m128i shift[4];
+			for(int ch = 0; ch != 4; ++ch) {
+				shift[ch] = _mm_cvtsi32_si128(layout.shift[ch]);
+			}
+			const int vector_width = width - width % lanes;
+			for(int y = 0; y != height; ++y) {
+				unsigned char* p = static_cast<unsigned char*>(pixels) + y * pitch;
+				for(int x = 0; x != vector_width; x += lanes) {
+					const Vec v = load(p + x * 4);
+					const Vec a = and_(srl(v, shift[ALPHA]), mask);
+					Vec out = sll(a, shift[ALPHA]);
+					for(int ch = RED; ch != ALPHA; ++ch) {
+						// Both values are below 256 so the product fits the low 16 bits of the lane.
+						const Vec t = add32(mul16(and_(srl(v, shift[ch]), mask), a), round);
+						out = or_(out, sll(srli8(add32(t, srli8(t))), shift[ch]));
+					}
+					store(p + x * 4, out);
+				}
+				premultiply_row_scalar(layout, p + vector_width * 4, width - vector_width);
+			}
+			return true;
+		}
+
+		bool opaque_bounds(const void* pixels, int pitch, int width, int height, uint32_t alpha_mask, int alpha_shift, int threshold, int* x1, int* y1, int* x2, int* y2)
+		{
+			const AlphaTest test = { alpha_mask, alpha_shift, threshold };
+			return find_opaque_bounds(static_cast<const unsigned char*>(pixels), pitch, width, height, test, find_first_vector, find_last_vector, x1, y1, x2, y2);
+		}
+#else
+		bool convert(const void* src, int src_pitch, PixelFormat::PF from, void* dst, int dst_pitch, PixelFormat::PF to, int width, int height, bool dither)
+		{
+			return convert_scalar(src, src_pitch, from, dst, dst_pitch, to, width, height, dither);
+		}
+
+		bool premultiply_alpha(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height)
+		{
+			return premultiply_alpha_scalar(pixels, pitch, fmt, width, height);
+		}
+
+		bool opaque_bounds(const void* pixels, int pitch, int width, int height, uint32_t alpha_mask, int alpha_shift, int threshold, int* x1, int* y1, int* x2, int* y2)
+		{
+			return opaque_bounds_scalar(pixels, pitch, width, height, alpha_mask, alpha_shift, threshold, x1, y1, x2, y2);
+		}
+#endif
+	}
+}
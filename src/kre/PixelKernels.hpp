@@ -0,0 +1,56 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include "PixelFormat.hpp"
+
+namespace KRE
+{
+	// Kernels that convert pixels between formats a row at a time, without going through a per-pixel
+	// callback. Packed 8, 16 and 32-bit RGB(A) formats and RGB24/BGR24 are handled. The SSE2 versions 
+	// are used whenever the compiler targets SSE2, the AVX2 versions when building with AVX2 enabled 
+	// (i.e. -mavx2), for conversions from 32-bit formats. The *_scalar versions are always available 
+	// and act as the reference implementation.
+	namespace pixel_kernels
+	{
+		// True if convert() handles converting between the two formats.
+		bool can_convert(PixelFormat::PF from, PixelFormat::PF to);
+		// Converts a block of pixels, src and dst must not overlap. Missing alpha is taken as opaque.
+		// When dither is set, channels that lose precision are ordered dithered (4x4 Bayer matrix).
+		// Returns false, having done nothing, if the formats aren't handled.
+		bool convert(const void* src, int src_pitch, PixelFormat::PF from, void* dst, int dst_pitch, PixelFormat::PF to, int width, int height, bool dither=false);
+		bool convert_scalar(const void* src, int src_pitch, PixelFormat::PF from, void* dst, int dst_pitch, PixelFormat::PF to, int width, int height, bool dither=false);
+
+		// In place, for 32-bit formats with an alpha channel. Return false for other formats.
+		bool premultiply_alpha(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height);
+		bool premultiply_alpha_scalar(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height);
+		bool unpremultiply_alpha(void* pixels, int pitch, PixelFormat::PF fmt, int width, int height);
+
+		// Bounding box, [x1,x2) x [y1,y2), of the 32-bit pixels whose alpha ((pixel & alpha_mask) >> alpha_shift)
+		// is above threshold. Returns false if there are none. Rows are scanned in order and only the
+		// pixels outside the box found so far are tested.
+		bool opaque_bounds(const void* pixels, int pitch, int width, int height, uint32_t alpha_mask, int alpha_shift, int threshold, int* x1, int* y1, int* x2, int* y2);
+		bool opaque_bounds_scalar(const void* pixels, int pitch, int width, int height, uint32_t alpha_mask, int alpha_shift, int threshold, int* x1, int* y1, int* x2, int* y2);
+	}
+}
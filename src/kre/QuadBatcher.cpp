@@ -0,0 +1,177 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include "AttributeSet.hpp"
+#include "DisplayDevice.hpp"
+#include "QuadBatcher.hpp"
+#include "Renderable.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		// A run shorter than this is drawn as is.
+		const size_t min_batch_size = 2;
+
+		// Batches only keep x and y, so anything that would end up with a z value, or that
+		// needs depth testing or clipping, has to be drawn by itself.
+		bool is_batchable(const Renderable* r, const glm::mat4& model)
+		{
+			return !r->hasClipSettings()
+				&& !(r->isDepthEnableStateSet() && r->isDepthEnabled())
+				&& model[0][2] == 0.0f 
+				&& model[1][2] == 0.0f 
+				&& model[3][2] == 0.0f;
+		}
+
+		bool can_batch(const Renderable* a, const Renderable* b)
+		{
+			return a->getTexture() == b->getTexture()
+				&& a->getShader() == b->getShader()
+				&& a->getCamera() == b->getCamera()
+				&& a->getRenderTarget() == b->getRenderTarget()
+				&& a->ignoreGlobalModelMatrix() == b->ignoreGlobalModelMatrix()
+				&& a->isBlendStateSet() == b->isBlendStateSet()
+				&& (!a->isBlendStateSet() || a->isBlendEnabled() == b->isBlendEnabled())
+				&& a->isBlendModeSet() == b->isBlendModeSet()
+				&& (!a->isBlendModeSet() || a->getBlendMode() == b->getBlendMode())
+				&& a->isBlendEquationSet() == b->isBlendEquationSet()
+				&& (!a->isBlendEquationSet() || a->getBlendEquation() == b->getBlendEquation())
+				&& a->isColorSet() == b->isColorSet()
+				&& (!a->isColorSet() || a->getColor() == b->getColor());
+		}
+	}
+
+	class QuadBatcher::QuadBatch : public Renderable
+	{
+	public:
+		QuadBatch() : Renderable() {
+			auto as = DisplayDevice::createAttributeSet();
+			attribs_.reset(new Attribute<vertex_texcoord>(AccessFreqHint::DYNAMIC, AccessTypeHint::DRAW));
+			attribs_->addAttributeDesc(AttributeDesc(AttrType::POSITION, 2, AttrFormat::FLOAT, false, sizeof(vertex_texcoord), offsetof(vertex_texcoord, vtx)));
+			attribs_->addAttributeDesc(AttributeDesc(AttrType::TEXTURE,  2, AttrFormat::FLOAT, false, sizeof(vertex_texcoord), offsetof(vertex_texcoord, tc)));
+			as->addAttribute(AttributeBasePtr(attribs_));
+			as->setDrawMode(DrawMode::TRIANGLES);
+			addAttributeSet(as);
+		}
+
+		// Takes the state from first and the quads from the renderables in [first, last).
+		void build(Renderable* const* first, Renderable* const* last, const glm::mat4* models) {
+			const Renderable* r = *first;
+			static_cast<ScopeableValue&>(*this) = *r;
+			if(getShader() != r->getShader()) {
+				setShader(r->getShader());
+			}
+			setTexture(r->getTexture());
+			setCamera(r->getCamera());
+			setRenderTarget(r->getRenderTarget());
+			useGlobalModelMatrix(r->ignoreGlobalModelMatrix());
+			setOrder(r->getOrder());
+
+			vertices_.clear();
+			vertices_.reserve((last - first) * 6);
+			for(; first != last; ++first, ++models) {
+				const vertex_texcoord* quad = (*first)->getQuadVertices();
+				vertex_texcoord v[4];
+				for(int n = 0; n != 4; ++n) {
+					const glm::vec4 p = *models * glm::vec4(quad[n].vtx, 0.0f, 1.0f);
+					v[n] = vertex_texcoord(glm::vec2(p.x, p.y), quad[n].tc);
+				}
+				// Triangle strip order to a pair of triangles.
+				vertices_.emplace_back(v[0]);
+				vertices_.emplace_back(v[1]);
+				vertices_.emplace_back(v[2]);
+				vertices_.emplace_back(v[2]);
+				vertices_.emplace_back(v[1]);
+				vertices_.emplace_back(v[3]);
+			}
+			getAttributeSet().back()->setCount(vertices_.size());
+			attribs_->update(&vertices_);
+		}
+	private:
+		std::shared_ptr<Attribute<vertex_texcoord>> attribs_;
+		std::vector<vertex_texcoord> vertices_;
+	};
+
+	QuadBatcher::QuadBatcher()
+		: batches_(),
+		  output_(),
+		  models_(),
+		  batch_count_(0),
+		  batched_count_(0)
+	{
+	}
+
+	QuadBatcher::~QuadBatcher()
+	{
+	}
+
+	QuadBatcherPtr QuadBatcher::create()
+	{
+		return std::make_shared<QuadBatcher>();
+	}
+
+	void QuadBatcher::batch(std::vector<Renderable*>* draw_list)
+	{
+		batch_count_ = 0;
+		batched_count_ = 0;
+		output_.clear();
+
+		auto& list = *draw_list;
+		size_t n = 0;
+		while(n < list.size()) {
+			Renderable* first = list[n];
+			size_t end = n + 1;
+			models_.clear();
+			if(first->getQuadVertices() != nullptr) {
+				models_.emplace_back(first->getModelMatrix());
+				if(is_batchable(first, models_.back())) {
+					while(end < list.size() && list[end]->getQuadVertices() != nullptr && can_batch(first, list[end])) {
+						models_.emplace_back(list[end]->getModelMatrix());
+						if(!is_batchable(list[end], models_.back())) {
+							models_.pop_back();
+							break;
+						}
+						++end;
+					}
+				}
+			}
+
+			if(end - n < min_batch_size) {
+				output_.emplace_back(first);
+				n = end;
+				continue;
+			}
+
+			if(static_cast<size_t>(batch_count_) == batches_.size()) {
+				batches_.emplace_back(new QuadBatch());
+			}
+			auto& b = batches_[batch_count_++];
+			b->build(&list[n], &list[0] + end, &models_[0]);
+			output_.emplace_back(b.get());
+			batched_count_ += static_cast<int>(end - n);
+			n = end;
+		}
+		list.swap(output_);
+	}
+}
@@ -0,0 +1,65 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "RenderFwd.hpp"
+
+namespace KRE
+{
+	// Merges runs of consecutive renderables that each draw a single textured quad into one 
+	// renderable and so one draw call. Quads are merged when they share texture, shader, 
+	// camera, render target, blend and color state, their vertices are transformed by each 
+	// renderable's model matrix on the CPU.
+	class QuadBatcher
+	{
+	public:
+		QuadBatcher();
+		~QuadBatcher();
+
+		// Replaces runs of compatible quads in the draw list with batches. The batches are
+		// owned by the batcher and stay valid until the next call.
+		void batch(std::vector<Renderable*>* draw_list);
+
+		// Number of batches made and renderables merged into them by the last call to batch().
+		int getBatchCount() const { return batch_count_; }
+		int getBatchedCount() const { return batched_count_; }
+
+		static QuadBatcherPtr create();
+	private:
+		class QuadBatch;
+
+		std::vector<std::shared_ptr<QuadBatch>> batches_;
+		std::vector<Renderable*> output_;
+		std::vector<glm::mat4> models_;
+		int batch_count_;
+		int batched_count_;
+
+		QuadBatcher(const QuadBatcher&);
+		void operator=(const QuadBatcher&);
+	};
+}
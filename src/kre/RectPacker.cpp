@@ -0,0 +1,271 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ostream>
+
+#include "profile_timer.hpp"
+#include "RectPacker.hpp"
+#include "stb_rect_pack.h"
+
+namespace KRE
+{
+	namespace
+	{
+		// Size steps for atlases, it keeps the estimate and the increments on nice boundaries.
+		const int size_granularity = 32;
+
+		int round_up(int n, int m)
+		{
+			return (n + m - 1) / m * m;
+		}
+	}
+
+	RectPacker::RectPacker(int width, int height, RectPackerMethod method)
+		: width_(width),
+		  height_(height),
+		  method_(method),
+		  used_area_(0),
+		  free_rects_(),
+		  new_rects_(),
+		  skyline_(),
+		  skyline_nodes_()
+	{
+		if(method_ == RectPackerMethod::SKYLINE) {
+			skyline_.reset(new stbrp_context);
+			skyline_nodes_.reset(new stbrp_node[width]);
+			stbrp_init_target(skyline_.get(), width, height, skyline_nodes_.get(), width);
+		} else {
+			Box b = { 0, 0, width, height };
+			free_rects_.emplace_back(b);
+		}
+	}
+
+	RectPacker::~RectPacker()
+	{
+	}
+
+	bool RectPacker::insert(int w, int h, rect* out)
+	{
+		if(w <= 0 || h <= 0) {
+			*out = rect(0, 0, std::max(w, 0), std::max(h, 0));
+			return true;
+		}
+		if(!(method_ == RectPackerMethod::SKYLINE ? insertSkyline(w, h, out) : insertMaxRects(w, h, out))) {
+			return false;
+		}
+		used_area_ += static_cast<long long>(w) * h;
+		return true;
+	}
+
+	bool RectPacker::insertSkyline(int w, int h, rect* out)
+	{
+		stbrp_rect r;
+		r.id = 0;
+		r.w = w;
+		r.h = h;
+		r.x = r.y = 0;
+		r.was_packed = 0;
+		stbrp_pack_rects(skyline_.get(), &r, 1);
+		if(!r.was_packed) {
+			return false;
+		}
+		*out = rect(r.x, r.y, w, h);
+		return true;
+	}
+
+	bool RectPacker::insertMaxRects(int w, int h, rect* out)
+	{
+		int best = -1;
+		int best_short = std::numeric_limits<int>::max();
+		int best_long = std::numeric_limits<int>::max();
+		for(int n = 0; n != static_cast<int>(free_rects_.size()); ++n) {
+			const Box& f = free_rects_[n];
+			if(f.w < w || f.h < h) {
+				continue;
+			}
+			const int dw = f.w - w;
+			const int dh = f.h - h;
+			const int short_side = std::min(dw, dh);
+			const int long_side = std::max(dw, dh);
+			if(short_side < best_short || (short_side == best_short && long_side < best_long)) {
+				best = n;
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+		if(best < 0) {
+			return false;
+		}
+		const Box node = { free_rects_[best].x, free_rects_[best].y, w, h };
+		place(node);
+		*out = rect(node.x, node.y, w, h);
+		return true;
+	}
+
+	void RectPacker::place(const Box& node)
+	{
+		// Every free rectangle overlapping the node is replaced by the (up to four) maximal 
+		// rectangles of it that are left around the node.
+		new_rects_.clear();
+		std::size_t kept = 0;
+		for(std::size_t n = 0; n != free_rects_.size(); ++n) {
+			const Box f = free_rects_[n];
+			if(!f.intersects(node)) {
+				free_rects_[kept++] = f;
+				continue;
+			}
+			if(node.x > f.x) {
+				Box b = { f.x, f.y, node.x - f.x, f.h };
+				new_rects_.emplace_back(b);
+			}
+			if(node.x + node.w < f.x + f.w) {
+				Box b = { node.x + node.w, f.y, f.x + f.w - node.x - node.w, f.h };
+				new_rects_.emplace_back(b);
+			}
+			if(node.y > f.y) {
+				Box b = { f.x, f.y, f.w, node.y - f.y };
+				new_rects_.emplace_back(b);
+			}
+			if(node.y + node.h < f.y + f.h) {
+				Box b = { f.x, node.y + node.h, f.w, f.y + f.h - node.y - node.h };
+				new_rects_.emplace_back(b);
+			}
+		}
+		free_rects_.resize(kept);
+
+		// The old free rectangles weren't contained in each other and each new one lies inside an old
+		// one, so only the new rectangles need checking against the rest.
+		for(std::size_t n = 0; n != new_rects_.size(); ++n) {
+			const Box& b = new_rects_[n];
+			bool redundant = false;
+			for(std::size_t m = 0; m != new_rects_.size() && !redundant; ++m) {
+				// Of two identical rectangles the later one is dropped.
+				redundant = m != n && new_rects_[m].contains(b) && (m < n || !b.contains(new_rects_[m]));
+			}
+			for(std::size_t m = 0; m != kept && !redundant; ++m) {
+				redundant = free_rects_[m].contains(b);
+			}
+			if(!redundant) {
+				free_rects_.emplace_back(b);
+			}
+		}
+	}
+
+	float RectPacker::getOccupancy() const
+	{
+		return width_ > 0 && height_ > 0 ? static_cast<float>(used_area_) / (static_cast<float>(width_) * height_) : 0.0f;
+	}
+
+	bool RectPacker::pack(const std::vector<point>& sizes, int max_width, int max_height, std::vector<rect>* out, RectPackerStats* stats, RectPackerMethod method)
+	{
+		profile::timer tm;
+		tm.start();
+
+		std::vector<int> order(sizes.size());
+		std::iota(order.begin(), order.end(), 0);
+		if(method == RectPackerMethod::SKYLINE) {
+			// Tallest first keeps the skyline flat.
+			std::sort(order.begin(), order.end(), [&sizes](int a, int b) {
+				return sizes[a].y != sizes[b].y ? sizes[a].y > sizes[b].y : sizes[a].x > sizes[b].x;
+			});
+		} else {
+			std::sort(order.begin(), order.end(), [&sizes](int a, int b) {
+				const int sa = std::max(sizes[a].x, sizes[a].y);
+				const int sb = std::max(sizes[b].x, sizes[b].y);
+				return sa != sb ? sa > sb : std::min(sizes[a].x, sizes[a].y) > std::min(sizes[b].x, sizes[b].y);
+			});
+		}
+
+		long long total_area = 0;
+		int max_w = 1, max_h = 1;
+		for(auto& sz : sizes) {
+			total_area += static_cast<long long>(sz.x) * sz.y;
+			max_w = std::max(max_w, sz.x);
+			max_h = std::max(max_h, sz.y);
+		}
+		if(max_w > max_width || max_h > max_height) {
+			return false;
+		}
+
+		// Start from a square with the total area, either packer will get within a few percent of that.
+		const int side = static_cast<int>(std::sqrt(static_cast<double>(total_area)));
+		int width = std::min(max_width, round_up(std::max(side, max_w), size_granularity));
+		int height = std::min(max_height, round_up(std::max(static_cast<int>(total_area / width), max_h), size_granularity));
+
+		out->resize(sizes.size());
+		int attempts = 0;
+		for(;;) {
+			++attempts;
+			RectPacker packer(width, height, method);
+			bool packed = true;
+			for(int n : order) {
+				if(!packer.insert(sizes[n].x, sizes[n].y, &(*out)[n])) {
+					packed = false;
+					break;
+				}
+			}
+			if(packed) {
+				break;
+			}
+			if(width >= max_width && height >= max_height) {
+				return false;
+			}
+			// Grow the shorter side by a thirty-second.
+			if((width <= height && width < max_width) || height >= max_height) {
+				width = std::min(max_width, round_up(width + std::max(width / 32, 1), size_granularity));
+			} else {
+				height = std::min(max_height, round_up(height + std::max(height / 32, 1), size_granularity));
+			}
+		}
+
+		if(stats != nullptr) {
+			stats->method = method;
+			stats->width = stats->height = 0;
+			for(auto& r : *out) {
+				stats->width = std::max(stats->width, r.x2());
+				stats->height = std::max(stats->height, r.y2());
+			}
+			stats->rects = static_cast<int>(sizes.size());
+			stats->used_area = total_area;
+			stats->efficiency = stats->width > 0 && stats->height > 0 
+				? static_cast<float>(total_area) / (static_cast<float>(stats->width) * stats->height) 
+				: 0.0f;
+			stats->attempts = attempts;
+			stats->elapsed = tm.check();
+		}
+		return true;
+	}
+
+	std::ostream& operator<<(std::ostream& os, const RectPackerStats& stats)
+	{
+		os << (stats.method == RectPackerMethod::SKYLINE ? "skyline: " : "maxrects: ") 
+			<< stats.rects << " rects in " << stats.width << "x" << stats.height
+			<< ", " << (stats.efficiency * 100.0f) << "% used"
+			<< ", " << stats.attempts << " attempt(s), " << (stats.elapsed * 1000.0) << "ms";
+		return os;
+	}
+}
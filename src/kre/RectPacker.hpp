@@ -0,0 +1,107 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "geometry.hpp"
+
+struct stbrp_context;
+struct stbrp_node;
+
+namespace KRE
+{
+	enum class RectPackerMethod {
+		// Bottom-left skyline (stb_rect_pack), fast and close to MaxRects for sprites of similar size.
+		SKYLINE,
+		// MaxRects with best short side fit, tighter for mixed sizes but slower for thousands of rectangles.
+		MAX_RECTS,
+	};
+
+	struct RectPackerStats
+	{
+		RectPackerStats() : method(RectPackerMethod::SKYLINE), width(0), height(0), rects(0), used_area(0), efficiency(0), attempts(0), elapsed(0) {}
+		RectPackerMethod method;
+		// Size of the area actually covered by the packed rectangles.
+		int width;
+		int height;
+		int rects;
+		long long used_area;
+		// used_area / (width * height)
+		float efficiency;
+		// Number of atlas sizes that were tried.
+		int attempts;
+		// In seconds.
+		double elapsed;
+	};
+
+	std::ostream& operator<<(std::ostream& os, const RectPackerStats& stats);
+
+	// Packs rectangles into a fixed size area, one at a time. Rectangles are never rotated.
+	// The MaxRects method keeps the list of maximal free rectangles and places each rectangle into
+	// the free one that leaves the shortest side over.
+	class RectPacker
+	{
+	public:
+		RectPacker(int width, int height, RectPackerMethod method=RectPackerMethod::SKYLINE);
+		~RectPacker();
+
+		// Places a w x h rectangle, returns false if there is no room for it.
+		bool insert(int w, int h, rect* out);
+
+		int width() const { return width_; }
+		int height() const { return height_; }
+		long long getUsedArea() const { return used_area_; }
+		float getOccupancy() const;
+
+		// Packs rectangles of the given sizes, largest first, into as small an area as it can find no bigger than
+		// max_width x max_height. The first size tried is the total area, growing a little on each failure.
+		// out receives the placements in the same order as sizes. Returns false if they can't all be fitted.
+		static bool pack(const std::vector<point>& sizes, int max_width, int max_height, std::vector<rect>* out, RectPackerStats* stats=nullptr, RectPackerMethod method=RectPackerMethod::SKYLINE);
+	private:
+		struct Box
+		{
+			int x, y, w, h;
+			bool contains(const Box& b) const { return b.x >= x && b.y >= y && b.x + b.w <= x + w && b.y + b.h <= y + h; }
+			bool intersects(const Box& b) const { return b.x < x + w && b.x + b.w > x && b.y < y + h && b.y + b.h > y; }
+		};
+		bool insertMaxRects(int w, int h, rect* out);
+		bool insertSkyline(int w, int h, rect* out);
+		void place(const Box& node);
+
+		int width_;
+		int height_;
+		RectPackerMethod method_;
+		long long used_area_;
+		std::vector<Box> free_rects_;
+		std::vector<Box> new_rects_;
+		std::unique_ptr<stbrp_context> skyline_;
+		std::unique_ptr<stbrp_node[]> skyline_nodes_;
+
+		RectPacker(const RectPacker&);
+		void operator=(const RectPacker&);
+	};
+}
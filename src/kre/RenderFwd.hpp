@@ -34,6 +34,9 @@ namespace KRE
 	class RenderQueue;
 	typedef std::shared_ptr<RenderQueue> RenderQueuePtr;
 
+	class QuadBatcher;
+	typedef std::shared_ptr<QuadBatcher> QuadBatcherPtr;
+
 	class RenderManager;
 	typedef std::shared_ptr<RenderManager> RenderManagerPtr;
     
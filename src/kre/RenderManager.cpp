@@ -22,8 +22,10 @@
 */
 
 #include "asserts.hpp"
+#include "profile_timer.hpp"
 #include "RenderManager.hpp"
 #include "RenderQueue.hpp"
+#include "Texture.hpp"
 
 namespace KRE
 {
@@ -57,6 +59,8 @@ namespace KRE
 
 	void RenderManager::render(const WindowPtr& wm) const
 	{
+		PROFILE_ZONE("RenderManager::render");
+		Texture::processPendingUploads();
 		for(auto& q : render_queues_) {
 			q.second->preRender(wm);
 		}
@@ -21,15 +21,174 @@
 	   distribution.
 */
 
+#include <cstring>
+
 #include "asserts.hpp"
+#include "AttributeSet.hpp"
+#include "profile_timer.hpp"
+#include "QuadBatcher.hpp"
 #include "Renderable.hpp"
 #include "RenderQueue.hpp"
 #include "WindowManager.hpp"
 
 namespace KRE
 {
+	namespace
+	{
+		// Bit positions of the fields in the sort key, from most to least significant:
+		// layer(8) blended(1) render target(6) shader(12) texture(16) blend(11) depth(10)
+		// Blended items only set the layer and blended fields, so the stable sort keeps them in
+		// submission order.
+		const int layer_shift = 56;
+		const int blended_shift = 55;
+		const int render_target_shift = 49;
+		const int shader_shift = 37;
+		const int texture_shift = 21;
+		const int blend_shift = 10;
+		const int depth_bits = 10;
+
+		// Maps a pointer to a few bits. Collisions only mean that two objects might not be grouped 
+		// together, state is always compared properly.
+		uint64_t hash_pointer(const void* p, int bits)
+		{
+			if(p == nullptr) {
+				return 0;
+			}
+			const uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)) * 0x9e3779b97f4a7c15ULL;
+			return h >> (64 - bits);
+		}
+
+		uint64_t blend_key(const Renderable* r)
+		{
+			uint64_t key = 0;
+			if(r->isBlendStateSet()) {
+				key |= (r->isBlendEnabled() ? 1 : 2) << 9;
+			}
+			if(r->isBlendModeSet()) {
+				key |= (1 << 8) 
+					| (static_cast<uint64_t>(r->getBlendMode().src()) << 4) 
+					| static_cast<uint64_t>(r->getBlendMode().dst());
+			}
+			return key;
+		}
+
+		// Flips the bits of a float so that it sorts correctly as an unsigned integer.
+		uint64_t depth_key(float z)
+		{
+			uint32_t u;
+			std::memcpy(&u, &z, sizeof(u));
+			u = (u & 0x80000000U) ? ~u : (u | 0x80000000U);
+			return u >> (32 - depth_bits);
+		}
+
+		// Blending is on unless the renderable turns it off, as that is the default device state.
+		bool is_blended(const Renderable* r)
+		{
+			return !r->isBlendStateSet() || r->isBlendEnabled();
+		}
+
+		uint64_t make_sort_key(uint64_t order, const Renderable* r)
+		{
+			if(is_blended(r)) {
+				return (order >> layer_shift << layer_shift) | (1ULL << blended_shift);
+			}
+			return (order >> layer_shift << layer_shift)
+				| (hash_pointer(r->getRenderTarget().get(), 6) << render_target_shift)
+				| (hash_pointer(r->getShader().get(), 12) << shader_shift)
+				| (hash_pointer(r->getTexture().get(), 16) << texture_shift)
+				| (blend_key(r) << blend_shift)
+				// World z, scene graph children are positioned through the derived model matrix.
+				| depth_key(r->getModelMatrix()[3].z);
+		}
+
+		bool depth_test_enabled(const Renderable* r)
+		{
+			return r->isDepthEnableStateSet() && r->isDepthEnabled();
+		}
+
+		void count_state_changes(const Renderable* prev, const Renderable* r, StateChangeCounts* counts)
+		{
+			if(prev->getRenderTarget() != r->getRenderTarget()) {
+				++counts->render_target;
+			}
+			if(prev->getShader() != r->getShader()) {
+				++counts->shader;
+			}
+			if(prev->getTexture() != r->getTexture()) {
+				++counts->texture;
+			}
+			if(blend_key(prev) != blend_key(r) 
+				|| prev->isBlendEquationSet() != r->isBlendEquationSet()
+				|| (r->isBlendEquationSet() && prev->getBlendEquation() != r->getBlendEquation())) {
+				++counts->blend;
+			}
+			if(depth_test_enabled(prev) != depth_test_enabled(r)) {
+				++counts->depth;
+			}
+		}
+
+		// Number of draw calls the display device will make for the renderable.
+		int count_draw_calls(const Renderable* r)
+		{
+			if(!r->isEnabled()) {
+				return 0;
+			}
+			int draws = 0;
+			for(auto& as : r->getAttributeSet()) {
+				if(as->isEnabled() && ((!as->isMultiDrawEnabled() && as->getCount() > 0) || (as->isMultiDrawEnabled() && as->getMultiDrawCount() > 0))) {
+					++draws;
+				}
+			}
+			return draws;
+		}
+
+		// Stable LSD radix sort on the keys, one byte at a time. Bytes that are the same for
+		// every key are skipped, which is common for the layer and render target.
+		template<typename T>
+		void radix_sort(std::vector<T>& items, std::vector<T>& scratch)
+		{
+			if(items.size() < 2) {
+				return;
+			}
+			scratch.resize(items.size());
+			for(int shift = 0; shift != 64; shift += 8) {
+				std::size_t offsets[257] = {};
+				for(auto& item : items) {
+					++offsets[((item.key >> shift) & 0xff) + 1];
+				}
+				if(offsets[((items.front().key >> shift) & 0xff) + 1] == items.size()) {
+					continue;
+				}
+				for(int n = 0; n != 256; ++n) {
+					offsets[n + 1] += offsets[n];
+				}
+				for(auto& item : items) {
+					scratch[offsets[(item.key >> shift) & 0xff]++] = item;
+				}
+				items.swap(scratch);
+			}
+		}
+	}
+
+	std::ostream& operator<<(std::ostream& os, const RenderQueueStats& stats)
+	{
+		os << "renderables: " << stats.renderables
+			<< ", draw calls: " << stats.draw_calls
+			<< ", skipped: " << stats.draw_calls_skipped
+			<< ", batches: " << stats.batches << " (" << stats.batched_renderables << " renderables)"
+			<< ", state changes: " << stats.sorted.total() 
+			<< " (avoided " << (stats.submitted.total() - stats.sorted.total()) << ")"
+			<< ", render target: " << stats.sorted.render_target << "/" << stats.submitted.render_target
+			<< ", shader: " << stats.sorted.shader << "/" << stats.submitted.shader
+			<< ", texture: " << stats.sorted.texture << "/" << stats.submitted.texture
+			<< ", blend: " << stats.sorted.blend << "/" << stats.submitted.blend
+			<< ", depth: " << stats.sorted.depth << "/" << stats.submitted.depth;
+		return os;
+	}
+
 	RenderQueue::RenderQueue(const std::string& name) 
-		: name_(name)
+		: name_(name),
+		  sort_mode_(SortMode::ORDER)
 	{
 	}
 
@@ -52,23 +211,87 @@ namespace KRE
 
 	void RenderQueue::preRender(const WindowPtr& wm)
 	{
-		for(auto r : renderables_) {
+		PROFILE_ZONE("RenderQueue::preRender");
+		for(auto& r : renderables_) {
 			r.second->preRender(wm);
 		}
+		if(sort_mode_ == SortMode::STATE || batcher_ != nullptr) {
+			buildDrawList();
+		}
+	}
+
+	void RenderQueue::setBatching(bool en)
+	{
+		if(!en) {
+			batcher_.reset();
+		} else if(batcher_ == nullptr) {
+			batcher_ = QuadBatcher::create();
+		}
+	}
+
+	void RenderQueue::buildDrawList()
+	{
+		stats_ = RenderQueueStats();
+		items_.clear();
+		const Renderable* prev = nullptr;
+		for(auto& rp : renderables_) {
+			Renderable* r = rp.second.get();
+			++stats_.renderables;
+			if(count_draw_calls(r) == 0) {
+				++stats_.draw_calls_skipped;
+				continue;
+			}
+			if(prev != nullptr) {
+				count_state_changes(prev, r, &stats_.submitted);
+			}
+			prev = r;
+			DrawItem item = { sort_mode_ == SortMode::STATE ? make_sort_key(rp.first, r) : 0, r };
+			items_.emplace_back(item);
+		}
+
+		if(sort_mode_ == SortMode::STATE) {
+			radix_sort(items_, scratch_);
+		}
+
+		draw_list_.clear();
+		for(auto& item : items_) {
+			draw_list_.emplace_back(item.r);
+		}
+		if(batcher_ != nullptr) {
+			batcher_->batch(&draw_list_);
+			stats_.batches = batcher_->getBatchCount();
+			stats_.batched_renderables = batcher_->getBatchedCount();
+		}
+
+		for(std::size_t n = 0; n != draw_list_.size(); ++n) {
+			stats_.draw_calls += count_draw_calls(draw_list_[n]);
+			if(n > 0) {
+				count_state_changes(draw_list_[n-1], draw_list_[n], &stats_.sorted);
+			}
+		}
 	}
 
 	void RenderQueue::render(const WindowPtr& wm) const 
 	{
-		for(auto r : renderables_) {
+		PROFILE_ZONE("RenderQueue::render");
+		if(sort_mode_ == SortMode::STATE || batcher_ != nullptr) {
+			for(auto r : draw_list_) {
+				wm->render(r);
+			}
+			return;
+		}
+		for(auto& r : renderables_) {
 			wm->render(r.second.get());
 		}
 	}
 
 	void RenderQueue::postRender(const WindowPtr& wm)
 	{
-		for(auto r : renderables_) {
+		for(auto& r : renderables_) {
 			r.second->postRender(wm);
 		}
 		renderables_.clear();
+		items_.clear();
+		draw_list_.clear();
 	}
 }
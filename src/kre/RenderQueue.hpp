@@ -25,15 +25,58 @@
 
 #include <map>
 #include <cstdint>
+#include <ostream>
+#include <vector>
 
 #include "RenderFwd.hpp"
 #include "WindowManagerFwd.hpp"
 
 namespace KRE
 {
+	// Number of times each piece of state differs between consecutive renderables.
+	struct StateChangeCounts
+	{
+		StateChangeCounts() : render_target(0), shader(0), texture(0), blend(0), depth(0) {}
+		int total() const { return render_target + shader + texture + blend + depth; }
+		int render_target;
+		int shader;
+		int texture;
+		int blend;
+		int depth;
+	};
+
+	struct RenderQueueStats
+	{
+		RenderQueueStats() : renderables(0), draw_calls(0), draw_calls_skipped(0), batches(0), batched_renderables(0), submitted(), sorted() {}
+		int renderables;
+		int draw_calls;
+		// Renderables that were disabled or had nothing to draw, so weren't sent to the display device.
+		int draw_calls_skipped;
+		// Batches drawn and the renderables that were merged into them.
+		int batches;
+		int batched_renderables;
+		// State changes the renderables needed in the order they were queued and in the order 
+		// they were drawn, after sorting and batching.
+		StateChangeCounts submitted;
+		StateChangeCounts sorted;
+	};
+
+	std::ostream& operator<<(std::ostream& os, const RenderQueueStats& stats);
+
 	class RenderQueue
 	{
 	public:
+		enum class SortMode {
+			// Draw in the order given to enQueue().
+			ORDER,
+			// Draw sorted by layer, the top eight bits of the order given to enQueue(). Within a
+			// layer, renderables with blending turned off by setBlendState(false) come first, 
+			// sorted by render target, shader, texture, blend mode then depth. Everything else
+			// is treated as blended and follows in the order given to enQueue(), so translucent
+			// items keep their painter's order.
+			STATE,
+		};
+
 		RenderQueue(const std::string& name);
 		const std::string& name() const { return name_; }
 
@@ -44,10 +87,33 @@ namespace KRE
 		void render(const WindowPtr& wm) const;
 		void postRender(const WindowPtr& wm);
 
+		void setSortMode(SortMode mode) { sort_mode_ = mode; }
+		SortMode getSortMode() const { return sort_mode_; }
+		// Merge consecutive compatible quads into single draw calls, see QuadBatcher.
+		void setBatching(bool en);
+		bool isBatchingEnabled() const { return batcher_ != nullptr; }
+		// Statistics for the last frame rendered in STATE mode or with batching enabled.
+		const RenderQueueStats& getStats() const { return stats_; }
+
 		static RenderQueuePtr create(const std::string& name);
 	private:
+		struct DrawItem
+		{
+			uint64_t key;
+			Renderable* r;
+		};
+
+		void buildDrawList();
+
 		std::map<uint64_t, RenderablePtr> renderables_;
 		std::string name_;
+		SortMode sort_mode_;
+		// Rebuilt every frame, but kept to avoid re-allocating.
+		std::vector<DrawItem> items_;
+		std::vector<DrawItem> scratch_;
+		std::vector<Renderable*> draw_list_;
+		QuadBatcherPtr batcher_;
+		RenderQueueStats stats_;
 		RenderQueue();
 		RenderQueue(const RenderQueue&);
 	};
@@ -21,12 +21,17 @@
 	   distribution.
 */
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "AttributeSet.hpp"
 #include "CameraObject.hpp"
 #include "DisplayDevice.hpp"
+#include "Frustum.hpp"
 #include "LightObject.hpp"
 #include "Renderable.hpp"
 #include "RenderTarget.hpp"
@@ -46,9 +51,9 @@ namespace KRE
 		  stencil_mask_(nullptr),
 		  enabled_(true),
 		  ignore_global_model_(false),
-		  derived_position_(0.0f),
-		  derived_rotation_(),
-		  derived_scale_(1.0f)
+		  derived_model_(1.0f),
+		  bounds_(),
+		  auto_bounds_(false)
 	{
 	}
 
@@ -62,9 +67,9 @@ namespace KRE
 		  stencil_mask_(nullptr),
 		  enabled_(true),
 		  ignore_global_model_(false),
-		  derived_position_(0.0f),
-		  derived_rotation_(),
-		  derived_scale_(1.0f)
+		  derived_model_(1.0f),
+		  bounds_(),
+		  auto_bounds_(false)
 	{
 	}
 
@@ -78,9 +83,9 @@ namespace KRE
 		  stencil_mask_(nullptr),
 		  enabled_(true),
 		  ignore_global_model_(false),
-		  derived_position_(0.0f),
-		  derived_rotation_(),
-		  derived_scale_(1.0f)
+		  derived_model_(1.0f),
+		  bounds_(),
+		  auto_bounds_(false)
 	{
 		if(!node.is_map()) {
 			return;
@@ -193,55 +198,199 @@ namespace KRE
 		if(node.has_key("use_lighting")) {
 			enableLighting(node["use_lighting"].as_bool());
 		}
+		if(node.has_key("bounds")) {
+			// Either "auto", {min:[x,y,z], max:[x,y,z]} or {centre:[x,y,z], radius:r}
+			const variant& b = node["bounds"];
+			if(b.is_string()) {
+				ASSERT_LOG(b.as_string() == "auto", "'bounds' should be \"auto\" or a map: " << b.as_string());
+				setAutoBounds(true);
+			} else if(b.has_key("radius")) {
+				setBoundingSphere(b.has_key("centre") ? variant_to_vec3(b["centre"]) : glm::vec3(0.0f), b["radius"].as_float());
+			} else {
+				ASSERT_LOG(b.has_key("min") && b.has_key("max"), "'bounds' map needs 'min' and 'max', or 'radius' keys: " << b.to_debug_string());
+				setBoundingBox(variant_to_vec3(b["min"]), variant_to_vec3(b["max"]));
+			}
+		}
+	}
+
+	void Renderable::setBoundingBox(const glm::vec3& mn, const glm::vec3& mx)
+	{
+		bounds_.type = RenderBounds::Type::BOX;
+		bounds_.min = mn;
+		bounds_.max = mx;
+		onBoundsChanged();
+	}
+
+	void Renderable::setBoundingSphere(const glm::vec3& centre, float radius)
+	{
+		bounds_.type = RenderBounds::Type::SPHERE;
+		bounds_.centre = centre;
+		bounds_.radius = radius;
+		onBoundsChanged();
+	}
+
+	void Renderable::clearBounds()
+	{
+		bounds_ = RenderBounds();
+		onBoundsChanged();
+	}
+
+	namespace
+	{
+		// Bounding box of the float position attributes, or a bounds of type NONE if there aren't any.
+		RenderBounds bounds_from_attributes(const std::vector<AttributeSetPtr>& attribute_sets)
+		{
+			RenderBounds res;
+			glm::vec3 mn(std::numeric_limits<float>::max());
+			glm::vec3 mx(-std::numeric_limits<float>::max());
+			for(auto& as : attribute_sets) {
+				for(auto& attr : as->getAttributes()) {
+					const uint8_t* data = static_cast<const uint8_t*>(attr->getData());
+					if(data == nullptr) {
+						continue;
+					}
+					for(auto& desc : attr->getAttrDesc()) {
+						if(desc.getAttrType() != AttrType::POSITION || desc.getVarType() != AttrFormat::FLOAT || desc.getNumElements() < 2) {
+							continue;
+						}
+						const unsigned elements = std::min(desc.getNumElements(), 3U);
+						const std::size_t stride = desc.getStride() != 0 ? desc.getStride() : desc.getNumElements() * sizeof(float);
+						const std::size_t size = attr->getDataSize();
+						for(std::size_t offs = desc.getOffset(); offs + elements * sizeof(float) <= size; offs += stride) {
+							glm::vec3 v(0.0f);
+							std::memcpy(&v, data + offs, elements * sizeof(float));
+							mn = glm::min(mn, v);
+							mx = glm::max(mx, v);
+							res.type = RenderBounds::Type::BOX;
+						}
+					}
+				}
+			}
+			res.min = mn;
+			res.max = mx;
+			return res;
+		}
+	}
+
+	void Renderable::calculateBoundsFromAttributes()
+	{
+		bounds_ = bounds_from_attributes(attributes_);
+		onBoundsChanged();
+	}
+
+	void Renderable::setAutoBounds(bool en)
+	{
+		auto_bounds_ = en;
+		onBoundsChanged();
+	}
+
+	RenderBounds Renderable::getBounds() const
+	{
+		if(auto_bounds_) {
+			return bounds_from_attributes(attributes_);
+		}
+		return bounds_;
 	}
 
-	void Renderable::setDerivedModel(const glm::vec3& p, const glm::quat& r, const glm::vec3& s)
+	bool Renderable::isVisible(const Frustum& frustum, const glm::mat4& parent) const
 	{
-		derived_position_ = p;
-		derived_rotation_ = r;
-		derived_scale_ = s;
+		const RenderBounds bounds = getBounds();
+		if(bounds.type == RenderBounds::Type::NONE) {
+			return true;
+		}
+		if(bounds.type == RenderBounds::Type::SPHERE) {
+			const glm::mat4 model = parent * getLocalModelMatrix();
+			const glm::vec3 centre(model * glm::vec4(bounds.centre, 1.0f));
+			const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+			return frustum.isCircleInside(centre, bounds.radius * scale);
+		}
+		glm::vec3 mn, mx;
+		getWorldBox(parent, &mn, &mx);
+		return frustum.isBoxInside(mn, mx);
+	}
+
+	bool Renderable::getWorldBox(const glm::mat4& parent, glm::vec3* mn, glm::vec3* mx) const
+	{
+		const RenderBounds bounds = getBounds();
+		if(bounds.type == RenderBounds::Type::NONE) {
+			return false;
+		}
+		const glm::mat4 model = parent * getLocalModelMatrix();
+		if(bounds.type == RenderBounds::Type::SPHERE) {
+			const glm::vec3 centre(model * glm::vec4(bounds.centre, 1.0f));
+			const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+			*mn = centre - glm::vec3(bounds.radius * scale);
+			*mx = centre + glm::vec3(bounds.radius * scale);
+			return true;
+		}
+		// Transform the box to a world space box that encloses it.
+		const glm::vec3 centre(model * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+		const glm::vec3 half = (bounds.max - bounds.min) * 0.5f;
+		const glm::vec3 extent = glm::abs(glm::vec3(model[0])) * half.x 
+			+ glm::abs(glm::vec3(model[1])) * half.y 
+			+ glm::abs(glm::vec3(model[2])) * half.z;
+		*mn = centre - extent;
+		*mx = centre + extent;
+		return true;
+	}
+
+	void Renderable::setDerivedModel(const glm::mat4& m)
+	{
+		derived_model_ = m;
 	}
 
 	void Renderable::setPosition(const glm::vec3& position) 
 	{
 		position_ = position;
+		onBoundsChanged();
 	}
 
 	void Renderable::setPosition(float x, float y, float z) 
 	{
 		position_ = glm::vec3(x, y, z);
+		onBoundsChanged();
 	}
 
 	void Renderable::setPosition(int x, int y, int z) 
 	{
 		position_ = glm::vec3(float(x), float(y), float(z));
+		onBoundsChanged();
 	}
 
 	void Renderable::setRotation(float angle, const glm::vec3& axis) 
 	{
 		rotation_ = glm::angleAxis(glm::radians(angle), axis);
+		onBoundsChanged();
 	}
 
 	void Renderable::setRotation(const glm::quat& rot) 
 	{
 		rotation_ = rot;
+		onBoundsChanged();
 	}
 
 	void Renderable::setScale(float xs, float ys, float zs) 
 	{
 		scale_ = glm::vec3(xs, ys, zs);
+		onBoundsChanged();
 	}
 
 	void Renderable::setScale(const glm::vec3& scale) 
 	{
 		scale_ = scale;
+		onBoundsChanged();
 	}
 
 	glm::mat4 Renderable::getModelMatrix() const 
 	{
-		return glm::translate(glm::mat4(1.0f), position_ + derived_position_) 
-			* glm::toMat4(derived_rotation_ * rotation_) 
-			* glm::scale(glm::mat4(1.0f), scale_ * derived_scale_);
+		return derived_model_ * getLocalModelMatrix();
+	}
+
+	glm::mat4 Renderable::getLocalModelMatrix() const
+	{
+		return glm::translate(glm::mat4(1.0f), position_) 
+			* glm::toMat4(rotation_) 
+			* glm::scale(glm::mat4(1.0f), scale_);
 	}
 
 	void Renderable::setCamera(const CameraPtr& camera)
@@ -35,6 +35,26 @@
 
 namespace KRE
 {
+	class Frustum;
+
+	// Local space bounding volume, used for frustum culling.
+	struct RenderBounds
+	{
+		enum class Type {
+			NONE,
+			BOX,
+			SPHERE,
+		};
+		RenderBounds() : type(Type::NONE), min(0.0f), max(0.0f), centre(0.0f), radius(0.0f) {}
+		Type type;
+		// For boxes.
+		glm::vec3 min;
+		glm::vec3 max;
+		// For spheres.
+		glm::vec3 centre;
+		float radius;
+	};
+
 	class Renderable : public ScopeableValue, public AlignedAllocator16
 	{
 	public:
@@ -62,8 +82,23 @@ namespace KRE
 		bool ignoreGlobalModelMatrix() const { return ignore_global_model_; }
 		void useGlobalModelMatrix(bool en=true) { ignore_global_model_ = en; }
 
-		// These are derived paramters, refreshed from parent SceneNode
-		void setDerivedModel(const glm::vec3& p, const glm::quat& r, const glm::vec3& s);
+		// This is the world transform of the parent SceneNode, refreshed when the node is rendered.
+		void setDerivedModel(const glm::mat4& m);
+
+		void setBoundingBox(const glm::vec3& mn, const glm::vec3& mx);
+		void setBoundingSphere(const glm::vec3& centre, float radius);
+		void clearBounds();
+		// Sets a bounding box around the float position attributes currently held.
+		void calculateBoundsFromAttributes();
+		// When set, the bounds are recalculated from the attributes every time they're needed.
+		void setAutoBounds(bool en);
+		bool hasAutoBounds() const { return auto_bounds_; }
+		// Renderables without bounds are never culled.
+		virtual RenderBounds getBounds() const;
+		// Tests the bounds, transformed by parent and then this renderable's own transform, against the frustum.
+		bool isVisible(const Frustum& frustum, const glm::mat4& parent) const;
+		// World space box enclosing the transformed bounds. Returns false if there are no bounds.
+		bool getWorldBox(const glm::mat4& parent, glm::vec3* mn, glm::vec3* mx) const;
 
 		size_t getOrder() const { return order_; }
 		void setOrder(size_t o) { order_ = o; }
@@ -108,8 +143,16 @@ namespace KRE
 		virtual void renderBegin() {}
 		// Called after draw commands have been sent before anything is torn down.
 		virtual void renderEnd() {}
+
+		// Renderables that draw one textured quad, as a four vertex triangle strip in model 
+		// space, can return it here to let render queues batch them. Batched renderables
+		// don't get renderBegin()/renderEnd() calls.
+		virtual const vertex_texcoord* getQuadVertices() const { return nullptr; }
 	private:
 		virtual void onTextureChanged() {}
+		// Called when the position, rotation, scale or bounds change.
+		virtual void onBoundsChanged() {}
+		glm::mat4 getLocalModelMatrix() const;
 
 		size_t order_;
 		glm::vec3 position_;
@@ -124,9 +167,9 @@ namespace KRE
 		StencilSettings stencil_settings_;
 		RenderablePtr stencil_mask_;
 
-		glm::vec3 derived_position_;
-		glm::quat derived_rotation_;
-		glm::vec3 derived_scale_;
+		glm::mat4 derived_model_;
+		RenderBounds bounds_;
+		bool auto_bounds_;
 
 		std::vector<AttributeSetPtr> attributes_;
 		//std::vector<UniformBufferBase> uniforms_;
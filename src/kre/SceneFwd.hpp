@@ -55,5 +55,24 @@ namespace KRE
 		RenderTargetPtr render_target;
 	};
 
+	struct SceneCullStats
+	{
+		SceneCullStats() : visible(0), culled(0) {}
+		int visible;
+		int culled;
+	};
+
+	// One object to be rendered this frame, as collected by SceneGraph::buildRenderList().
+	struct SceneRenderItem
+	{
+		// Points into the owning node's object set, which mustn't change until the items are submitted.
+		const SceneObjectPtr* object;
+		glm::mat4 world;
+		size_t queue;
+		size_t order;
+		// Index into SceneGraph::getRenderParams().
+		int params;
+	};
+
 	class Blittable;
 }
@@ -21,13 +21,21 @@
 	   distribution.
 */
 
+#include <algorithm>
 #include <functional>
 #include <map>
+#include <vector>
 
 #include "asserts.hpp"
+#include "CameraObject.hpp"
+#include "Frustum.hpp"
+#include "profile_timer.hpp"
+#include "RenderManager.hpp"
+#include "RenderTarget.hpp"
 #include "SceneGraph.hpp"
 #include "SceneNode.hpp"
 #include "SceneObject.hpp"
+#include "WorkerPool.hpp"
 
 namespace KRE
 {
@@ -42,12 +50,19 @@ namespace KRE
 	}
 		
 	SceneGraph::SceneGraph(const std::string& name) 
-		: name_(name) 
+		: name_(name),
+		  parallel_process_(false),
+		  culling_(true),
+		  cull_stats_(),
+		  visibility_count_(0),
+		  visibility_stamp_(0)
 	{
 	}
 
 	SceneGraph::~SceneGraph() 
 	{
+		// Objects may outlive the graph, they mustn't keep pointing at it.
+		setSpatialIndex(false);
 	}
 
 	SceneNodePtr SceneGraph::getRootNode()
@@ -57,41 +72,60 @@ namespace KRE
 
 	void SceneGraph::removeNode(std::weak_ptr<SceneNode> parent, SceneNodePtr node) 
 	{
-		the::tree<SceneNodePtr>::pre_iterator it = graph_.begin();
-		for(; it != graph_.end(); ++it) {
-			if(*it == node) {
-				graph_.erase(it);
-				//node->notifyNodeRemoved(parent);
-				return;
+		ASSERT_LOG(node->isAttached() && node->scene_graph_.lock().get() == this, "node not found when removing a child node");
+		// The node's children go with it. They are walked by child ranges, as finding the end of 
+		// a sub-tree in pre-order has to climb back up the tree.
+		the::tree<SceneNodePtr>::pre_iterator pos = node->tree_position_;
+		std::vector<the::tree<SceneNodePtr>::sub_pre_iterator> stack(1, pos);
+		while(!stack.empty()) {
+			auto sub = stack.back();
+			stack.pop_back();
+			if(!sub->childless()) {
+				for(the::tree<SceneNodePtr>::child_iterator it = sub->begin_child(); it != sub->end_child(); ++it) {
+					stack.emplace_back(it);
+				}
+			}
+			SceneNodePtr& n = *the::tree<SceneNodePtr>::pre_iterator(sub);
+			n->tree_position_ = the::tree<SceneNodePtr>::pre_iterator();
+			n->world_dirty_ = true;
+			if(spatial_index_ != nullptr) {
+				for(auto& o : n->objects_) {
+					unindexObject(o);
+				}
 			}
 		}
-		ASSERT_LOG(false, "node not found when removing a child node");
+		node->parent_.reset();
+		graph_.erase(pos);
+		//node->notifyNodeRemoved(parent);
 	}
 
 	void SceneGraph::attachNode(std::weak_ptr<SceneNode> parent, SceneNodePtr node) 
 	{
-		if(parent.lock() == nullptr) {
-			graph_.insert(graph_.end_child(), node);
-			node->notifyNodeAttached(*graph_.end_child());
-			return;
+		ASSERT_LOG(!node->isAttached(), "node is already attached to a scene graph");
+		SceneNodePtr parent_node = parent.lock();
+		if(parent_node == nullptr) {
+			parent_node = getRootNode();
 		}
-		the::tree<SceneNodePtr>::pre_iterator it = graph_.begin();
-		for(; it != graph_.end(); ++it) {
-			if(*it == parent.lock()) {
-				//graph_.insert(it, node);
-				graph_.insert_below(it, node);
-				node->notifyNodeAttached(parent);
-				return;
+		ASSERT_LOG(parent_node->isAttached() && parent_node->scene_graph_.lock().get() == this, "parent node not found when attaching a child node");
+		// New nodes are added as the last child of the parent.
+		the::tree<SceneNodePtr>::sub_pre_iterator sub = parent_node->tree_position_;
+		node->tree_position_ = graph_.insert(sub->end_child(), node);
+		node->parent_ = parent_node;
+		node->markDirty();
+		if(spatial_index_ != nullptr) {
+			for(auto& o : node->objects_) {
+				indexObject(node.get(), o);
 			}
 		}
-		ASSERT_LOG(false, "parent node not found when attaching a child node");
+		node->notifyNodeAttached(parent_node);
 	}
 
 	SceneGraphPtr SceneGraph::create(const std::string& name) 
 	{
 		// Create graph then insert a root node into the tree.
 		auto sg = std::make_shared<SceneGraph>(name);
-		sg->graph_.insert(sg->graph_.end(), sg->createNode());
+		auto root = sg->createNode();
+		root->tree_position_ = sg->graph_.insert(sg->graph_.end(), root);
 		return sg;
 	}
 	
@@ -115,32 +149,304 @@ namespace KRE
 		
 	}
 
-	void SceneGraph::renderSceneHelper(const RenderManagerPtr& renderer, 
-		the::tree<SceneNodePtr>::pre_iterator& it, 
-		SceneNodeParams* snp)
+	namespace
+	{
+		void erase_object(std::vector<SceneObject*>* objects, SceneObject* obj)
+		{
+			auto it = std::find(objects->begin(), objects->end(), obj);
+			if(it != objects->end()) {
+				*it = objects->back();
+				objects->pop_back();
+			}
+		}
+	}
+
+	void SceneGraph::indexObject(const SceneNode* node, const SceneObjectPtr& obj)
+	{
+		obj->spatial_graph_ = this;
+		obj->spatial_node_ = node;
+		// The pointer is to the entry in the node's object set, which stays put until it is removed.
+		obj->spatial_entry_ = &obj;
+		if(obj->hasAutoBounds() != obj->spatial_auto_) {
+			obj->spatial_auto_ = obj->hasAutoBounds();
+			if(obj->spatial_auto_) {
+				spatial_auto_.emplace_back(obj.get());
+			} else {
+				erase_object(&spatial_auto_, obj.get());
+			}
+		}
+		updateObjectBox(obj.get());
+	}
+
+	void SceneGraph::updateObjectBox(SceneObject* obj)
+	{
+		glm::vec3 mn, mx;
+		if(!obj->getWorldBox(obj->spatial_node_->getWorldMatrix(), &mn, &mx)) {
+			if(obj->spatial_proxy_ >= 0) {
+				spatial_index_->remove(obj->spatial_proxy_);
+				obj->spatial_proxy_ = -1;
+			}
+		} else if(obj->spatial_proxy_ < 0) {
+			obj->spatial_proxy_ = spatial_index_->insert(SpatialBox(mn, mx), const_cast<SceneObjectPtr*>(obj->spatial_entry_));
+		} else {
+			spatial_index_->update(obj->spatial_proxy_, SpatialBox(mn, mx));
+		}
+	}
+
+	void SceneGraph::unindexObject(const SceneObjectPtr& obj)
+	{
+		if(obj->spatial_proxy_ >= 0) {
+			spatial_index_->remove(obj->spatial_proxy_);
+			obj->spatial_proxy_ = -1;
+		}
+		if(obj->spatial_moved_) {
+			std::lock_guard<std::mutex> lock(spatial_moved_mutex_);
+			erase_object(&spatial_moved_, obj.get());
+			obj->spatial_moved_ = false;
+		}
+		if(obj->spatial_auto_) {
+			erase_object(&spatial_auto_, obj.get());
+			obj->spatial_auto_ = false;
+		}
+		obj->spatial_graph_ = nullptr;
+		obj->spatial_node_ = nullptr;
+		obj->spatial_entry_ = nullptr;
+	}
+
+	void SceneGraph::queueObjectUpdate(SceneObject* obj)
+	{
+		if(!obj->spatial_moved_) {
+			obj->spatial_moved_ = true;
+			std::lock_guard<std::mutex> lock(spatial_moved_mutex_);
+			spatial_moved_.emplace_back(obj);
+		}
+	}
+
+	void SceneGraph::setSpatialIndex(bool en)
+	{
+		if(en == hasSpatialIndex()) {
+			return;
+		}
+		if(!en) {
+			for(auto& n : graph_) {
+				for(auto& o : n->objects_) {
+					unindexObject(o);
+				}
+			}
+			spatial_updates_.clear();
+			spatial_index_.reset();
+			return;
+		}
+		spatial_updates_.clear();
+		spatial_index_.reset(new SpatialIndex());
+		for(auto& n : graph_) {
+			for(auto& o : n->objects_) {
+				indexObject(n.get(), o);
+			}
+		}
+	}
+
+	void SceneGraph::updateSpatialIndex()
+	{
+		if(spatial_index_ == nullptr) {
+			return;
+		}
+		PROFILE_ZONE("SceneGraph::updateSpatialIndex");
+		for(auto& n : spatial_updates_) {
+			// Nodes may have been removed since they were queued.
+			if(!n->isAttached()) {
+				continue;
+			}
+			for(auto& o : n->objects_) {
+				indexObject(n.get(), o);
+			}
+		}
+		spatial_updates_.clear();
+		// Removed objects have already been taken off the list.
+		for(auto obj : spatial_moved_) {
+			obj->spatial_moved_ = false;
+			indexObject(obj->spatial_node_, *obj->spatial_entry_);
+		}
+		spatial_moved_.clear();
+		for(auto obj : spatial_auto_) {
+			updateObjectBox(obj);
+		}
+	}
+
+	void SceneGraph::getQueryObjects(std::vector<SceneObjectPtr>* objects) const
+	{
+		objects->reserve(objects->size() + spatial_results_.size());
+		for(int proxy : spatial_results_) {
+			objects->emplace_back(*static_cast<const SceneObjectPtr*>(spatial_index_->getUserData(proxy)));
+		}
+	}
+
+	void SceneGraph::queryFrustum(const Frustum& frustum, std::vector<SceneObjectPtr>* objects)
+	{
+		ASSERT_LOG(spatial_index_ != nullptr, "Spatial index queries need setSpatialIndex(true)");
+		updateSpatialIndex();
+		spatial_results_.clear();
+		spatial_index_->queryFrustum(frustum, &spatial_results_);
+		getQueryObjects(objects);
+	}
+
+	void SceneGraph::queryRect(const rectf& r, std::vector<SceneObjectPtr>* objects)
 	{
-		if(it == graph_.end()) {
+		ASSERT_LOG(spatial_index_ != nullptr, "Spatial index queries need setSpatialIndex(true)");
+		updateSpatialIndex();
+		spatial_results_.clear();
+		spatial_index_->queryRect(r, &spatial_results_);
+		getQueryObjects(objects);
+	}
+
+	void SceneGraph::queryRay(const glm::vec3& origin, const glm::vec3& direction, float max_distance, std::vector<SceneObjectPtr>* objects)
+	{
+		ASSERT_LOG(spatial_index_ != nullptr, "Spatial index queries need setSpatialIndex(true)");
+		updateSpatialIndex();
+		std::vector<SpatialRayHit> hits;
+		spatial_index_->queryRay(origin, direction, max_distance, &hits);
+		spatial_results_.clear();
+		for(auto& hit : hits) {
+			spatial_results_.emplace_back(hit.proxy);
+		}
+		getQueryObjects(objects);
+	}
+
+	const SceneGraph::FrustumVisibility& SceneGraph::getFrustumVisibility(const Frustum* frustum)
+	{
+		for(size_t n = 0; n != visibility_count_; ++n) {
+			if(visibility_[n].frustum == frustum) {
+				return visibility_[n];
+			}
+		}
+		if(visibility_count_ == visibility_.size()) {
+			visibility_.emplace_back();
+		}
+		FrustumVisibility& fv = visibility_[visibility_count_++];
+		fv.frustum = frustum;
+		fv.stamp = ++visibility_stamp_;
+		fv.marks.resize(spatial_index_->getCapacity(), 0);
+		spatial_results_.clear();
+		spatial_index_->queryFrustum(*frustum, &spatial_results_);
+		for(int proxy : spatial_results_) {
+			fv.marks[proxy] = fv.stamp;
+		}
+		return fv;
+	}
+
+	int SceneGraph::addRenderItems(SceneNode* node, int params)
+	{
+		// Nodes that don't change the camera, lights or render target share their parent's entry.
+		if(node->camera_ || !node->lights_.empty() || node->render_target_) {
+			SceneNodeParams snp = render_params_[params];
+			if(node->camera_) {
+				snp.camera = node->camera_;
+			}
+			for(auto& l : node->lights_) {
+				snp.lights[l.first] = l.second;
+			}
+			if(node->render_target_) {
+				snp.render_target = node->render_target_;
+				node->render_target_->clear();
+			}
+			params = static_cast<int>(render_params_.size());
+			render_params_.emplace_back(std::move(snp));
+		}
+
+		// Refreshed for every node, parents first, so that getWorldMatrix() never has to walk up a long chain.
+		const glm::mat4& world = node->getWorldMatrix();
+		const CameraPtr& camera = render_params_[params].camera;
+		const Frustum* frustum = culling_ && camera != nullptr ? camera->getFrustum().get() : nullptr;
+		// With the spatial index the frustum is tested once against the tree, objects just look up the result.
+		const FrustumVisibility* visibility = frustum != nullptr && spatial_index_ != nullptr ? &getFrustumVisibility(frustum) : nullptr;
+		for(auto& o : node->objects_) {
+			const bool visible = frustum == nullptr 
+				|| (visibility != nullptr && o->spatial_proxy_ >= 0 ? visibility->marks[o->spatial_proxy_] == visibility->stamp : o->isVisible(*frustum, world));
+			if(!visible) {
+				++cull_stats_.culled;
+				continue;
+			}
+			++cull_stats_.visible;
+			SceneRenderItem item = { &o, world, o->getQueue(), o->getOrder(), params };
+			render_items_.emplace_back(item);
+		}
+		return params;
+	}
+
+	void SceneGraph::buildRenderList()
+	{
+		render_items_.clear();
+		render_params_.clear();
+		cull_stats_ = SceneCullStats();
+		traversal_stack_.clear();
+		visibility_count_ = 0;
+		updateSpatialIndex();
+		render_params_.emplace_back();
+		if(graph_.empty()) {
 			return;
 		}
-		// XXX the logic isn't quite right here, snp needs to be cleared at some point.
-		(*it)->renderNode(renderer, snp);
-		renderSceneHelper(renderer, ++it, snp);
+
+		// Each frame on the stack holds the remaining children of a node and the parameters they inherit,
+		// so siblings never see each other's camera, lights or render target.
+		const auto visit = [this](SceneNode* node, int params) {
+			params = addRenderItems(node, params);
+			the::tree<SceneNodePtr>::sub_pre_iterator sub = node->tree_position_;
+			if(!sub->childless()) {
+				TraversalFrame frame = { sub->begin_child(), sub->end_child(), params };
+				traversal_stack_.emplace_back(frame);
+			}
+		};
+		visit(graph_.begin()->get(), 0);
+		while(!traversal_stack_.empty()) {
+			TraversalFrame& frame = traversal_stack_.back();
+			if(frame.next == frame.end) {
+				traversal_stack_.pop_back();
+				continue;
+			}
+			SceneNode* node = (frame.next++)->get();
+			visit(node, frame.params);
+		}
 	}
 
 	void SceneGraph::renderScene(const RenderManagerPtr& renderer)
 	{
-		the::tree<SceneNodePtr>::pre_iterator it = graph_.begin();
-		//LOG_DEBUG("RenderScene: " << (*it)->NodeName());
-		SceneNodeParams snp;
-		renderSceneHelper(renderer, it, &snp);
+		PROFILE_ZONE("SceneGraph::renderScene");
+		buildRenderList();
+		for(auto& item : render_items_) {
+			const SceneObjectPtr& o = *item.object;
+			const SceneNodeParams& snp = render_params_[item.params];
+			o->setDerivedModel(item.world);
+			o->setCamera(snp.camera);
+			o->setLights(snp.lights);
+			o->setRenderTarget(snp.render_target);
+			renderer->addRenderableToQueue(item.queue, item.order, o);
+		}
 	}
 
 	void SceneGraph::process(float elapsed_time)
 	{
+		PROFILE_ZONE("SceneGraph::process");
+		if(!parallel_process_) {
+			the::tree<SceneNodePtr>::pre_iterator it = graph_.begin();
+			for(; it != graph_.end(); ++it) {
+				(*it)->process(elapsed_time);
+			}
+			return;
+		}
+
+		// Other nodes are processed in order first, then the independent ones all at once.
+		std::vector<SceneNodePtr> concurrent;
 		the::tree<SceneNodePtr>::pre_iterator it = graph_.begin();
 		for(; it != graph_.end(); ++it) {
-			(*it)->process(elapsed_time);
+			if((*it)->canProcessConcurrently()) {
+				concurrent.emplace_back(*it);
+			} else {
+				(*it)->process(elapsed_time);
+			}
 		}
+		WorkerPool::getDefault().parallelFor(concurrent.size(), [&concurrent, elapsed_time](std::size_t n) {
+			concurrent[n]->process(elapsed_time);
+		});
 	}
 
 	std::ostream& operator<<(std::ostream& os, const SceneGraph& sg)
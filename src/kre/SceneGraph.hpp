@@ -23,8 +23,14 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "geometry.hpp"
 #include "RenderFwd.hpp"
 #include "SceneFwd.hpp"
+#include "SpatialIndex.hpp"
 #include "WindowManager.hpp"
 #include "treetree/tree.hpp"
 
@@ -40,17 +46,94 @@ namespace KRE
 		static SceneGraphPtr create(const std::string& name);
 		SceneNodePtr createNode(const std::string& node_type=std::string(), const variant& node=variant());
 		SceneNodePtr getRootNode();
+		// Builds the render list and adds the items to the renderer's queues.
 		void renderScene(const RenderManagerPtr& renderer);
-		void renderSceneHelper(const RenderManagerPtr& renderer, the::tree<SceneNodePtr>::pre_iterator& it, SceneNodeParams* snp);
+		// Walks the graph once, without recursion, collecting the objects to be rendered.
+		void buildRenderList();
+		const std::vector<SceneRenderItem>& getRenderItems() const { return render_items_; }
+		// Camera, lights and render target in effect for each item, shared by the items from the same sub-tree.
+		const std::vector<SceneNodeParams>& getRenderParams() const { return render_params_; }
+
+		// Objects with bounds are left out of the render list when they are outside the frustum of 
+		// their camera. Only cameras with a frustum attached (Camera::createFrustum()) cull.
+		void setCulling(bool en) { culling_ = en; }
+		bool isCullingEnabled() const { return culling_; }
+		// Counts from the last buildRenderList().
+		const SceneCullStats& getCullStats() const { return cull_stats_; }
+
+		// While enabled, objects with bounds are kept in a spatial index that follows the nodes
+		// and the objects' own transforms and bounds as they change. Objects with auto bounds are
+		// refreshed on every update, as their attributes can change at any time. Rendering uses
+		// it for culling, and it answers the queries below.
+		void setSpatialIndex(bool en);
+		bool hasSpatialIndex() const { return spatial_index_ != nullptr; }
+		const SpatialIndex* getSpatialIndex() const { return spatial_index_.get(); }
+		// Applies the node, transform and bounds changes made since the last update. Called by buildRenderList()
+		// and the queries, so only needed before using getSpatialIndex() directly.
+		void updateSpatialIndex();
+		// The queries test the indexed boxes, which are grown by a margin, so the results may 
+		// include objects just outside the area.
+		void queryFrustum(const Frustum& frustum, std::vector<SceneObjectPtr>* objects);
+		void queryRect(const rectf& r, std::vector<SceneObjectPtr>* objects);
+		// Objects are sorted by the distance at which the ray enters their box.
+		void queryRay(const glm::vec3& origin, const glm::vec3& direction, float max_distance, std::vector<SceneObjectPtr>* objects);
 	
 		void process(float);
+		// When set, nodes that can be processed concurrently are handed to the default worker pool.
+		void setParallelProcess(bool en) { parallel_process_ = en; }
+		bool isParallelProcess() const { return parallel_process_; }
 
 		static void registerFactoryFunction(const std::string& type, std::function<SceneNodePtr(std::weak_ptr<SceneGraph>,const variant&)>);
 	private:
 		std::string name_;
 		the::tree<SceneNodePtr> graph_;
+		bool parallel_process_;
+		bool culling_;
+		SceneCullStats cull_stats_;
+
+		struct TraversalFrame {
+			the::tree<SceneNodePtr>::child_iterator next;
+			the::tree<SceneNodePtr>::child_iterator end;
+			int params;
+		};
+		// Rebuilt every frame, but kept to avoid re-allocating.
+		std::vector<SceneRenderItem> render_items_;
+		std::vector<SceneNodeParams> render_params_;
+		std::vector<TraversalFrame> traversal_stack_;
+
+		std::unique_ptr<SpatialIndex> spatial_index_;
+		// Nodes that moved, or whose objects changed bounds, since the last update.
+		std::vector<SceneNodePtr> spatial_updates_;
+		// Objects that moved themselves since the last update. Locked as objects of concurrently
+		// processed nodes may move.
+		std::vector<SceneObject*> spatial_moved_;
+		std::mutex spatial_moved_mutex_;
+		std::vector<SceneObject*> spatial_auto_;
+		std::vector<int> spatial_results_;
+		// Results of the frustum queries made while building the render list, one per frustum.
+		// A proxy was found if its mark equals the stamp, so the marks never need clearing.
+		struct FrustumVisibility {
+			const Frustum* frustum;
+			unsigned stamp;
+			std::vector<unsigned> marks;
+		};
+		std::vector<FrustumVisibility> visibility_;
+		size_t visibility_count_;
+		unsigned visibility_stamp_;
+
+		int addRenderItems(SceneNode* node, int params);
+		void indexObject(const SceneNode* node, const SceneObjectPtr& obj);
+		void unindexObject(const SceneObjectPtr& obj);
+		void updateObjectBox(SceneObject* obj);
+		void queueSpatialUpdate(const SceneNodePtr& node) { spatial_updates_.emplace_back(node); }
+		void queueObjectUpdate(SceneObject* obj);
+		const FrustumVisibility& getFrustumVisibility(const Frustum* frustum);
+		void getQueryObjects(std::vector<SceneObjectPtr>* objects) const;
+
 		SceneGraph(const SceneGraph&);
 
+		friend class SceneNode;
+		friend class SceneObject;
 		friend std::ostream& operator<<(std::ostream& s, const SceneGraph& sg);
 	};
 
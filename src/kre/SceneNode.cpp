@@ -24,7 +24,6 @@
 #include "asserts.hpp"
 #include "CameraObject.hpp"
 #include "LightObject.hpp"
-#include "RenderManager.hpp"
 #include "RenderTarget.hpp"
 #include "SceneGraph.hpp"
 #include "SceneNode.hpp"
@@ -51,7 +50,12 @@ namespace KRE
 		: scene_graph_(sg),
 		  position_(0.0f),
 		  rotation_(1.0f, 0.0f, 0.0f, 0.0f),
-		  scale_(1.0f)
+		  scale_(1.0f),
+		  model_matrix_(1.0f),
+		  world_matrix_(1.0f),
+		  model_dirty_(true),
+		  world_dirty_(true),
+		  tree_position_()
 	{
 		ASSERT_LOG(scene_graph_.lock() != nullptr, "scene_graph_ was null.");
 	}
@@ -61,7 +65,12 @@ namespace KRE
 		  parent_(),
 		  position_(0.0f),
 		  rotation_(1.0f, 0.0f, 0.0f, 0.0f),
-		  scale_(1.0f)
+		  scale_(1.0f),
+		  model_matrix_(1.0f),
+		  world_matrix_(1.0f),
+		  model_dirty_(true),
+		  world_dirty_(true),
+		  tree_position_()
 	{
 		ASSERT_LOG(scene_graph_.lock() != nullptr, "scene_graph_ was null.");
 		if(node.has_key("camera")) {
@@ -149,13 +158,21 @@ namespace KRE
 
 	void SceneNode::attachObject(const SceneObjectPtr& obj)
 	{
-		objects_.emplace(obj);
+		auto res = objects_.emplace(obj);
+		auto sg = scene_graph_.lock();
+		if(res.second && isAttached() && sg != nullptr && sg->hasSpatialIndex()) {
+			sg->indexObject(this, *res.first);
+		}
 	}
 
 	void SceneNode::removeObject(const SceneObjectPtr& obj)
 	{
 		auto it = objects_.find(obj);
 		ASSERT_LOG(it != objects_.end(), "Object is not in list: " << obj);
+		auto sg = scene_graph_.lock();
+		if(isAttached() && sg != nullptr && sg->hasSpatialIndex()) {
+			sg->unindexObject(*it);
+		}
 		objects_.erase(it);
 	}
 
@@ -178,66 +195,123 @@ namespace KRE
 		render_target_ = obj;
 	}
 
-	void SceneNode::renderNode(const RenderManagerPtr& renderer, SceneNodeParams* rp)
-	{
-		if(camera_) {
-			rp->camera = camera_;
-		}
-		for(auto l : lights_) {
-			rp->lights[l.first] = l.second;
-		}
-		if(render_target_) {
-			rp->render_target = render_target_;
-			render_target_->clear();
-		}
-		
-		for(auto o : objects_) {
-			o->setDerivedModel(getPosition(), getRotation(), getScale());
-			o->setCamera(rp->camera);
-			o->setLights(rp->lights);
-			o->setRenderTarget(rp->render_target);
-			renderer->addRenderableToQueue(o->getQueue(), o->getOrder(), o);
-		}
-	}
-
 	void SceneNode::setPosition(const glm::vec3& position) 
 	{
 		position_ = position;
+		markDirty();
 	}
 
 	void SceneNode::setPosition(float x, float y, float z) 
 	{
 		position_ = glm::vec3(x, y, z);
+		markDirty();
 	}
 
 	void SceneNode::setPosition(int x, int y, int z) 
 	{
 		position_ = glm::vec3(float(x), float(y), float(z));
+		markDirty();
 	}
 
 	void SceneNode::setRotation(float angle, const glm::vec3& axis) 
 	{
 		rotation_ = glm::angleAxis(glm::radians(angle), axis);
+		markDirty();
 	}
 
 	void SceneNode::setRotation(const glm::quat& rot) 
 	{
 		rotation_ = rot;
+		markDirty();
 	}
 
 	void SceneNode::setScale(float xs, float ys, float zs) 
 	{
 		scale_ = glm::vec3(xs, ys, zs);
+		markDirty();
 	}
 
 	void SceneNode::setScale(const glm::vec3& scale) 
 	{
 		scale_ = scale;
+		markDirty();
 	}
 
-	glm::mat4 SceneNode::getModelMatrix() const 
+	const glm::mat4& SceneNode::getModelMatrix() const 
 	{
-		return glm::translate(glm::mat4(1.0f), position_) * glm::toMat4(rotation_) * glm::scale(glm::mat4(1.0f), scale_);
+		if(model_dirty_) {
+			model_matrix_ = glm::translate(glm::mat4(1.0f), position_) * glm::toMat4(rotation_) * glm::scale(glm::mat4(1.0f), scale_);
+			model_dirty_ = false;
+		}
+		return model_matrix_;
+	}
+
+	const glm::mat4& SceneNode::getWorldMatrix() const
+	{
+		if(world_dirty_) {
+			auto parent = parent_.lock();
+			world_matrix_ = parent != nullptr ? parent->getWorldMatrix() * getModelMatrix() : getModelMatrix();
+			world_dirty_ = false;
+		}
+		return world_matrix_;
+	}
+
+	void SceneNode::markDirty()
+	{
+		model_dirty_ = true;
+		// Children of a dirty node are already dirty.
+		if(world_dirty_) {
+			return;
+		}
+		world_dirty_ = true;
+		if(!isAttached()) {
+			return;
+		}
+		// Nodes that become dirty are queued so their objects get moved in the spatial index.
+		auto sg = scene_graph_.lock();
+		SceneGraph* index_graph = sg != nullptr && sg->hasSpatialIndex() ? sg.get() : nullptr;
+		if(index_graph != nullptr && !objects_.empty()) {
+			index_graph->queueSpatialUpdate(*tree_position_);
+		}
+		if(the::tree<SceneNodePtr>::sub_pre_iterator(tree_position_)->childless()) {
+			return;
+		}
+		std::vector<the::tree<SceneNodePtr>::sub_pre_iterator> stack(1, tree_position_);
+		while(!stack.empty()) {
+			auto sub = stack.back();
+			stack.pop_back();
+			if(sub->childless()) {
+				continue;
+			}
+			for(the::tree<SceneNodePtr>::child_iterator it = sub->begin_child(); it != sub->end_child(); ++it) {
+				if(!(*it)->world_dirty_) {
+					(*it)->world_dirty_ = true;
+					if(index_graph != nullptr && !(*it)->objects_.empty()) {
+						index_graph->queueSpatialUpdate(*it);
+					}
+					stack.emplace_back(it);
+				}
+			}
+		}
+	}
+
+	void SceneNode::markBoundsDirty()
+	{
+		auto sg = scene_graph_.lock();
+		if(isAttached() && sg != nullptr && sg->hasSpatialIndex()) {
+			sg->queueSpatialUpdate(*tree_position_);
+		}
+	}
+
+	void SceneNode::clear()
+	{
+		auto sg = scene_graph_.lock();
+		if(isAttached() && sg != nullptr && sg->hasSpatialIndex()) {
+			for(auto& o : objects_) {
+				sg->unindexObject(o);
+			}
+		}
+		objects_.clear();
 	}
 
 	void SceneNode::notifyNodeAttached(std::weak_ptr<SceneNode> parent)
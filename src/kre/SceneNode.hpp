@@ -31,6 +31,7 @@
 #include "RenderFwd.hpp"
 #include "SceneFwd.hpp"
 #include "variant.hpp"
+#include "treetree/tree.hpp"
 
 namespace KRE
 {
@@ -52,10 +53,12 @@ namespace KRE
 		const CameraPtr& getCamera() const { return camera_; }
 		const LightPtrList& getLights() const { return lights_; }
 		const RenderTargetPtr getRenderTarget() const { return render_target_; }
-		void renderNode(const RenderManagerPtr& renderer, SceneNodeParams* rp);
 		std::shared_ptr<SceneGraph> getParentGraph();
 		std::shared_ptr<SceneNode> getParent();
 		virtual void process(float);
+		// Nodes that return true may have process() called from a worker thread, at the same 
+		// time as other such nodes, when the scene graph is in parallel mode.
+		virtual bool canProcessConcurrently() const { return false; }
 		virtual void notifyNodeAttached(std::weak_ptr<SceneNode> parent);
 		void setNodeName(const std::string& s) { name_ = s; }
 		const std::string& getNodeName() const { return name_; }
@@ -73,9 +76,16 @@ namespace KRE
 		void setScale(const glm::vec3& scale);
 		const glm::vec3& getScale() const { return scale_; }
 
-		glm::mat4 getModelMatrix() const;
+		// Transform relative to the parent node.
+		const glm::mat4& getModelMatrix() const;
+		// Transform including all the parent nodes, cached until this node or a parent moves.
+		const glm::mat4& getWorldMatrix() const;
 
-		void clear() { objects_.clear(); }
+		bool isAttached() const { return tree_position_ != the::tree<SceneNodePtr>::pre_iterator(); }
+
+		void clear();
+		// Call after changing the bounds of attached objects, so the scene graph's spatial index picks them up.
+		void markBoundsDirty();
 
 		static void registerObjectType(const std::string& type, ObjectTypeFunction fn);
 	private:
@@ -83,6 +93,8 @@ namespace KRE
 		SceneNode();
 		void operator=(const SceneNode&);
 
+		void markDirty();
+
 		std::string name_;
 		std::weak_ptr<SceneGraph> scene_graph_;
 		std::weak_ptr<SceneNode> parent_;
@@ -94,6 +106,16 @@ namespace KRE
 		glm::quat rotation_;
 		glm::vec3 scale_;
 
+		mutable glm::mat4 model_matrix_;
+		mutable glm::mat4 world_matrix_;
+		mutable bool model_dirty_;
+		// If set then it is also set for all the child nodes.
+		mutable bool world_dirty_;
+
+		// Position in the scene graph, so that attaching and removing doesn't need to search for the node.
+		the::tree<SceneNodePtr>::pre_iterator tree_position_;
+
+		friend class SceneGraph;
 		friend std::ostream& operator<<(std::ostream& os, const SceneNode& node);
 	};
 
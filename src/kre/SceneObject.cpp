@@ -29,13 +29,25 @@ namespace KRE
 {
 	SceneObject::SceneObject(const std::string& name)
 		: name_(name), 
-		  queue_(0)
+		  queue_(0),
+		  spatial_proxy_(-1),
+		  spatial_graph_(nullptr),
+		  spatial_node_(nullptr),
+		  spatial_entry_(nullptr),
+		  spatial_moved_(false),
+		  spatial_auto_(false)
 	{
 	}
 
 	SceneObject::SceneObject(const variant& node)
 		: Renderable(node),
-		  queue_(0)
+		  queue_(0),
+		  spatial_proxy_(-1),
+		  spatial_graph_(nullptr),
+		  spatial_node_(nullptr),
+		  spatial_entry_(nullptr),
+		  spatial_moved_(false),
+		  spatial_auto_(false)
 	{
 		if(node.has_key("name")) {
 			name_ = node["name"].as_string();
@@ -48,4 +60,11 @@ namespace KRE
 	SceneObject::~SceneObject()
 	{
 	}
+
+	void SceneObject::onBoundsChanged()
+	{
+		if(spatial_graph_ != nullptr) {
+			spatial_graph_->queueObjectUpdate(this);
+		}
+	}
 }
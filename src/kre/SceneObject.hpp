@@ -40,9 +40,24 @@ namespace KRE
 		const std::string& objectName() const { return name_; }
 		void setObjectName(const std::string& name) { name_ = name; }
 	private:
+		void onBoundsChanged() override;
+
 		size_t queue_;
 		std::string name_;
+		// Entry in the scene graph's spatial index, or -1.
+		int spatial_proxy_;
+		// Set while the object is attached to a graph with a spatial index, entry points at the
+		// node's reference to this object.
+		SceneGraph* spatial_graph_;
+		const SceneNode* spatial_node_;
+		const SceneObjectPtr* spatial_entry_;
+		// Queued because its own transform or bounds changed.
+		bool spatial_moved_;
+		// Has auto bounds, so it is refreshed on every index update.
+		bool spatial_auto_;
 
 		SceneObject();
+
+		friend class SceneGraph;
 	};
 }
@@ -396,6 +396,25 @@ namespace KRE
 				"    }\n"
 				"    gl_FragColor = color * v_color * u_color;\n"
 				"}\n";
+			// Glyphs stored as signed distance fields, 0.5 being the outline. The edge is smoothed
+			// over about a screen pixel, whatever the scale.
+			const char* const font_sdf_shader_fs = 
+				"#version 120\n"
+				"uniform sampler2D u_tex_map;\n"
+				"uniform vec4 u_color;\n"
+				"uniform bool ignore_alpha;\n"
+				"varying vec4 v_color;\n"
+				"varying vec2 v_texcoord;\n"
+				"void main()\n"
+				"{\n"
+				"    float dist = texture2D(u_tex_map, v_texcoord).r;\n"
+				"    float width = 0.7 * length(vec2(dFdx(dist), dFdy(dist)));\n"
+				"    vec4 color = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - width, 0.5 + width, dist));\n"
+				"    if(ignore_alpha && color.a > 0) {\n"
+				"	     color.a = 255;\n"
+				"    }\n"
+				"    gl_FragColor = color * v_color * u_color;\n"
+				"}\n";
 			const uniform_mapping font_shader_uniform_mapping[] = 
 			{
 				{"mvp_matrix", "u_mvp_matrix"},
@@ -693,7 +712,7 @@ namespace KRE
 						spp->setActives();
 					}
 
-					// special case for font-shader to work around amd bug.
+					// special case for the font shaders to work around amd bug.
 					std::string font_shader_vertex_shader;
 					variant node;
 					if(GLEW_ARB_explicit_attrib_location && glewIsSupported("GL_VERSION_3_2")) {
@@ -708,22 +727,33 @@ namespace KRE
 						node = resb.build();
 					}
 
-					auto spp = std::make_shared<OpenGL::ShaderProgram>("font_shader", 
-						ShaderDef("font_shader_vs", font_shader_vertex_shader),
-						ShaderDef("font_shader_fs", font_shader_fs),
-						node);
-					res["font_shader"] = spp;
-					auto um = font_shader_uniform_mapping;
-					while(strlen(um->alt_name) > 0) {
-						spp->setAlternateUniformName(um->name, um->alt_name);
-						++um;
-					}
-					auto am = font_shader_attribute_mapping;
-					while(strlen(am->alt_name) > 0) {
-						spp->setAlternateAttributeName(am->name, am->alt_name);
-						++am;
+					const struct {
+						const char* shader_name;
+						const char* fragment_shader_name;
+						const char* const fragment_shader_data;
+					} font_shader_defs[] = 
+					{
+						{ "font_shader", "font_shader_fs", font_shader_fs },
+						{ "font_sdf_shader", "font_sdf_shader_fs", font_sdf_shader_fs },
+					};
+					for(auto& def : font_shader_defs) {
+						auto spp = std::make_shared<OpenGL::ShaderProgram>(def.shader_name, 
+							ShaderDef("font_shader_vs", font_shader_vertex_shader),
+							ShaderDef(def.fragment_shader_name, def.fragment_shader_data),
+							node);
+						res[def.shader_name] = spp;
+						auto um = font_shader_uniform_mapping;
+						while(strlen(um->alt_name) > 0) {
+							spp->setAlternateUniformName(um->name, um->alt_name);
+							++um;
+						}
+						auto am = font_shader_attribute_mapping;
+						while(strlen(am->alt_name) > 0) {
+							spp->setAlternateAttributeName(am->name, am->alt_name);
+							++am;
+						}
+						spp->setActives();
 					}
-					spp->setActives();
 				}
 				return res;
 			}
@@ -1009,6 +1039,9 @@ namespace KRE
 		bool ShaderProgram::link(const std::vector<Shader>& shader_programs)
 		{
 			if(object_) {
+				if(get_current_active_shader() == object_) {
+					get_current_active_shader() = 0;
+				}
 				glDeleteProgram(object_);
 				object_ = 0;
 			}
@@ -1104,9 +1137,9 @@ namespace KRE
 
 		void ShaderProgram::makeActive()
 		{
-			//if(get_current_active_shader() == object_) {
-			//	return;
-			//}
+			if(get_current_active_shader() == object_) {
+				return;
+			}
 			glUseProgram(object_);
 			get_current_active_shader() = object_;
 		}
@@ -1607,6 +1640,7 @@ namespace KRE
 		void ShaderProgram::setActives()
 		{
 			glUseProgram(object_);
+			get_current_active_shader() = object_;
 			// Cache some frequently used uniforms.
 			u_mvp_ = getUniform("mvp_matrix");
 			u_mv_ = getUniform("mv_matrix");
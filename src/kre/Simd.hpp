@@ -0,0 +1,59 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+// Instruction sets the compiler targets, each one implies those below it. Vector kernels
+// use the best of these that they have code for.
+#if defined(__AVX2__)
+#	define KRE_SIMD_AVX2
+#endif
+#if defined(__AVX__)
+#	define KRE_SIMD_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define KRE_SIMD_SSE2
+#endif
+
+#if defined(KRE_SIMD_AVX)
+#	include <immintrin.h>
+#elif defined(KRE_SIMD_SSE2)
+#	include <emmintrin.h>
+#endif
+
+namespace KRE
+{
+	// Name of the best instruction set the build targets.
+	inline const char* get_instruction_set()
+	{
+#if defined(KRE_SIMD_AVX2)
+		return "AVX2";
+#elif defined(KRE_SIMD_AVX)
+		return "AVX";
+#elif defined(KRE_SIMD_SSE2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+}
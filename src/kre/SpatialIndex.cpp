@@ -0,0 +1,383 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "asserts.hpp"
+#include "Frustum.hpp"
+#include "SpatialIndex.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		const int null_node = -1;
+
+		SpatialBox combine(const SpatialBox& a, const SpatialBox& b)
+		{
+			return SpatialBox(glm::min(a.min, b.min), glm::max(a.max, b.max));
+		}
+
+		// Sum of the box's edge lengths, used as the cost of a node rather than the surface 
+		// area, since flat boxes (sprites) have no area in one axis.
+		float get_cost(const SpatialBox& b)
+		{
+			const glm::vec3 d = b.max - b.min;
+			return d.x + d.y + d.z;
+		}
+
+		bool ray_box(const glm::vec3& origin, const glm::vec3& inv_dir, float max_distance, const SpatialBox& b, float* distance)
+		{
+			float tmin = 0.0f;
+			float tmax = max_distance;
+			for(int n = 0; n != 3; ++n) {
+				float t1 = (b.min[n] - origin[n]) * inv_dir[n];
+				float t2 = (b.max[n] - origin[n]) * inv_dir[n];
+				if(t1 > t2) {
+					std::swap(t1, t2);
+				}
+				// Written so that NaNs (from 0 * inf) leave the limits unchanged.
+				tmin = t1 > tmin ? t1 : tmin;
+				tmax = t2 < tmax ? t2 : tmax;
+				if(tmin > tmax) {
+					return false;
+				}
+			}
+			*distance = tmin;
+			return true;
+		}
+	}
+
+	bool SpatialBox::contains(const SpatialBox& b) const
+	{
+		return min.x <= b.min.x && min.y <= b.min.y && min.z <= b.min.z
+			&& max.x >= b.max.x && max.y >= b.max.y && max.z >= b.max.z;
+	}
+
+	bool SpatialBox::intersects(const SpatialBox& b) const
+	{
+		return min.x <= b.max.x && min.y <= b.max.y && min.z <= b.max.z
+			&& max.x >= b.min.x && max.y >= b.min.y && max.z >= b.min.z;
+	}
+
+	SpatialIndex::SpatialIndex(float margin)
+		: root_(null_node),
+		  free_list_(null_node),
+		  proxy_count_(0),
+		  margin_(margin)
+	{
+	}
+
+	int SpatialIndex::allocateNode()
+	{
+		if(free_list_ == null_node) {
+			Node n;
+			n.user_data = nullptr;
+			n.parent = null_node;
+			n.height = -1;
+			nodes_.emplace_back(n);
+			free_list_ = static_cast<int>(nodes_.size()) - 1;
+		}
+		const int n = free_list_;
+		Node& node = nodes_[n];
+		free_list_ = node.parent;
+		node.parent = node.child1 = node.child2 = null_node;
+		node.height = 0;
+		node.user_data = nullptr;
+		return n;
+	}
+
+	void SpatialIndex::freeNode(int n)
+	{
+		nodes_[n].parent = free_list_;
+		nodes_[n].height = -1;
+		free_list_ = n;
+	}
+
+	int SpatialIndex::insert(const SpatialBox& box, void* user_data)
+	{
+		const int proxy = allocateNode();
+		const glm::vec3 margin(margin_);
+		nodes_[proxy].box = SpatialBox(box.min - margin, box.max + margin);
+		nodes_[proxy].user_data = user_data;
+		insertLeaf(proxy);
+		++proxy_count_;
+		return proxy;
+	}
+
+	void SpatialIndex::remove(int proxy)
+	{
+		ASSERT_LOG(proxy >= 0 && proxy < getCapacity() && nodes_[proxy].isLeaf() && nodes_[proxy].height == 0, "Invalid spatial index proxy: " << proxy);
+		removeLeaf(proxy);
+		freeNode(proxy);
+		--proxy_count_;
+	}
+
+	bool SpatialIndex::update(int proxy, const SpatialBox& box)
+	{
+		ASSERT_LOG(proxy >= 0 && proxy < getCapacity() && nodes_[proxy].isLeaf() && nodes_[proxy].height == 0, "Invalid spatial index proxy: " << proxy);
+		if(nodes_[proxy].box.contains(box)) {
+			return false;
+		}
+		removeLeaf(proxy);
+		const glm::vec3 margin(margin_);
+		nodes_[proxy].box = SpatialBox(box.min - margin, box.max + margin);
+		insertLeaf(proxy);
+		return true;
+	}
+
+	void SpatialIndex::clear()
+	{
+		nodes_.clear();
+		root_ = free_list_ = null_node;
+		proxy_count_ = 0;
+	}
+
+	void* SpatialIndex::getUserData(int proxy) const
+	{
+		ASSERT_LOG(proxy >= 0 && proxy < getCapacity(), "Invalid spatial index proxy: " << proxy);
+		return nodes_[proxy].user_data;
+	}
+
+	const SpatialBox& SpatialIndex::getBox(int proxy) const
+	{
+		ASSERT_LOG(proxy >= 0 && proxy < getCapacity(), "Invalid spatial index proxy: " << proxy);
+		return nodes_[proxy].box;
+	}
+
+	int SpatialIndex::getHeight() const
+	{
+		return root_ == null_node ? 0 : nodes_[root_].height;
+	}
+
+	void SpatialIndex::insertLeaf(int leaf)
+	{
+		if(root_ == null_node) {
+			root_ = leaf;
+			nodes_[leaf].parent = null_node;
+			return;
+		}
+
+		// Walk down to the cheapest sibling for the new leaf, the cost of a node being the growth of
+		// all the ancestors' boxes plus the new parent's box.
+		const SpatialBox leaf_box = nodes_[leaf].box;
+		int index = root_;
+		while(!nodes_[index].isLeaf()) {
+			const Node& node = nodes_[index];
+			const float cost = get_cost(node.box);
+			const float combined_cost = get_cost(combine(node.box, leaf_box));
+			// Cost of making a new parent for this node and the leaf, and of pushing the leaf further down.
+			const float new_parent_cost = 2.0f * combined_cost;
+			const float inherited_cost = 2.0f * (combined_cost - cost);
+
+			float child_cost[2];
+			const int children[2] = { node.child1, node.child2 };
+			for(int n = 0; n != 2; ++n) {
+				const Node& child = nodes_[children[n]];
+				const float grown = get_cost(combine(child.box, leaf_box));
+				child_cost[n] = (child.isLeaf() ? grown : grown - get_cost(child.box)) + inherited_cost;
+			}
+			if(new_parent_cost < child_cost[0] && new_parent_cost < child_cost[1]) {
+				break;
+			}
+			index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+		}
+
+		const int sibling = index;
+		const int old_parent = nodes_[sibling].parent;
+		const int new_parent = allocateNode();
+		nodes_[new_parent].parent = old_parent;
+		nodes_[new_parent].box = combine(leaf_box, nodes_[sibling].box);
+		nodes_[new_parent].height = nodes_[sibling].height + 1;
+		nodes_[new_parent].child1 = sibling;
+		nodes_[new_parent].child2 = leaf;
+		nodes_[sibling].parent = new_parent;
+		nodes_[leaf].parent = new_parent;
+		if(old_parent == null_node) {
+			root_ = new_parent;
+		} else if(nodes_[old_parent].child1 == sibling) {
+			nodes_[old_parent].child1 = new_parent;
+		} else {
+			nodes_[old_parent].child2 = new_parent;
+		}
+		refit(nodes_[leaf].parent);
+	}
+
+	void SpatialIndex::removeLeaf(int leaf)
+	{
+		if(leaf == root_) {
+			root_ = null_node;
+			return;
+		}
+		const int parent = nodes_[leaf].parent;
+		const int grand_parent = nodes_[parent].parent;
+		const int sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+		// The sibling takes the place of the parent.
+		if(grand_parent == null_node) {
+			root_ = sibling;
+			nodes_[sibling].parent = null_node;
+		} else {
+			if(nodes_[grand_parent].child1 == parent) {
+				nodes_[grand_parent].child1 = sibling;
+			} else {
+				nodes_[grand_parent].child2 = sibling;
+			}
+			nodes_[sibling].parent = grand_parent;
+			refit(grand_parent);
+		}
+		freeNode(parent);
+		nodes_[leaf].parent = null_node;
+	}
+
+	void SpatialIndex::refit(int n)
+	{
+		while(n != null_node) {
+			n = balance(n);
+			Node& node = nodes_[n];
+			node.height = 1 + std::max(nodes_[node.child1].height, nodes_[node.child2].height);
+			node.box = combine(nodes_[node.child1].box, nodes_[node.child2].box);
+			n = node.parent;
+		}
+	}
+
+	// If one child of a is more than one level taller than the other, it is rotated up to replace a.
+	// Returns the node that is now in a's place.
+	int SpatialIndex::balance(int a)
+	{
+		if(nodes_[a].isLeaf()) {
+			return a;
+		}
+		const int b = nodes_[a].child1;
+		const int c = nodes_[a].child2;
+		const int diff = nodes_[c].height - nodes_[b].height;
+		if(diff >= -1 && diff <= 1) {
+			return a;
+		}
+		// The taller child moves up, a becomes its child and takes the shorter of its children.
+		const int up = diff > 1 ? c : b;
+		const int f = nodes_[up].child1;
+		const int g = nodes_[up].child2;
+
+		nodes_[up].child1 = a;
+		nodes_[up].parent = nodes_[a].parent;
+		nodes_[a].parent = up;
+		if(nodes_[up].parent == null_node) {
+			root_ = up;
+		} else if(nodes_[nodes_[up].parent].child1 == a) {
+			nodes_[nodes_[up].parent].child1 = up;
+		} else {
+			nodes_[nodes_[up].parent].child2 = up;
+		}
+
+		const bool keep_f = nodes_[f].height > nodes_[g].height;
+		const int kept = keep_f ? f : g;
+		const int moved = keep_f ? g : f;
+		nodes_[up].child2 = kept;
+		if(diff > 1) {
+			nodes_[a].child2 = moved;
+		} else {
+			nodes_[a].child1 = moved;
+		}
+		nodes_[moved].parent = a;
+		nodes_[a].box = combine(nodes_[nodes_[a].child1].box, nodes_[nodes_[a].child2].box);
+		nodes_[a].height = 1 + std::max(nodes_[nodes_[a].child1].height, nodes_[nodes_[a].child2].height);
+		nodes_[up].box = combine(nodes_[a].box, nodes_[kept].box);
+		nodes_[up].height = 1 + std::max(nodes_[a].height, nodes_[kept].height);
+		return up;
+	}
+
+	template<typename Test> void SpatialIndex::query(const Test& test, std::vector<int>* proxies) const
+	{
+		if(root_ == null_node) {
+			return;
+		}
+		std::vector<int> stack;
+		stack.reserve(64);
+		stack.emplace_back(root_);
+		while(!stack.empty()) {
+			const int n = stack.back();
+			stack.pop_back();
+			const Node& node = nodes_[n];
+			if(!test(node.box)) {
+				continue;
+			}
+			if(node.isLeaf()) {
+				proxies->emplace_back(n);
+			} else {
+				stack.emplace_back(node.child1);
+				stack.emplace_back(node.child2);
+			}
+		}
+	}
+
+	void SpatialIndex::queryBox(const SpatialBox& box, std::vector<int>* proxies) const
+	{
+		query([&box](const SpatialBox& b) { return b.intersects(box); }, proxies);
+	}
+
+	void SpatialIndex::queryRect(const rectf& r, std::vector<int>* proxies) const
+	{
+		const float x1 = r.x1(), y1 = r.y1(), x2 = r.x2(), y2 = r.y2();
+		query([=](const SpatialBox& b) { 
+			return b.min.x <= x2 && b.max.x >= x1 && b.min.y <= y2 && b.max.y >= y1; 
+		}, proxies);
+	}
+
+	void SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<int>* proxies) const
+	{
+		query([&frustum](const SpatialBox& b) { return frustum.isBoxInside(b.min, b.max); }, proxies);
+	}
+
+	void SpatialIndex::queryRay(const glm::vec3& origin, const glm::vec3& direction, float max_distance, std::vector<SpatialRayHit>* hits) const
+	{
+		if(root_ == null_node) {
+			return;
+		}
+		const glm::vec3 inv_dir = 1.0f / direction;
+		if(max_distance <= 0.0f) {
+			max_distance = std::numeric_limits<float>::max();
+		}
+		const size_t first = hits->size();
+		std::vector<int> stack(1, root_);
+		while(!stack.empty()) {
+			const int n = stack.back();
+			stack.pop_back();
+			const Node& node = nodes_[n];
+			float distance;
+			if(!ray_box(origin, inv_dir, max_distance, node.box, &distance)) {
+				continue;
+			}
+			if(node.isLeaf()) {
+				SpatialRayHit hit = { n, distance };
+				hits->emplace_back(hit);
+			} else {
+				stack.emplace_back(node.child1);
+				stack.emplace_back(node.child2);
+			}
+		}
+		std::sort(hits->begin() + first, hits->end(), [](const SpatialRayHit& a, const SpatialRayHit& b) { 
+			return a.distance < b.distance; 
+		});
+	}
+}
@@ -0,0 +1,113 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "geometry.hpp"
+
+namespace KRE
+{
+	class Frustum;
+
+	// Axis-aligned box given by its minimum and maximum corners.
+	struct SpatialBox
+	{
+		SpatialBox() : min(0.0f), max(0.0f) {}
+		SpatialBox(const glm::vec3& mn, const glm::vec3& mx) : min(mn), max(mx) {}
+		bool contains(const SpatialBox& b) const;
+		bool intersects(const SpatialBox& b) const;
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	struct SpatialRayHit
+	{
+		int proxy;
+		// Distance along the ray to where it enters the proxy's box.
+		float distance;
+	};
+
+	// Dynamic AABB tree. Each entry (a proxy) is stored with its box grown by a margin, so 
+	// small movements don't change the tree. Inserting, moving and removing entries is 
+	// O(log n), the tree is re-balanced with rotations as it changes.
+	// Queries return proxies whose (grown) boxes pass the test, so the results are conservative.
+	class SpatialIndex
+	{
+	public:
+		explicit SpatialIndex(float margin=8.0f);
+
+		int insert(const SpatialBox& box, void* user_data);
+		void remove(int proxy);
+		// Returns false if the box still fits in the stored box, in which case nothing was changed.
+		bool update(int proxy, const SpatialBox& box);
+		void clear();
+
+		void* getUserData(int proxy) const;
+		const SpatialBox& getBox(int proxy) const;
+		// Proxies are always less than this, for callers that keep data indexed by proxy.
+		int getCapacity() const { return static_cast<int>(nodes_.size()); }
+		int size() const { return proxy_count_; }
+		int getHeight() const;
+
+		void queryBox(const SpatialBox& box, std::vector<int>* proxies) const;
+		// Rectangle in the x-y plane, for 2D scenes, z is ignored.
+		void queryRect(const rectf& r, std::vector<int>* proxies) const;
+		void queryFrustum(const Frustum& frustum, std::vector<int>* proxies) const;
+		// Hits are sorted by distance. A max_distance of zero or less means no limit.
+		void queryRay(const glm::vec3& origin, const glm::vec3& direction, float max_distance, std::vector<SpatialRayHit>* hits) const;
+	private:
+		struct Node
+		{
+			SpatialBox box;
+			void* user_data;
+			// Parent when in the tree, next free node when on the free list.
+			int parent;
+			int child1;
+			int child2;
+			// Leaves are 0, free nodes -1.
+			int height;
+			bool isLeaf() const { return child1 < 0; }
+		};
+
+		int allocateNode();
+		void freeNode(int n);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int n);
+		void refit(int n);
+
+		template<typename Test> void query(const Test& test, std::vector<int>* proxies) const;
+
+		std::vector<Node> nodes_;
+		int root_;
+		int free_list_;
+		int proxy_count_;
+		float margin_;
+
+		SpatialIndex(const SpatialIndex&);
+		void operator=(const SpatialIndex&);
+	};
+}
@@ -21,12 +21,18 @@
 	   distribution.
 */
 
+#include <atomic>
 #include <future>
+#include <list>
+#include <mutex>
 #include <thread>
 #include <tuple>
 
+#include "PixelKernels.hpp"
+#include "profile_timer.hpp"
+#include "RectPacker.hpp"
 #include "Surface.hpp"
-#include "stb_rect_pack.h"
+#include "WorkerPool.hpp"
 
 namespace KRE
 {
@@ -39,16 +45,160 @@ namespace KRE
 			return res;
 		}
 
-		typedef std::map<std::string, SurfacePtr> SurfaceCacheType;
-		SurfaceCacheType& get_surface_cache()
+		// Surfaces loaded from files, keyed on the file name, flags and pixel format. May be used from 
+		// any thread. A file requested while it is being loaded is waited on rather than loaded twice.
+		// Surfaces that only the cache references are dropped, least recently used first, while the
+		// cache is over budget.
+		class SurfaceCache
+		{
+		public:
+			typedef std::tuple<std::string, int, int> Key;
+
+			SurfaceCache() : budget_(256 * 1024 * 1024), next_serial_(1), stats_() 
+			{
+				stats_.budget = budget_;
+			}
+
+			SurfacePtr get(const Key& key, const std::function<SurfacePtr()>& load) 
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				auto it = index_.find(key);
+				if(it != index_.end()) {
+					++stats_.hits;
+					lru_.splice(lru_.begin(), lru_, it->second);
+					if(it->second->surface != nullptr) {
+						return it->second->surface;
+					}
+					auto pending = it->second->pending;
+					lock.unlock();
+					return pending.get();
+				}
+
+				++stats_.misses;
+				std::promise<SurfacePtr> promise;
+				Entry entry;
+				entry.key = key;
+				entry.pending = promise.get_future().share();
+				entry.bytes = 0;
+				entry.serial = next_serial_++;
+				const unsigned serial = entry.serial;
+				lru_.emplace_front(std::move(entry));
+				index_[key] = lru_.begin();
+				lock.unlock();
+
+				SurfacePtr surface;
+				try {
+					surface = load();
+				} catch(...) {
+					promise.set_exception(std::current_exception());
+					lock.lock();
+					erase(key, serial);
+					throw;
+				}
+				promise.set_value(surface);
+
+				lock.lock();
+				// The cache may have been cleared while loading.
+				it = index_.find(key);
+				if(it != index_.end() && it->second->serial == serial) {
+					Entry& e = *it->second;
+					e.surface = surface;
+					e.pending = std::shared_future<SurfacePtr>();
+					e.bytes = get_surface_bytes(surface);
+					stats_.bytes += e.bytes;
+					++stats_.entries;
+					trim();
+				}
+				return surface;
+			}
+
+			void clear() 
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				index_.clear();
+				lru_.clear();
+				stats_.bytes = 0;
+				stats_.entries = 0;
+			}
+
+			void setBudget(size_t bytes)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				budget_ = stats_.budget = bytes;
+				trim();
+			}
+
+			SurfaceCacheStats getStats() const
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return stats_;
+			}
+		private:
+			struct Entry
+			{
+				Key key;
+				// Set once loaded, until then other requests wait on pending.
+				SurfacePtr surface;
+				std::shared_future<SurfacePtr> pending;
+				size_t bytes;
+				// Tells a loader whether its entry is still the one in the cache.
+				unsigned serial;
+			};
+
+			static size_t get_surface_bytes(const SurfacePtr& surface)
+			{
+				size_t bytes = static_cast<size_t>(surface->rowPitch()) * surface->height();
+				if(surface->hasAlphaMap()) {
+					bytes += surface->getAlphaMap()->getBytes();
+				}
+				return bytes;
+			}
+
+			void erase(const Key& key, unsigned serial)
+			{
+				auto it = index_.find(key);
+				if(it != index_.end() && it->second->serial == serial) {
+					lru_.erase(it->second);
+					index_.erase(it);
+				}
+			}
+
+			// Called with the mutex held.
+			void trim()
+			{
+				auto it = lru_.end();
+				while(stats_.bytes > budget_ && it != lru_.begin()) {
+					--it;
+					// Still loading, or in use elsewhere.
+					if(it->surface == nullptr || it->surface.use_count() > 1) {
+						continue;
+					}
+					stats_.bytes -= it->bytes;
+					--stats_.entries;
+					++stats_.evictions;
+					index_.erase(it->key);
+					it = lru_.erase(it);
+				}
+			}
+
+			mutable std::mutex mutex_;
+			// Most recently used at the front.
+			std::list<Entry> lru_;
+			std::map<Key, std::list<Entry>::iterator> index_;
+			size_t budget_;
+			unsigned next_serial_;
+			SurfaceCacheStats stats_;
+		};
+
+		SurfaceCache& get_surface_cache()
 		{
-			static SurfaceCacheType res;
+			static SurfaceCache res;
 			return res;
 		}
 
 		unsigned get_next_id()
 		{
-			static unsigned id = 1;
+			static std::atomic<unsigned> id(1);
 			return id++;
 		}
 
@@ -63,6 +213,13 @@ namespace KRE
 			static std::set<const Surface*>* all_surfaces = new std::set<const Surface*>;
 			return *all_surfaces;
 		}
+
+		// Surfaces are created and destroyed on loader threads.
+		std::mutex& get_all_surfaces_mutex()
+		{
+			static std::mutex res;
+			return res;
+		}
 	}
 
 	const std::set<const Surface*>& Surface::getAllSurfaces() { return getAllSurfacesMutable(); }
@@ -75,11 +232,13 @@ namespace KRE
 		  id_(get_next_id()),
 		  alpha_borders_{}
 	{
+		std::lock_guard<std::mutex> lock(get_all_surfaces_mutex());
 		getAllSurfacesMutable().insert(this);
 	}
 
 	Surface::~Surface()
 	{
+		std::lock_guard<std::mutex> lock(get_all_surfaces_mutex());
 		getAllSurfacesMutable().erase(this);
 	}
 
@@ -115,6 +274,31 @@ namespace KRE
 		*this = *surf.get();
 	}
 
+	SurfacePtr Surface::convertDithered(PixelFormat::PF fmt)
+	{
+		const PixelFormat::PF src_fmt = getPixelFormat()->getFormat();
+		if(!pixel_kernels::can_convert(src_fmt, fmt)) {
+			return handleConvert(fmt, nullptr);
+		}
+		auto dst = Surface::create(width(), height(), fmt);
+		SurfaceLock src_lock(shared_from_this());
+		SurfaceLock dst_lock(dst);
+		pixel_kernels::convert(pixels(), rowPitch(), src_fmt, dst->pixelsWriteable(), dst->rowPitch(), fmt, width(), height(), true);
+		return dst;
+	}
+
+	bool Surface::premultiplyAlpha()
+	{
+		SurfaceLock lck(shared_from_this());
+		return pixel_kernels::premultiply_alpha(pixelsWriteable(), rowPitch(), getPixelFormat()->getFormat(), width(), height());
+	}
+
+	bool Surface::unpremultiplyAlpha()
+	{
+		SurfaceLock lck(shared_from_this());
+		return pixel_kernels::unpremultiply_alpha(pixelsWriteable(), rowPitch(), getPixelFormat()->getFormat(), width(), height());
+	}
+
 	bool Surface::registerSurfaceCreator(const std::string& name, 
 		SurfaceCreatorFileFn file_fn, 
 		SurfaceCreatorPixelsFn pixels_fn, 
@@ -133,23 +317,33 @@ namespace KRE
 
 	SurfacePtr Surface::create(const std::string& filename, SurfaceFlags flags, PixelFormat::PF fmt, SurfaceConvertFn convert)
 	{
+		PROFILE_ZONE("Surface::create");
 		ASSERT_LOG(get_surface_creator().empty() == false, "No resources registered to surfaces images from files.");
-		auto create_fn_tuple = get_surface_creator().begin()->second;
+		const auto& create_fn_tuple = get_surface_creator().begin()->second;
+		auto load = [&]() {
+			auto surf = std::get<0>(create_fn_tuple)(filename, fmt, flags, convert);
+			surf->name_ = filename;
+			surf->init();
+			return surf;
+		};
 		if(!(flags & SurfaceFlags::NO_CACHE)) {
-			auto it = get_surface_cache().find(filename);
-			if(it != get_surface_cache().end()) {
-				return it->second;
-			}
-			auto surface = std::get<0>(create_fn_tuple)(filename, fmt, flags, convert);
-			surface->name_ = filename;
-			get_surface_cache()[filename] = surface;
-			surface->init();
-			return surface;
+			return get_surface_cache().get(SurfaceCache::Key(filename, static_cast<int>(flags), static_cast<int>(fmt)), load);
 		} 
-		auto surf = std::get<0>(create_fn_tuple)(filename, fmt, flags, convert);
-		surf->name_ = filename;
-		surf->init();
-		return surf;
+		return load();
+	}
+
+	std::shared_future<SurfacePtr> Surface::createAsync(const std::string& filename, SurfaceFlags flags, PixelFormat::PF fmt, SurfaceConvertFn convert)
+	{
+		auto promise = std::make_shared<std::promise<SurfacePtr>>();
+		std::shared_future<SurfacePtr> res = promise->get_future().share();
+		WorkerPool::getDefault().enqueue([promise, filename, flags, fmt, convert]() {
+			try {
+				promise->set_value(Surface::create(filename, flags, fmt, convert));
+			} catch(...) {
+				promise->set_exception(std::current_exception());
+			}
+		});
+		return res;
 	}
 
 	SurfacePtr Surface::create(int width, 
@@ -204,7 +398,9 @@ namespace KRE
 
 	void Surface::init()
 	{
-		createAlphaMap();
+		if(flags_ & SurfaceFlags::ALPHA_MAP) {
+			createAlphaMap();
+		}
 		if(flags_ & SurfaceFlags::STRIP_ALPHA_BORDERS) {
 			stripAlphaBorders(alpha_strip_threshold);
 		}
@@ -212,95 +408,60 @@ namespace KRE
 
 	void Surface::createAlphaMap()
 	{
-		const int npixels = width() * height();
-		alpha_map_ = std::make_shared<std::vector<bool>>();
-		alpha_map_->resize(npixels);
-
-		if(getPixelFormat()->hasAlphaChannel()) {
+		PROFILE_ZONE("Surface::createAlphaMap");
+		AlphaMaskPtr mask;
+		if(!getPixelFormat()->hasAlphaChannel()) {
+			mask = AlphaMask::createOpaque(width(), height());
+		} else if(bytesPerPixel() == 4) {
 			SurfaceLock lck(shared_from_this());
-			auto pf = getPixelFormat();
-			uint32_t alpha_mask = pf->getAlphaMask();
-			if(bytesPerPixel() == 4 && rowPitch() % 4 == 0) {
-				// Optimization for a common case. Operates ~25 faster than default case.
-				const uint32_t* px = reinterpret_cast<const uint32_t*>(pixels());
-				auto it = alpha_map_->begin();
-				for(int n = 0; n != npixels; ++n) {
-					*it++ = (*px++ & alpha_mask) ? false : true;
+			mask = AlphaMask::create(pixels(), width(), height(), rowPitch(), getPixelFormat()->getAlphaMask());
+		} else {
+			mask = std::make_shared<AlphaMask>(width(), height());
+			iterateOverSurface([&mask](int x, int y, int r, int g, int b, int a) {
+				if(a != 0) {
+					mask->setOpaque(x, y, true);
 				}
-			} else {
-				std::fill(alpha_map_->begin(), alpha_map_->end(), false);
-				int w = width();
-				auto& am = *alpha_map_;
-				iterateOverSurface([&am, w](int x, int y, int r, int g, int b, int a) {
-					if(a == 0) {
-						am[x + y * w] = true;
-					}
-				});
-			}
+			});
+			mask->buildHierarchy();
 		}
+		std::atomic_store(&alpha_map_, mask);
+	}
 
-		//if(getPixelFormat()->hasAlphaChannel()) {
-			//int w = width();
-			//auto& am = alpha_map_;
-			//iterateOverSurface([&am, w](int x, int y, int r, int g, int b, int a) {
-			//	am[x + y * w] = a == 0 ? true : false;
-			//});
-		//}
+	bool Surface::hasAlphaMap() const
+	{
+		return std::atomic_load(&alpha_map_) != nullptr;
+	}
+
+	AlphaMaskPtr Surface::getAlphaMap() const
+	{
+		auto mask = std::atomic_load(&alpha_map_);
+		if(mask == nullptr) {
+			// Building only reads the pixels, though it needs to lock the surface to do so.
+			const_cast<Surface*>(this)->createAlphaMap();
+			mask = std::atomic_load(&alpha_map_);
+		}
+		return mask;
+	}
+
+	void Surface::setAlphaMap(AlphaMaskPtr am)
+	{
+		std::atomic_store(&alpha_map_, am);
 	}
 
 	void Surface::stripAlphaBorders(int threshold)
 	{
 		if(getPixelFormat()->hasAlphaChannel()) {
+			ASSERT_LOG(bytesPerPixel() == 4, "won't apply stripAlphaBorders to non 32-bit RGBA image");
 			const int w = width();
 			const int h = height();
 			SurfaceLock lck(shared_from_this());
 			auto pf = getPixelFormat();
-			uint32_t alpha_mask = pf->getAlphaMask();
-			int alpha_shift = pf->getAlphaShift();
-			threshold <<= alpha_shift;
-			if(bytesPerPixel() == 4 && rowPitch() % 4 == 0) {
-				// Optimization for a common case. Operates ~25 faster than default case.
-				const int num_pixels = w * h;
-				// top border
-				uint32_t const* pxt = reinterpret_cast<const uint32_t*>(pixels());
-				for(int ndx = 0; ndx < num_pixels; ++ndx) {
-					if((*pxt++ & alpha_mask) > static_cast<uint32_t>(threshold)) {
-						alpha_borders_[1] = ndx / w;
-						break;
-					}
-				}
-				const uint32_t* pxb = &reinterpret_cast<const uint32_t*>(pixels())[w * h];
-				// bottom border
-				for(int ndx = num_pixels - 1; ndx >= 0; --ndx) {
-					if((*(--pxb) & alpha_mask) > static_cast<uint32_t>(threshold)) {
-						alpha_borders_[3] = h - 1 - ndx / w;
-						break;
-					}
-				}
-				// left border
-				const uint32_t* pxl = reinterpret_cast<const uint32_t*>(pixels());
-				bool finished = false;
-				for(int x = 0; x < w && !finished; ++x) {
-					for(int y = 0; y < h && !finished; ++y) {
-						if((pxl[x + y*w] & alpha_mask) > static_cast<uint32_t>(threshold)) {
-							alpha_borders_[0] = x;
-							finished = true;
-						}
-					}
-				}
-				// right border
-				const uint32_t* pxr = reinterpret_cast<const uint32_t*>(pixels());
-				finished = false;
-				for(int x = w - 1; x >= 0 && !finished; --x) {
-					for(int y = 0; y < h && !finished; ++y) {
-						if((pxr[x + y*w] & alpha_mask) > static_cast<uint32_t>(threshold)) {
-							alpha_borders_[2] = w - 1 - x;
-							finished = true;
-						}
-					}
-				}
-			} else {
-				ASSERT_LOG(false, "won't apply stripAlphaBorders to non 32-bit RGBA image");
+			int x1, y1, x2, y2;
+			if(pixel_kernels::opaque_bounds(pixels(), rowPitch(), w, h, pf->getAlphaMask(), pf->getAlphaShift(), threshold, &x1, &y1, &x2, &y2)) {
+				alpha_borders_[0] = x1;
+				alpha_borders_[1] = y1;
+				alpha_borders_[2] = w - x2;
+				alpha_borders_[3] = h - y2;
 			}
 		}
 	}
@@ -315,6 +476,26 @@ namespace KRE
 		get_surface_cache().clear();
 	}
 
+	void Surface::setSurfaceCacheBudget(size_t bytes)
+	{
+		get_surface_cache().setBudget(bytes);
+	}
+
+	SurfaceCacheStats Surface::getSurfaceCacheStats()
+	{
+		return get_surface_cache().getStats();
+	}
+
+	std::ostream& operator<<(std::ostream& os, const SurfaceCacheStats& stats)
+	{
+		os << "hits: " << stats.hits
+			<< ", misses: " << stats.misses
+			<< ", evictions: " << stats.evictions
+			<< ", surfaces: " << stats.entries
+			<< ", bytes: " << stats.bytes << "/" << stats.budget;
+		return os;
+	}
+
 	void Surface::fillRect(const rect& dst_rect, const Color& color)
 	{
 		// XXX do we need to consider ARGB/RGBA ordering issues here.
@@ -455,21 +636,19 @@ namespace KRE
 
 	bool Surface::isAlpha(unsigned x, unsigned y) const
 	{ 
-		ASSERT_LOG(alpha_map_ != nullptr && alpha_map_->size() > 0, "No alpha map found.");
-		ASSERT_LOG(x + y* width() < static_cast<int>(alpha_map_->size()), "Index exceeds alpha map size.");
-		return (*alpha_map_)[y*width()+x]; 
+		auto mask = getAlphaMap();
+		ASSERT_LOG(x < static_cast<unsigned>(mask->width()) && y < static_cast<unsigned>(mask->height()), "Index exceeds alpha map size.");
+		return mask->isAlpha(x, y);
 	}
 
-	std::vector<bool>::const_iterator Surface::getAlphaRow(int x, int y) const 
-	{ 
-		ASSERT_LOG(alpha_map_ != nullptr && alpha_map_->size() > 0, "No alpha map found.");
-		ASSERT_LOG(x + y* width() < static_cast<int>(alpha_map_->size()), "Index exceeds alpha map size.");
-		return alpha_map_->begin() + y * width() + x; 
+	bool Surface::anyOpaque(const rect& r) const
+	{
+		return getAlphaMap()->anyOpaque(r);
 	}
 
-	std::vector<bool>::const_iterator Surface::endAlpha() const 
-	{ 
-		return alpha_map_->end(); 
+	bool Surface::collides(const SurfacePtr& other, int x, int y) const
+	{
+		return getAlphaMap()->collides(*other->getAlphaMap(), x, y);
 	}
 
 	void Surface::iterateOverSurface(surface_iterator_fn fn)
@@ -525,101 +704,55 @@ namespace KRE
 		return alpha_strip_threshold;
 	}
 
-#include "profile_timer.hpp"
-
-	SurfacePtr Surface::packImages(const std::vector<std::string>& filenames, std::vector<rect>* outr, std::vector<std::array<int, 4>>* borders)
+	SurfacePtr Surface::packImages(const std::vector<std::string>& filenames, std::vector<rect>* outr, std::vector<std::array<int, 4>>* borders, RectPackerStats* stats)
 	{
-		profile::manager pman("fit rects");
-
-		const int max_threads = 8;
+		PROFILE_ZONE("Surface::packImages");
 
-		SurfaceFlags flags = SurfaceFlags::NO_CACHE;
+		SurfaceFlags flags = SurfaceFlags::NONE;
 		if(borders != nullptr) {
 			flags = flags | SurfaceFlags::STRIP_ALPHA_BORDERS;
 		}
 
-		std::vector<std::future<void>> futures;
-
-		std::vector<SurfacePtr> images;
-		images.resize(filenames.size());
-		const int n_incr = images.size() / max_threads;
-		for(int n = 0; n < static_cast<int>(images.size()); n += n_incr) {
-			int n2 = n + n_incr > static_cast<int>(images.size()) ? images.size() : n + n_incr;
-			futures.push_back(std::async([&images, n, n2, &filenames, flags]() {
-				for(int ndx = n; ndx != n2; ++ndx) {
-					images[ndx] = Surface::create(filenames[ndx], flags);
-				}
-			}));
-		}
-		for(auto& f : futures) {
-			f.get();
-		}
-
-		std::vector<stbrp_node> nodes;
-		nodes.resize(max_surface_width);
-
-		const int increment = 128;
-		int width = 256;
-		int height = 256;
-
-		int nn = 0;
+		std::vector<SurfacePtr> images(filenames.size());
+		WorkerPool::getDefault().parallelFor(images.size(), [&images, &filenames, flags](std::size_t n) {
+			images[n] = Surface::create(filenames[n], flags);
+		});
 
-		std::vector<stbrp_rect> rects;
+		std::vector<point> sizes;
+		sizes.reserve(images.size());
 		for(auto& img : images) {
-			stbrp_rect r;
-			r.id = rects.size();
-			r.w = img->width();
-			r.h = img->height();
+			int w = img->width();
+			int h = img->height();
 			if(borders != nullptr) {
-				r.w -= img->getAlphaBorders()[0] + img->getAlphaBorders()[2];
-				r.h -= img->getAlphaBorders()[1] + img->getAlphaBorders()[3];
+				w -= img->getAlphaBorders()[0] + img->getAlphaBorders()[2];
+				h -= img->getAlphaBorders()[1] + img->getAlphaBorders()[3];
 			}
-			rects.emplace_back(r);
+			sizes.emplace_back(w, h);
 		}
 
-		bool packed = false;
-		while(!packed) {
-			for(auto& r : rects) {
-				r.x = r.y = r.was_packed = 0;
-			}
-			stbrp_context context;
-			stbrp_init_target(&context, width, height, nodes.data(), nodes.size());
-			stbrp_pack_rects(&context, rects.data(), rects.size());
-
-			packed = true;
-			for(auto& r : rects) {
-				if(!r.was_packed) {
-					if(nn & 1) {
-						height += increment;
-					} else {
-						width += increment;
-					}
-					++nn;
-					if(width > max_surface_width || height > max_surface_height) {
-						return nullptr;
-					}
-					packed = false;
-					break;
-				}
-			}
-			
+		RectPackerStats pack_stats;
+		if(!RectPacker::pack(sizes, max_surface_width, max_surface_height, outr, &pack_stats)) {
+			return nullptr;
+		}
+		LOG_DEBUG("packImages: " << pack_stats);
+		if(stats != nullptr) {
+			*stats = pack_stats;
 		}
 
 		if(borders != nullptr) {
 			borders->resize(images.size());
 		}
-		outr->resize(images.size());
 
-		auto out = Surface::create(width, height, PixelFormat::PF::PIXELFORMAT_RGBA8888);
-		for(auto& r : rects) {
-			(*outr)[r.id] = rect(r.x, r.y, r.w, r.h);
-			rect alpha_borders(0, 0, r.w, r.h);
+		auto out = Surface::create(std::max(pack_stats.width, 1), std::max(pack_stats.height, 1), PixelFormat::PF::PIXELFORMAT_RGBA8888);
+		for(std::size_t n = 0; n != images.size(); ++n) {
+			const rect& r = (*outr)[n];
+			rect alpha_borders(0, 0, r.w(), r.h());
 			if(borders != nullptr) {
-				alpha_borders = rect(images[r.id]->getAlphaBorders()[0], images[r.id]->getAlphaBorders()[1], r.w, r.h);
+				alpha_borders = rect(images[n]->getAlphaBorders()[0], images[n]->getAlphaBorders()[1], r.w(), r.h());
+				(*borders)[n] = images[n]->getAlphaBorders();
 			}
-			out->blitTo(images[r.id], alpha_borders, (*outr)[r.id]);
-			if(borders != nullptr) {
-				(*borders)[r.id] = images[r.id]->getAlphaBorders();
+			if(r.w() > 0 && r.h() > 0) {
+				out->blitTo(images[n], alpha_borders, r);
 			}
 		}
 		return out;
@@ -25,6 +25,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <set>
@@ -32,8 +33,10 @@
 #include <unordered_map>
 
 #include "geometry.hpp"
+#include "AlphaMask.hpp"
 #include "Cursor.hpp"
 #include "PixelFormat.hpp"
+#include "RectPacker.hpp"
 #include "WindowManagerFwd.hpp"
 
 namespace KRE
@@ -51,6 +54,8 @@ namespace KRE
 		// If this is supplied then any rows/columns of the image that contain pure alpha pixels are stripped
 		// until we generate an image that is minimal in size.
 		STRIP_ALPHA_BORDERS = 4,
+		// Build the alpha map while loading, rather than on the first hit test.
+		ALPHA_MAP			= 8,
 
 		// Special internal code to indicate that we are not loading from a file, but the image data is inside
 		// the passed in string.
@@ -111,6 +116,19 @@ namespace KRE
 
 	typedef std::function<void(int,int,int,int,int,int)> surface_iterator_fn;
 
+	struct SurfaceCacheStats
+	{
+		SurfaceCacheStats() : hits(0), misses(0), evictions(0), entries(0), bytes(0), budget(0) {}
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t entries;
+		size_t bytes;
+		size_t budget;
+	};
+
+	std::ostream& operator<<(std::ostream& os, const SurfaceCacheStats& stats);
+
 	class Surface : public std::enable_shared_from_this<Surface>
 	{
 	public:
@@ -175,6 +193,12 @@ namespace KRE
 		virtual const rect getClipRect() = 0;
 		SurfacePtr convert(PixelFormat::PF fmt, SurfaceConvertFn convert=nullptr);
 		void convertInPlace(PixelFormat::PF fmt, SurfaceConvertFn convert=nullptr);
+		// As convert(), but channels that lose precision (e.g. converting to RGB565 or RGBA4444) are ordered dithered.
+		SurfacePtr convertDithered(PixelFormat::PF fmt);
+		// Multiply the color channels by alpha, or divide them back out. Only 32-bit formats with an alpha
+		// channel are handled, returns false for anything else.
+		bool premultiplyAlpha();
+		bool unpremultiplyAlpha();
 
 		color_histogram_type getColorHistogram(ColorCountFlags flags=ColorCountFlags::NONE);
 		size_t getColorCount(ColorCountFlags flags=ColorCountFlags::NONE);
@@ -188,6 +212,8 @@ namespace KRE
 			SurfaceCreatorFormatFn format_fn);
 		static void unRegisterSurfaceCreator(const std::string& name);
 		static SurfacePtr create(const std::string& filename, SurfaceFlags flags=SurfaceFlags::NONE, PixelFormat::PF fmt=PixelFormat::PF::PIXELFORMAT_UNKNOWN, SurfaceConvertFn convert=nullptr);
+		// Decodes and converts the image on the default worker pool, building the alpha map there too if ALPHA_MAP is given.
+		static std::shared_future<SurfacePtr> createAsync(const std::string& filename, SurfaceFlags flags=SurfaceFlags::NONE, PixelFormat::PF fmt=PixelFormat::PF::PIXELFORMAT_UNKNOWN, SurfaceConvertFn convert=nullptr);
 		static SurfacePtr create(int width, 
 			int height, 
 			int bpp, 
@@ -207,6 +233,11 @@ namespace KRE
 		static SurfacePtr create(int width, int height, PixelFormat::PF fmt);
 
 		static void resetSurfaceCache();
+		// Surfaces created from files are cached, unless NO_CACHE is given, and Surface::create() may be 
+		// called from any thread. Cached surfaces that aren't in use elsewhere are released, least recently 
+		// used first, once the cache holds more than the budget. Defaults to 256MB.
+		static void setSurfaceCacheBudget(size_t bytes);
+		static SurfaceCacheStats getSurfaceCacheStats();
 
 		static void setFileFilter(FileFilterType type, file_filter fn);
 		static file_filter getFileFilter(FileFilterType type);
@@ -221,16 +252,19 @@ namespace KRE
 		virtual Color getColorAt(int x, int y) const;
 
 		virtual const unsigned char* colorAt(int x, int y) const { return nullptr; }
+		// Hit testing, the alpha map is built the first time one of these is called.
 		bool isAlpha(unsigned x, unsigned y) const;
-		std::vector<bool>::const_iterator getAlphaRow(int x, int y) const;
-		std::vector<bool>::const_iterator endAlpha() const;
+		bool anyOpaque(const rect& r) const;
+		bool collides(const SurfacePtr& other, int x, int y) const;
 
+		// (Re)builds the alpha map from the current pixels.
 		void createAlphaMap();
+		bool hasAlphaMap() const;
 
 		const std::string& getName() const { return name_; }
 
-		std::shared_ptr<std::vector<bool>> getAlphaMap() { return alpha_map_; }
-		void setAlphaMap(std::shared_ptr<std::vector<bool>> am) { alpha_map_ = am; }
+		AlphaMaskPtr getAlphaMap() const;
+		void setAlphaMap(AlphaMaskPtr am);
 
 		const std::array<int, 4>& getAlphaBorders() const { return alpha_borders_; }
 
@@ -240,9 +274,9 @@ namespace KRE
 		static int getAlphaStripThreshold();
 
 		// load a group of images into a single surface, will try to enlarge the surface up
-		// to a maximum size until all images are packed. 
+		// to a maximum size until all images are packed. Images are loaded on the default worker pool.
 		/// Returns nullptr if all the images can't be packed into a maximally sized surface.
-		static SurfacePtr packImages(const std::vector<std::string>& filenames, std::vector<rect>* outr, std::vector<std::array<int, 4>>* borders=nullptr);
+		static SurfacePtr packImages(const std::vector<std::string>& filenames, std::vector<rect>* outr, std::vector<std::array<int, 4>>* borders=nullptr, RectPackerStats* stats=nullptr);
 	protected:
 		Surface();
 		void setPixelFormat(PixelFormatPtr pf);
@@ -253,7 +287,8 @@ namespace KRE
 		virtual SurfacePtr handleConvert(PixelFormat::PF fmt, SurfaceConvertFn convert) = 0;
 		SurfaceFlags flags_;
 		PixelFormatPtr pf_;
-		std::shared_ptr<std::vector<bool>> alpha_map_;
+		// Accessed with std::atomic_load/atomic_store since it is built lazily from const methods.
+		mutable AlphaMaskPtr alpha_map_;
 		std::string name_;
 		unsigned id_;
 		// If STRIP_ALPHA_BORDERS was given this is the number of pixels stripped off each side.
@@ -21,9 +21,15 @@
 	   distribution.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "profile_timer.hpp"
 
+#include "Simd.hpp"
 #include "SurfaceBlur.hpp"
+#include "WorkerPool.hpp"
 
 namespace KRE
 {
@@ -96,7 +102,7 @@ namespace KRE
 
 	void pixels_alpha_blur(void* pixels, int w, int h, int stride, float blur)
 	{
-		profile::manager pman("pixels_alpha_blur");
+		PROFILE_ZONE("pixels_alpha_blur");
 		if(blur < 1.0f || blur > 128.0f) {
 			return;
 		}
@@ -112,7 +118,7 @@ namespace KRE
 
 	void surface_alpha_blur(const SurfacePtr& surface, float blur)
 	{
-		profile::manager pman("surface_alpha_blur");
+		PROFILE_ZONE("surface_alpha_blur");
 		if(blur < 1.0f || blur > 128.0f) {
 			return;
 		}
@@ -130,4 +136,221 @@ namespace KRE
 		blur_rows(dst, w, h, stride, alpha, alpha_offset, Bpp);
 		blur_cols(dst, w, h, stride, alpha, alpha_offset, Bpp);
 	}
+
+	namespace
+	{
+		// Rows (or columns on the second pass) handled by one task.
+		const int blur_band_size = 16;
+
+		std::vector<float> gaussian_kernel(float sigma)
+		{
+			const int radius = std::max(1, static_cast<int>(std::ceil(sigma * 3.0f)));
+			std::vector<float> res(radius * 2 + 1);
+			float sum = 0.0f;
+			for(int n = -radius; n <= radius; ++n) {
+				res[n + radius] = std::exp(-static_cast<float>(n * n) / (2.0f * sigma * sigma));
+				sum += res[n + radius];
+			}
+			for(auto& w : res) {
+				w /= sum;
+			}
+			return res;
+		}
+
+		// Radii of three box filters whose combination has the given standard deviation.
+		std::vector<int> box_radii(float sigma)
+		{
+			const int passes = 3;
+			const float ideal = std::sqrt(12.0f * sigma * sigma / passes + 1.0f);
+			int lower = static_cast<int>(std::floor(ideal));
+			if(lower % 2 == 0) {
+				--lower;
+			}
+			const int upper = lower + 2;
+			const int use_lower = static_cast<int>(std::floor((12.0f * sigma * sigma - passes * lower * lower - 4.0f * passes * lower - 3.0f * passes) / (-4.0f * lower - 4.0f) + 0.5f));
+			std::vector<int> res;
+			for(int n = 0; n != passes; ++n) {
+				res.emplace_back(((n < use_lower ? lower : upper) - 1) / 2);
+			}
+			return res;
+		}
+
+		// Copies a row of count pixels of channels floats, repeating the edge pixels radius times either side.
+		void pad_row(const float* in, int count, int channels, int radius, float* out)
+		{
+			for(int n = 0; n != radius; ++n) {
+				std::copy(in, in + channels, out + n * channels);
+				std::copy(in + (count - 1) * channels, in + count * channels, out + (radius + count + n) * channels);
+			}
+			std::copy(in, in + count * channels, out + radius * channels);
+		}
+
+		// out[i] = sum(weights[k] * in[i + k * channels]) for the n floats of the row. Channels are interleaved
+		// so neighbouring outputs are independent and map directly onto vector lanes.
+		void convolve_row(const float* in, float* out, int n, int channels, const std::vector<float>& weights)
+		{
+			const int taps = static_cast<int>(weights.size());
+			int i = 0;
+#if defined(KRE_SIMD_AVX)
+			for(; i + 8 <= n; i += 8) {
+				__m256 sum = _mm256_setzero_ps();
+				for(int k = 0; k != taps; ++k) {
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(in + i + k * channels)));
+				}
+				_mm256_storeu_ps(out + i, sum);
+			}
+#elif defined(KRE_SIMD_SSE2)
+			for(; i + 4 <= n; i += 4) {
+				__m128 sum = _mm_setzero_ps();
+				for(int k = 0; k != taps; ++k) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(in + i + k * channels)));
+				}
+				_mm_storeu_ps(out + i, sum);
+			}
+#endif
+			for(; i != n; ++i) {
+				float sum = 0.0f;
+				for(int k = 0; k != taps; ++k) {
+					sum += weights[k] * in[i + k * channels];
+				}
+				out[i] = sum;
+			}
+		}
+
+		// Box filter of the given radius using a running sum per channel, the channels of a pixel are 
+		// updated together so the row is read in order.
+		void box_row(const float* in, float* out, int count, int channels, int radius)
+		{
+			const float scale = 1.0f / (radius * 2 + 1);
+			const int window = (radius * 2 + 1) * channels;
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for(int k = 0; k != window; ++k) {
+				sum[k % channels] += in[k];
+			}
+			const int n = count * channels;
+#if defined(KRE_SIMD_AVX) || defined(KRE_SIMD_SSE2)
+			if(channels == 4) {
+				// A pixel is exactly one vector.
+				__m128 vsum = _mm_loadu_ps(sum);
+				const __m128 vscale = _mm_set1_ps(scale);
+				for(int i = 0; i < n; i += 4) {
+					_mm_storeu_ps(out + i, _mm_mul_ps(vsum, vscale));
+					vsum = _mm_add_ps(vsum, _mm_sub_ps(_mm_loadu_ps(in + i + window), _mm_loadu_ps(in + i)));
+				}
+				return;
+			}
+#endif
+			for(int i = 0; i < n; i += channels) {
+				for(int ch = 0; ch != channels; ++ch) {
+					out[i + ch] = sum[ch] * scale;
+					sum[ch] += in[i + window + ch] - in[i + ch];
+				}
+			}
+		}
+
+		class RowBlur
+		{
+		public:
+			RowBlur(float sigma, BlurMode mode) 
+				: mode_(mode),
+				  weights_(mode == BlurMode::GAUSSIAN ? gaussian_kernel(sigma) : std::vector<float>()),
+				  radii_(mode == BlurMode::BOX ? box_radii(sigma) : std::vector<int>())
+			{
+			}
+			int getMaxRadius() const {
+				return mode_ == BlurMode::GAUSSIAN ? static_cast<int>(weights_.size() / 2) : *std::max_element(radii_.begin(), radii_.end());
+			}
+			// Blurs row in place, pad is scratch space of (count + 2 * getMaxRadius() + 1) * channels floats.
+			void operator()(float* row, int count, int channels, float* pad) const {
+				if(mode_ == BlurMode::GAUSSIAN) {
+					const int radius = static_cast<int>(weights_.size() / 2);
+					pad_row(row, count, channels, radius, pad);
+					convolve_row(pad, row, count * channels, channels, weights_);
+				} else {
+					for(int radius : radii_) {
+						pad_row(row, count, channels, radius, pad);
+						box_row(pad, row, count, channels, radius);
+					}
+				}
+			}
+		private:
+			BlurMode mode_;
+			std::vector<float> weights_;
+			std::vector<int> radii_;
+		};
+	}
+
+	void pixels_blur(void* pixels, int w, int h, int stride, int channels, float sigma, BlurMode mode)
+	{
+		PROFILE_ZONE("pixels_blur");
+		if(sigma <= 0.0f || w <= 0 || h <= 0) {
+			return;
+		}
+		const RowBlur blur(sigma, mode);
+		const int max_radius = blur.getMaxRadius();
+		uint8_t* dst = static_cast<uint8_t*>(pixels);
+		const int row_floats = w * channels;
+		const int col_floats = h * channels;
+		
+		// Horizontal pass, written back to the image so no image sized buffer is needed.
+		const int row_bands = (h + blur_band_size - 1) / blur_band_size;
+		WorkerPool::getDefault().parallelFor(row_bands, [&](std::size_t band) {
+			const int y1 = static_cast<int>(band) * blur_band_size;
+			const int y2 = std::min(h, y1 + blur_band_size);
+			std::vector<float> row(row_floats);
+			std::vector<float> pad((w + 2 * max_radius + 1) * channels);
+			for(int y = y1; y != y2; ++y) {
+				uint8_t* src = dst + y * stride;
+				for(int n = 0; n != row_floats; ++n) {
+					row[n] = src[n];
+				}
+				blur(&row[0], w, channels, &pad[0]);
+				for(int n = 0; n != row_floats; ++n) {
+					src[n] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, row[n] + 0.5f)));
+				}
+			}
+		});
+
+		// Vertical pass, a band of columns at a time is transposed into a tile so each column 
+		// is a contiguous run. The tile is the band width times the image height.
+		const int col_bands = (w + blur_band_size - 1) / blur_band_size;
+		WorkerPool::getDefault().parallelFor(col_bands, [&](std::size_t band) {
+			const int x1 = static_cast<int>(band) * blur_band_size;
+			const int x2 = std::min(w, x1 + blur_band_size);
+			std::vector<float> tile((x2 - x1) * col_floats);
+			std::vector<float> pad((h + 2 * max_radius + 1) * channels);
+			for(int y = 0; y != h; ++y) {
+				const uint8_t* in = dst + y * stride + x1 * channels;
+				for(int x = x1; x != x2; ++x) {
+					float* out = &tile[(x - x1) * col_floats + y * channels];
+					for(int ch = 0; ch != channels; ++ch) {
+						out[ch] = *in++;
+					}
+				}
+			}
+			for(int x = x1; x != x2; ++x) {
+				blur(&tile[(x - x1) * col_floats], h, channels, &pad[0]);
+			}
+			// Transpose back, writing the band's columns a row at a time.
+			for(int y = 0; y != h; ++y) {
+				uint8_t* out = dst + y * stride + x1 * channels;
+				for(int x = x1; x != x2; ++x) {
+					const float* in = &tile[(x - x1) * col_floats + y * channels];
+					for(int ch = 0; ch != channels; ++ch) {
+						*out++ = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, in[ch] + 0.5f)));
+					}
+				}
+			}
+		});
+	}
+
+	void surface_blur(const SurfacePtr& surface, float sigma, BlurMode mode)
+	{
+		PROFILE_ZONE("surface_blur");
+		ASSERT_LOG(!PixelFormat::isIndexedFormat(surface->getPixelFormat()->getFormat()), "Can't blur surfaces with indexed formats.");
+		const int bpp = surface->getPixelFormat()->bytesPerPixel();
+		ASSERT_LOG(bpp == 1 || bpp == 3 || bpp == 4, "Can only blur 8-bit per channel surfaces, bytes per pixel: " << bpp);
+		SurfaceLock lck(surface);
+		pixels_blur(surface->pixelsWriteable(), surface->width(), surface->height(), surface->rowPitch(), bpp, sigma, mode);
+	}
 }
@@ -31,4 +31,19 @@ namespace KRE
 	void pixels_alpha_blur(void* pixels, int w, int h, int stride, float blur);
 
 	void surface_alpha_blur(const SurfacePtr& surface, float blur);
+
+	enum class BlurMode {
+		// Direct convolution with a Gaussian kernel of radius 3 * sigma.
+		GAUSSIAN,
+		// Three successive box blurs approximating the Gaussian, the cost doesn't depend on sigma.
+		BOX,
+	};
+
+	// Blurs every channel of 8-bit per channel pixels, channels being the number of bytes per pixel. Both
+	// passes work on bands spread over the default worker pool, the vertical pass transposes each band of
+	// columns into a tile so it also runs along rows. Edge pixels are repeated. Straight alpha images 
+	// should be premultiplied first to avoid dark fringes.
+	void pixels_blur(void* pixels, int w, int h, int stride, int channels, float sigma, BlurMode mode=BlurMode::GAUSSIAN);
+
+	void surface_blur(const SurfacePtr& surface, float sigma, BlurMode mode=BlurMode::GAUSSIAN);
 }
@@ -32,6 +32,7 @@
 
 #include "asserts.hpp"
 #include "formatter.hpp"
+#include "PixelKernels.hpp"
 #include "SurfaceSDL.hpp"
 
 enum {
@@ -956,7 +957,17 @@ namespace KRE
 	SurfacePtr SurfaceSDL::handleConvert(PixelFormat::PF fmt, SurfaceConvertFn convert)
 	{
 		ASSERT_LOG(fmt != PixelFormat::PF::PIXELFORMAT_UNKNOWN, "unknown pixel format to convert to.");
+		const PixelFormat::PF src_fmt = getPixelFormat()->getFormat();
 		if(convert == nullptr) {
+			// SDL turns a color key into alpha while converting, which the kernels don't.
+			Uint32 color_key;
+			if(pixel_kernels::can_convert(src_fmt, fmt) && SDL_GetColorKey(surface_, &color_key) != 0) {
+				auto dst = std::make_shared<SurfaceSDL>(width(), height(), fmt);
+				SurfaceLock src_lock(shared_from_this());
+				SurfaceLock dst_lock(dst);
+				pixel_kernels::convert(pixels(), rowPitch(), src_fmt, dst->pixelsWriteable(), dst->rowPitch(), fmt, width(), height());
+				return dst;
+			}
 			SDL_PixelFormat* pf = SDL_AllocFormat(get_sdl_pixel_format(fmt));
 			ASSERT_LOG(pf != nullptr, "error allocating pixel format: " << SDL_GetError());
 			auto surface = new SurfaceSDL(SDL_ConvertSurface(surface_, pf, 0));
@@ -967,6 +978,31 @@ namespace KRE
 		// Create a destination surface
 		ASSERT_LOG(PixelFormat::isIndexedFormat(fmt) == false, "Indexed format can't be handled right now for conversion.");
 		auto dst = std::make_shared<SurfaceSDL>(width(), height(), fmt);
+
+		// Each row is unpacked to bytes in R,G,B,A order, passed through the conversion function and 
+		// packed straight into the destination.
+		const PixelFormat::PF row_fmt = PixelFormat::PF::PIXELFORMAT_ABGR8888;
+		if(pixel_kernels::can_convert(src_fmt, row_fmt) && pixel_kernels::can_convert(row_fmt, fmt)) {
+			SurfaceLock src_lock(shared_from_this());
+			SurfaceLock dst_lock(dst);
+			const int w = width();
+			std::vector<uint8_t> row(w * 4);
+			for(int y = 0; y != height(); ++y) {
+				pixel_kernels::convert(static_cast<const uint8_t*>(pixels()) + y * rowPitch(), rowPitch(), src_fmt, &row[0], w * 4, row_fmt, w, 1);
+				for(int x = 0; x != w; ++x) {
+					uint8_t* px = &row[x * 4];
+					int r = px[0], g = px[1], b = px[2], a = px[3];
+					convert(r, g, b, a);
+					px[0] = static_cast<uint8_t>(r);
+					px[1] = static_cast<uint8_t>(g);
+					px[2] = static_cast<uint8_t>(b);
+					px[3] = static_cast<uint8_t>(a);
+				}
+				pixel_kernels::convert(&row[0], w * 4, row_fmt, static_cast<uint8_t*>(dst->pixelsWriteable()) + y * dst->rowPitch(), dst->rowPitch(), fmt, w, 1);
+			}
+			return dst;
+		}
+
 		int dst_size = dst->rowPitch() * dst->height();
 		void* dst_pixels = new uint8_t[dst_size];
 
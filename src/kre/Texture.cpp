@@ -29,9 +29,11 @@ using boost::math::round;
 using std::round;
 #endif
 
+#include <list>
 #include <set>
 #include "asserts.hpp"
 #include "DisplayDevice.hpp"
+#include "profile_timer.hpp"
 #include "Texture.hpp"
 #include "TextureUtils.hpp"
 
@@ -42,6 +44,30 @@ namespace KRE
 			static std::set<Texture*>* value = new std::set<Texture*>;
 			return *value;
 		}
+
+		// Textures from createTextureAsync() waiting on their image. Only used on the render thread.
+		struct PendingUpload
+		{
+			std::weak_ptr<Texture> texture;
+			std::shared_future<SurfacePtr> surface;
+		};
+		std::list<PendingUpload>& get_pending_uploads()
+		{
+			static std::list<PendingUpload> res;
+			return res;
+		}
+
+		double upload_budget_ms = 2.0;
+
+		SurfacePtr get_placeholder_surface()
+		{
+			static SurfacePtr res;
+			if(res == nullptr) {
+				res = Surface::create(1, 1, PixelFormat::PF::PIXELFORMAT_RGBA8888);
+				res->fillRect(rect(0, 0, 1, 1), Color(0, 0, 0, 0));
+			}
+			return res;
+		}
 	}
 
 	const std::set<Texture*>& Texture::getAllTextures() {
@@ -51,7 +77,8 @@ namespace KRE
 	Texture::Texture(const variant& node, const std::vector<SurfacePtr>& surfaces)
 		: is_paletteized_(false),
 		  mix_ratio_(0.0f),
-		  mix_palettes_(false)
+		  mix_palettes_(false),
+		  placeholder_(false)
 	{
 		palette_[0] = palette_[1] = 0;
 		if(node.is_list()) {
@@ -147,7 +174,8 @@ namespace KRE
 	Texture::Texture(const std::vector<SurfacePtr>& surfaces, TextureType type, int mipmap_levels)
 		: is_paletteized_(false),
 		  mix_ratio_(0.0f),
-		  mix_palettes_(false)
+		  mix_palettes_(false),
+		  placeholder_(false)
 	{
 		palette_[0] = palette_[1] = 0;
 		texture_params_.reserve(surfaces.size());
@@ -173,7 +201,8 @@ namespace KRE
 		TextureType type)
 		: is_paletteized_(false),
 		  mix_ratio_(0.0f),
-		  mix_palettes_(false)
+		  mix_palettes_(false),
+		  placeholder_(false)
 	{
 		ASSERT_LOG(count > 0, "Insufficient number of textures specified: " << count);
 		palette_[0] = palette_[1] = 0;
@@ -200,7 +229,8 @@ namespace KRE
 		is_paletteized_(o.is_paletteized_),
 		mix_ratio_(o.mix_ratio_),
 		mix_palettes_(o.mix_palettes_),
-		palette_row_map_(o.palette_row_map_)
+		palette_row_map_(o.palette_row_map_),
+		placeholder_(o.placeholder_)
 	{
 		memcpy(palette_, o.palette_, sizeof(palette_));
 		allTextures().insert(this);
@@ -347,7 +377,11 @@ namespace KRE
 		tp->filtering[0] = Filtering::POINT;
 		tp->filtering[1] = Filtering::POINT;
 		tp->filtering[2] = Filtering::NONE;
+		updateSize(tp);
+	}
 
+	void Texture::updateSize(texture_params_iterator tp)
+	{
 		// XXX For reasons (i.e. some video cards are problematic either hardware/drivers)
 		// we are forced to use power-of-two textures anyway if we want mip-mapping and
 		// address modes other than CLAMP.
@@ -704,6 +738,72 @@ namespace KRE
 		internalInit(texture_params_.begin() + n);
 	}
 
+	void Texture::setLoadedSurface(int n, const SurfacePtr& surf)
+	{
+		ASSERT_LOG(n < static_cast<int>(texture_params_.size()), "index out of bounds. " << n << " >= " << texture_params_.size());
+		auto tp = texture_params_.begin() + n;
+		tp->surface = surf;
+		tp->filename = surf->getName();
+		tp->fmt = surf->getPixelFormat() ? surf->getPixelFormat()->getFormat() : PixelFormat::PF::PIXELFORMAT_UNKNOWN;
+		tp->surface_width = surf->width();
+		tp->surface_height = surf->height();
+		updateSize(tp);
+		handleSurfaceLoaded(n);
+		placeholder_ = false;
+	}
+
+	TexturePtr Texture::createTextureAsync(const std::string& filename, const variant& node)
+	{
+		auto tex = DisplayDevice::createTexture(get_placeholder_surface(), node);
+		tex->placeholder_ = true;
+		PendingUpload upload = { tex, Surface::createAsync(filename) };
+		get_pending_uploads().emplace_back(upload);
+		return tex;
+	}
+
+	int Texture::processPendingUploads()
+	{
+		auto& pending = get_pending_uploads();
+		if(pending.empty()) {
+			return 0;
+		}
+		PROFILE_ZONE("Texture::processPendingUploads");
+		profile::timer tm;
+		tm.start();
+		int uploaded = 0;
+		for(auto it = pending.begin(); it != pending.end(); ) {
+			if(uploaded > 0 && tm.check() * 1000.0 >= upload_budget_ms) {
+				break;
+			}
+			if(it->surface.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++it;
+				continue;
+			}
+			// Textures released before their image arrived are skipped.
+			auto tex = it->texture.lock();
+			if(tex != nullptr) {
+				try {
+					tex->setLoadedSurface(0, it->surface.get());
+					++uploaded;
+				} catch(std::exception& e) {
+					LOG_ERROR("Failed to load texture image: " << e.what());
+				}
+			}
+			it = pending.erase(it);
+		}
+		return uploaded;
+	}
+
+	int Texture::getPendingUploadCount()
+	{
+		return static_cast<int>(get_pending_uploads().size());
+	}
+
+	void Texture::setUploadBudget(double milliseconds)
+	{
+		upload_budget_ms = milliseconds;
+	}
+
 	Color Texture::mapPaletteColor(const Color& color, int palette)
 	{
 		if(!isPaletteized()) {
@@ -125,6 +125,18 @@ namespace KRE
 		static TexturePtr createTextureArray(int count, int width, int height, PixelFormat::PF fmt, TextureType type);
 		static TexturePtr createTextureArray(const std::vector<SurfacePtr>& surfaces, const variant& node);
 
+		// Returns a placeholder texture straight away, the image is loaded on the worker pool and then
+		// uploaded by processPendingUploads(). Must be called on the render thread.
+		static TexturePtr createTextureAsync(const std::string& filename, const variant& node=variant());
+		// Uploads textures whose images have finished loading, until the upload budget for the frame is
+		// used up. At least one is uploaded per call. Called by RenderManager::render().
+		static int processPendingUploads();
+		static int getPendingUploadCount();
+		static void setUploadBudget(double milliseconds);
+		bool isPlaceholder() const { return placeholder_; }
+		// Replaces a surface, keeping the addressing and filtering settings, and re-uploads it.
+		void setLoadedSurface(int n, const SurfacePtr& surf);
+
 		void addPalette(int index, const SurfacePtr& palette);
 
 		int getTextureCount() const { return static_cast<int>(texture_params_.size()); }
@@ -261,6 +273,8 @@ namespace KRE
 		Texture();
 		virtual void rebuild() = 0;
 		virtual void handleAddPalette(int index, const SurfacePtr& palette) = 0;
+		// Re-creates the hardware texture n from its new surface.
+		virtual void handleSurfaceLoaded(int n) = 0;
 
 		struct TextureParams {
 			TextureParams()
@@ -324,8 +338,10 @@ namespace KRE
 		float mix_ratio_;
 		bool mix_palettes_;
 		std::map<int,int> palette_row_map_;
+		bool placeholder_;
 
 		void initFromVariant(texture_params_iterator tp, const variant& node);
 		void internalInit(texture_params_iterator tp);
+		void updateSize(texture_params_iterator tp);
 	};
 }
@@ -289,7 +289,7 @@ namespace KRE
 
 	void OpenGLTexture::handleAddPalette(int index, const SurfacePtr& palette)
 	{
-		//profile::manager pman("handleAddPalette");
+		PROFILE_ZONE("OpenGLTexture::handleAddPalette");
 		ASSERT_LOG(is_yuv_planar_ == false, "Can't create a palette for a YUV surface.");
 		ASSERT_LOG(index < maximum_palette_variations, "index of (" << index << ") exceeds the maximum soft palette limit: " << maximum_palette_variations);
 
@@ -334,7 +334,9 @@ namespace KRE
 				ASSERT_LOG(td.palette.size() < 256, "Can't convert surface to palettized version. Too many colors in source image > 256");
 			});
 			surf->writePixels(&new_pixels[0], static_cast<int>(new_pixels.size()));
-			surf->setAlphaMap(getSurface(0)->getAlphaMap());
+			if(getSurface(0)->hasAlphaMap()) {
+				surf->setAlphaMap(getSurface(0)->getAlphaMap());
+			}
 
 			//LOG_DEBUG("adding palette '" << palette->getName() << "' to: " << getSurface(0)->getName() << ". " << td.color_index_map.size() << " colors in map");
 
@@ -662,6 +664,7 @@ namespace KRE
 					glTexImage2D(GL_TEXTURE_2D, 0, td.internal_format, w, h, 0, td.format, td.type, 0);
 				} else {
 					glTexImage2D(GL_TEXTURE_2D, 0, td.internal_format, surf->width(), surf->height(), 0, td.format, td.type, pixels);
+					PROFILE_COUNTER_ADD(BYTES_UPLOADED, surf->height() * surf->rowPitch());
 				}
 				break;
 			case TextureType::TEXTURE_3D:
@@ -804,6 +807,15 @@ namespace KRE
 		}
 	}
 
+	void OpenGLTexture::handleSurfaceLoaded(int n)
+	{
+		texture_data_[n] = TextureData();
+		texture_data_[n].surface_format = getSurface(n)->getPixelFormat()->getFormat();
+		createTexture(n);
+		init(n);
+		clearSurfaces();
+	}
+
 	const unsigned char* OpenGLTexture::colorAt(int x, int y) const 
 	{
 		if(getFrontSurface() == nullptr) {
@@ -60,6 +60,7 @@ namespace KRE
 		void updatePaletteRow(int index, SurfacePtr new_palette_surface, int palette_width, const std::vector<glm::u8vec4>& pixels);
 		void rebuild() override;
 		void handleAddPalette(int index, const SurfacePtr& palette) override;
+		void handleSurfaceLoaded(int n) override;
 		void handleInit(int n);
 
 		// For YUV family textures we need two more texture id's
@@ -30,6 +30,7 @@
 
 #include "asserts.hpp"
 #include "DisplayDevice.hpp"
+#include "FontDriver.hpp"
 #include "SurfaceSDL.hpp"
 #include "SDL.h"
 #include "SDL_image.h"
@@ -257,10 +258,13 @@ namespace KRE
 			}
 			window_.reset(SDL_CreateWindow(getTitle().c_str(), x, y, w, h, wnd_flags), [&](SDL_Window* wnd){
 #ifdef USE_IMGUI
-				ImGui_ImplSdlGL3_Shutdown();
+				if(context_) {
+					ImGui_ImplSdlGL3_Shutdown();
+				}
 #endif
-				if(getDisplayDevice()->ID() != DisplayDevice::DISPLAY_DEVICE_SDL) {
+				if(renderer_ != nullptr) {
 					SDL_DestroyRenderer(renderer_);
+					renderer_ = nullptr;
 				}
 				getDisplayDevice().reset();
 				if(context_) {
@@ -271,10 +275,13 @@ namespace KRE
 			});
 
 #ifdef USE_IMGUI
-			ImGui_ImplSdlGL3_Init(window_.get());
+			if(context_) {
+				ImGui_ImplSdlGL3_Init(window_.get());
+			}
 #endif
 
-			if(getDisplayDevice()->ID() != DisplayDevice::DISPLAY_DEVICE_SDL) {
+			// The null device draws nothing, so has no need of an SDL renderer.
+			if(getDisplayDevice()->ID() != DisplayDevice::DISPLAY_DEVICE_SDL && getDisplayDevice()->ID() != DisplayDevice::DISPLAY_DEVICE_NULL) {
 				Uint32 rnd_flags = SDL_RENDERER_ACCELERATED;
 				if(vSync()) {
 					rnd_flags |= SDL_RENDERER_PRESENTVSYNC;
@@ -308,7 +315,9 @@ namespace KRE
 			getDisplayDevice()->setClearColor(clear_color_);
 			getDisplayDevice()->clear(f);
 #ifdef USE_IMGUI
-			ImGui_ImplSdlGL3_NewFrame(window_.get());
+			if(context_) {
+				ImGui_ImplSdlGL3_NewFrame(window_.get());
+			}
 #endif
 		}
 
@@ -317,7 +326,9 @@ namespace KRE
 			// But SDL provides a device independent way of doing it which is really nice.
 			// So we use that.
 #ifdef USE_IMGUI
-			ImGui::Render();
+			if(context_) {
+				ImGui::Render();
+			}
 #endif
 			if(getDisplayDevice()->ID() == DisplayDevice::DISPLAY_DEVICE_OPENGL || getDisplayDevice()->ID() == DisplayDevice::DISPLAY_DEVICE_OPENGLES) {
 				SDL_GL_SwapWindow(window_.get());
@@ -325,6 +336,7 @@ namespace KRE
 				// default to delegating to the display device.
 				getDisplayDevice()->swap();
 			}
+			FontDriver::nextFrame();
 		}
 
 		unsigned getWindowID() const override {
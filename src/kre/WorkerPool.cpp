@@ -0,0 +1,251 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <exception>
+
+#include "asserts.hpp"
+#include "WorkerPool.hpp"
+
+namespace KRE
+{
+	namespace
+	{
+		// Identifies the pool and queue owned by the current thread, if it is a worker.
+		KRE_THREAD_LOCAL const WorkerPool* current_pool = nullptr;
+		KRE_THREAD_LOCAL std::size_t current_queue = 0;
+
+		int default_thread_count = -1;
+
+		std::unique_ptr<WorkerPool>& get_default_pool()
+		{
+			static std::unique_ptr<WorkerPool> res;
+			return res;
+		}
+
+		std::mutex& get_default_pool_mutex()
+		{
+			static std::mutex res;
+			return res;
+		}
+	}
+
+	WorkerPool::WorkerPool(int thread_count)
+		: queues_(),
+		  threads_(),
+		  pending_(0),
+		  done_(false)
+	{
+		ASSERT_LOG(thread_count >= 0, "Worker pool thread count must be non-negative: " << thread_count);
+		// The extra queue at the end receives tasks pushed by threads outside the pool.
+		for(int n = 0; n != thread_count + 1; ++n) {
+			queues_.emplace_back(new TaskQueue);
+		}
+		for(int n = 0; n != thread_count; ++n) {
+			threads_.emplace_back(&WorkerPool::workerMain, this, static_cast<std::size_t>(n));
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex_);
+			done_ = true;
+		}
+		wake_.notify_all();
+		for(auto& t : threads_) {
+			t.join();
+		}
+	}
+
+	void WorkerPool::workerMain(std::size_t index)
+	{
+		current_pool = this;
+		current_queue = index;
+		for(;;) {
+			if(runOne()) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(wake_mutex_);
+			if(done_ && pending_ == 0) {
+				break;
+			}
+			wake_.wait(lock, [this]() { return done_ || pending_ > 0; });
+		}
+		current_pool = nullptr;
+	}
+
+	std::size_t WorkerPool::getQueueIndex() const
+	{
+		return current_pool == this ? current_queue : queues_.size() - 1;
+	}
+
+	void WorkerPool::push(Task task)
+	{
+		auto& q = *queues_[getQueueIndex()];
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.emplace_back(std::move(task));
+		}
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex_);
+			++pending_;
+		}
+		wake_.notify_one();
+	}
+
+	bool WorkerPool::pop(std::size_t index, Task* task)
+	{
+		// Newest first from our own queue, it is the most likely to still be in cache.
+		auto& q = *queues_[index];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if(q.tasks.empty()) {
+			return false;
+		}
+		*task = std::move(q.tasks.back());
+		q.tasks.pop_back();
+		return true;
+	}
+
+	bool WorkerPool::steal(std::size_t index, Task* task)
+	{
+		// Oldest first from everyone else's queue.
+		for(std::size_t n = 1; n != queues_.size(); ++n) {
+			auto& q = *queues_[(index + n) % queues_.size()];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if(!q.tasks.empty()) {
+				*task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool WorkerPool::runOne()
+	{
+		const std::size_t index = getQueueIndex();
+		Task task;
+		if(!pop(index, &task) && !steal(index, &task)) {
+			return false;
+		}
+		--pending_;
+		task();
+		return true;
+	}
+
+	void WorkerPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn)
+	{
+		if(threads_.empty() || count < 2) {
+			for(std::size_t n = 0; n != count; ++n) {
+				fn(n);
+			}
+			return;
+		}
+
+		// A few chunks per thread is enough to balance the load without paying for a task per item.
+		// Chunks are claimed from a counter by the caller and by helper tasks, so the caller only 
+		// ever runs work from this call and never picks up unrelated tasks, such as enqueue()d loads.
+		struct Batch
+		{
+			const std::function<void(std::size_t)>* fn;
+			std::size_t count;
+			std::size_t chunks;
+			std::atomic<std::size_t> next;
+			std::atomic<std::size_t> completed;
+			std::exception_ptr error;
+			std::mutex error_mutex;
+		};
+		auto batch = std::make_shared<Batch>();
+		batch->fn = &fn;
+		batch->count = count;
+		batch->chunks = std::min(count, queues_.size() * 4);
+		batch->next = 0;
+		batch->completed = 0;
+
+		// Helpers may be run after the call has returned, by then there are no chunks left to 
+		// claim so they don't touch fn.
+		auto run_chunks = [](const std::shared_ptr<Batch>& b) {
+			for(std::size_t c = b->next++; c < b->chunks; c = b->next++) {
+				const std::size_t first = b->count * c / b->chunks;
+				const std::size_t last = b->count * (c + 1) / b->chunks;
+				try {
+					for(std::size_t n = first; n != last; ++n) {
+						(*b->fn)(n);
+					}
+				} catch(...) {
+					std::lock_guard<std::mutex> lock(b->error_mutex);
+					if(!b->error) {
+						b->error = std::current_exception();
+					}
+				}
+				++b->completed;
+			}
+		};
+
+		const std::size_t helpers = std::min(batch->chunks - 1, threads_.size());
+		for(std::size_t n = 0; n != helpers; ++n) {
+			push([batch, run_chunks]() { run_chunks(batch); });
+		}
+		run_chunks(batch);
+
+		// Everything is claimed, only wait for the chunks still running on other threads.
+		while(batch->completed < batch->chunks) {
+			std::this_thread::yield();
+		}
+
+		if(batch->error) {
+			std::rethrow_exception(batch->error);
+		}
+	}
+
+	void WorkerPool::enqueue(Task task)
+	{
+		if(threads_.empty()) {
+			task();
+			return;
+		}
+		push(std::move(task));
+	}
+
+	WorkerPool& WorkerPool::getDefault()
+	{
+		std::lock_guard<std::mutex> lock(get_default_pool_mutex());
+		auto& pool = get_default_pool();
+		if(pool == nullptr) {
+			int count = default_thread_count;
+			if(count < 0) {
+				count = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+			}
+			pool.reset(new WorkerPool(count));
+		}
+		return *pool;
+	}
+
+	void WorkerPool::setDefaultThreadCount(int thread_count)
+	{
+		std::lock_guard<std::mutex> lock(get_default_pool_mutex());
+		default_thread_count = thread_count;
+		get_default_pool().reset();
+	}
+}
@@ -0,0 +1,92 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define KRE_THREAD_LOCAL __declspec(thread)
+#else
+#define KRE_THREAD_LOCAL thread_local
+#endif
+
+namespace KRE
+{
+	// Fixed size pool of worker threads. Each worker has its own task queue, idle workers
+	// steal work from the front of the other queues. A thread calling parallelFor() works on
+	// the items of that call rather than blocking, so it is safe to nest calls, but it never 
+	// runs other queued tasks.
+	class WorkerPool
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		explicit WorkerPool(int thread_count);
+		~WorkerPool();
+
+		int getThreadCount() const { return static_cast<int>(threads_.size()); }
+
+		// Calls fn(n) for every n in [0,count) and returns once all calls have completed.
+		// Runs serially on the calling thread if the pool has no workers.
+		void parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn);
+		// Queue a task to be run at some later time on a worker thread.
+		void enqueue(Task task);
+
+		static WorkerPool& getDefault();
+		// Number of workers in the default pool, by default one less than the number of hardware threads.
+		// Must not be called while the default pool is in use.
+		static void setDefaultThreadCount(int thread_count);
+	private:
+		struct TaskQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void workerMain(std::size_t index);
+		void push(Task task);
+		bool runOne();
+		bool pop(std::size_t index, Task* task);
+		bool steal(std::size_t index, Task* task);
+		std::size_t getQueueIndex() const;
+
+		std::vector<std::unique_ptr<TaskQueue>> queues_;
+		std::vector<std::thread> threads_;
+		std::atomic<int> pending_;
+		std::atomic<bool> done_;
+		std::mutex wake_mutex_;
+		std::condition_variable wake_;
+
+		WorkerPool(const WorkerPool&);
+		void operator=(const WorkerPool&);
+	};
+}
@@ -1,6 +1,7 @@
 #include <cstddef>
 #include <deque>
 #include <list>
+#include <set>
 #include <vector>
 
 #include <glm/gtc/type_precision.hpp>
@@ -13,26 +14,34 @@
 #include "Blend.hpp"
 #include "CameraObject.hpp"
 #include "Canvas.hpp"
+#include "DisplayDeviceNull.hpp"
 #include "Font.hpp"
 #include "LightObject.hpp"
 #include "ModelMatrixScope.hpp"
 #include "ParticleSystem.hpp"
 #include "ParticleSystemAffectors.hpp"
 #include "ParticleSystemEmitters.hpp"
+#include "ParticleSystemKernels.hpp"
 #include "ParticleSystemParameters.hpp"
+#include "PixelKernels.hpp"
 #include "Renderable.hpp"
 #include "RenderManager.hpp"
 #include "RenderQueue.hpp"
 #include "RenderTarget.hpp"
 #include "SceneGraph.hpp"
 #include "SceneNode.hpp"
+#include "SceneObject.hpp"
 #include "SceneTree.hpp"
 #include "Shaders.hpp"
+#include "Simd.hpp"
+#include "SpatialIndex.hpp"
 #include "Surface.hpp"
+#include "SurfaceBlur.hpp"
 #include "TexPack.hpp"
 #include "UniformBuffer.hpp"
 #include "WindowManager.hpp"
 #include "VGraph.hpp"
+#include "WorkerPool.hpp"
 
 #include "tmx_reader.hpp"
 
@@ -434,6 +443,123 @@ void texture_packing_test()
 	// output surface available as tp.getOutputSurface()
 }
 
+// Times the per-frame particle update kernels against the scalar reference versions.
+void particle_kernel_benchmark(std::size_t count = 100000, int iterations = 100)
+{
+	using namespace KRE::Particles;
+	std::vector<glm::vec3> position(count), direction(count);
+	std::vector<float> velocity(count), ttl(count);
+	for(std::size_t n = 0; n != count; ++n) {
+		position[n] = glm::vec3(get_random_float(-100.0f, 100.0f), get_random_float(-100.0f, 100.0f), get_random_float(-100.0f, 100.0f));
+		direction[n] = glm::vec3(get_random_float(-1.0f, 1.0f), get_random_float(-1.0f, 1.0f), get_random_float(-1.0f, 1.0f));
+		velocity[n] = get_random_float(0.0f, 200.0f);
+		ttl[n] = get_random_float(1.0f, 10.0f);
+	}
+
+	const float t = 1.0f / 60.0f;
+	profile::timer tm;
+
+	tm.start();
+	for(int i = 0; i != iterations; ++i) {
+		kernels::decrement_ttl_scalar(ttl.data(), count, 0.0f);
+		kernels::find_expired_scalar(ttl.data(), 0, count);
+		kernels::integrate_scalar(position.data(), direction.data(), velocity.data(), count, t, true, 150.0f);
+	}
+	const double scalar_time = tm.check();
+
+	tm.start();
+	for(int i = 0; i != iterations; ++i) {
+		kernels::decrement_ttl(ttl.data(), count, 0.0f);
+		kernels::find_expired(ttl.data(), 0, count);
+		kernels::integrate(position.data(), direction.data(), velocity.data(), count, t, true, 150.0f);
+	}
+	const double simd_time = tm.check();
+
+	LOG_INFO("Particle kernels, " << count << " particles x " << iterations << " iterations: scalar " 
+		<< (scalar_time * 1000.0) << "ms, " << KRE::get_instruction_set() << " " << (simd_time * 1000.0) 
+		<< "ms, speed-up " << (scalar_time / simd_time) << "x");
+}
+
+// Times the pixel conversion kernels against the scalar reference versions for the common format pairs.
+void pixel_convert_benchmark(int width = 1920, int height = 1080, int iterations = 20)
+{
+	using namespace KRE;
+	typedef PixelFormat::PF PF;
+	const std::pair<PF, PF> pairs[] = {
+		std::make_pair(PF::PIXELFORMAT_ARGB8888, PF::PIXELFORMAT_ABGR8888),
+		std::make_pair(PF::PIXELFORMAT_RGBA8888, PF::PIXELFORMAT_BGRA8888),
+		std::make_pair(PF::PIXELFORMAT_RGB24, PF::PIXELFORMAT_ABGR8888),
+		std::make_pair(PF::PIXELFORMAT_ARGB8888, PF::PIXELFORMAT_RGB565),
+		std::make_pair(PF::PIXELFORMAT_ARGB8888, PF::PIXELFORMAT_RGBA4444),
+	};
+	const int pitch = width * 4;
+	std::vector<uint8_t> src(pitch * height), dst(pitch * height);
+	for(auto& c : src) {
+		c = static_cast<uint8_t>(rand());
+	}
+
+	profile::timer tm;
+	for(auto& p : pairs) {
+		tm.start();
+		for(int i = 0; i != iterations; ++i) {
+			pixel_kernels::convert_scalar(src.data(), pitch, p.first, dst.data(), pitch, p.second, width, height);
+		}
+		const double scalar_time = tm.check();
+
+		tm.start();
+		for(int i = 0; i != iterations; ++i) {
+			pixel_kernels::convert(src.data(), pitch, p.first, dst.data(), pitch, p.second, width, height);
+		}
+		const double simd_time = tm.check();
+
+		LOG_INFO("Convert " << static_cast<int>(p.first) << " -> " << static_cast<int>(p.second) 
+			<< ", " << width << "x" << height << ": scalar " << (scalar_time * 1000.0 / iterations) << "ms, " 
+			<< get_instruction_set() << " " << (simd_time * 1000.0 / iterations) 
+			<< "ms, speed-up " << (scalar_time / simd_time) << "x");
+	}
+
+	tm.start();
+	for(int i = 0; i != iterations; ++i) {
+		pixel_kernels::premultiply_alpha_scalar(src.data(), pitch, PF::PIXELFORMAT_ARGB8888, width, height);
+	}
+	const double scalar_time = tm.check();
+	tm.start();
+	for(int i = 0; i != iterations; ++i) {
+		pixel_kernels::premultiply_alpha(src.data(), pitch, PF::PIXELFORMAT_ARGB8888, width, height);
+	}
+	const double simd_time = tm.check();
+	LOG_INFO("Premultiply alpha, " << width << "x" << height << ": scalar " << (scalar_time * 1000.0 / iterations) << "ms, " 
+		<< get_instruction_set() << " " << (simd_time * 1000.0 / iterations) << "ms");
+}
+
+// Times the CPU blur modes on an RGBA image against the original alpha-only exponential blur.
+void blur_benchmark(int width = 2048, int height = 2048, float sigma = 8.0f)
+{
+	using namespace KRE;
+	std::vector<uint8_t> pixels(width * height * 4);
+	for(auto& c : pixels) {
+		c = static_cast<uint8_t>(rand());
+	}
+	std::vector<uint8_t> alpha(width * height);
+	profile::timer tm;
+
+	tm.start();
+	pixels_alpha_blur(alpha.data(), width, height, width, sigma * 1.732f);
+	const double alpha_time = tm.check();
+
+	tm.start();
+	pixels_blur(pixels.data(), width, height, width * 4, 4, sigma, BlurMode::GAUSSIAN);
+	const double gaussian_time = tm.check();
+
+	tm.start();
+	pixels_blur(pixels.data(), width, height, width * 4, 4, sigma, BlurMode::BOX);
+	const double box_time = tm.check();
+
+	LOG_INFO("Blur " << width << "x" << height << ", sigma " << sigma << ", " << WorkerPool::getDefault().getThreadCount() 
+		<< " worker(s), " << get_instruction_set() << ": alpha only exponential " << (alpha_time * 1000.0) 
+		<< "ms, RGBA gaussian " << (gaussian_time * 1000.0) << "ms, RGBA box " << (box_time * 1000.0) << "ms");
+}
+
 std::vector<float> generate_gaussian(float sigma, int radius = 4)
 {
 	std::vector<float> std_gaussian_weights;
@@ -685,12 +811,311 @@ void EmitObjectUI(const KRE::Particles::EmitObjectPtr& eo)
 	}
 }
 
+// Times spawning, moving and despawning a large number of scene nodes.
+void scene_graph_benchmark(int count = 10000)
+{
+	using namespace KRE;
+	SceneGraphPtr scene = SceneGraph::create("benchmark");
+	SceneNodePtr root = scene->getRootNode();
+
+	std::vector<SceneNodePtr> nodes;
+	nodes.reserve(count);
+	for(int n = 0; n != count; ++n) {
+		nodes.emplace_back(scene->createNode());
+		nodes.back()->setPosition(n % 100, n / 100);
+	}
+
+	profile::timer tm;
+	tm.start();
+	for(int n = 0; n != count; ++n) {
+		// Every fourth node is a child of an earlier node, so that world transforms have parents to concatenate.
+		if(n % 4 == 3) {
+			nodes[n - 1]->attachNode(nodes[n]);
+		} else {
+			root->attachNode(nodes[n]);
+		}
+	}
+	const double attach_time = tm.check();
+
+	tm.start();
+	float sum = 0.0f;
+	for(int n = 0; n != count; ++n) {
+		nodes[n]->setRotation(static_cast<float>(n), glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+	for(auto& node : nodes) {
+		sum += node->getWorldMatrix()[3][0];
+	}
+	const double transform_time = tm.check();
+
+	tm.start();
+	for(int n = count - 1; n >= 0; --n) {
+		if(nodes[n]->isAttached()) {
+			nodes[n]->getParent()->removeNode(nodes[n]);
+		}
+	}
+	const double remove_time = tm.check();
+
+	LOG_INFO("Scene graph, " << count << " nodes: attach " << (attach_time * 1000.0) << "ms, transforms " 
+		<< (transform_time * 1000.0) << "ms (" << sum << "), remove " << (remove_time * 1000.0) << "ms");
+}
+
+// Compares spatial index queries with testing every box, for a 2D world of sprite sized boxes
+// with the same density at each size. Each query is a screen sized area.
+void spatial_index_benchmark(int queries = 100)
+{
+	using namespace KRE;
+	const int counts[] = { 10000, 100000, 1000000 };
+	for(int count : counts) {
+		const float world_size = std::sqrt(static_cast<float>(count)) * 64.0f;
+		std::vector<SpatialBox> boxes;
+		boxes.reserve(count);
+		for(int n = 0; n != count; ++n) {
+			const glm::vec3 pos(world_size * (rand() / static_cast<float>(RAND_MAX)), world_size * (rand() / static_cast<float>(RAND_MAX)), 0.0f);
+			boxes.emplace_back(pos, pos + glm::vec3(32.0f, 32.0f, 0.0f));
+		}
+
+		profile::timer tm;
+		tm.start();
+		SpatialIndex index;
+		std::vector<int> proxies;
+		proxies.reserve(count);
+		for(auto& b : boxes) {
+			proxies.emplace_back(index.insert(b, nullptr));
+		}
+		const double build_time = tm.check();
+
+		// A tenth of the objects move a few pixels, as they might in a frame.
+		tm.start();
+		int reinserted = 0;
+		for(int n = 0; n < count; n += 10) {
+			const glm::vec3 delta(static_cast<float>(rand() % 9 - 4), static_cast<float>(rand() % 9 - 4), 0.0f);
+			boxes[n].min += delta;
+			boxes[n].max += delta;
+			reinserted += index.update(proxies[n], boxes[n]) ? 1 : 0;
+		}
+		const double update_time = tm.check();
+
+		std::vector<Frustum> frusta;
+		std::vector<rectf> rects;
+		for(int q = 0; q != queries; ++q) {
+			const float x = (world_size - 1600.0f) * (rand() / static_cast<float>(RAND_MAX));
+			const float y = (world_size - 900.0f) * (rand() / static_cast<float>(RAND_MAX));
+			rects.emplace_back(x, y, 1600.0f, 900.0f);
+			frusta.emplace_back(glm::ortho(0.0f, 1600.0f, 900.0f, 0.0f, -1.0f, 1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(-x, -y, 0.0f)));
+		}
+
+		std::vector<int> results;
+		size_t index_hits = 0;
+		tm.start();
+		for(auto& f : frusta) {
+			results.clear();
+			index.queryFrustum(f, &results);
+			index_hits += results.size();
+		}
+		const double index_frustum_time = tm.check();
+		tm.start();
+		for(auto& r : rects) {
+			results.clear();
+			index.queryRect(r, &results);
+		}
+		const double index_rect_time = tm.check();
+
+		size_t brute_hits = 0;
+		tm.start();
+		for(auto& f : frusta) {
+			for(auto& b : boxes) {
+				brute_hits += f.isBoxInside(b.min, b.max) ? 1 : 0;
+			}
+		}
+		const double brute_frustum_time = tm.check();
+		size_t brute_rect_hits = 0;
+		tm.start();
+		for(auto& r : rects) {
+			for(auto& b : boxes) {
+				brute_rect_hits += b.min.x <= r.x2() && b.max.x >= r.x1() && b.min.y <= r.y2() && b.max.y >= r.y1() ? 1 : 0;
+			}
+		}
+		const double brute_rect_time = tm.check();
+
+		LOG_INFO("Spatial index, " << count << " objects: build " << (build_time * 1000.0) << "ms, update " 
+			<< (update_time * 1000.0) << "ms (" << reinserted << " re-inserted), height " << index.getHeight());
+		LOG_INFO("  per query: frustum " << (index_frustum_time * 1000.0 / queries) << "ms vs " << (brute_frustum_time * 1000.0 / queries) 
+			<< "ms brute force, rect " << (index_rect_time * 1000.0 / queries) << "ms vs " << (brute_rect_time * 1000.0 / queries)
+			<< "ms brute force, found " << (index_hits / queries) << " (" << (brute_hits / queries) << " without the margin), " 
+			<< (brute_rect_hits / queries) << " in the rect");
+	}
+}
+
+// Checks that spatial index culling agrees with testing every object after objects are moved,
+// both through their nodes and through their own transforms and bounds.
+void spatial_culling_check(int count = 2000)
+{
+	using namespace KRE;
+	SceneGraphPtr scene = SceneGraph::create("culling_check");
+	scene->setSpatialIndex(true);
+	SceneNodePtr root = scene->getRootNode();
+
+	std::vector<SceneNodePtr> nodes;
+	std::vector<SceneObjectPtr> objs;
+	for(int n = 0; n != count; ++n) {
+		if(n % 10 == 0) {
+			nodes.emplace_back(scene->createNode());
+			root->attachNode(nodes.back());
+		}
+		auto obj = std::make_shared<SceneObject>("obj" + std::to_string(n));
+		obj->setBoundingBox(glm::vec3(0.0f), glm::vec3(32.0f, 32.0f, 0.0f));
+		obj->setPosition((n * 37) % 4000, (n * 53) % 3000);
+		nodes.back()->attachObject(obj);
+		objs.emplace_back(obj);
+	}
+
+	int mismatches = 0;
+	std::vector<SceneObjectPtr> found;
+	for(int pass = 0; pass != 4; ++pass) {
+		if(pass != 0) {
+			for(int n = 0; n != static_cast<int>(nodes.size()); ++n) {
+				if((n + pass) % 3 == 0) {
+					nodes[n]->setPosition((n * 131 * pass) % 2000, (n * 71 * pass) % 1500);
+				}
+			}
+			for(int n = 0; n != count; ++n) {
+				switch((n + pass) % 4) {
+				case 0: objs[n]->setPosition((n * 97 * pass) % 4000, (n * 89 * pass) % 3000); break;
+				case 1: objs[n]->setScale(1.0f + pass, 1.0f + pass); break;
+				case 2: objs[n]->setBoundingBox(glm::vec3(-16.0f * pass), glm::vec3(16.0f * pass, 16.0f * pass, 0.0f)); break;
+				default: break;
+				}
+			}
+		}
+		for(int y = 0; y < 3000; y += 700) {
+			for(int x = 0; x < 4000; x += 900) {
+				const Frustum frustum(glm::ortho(0.0f, 1600.0f, 900.0f, 0.0f, -1.0f, 1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(-x, -y, 0.0f)));
+				found.clear();
+				scene->queryFrustum(frustum, &found);
+				std::set<SceneObjectPtr> found_set(found.begin(), found.end());
+				for(int n = 0; n != count; ++n) {
+					// The index grows boxes by a margin, so only objects it misses are errors.
+					if(objs[n]->isVisible(frustum, nodes[n / 10]->getWorldMatrix()) && found_set.find(objs[n]) == found_set.end()) {
+						++mismatches;
+					}
+				}
+			}
+		}
+	}
+	if(mismatches != 0) {
+		LOG_ERROR("Spatial culling check: " << mismatches << " visible objects missing from the index results");
+	} else {
+		LOG_INFO("Spatial culling check: index results match testing every object");
+	}
+}
+
+// Renders a large number of sprites through the null display device, so that the cost of
+// the CPU side of the renderer can be measured without a GPU or display.
+void render_benchmark(bool sort_by_state, bool batch_quads, int sprites = 10000, int frames = 100)
+{
+	using namespace KRE;
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+	SDL::SDL_ptr manager(new SDL::SDL());
+	WindowManager wm("SDL");
+
+	variant_builder hints;
+	hints.add("renderer", "null");
+	auto wnd = wm.createWindow(1600, 900, hints.build());
+	auto dev = std::dynamic_pointer_cast<DisplayDeviceNull>(DisplayDevice::getCurrent());
+	ASSERT_LOG(dev != nullptr, "Null display device wasn't created.");
+	DisplayDevice::getCurrent()->setDefaultCamera(std::make_shared<Camera>("ortho1", 0, 1600, 0, 900));
+
+	std::vector<TexturePtr> textures;
+	for(int n = 0; n != 4; ++n) {
+		textures.emplace_back(Texture::createTexture2D(256, 256, PixelFormat::PF::PIXELFORMAT_RGBA8888));
+	}
+	std::vector<std::shared_ptr<Blittable>> blits;
+	for(int n = 0; n != sprites; ++n) {
+		// Interleave the textures so that the order mode has something to lose.
+		auto blit = std::make_shared<Blittable>(textures[n % textures.size()]);
+		blit->setDrawRect(rect(0, 0, 32, 32));
+		blit->setPosition((n * 37) % 1600, (n * 53) % 900);
+		// Only opaque sprites are sorted by state.
+		blit->setBlendState(false);
+		blits.emplace_back(blit);
+	}
+
+	auto rman = std::make_shared<RenderManager>();
+	auto rq = rman->addQueue(0, "opaques");
+	rq->setSortMode(sort_by_state ? RenderQueue::SortMode::STATE : RenderQueue::SortMode::ORDER);
+	rq->setBatching(batch_quads);
+
+	profile::timer tm;
+	tm.start();
+	for(int f = 0; f != frames; ++f) {
+		for(int n = 0; n != sprites; ++n) {
+			rman->addRenderableToQueue(0, n, blits[n]);
+		}
+		PROFILE_FRAME_BEGIN();
+		rman->render(wnd);
+		wnd->swap();
+		PROFILE_FRAME_END();
+	}
+	const double elapsed = tm.check();
+
+	LOG_INFO("Render benchmark, " << sprites << " sprites x " << frames << " frames: " << (elapsed * 1000.0 / frames) << "ms/frame");
+	LOG_INFO("Queue: " << rq->getStats());
+	LOG_INFO("Device: " << dev->getFrameStats());
+#if defined(USE_PROFILER)
+	LOG_INFO("Profile: " << profile::get_last_frame());
+#endif
+}
+
 int main(int argc, char *argv[])
 {
 #ifdef _MSC_VER
 	SetProcessDPIAware();
 #endif
 
+	bool parallel_process = false;
+	bool sort_by_state = false;
+	bool batch_quads = false;
+	bool run_render_benchmark = false;
+	std::string trace_file;
+	for(int n = 1; n < argc; ++n) {
+		const std::string arg(argv[n]);
+		if(arg == "--particle-benchmark") {
+			particle_kernel_benchmark();
+			return 0;
+		} else if(arg == "--scene-benchmark") {
+			scene_graph_benchmark();
+			return 0;
+		} else if(arg == "--spatial-benchmark") {
+			spatial_index_benchmark();
+			spatial_culling_check();
+			return 0;
+		} else if(arg == "--convert-benchmark") {
+			pixel_convert_benchmark();
+			return 0;
+		} else if(arg == "--blur-benchmark") {
+			blur_benchmark();
+			return 0;
+		} else if(arg.compare(0, 10, "--threads=") == 0) {
+			KRE::WorkerPool::setDefaultThreadCount(atoi(arg.c_str() + 10));
+			parallel_process = true;
+		} else if(arg == "--sort-by-state") {
+			sort_by_state = true;
+		} else if(arg == "--batch") {
+			batch_quads = true;
+		} else if(arg == "--render-benchmark") {
+			run_render_benchmark = true;
+		} else if(arg.compare(0, 8, "--trace=") == 0) {
+			trace_file = arg.substr(8);
+		}
+	}
+	if(run_render_benchmark) {
+		render_benchmark(sort_by_state, batch_quads);
+		if(!trace_file.empty()) {
+			profile::write_chrome_trace(trace_file);
+		}
+		return 0;
+	}
+
 	std::list<double> smoothed_time;
 	double cumulative_time = 0.0;
 	int cnt = 0;
@@ -740,6 +1165,7 @@ int main(int argc, char *argv[])
 	
 	// XXX should a scenegraph be created from a specific window? It'd solve a couple of issues
 	SceneGraphPtr scene = SceneGraph::create("main");
+	scene->setParallelProcess(parallel_process);
 	SceneNodePtr root = scene->getRootNode();
 	root->setNodeName("root_node");
 
@@ -748,6 +1174,8 @@ int main(int argc, char *argv[])
 
 	auto rman = std::make_shared<RenderManager>();
 	auto rq = rman->addQueue(0, "opaques");
+	rq->setSortMode(sort_by_state ? RenderQueue::SortMode::STATE : RenderQueue::SortMode::ORDER);
+	rq->setBatching(batch_quads);
 
 #if defined(__linux__)
 	std::string shader_test_file = "data/shaders.cfg";
@@ -787,6 +1215,7 @@ int main(int argc, char *argv[])
 	SDL_Event e;
 	bool done = false;
 	while(!done) {
+		PROFILE_FRAME_BEGIN();
 		while(SDL_PollEvent(&e)) {
 #ifdef USE_IMGUI
 			ImGui_ImplSdlGL3_ProcessEvent(&e);
@@ -822,6 +1251,24 @@ int main(int argc, char *argv[])
 
 			ImGui::Begin("Particle System Editor");
 			ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+#if defined(USE_PROFILER)
+			{
+				const auto frame = profile::get_last_frame();
+				for(auto& zs : frame.summary) {
+					ImGui::Text("%s %.3f ms (%d)", zs.name, zs.total_ms, zs.calls);
+				}
+			}
+#endif
+			if(rq->getSortMode() == RenderQueue::SortMode::STATE || rq->isBatchingEnabled()) {
+				const auto& rqs = rq->getStats();
+				ImGui::Text("Draw calls %d, state changes %d (%d avoided)", rqs.draw_calls, rqs.sorted.total(), rqs.submitted.total() - rqs.sorted.total());
+				ImGui::Text("Batches %d (%d renderables)", rqs.batches, rqs.batched_renderables);
+			}
+			ImGui::Text("Scene objects %d visible, %d culled", scene->getCullStats().visible, scene->getCullStats().culled);
+			{
+				const auto& tcs = Font::getRenderCacheStats();
+				ImGui::Text("Text cache %d textures, %d KB, %.1f%% hits, %d evicted", static_cast<int>(tcs.entries), static_cast<int>(tcs.bytes / 1024), tcs.getHitRate() * 100.0f, static_cast<int>(tcs.evictions));
+			}
 
 			if(ImGui::CollapsingHeader("Camera")) {
 				static std::vector<std::string> camera_types{ "Perspective", "Orthogonal" };
@@ -1361,6 +1808,10 @@ int main(int argc, char *argv[])
 #endif
 
 		main_wnd->swap();
+		PROFILE_FRAME_END();
+	}
+	if(!trace_file.empty()) {
+		profile::write_chrome_trace(trace_file);
 	}
 	return 0;
 }
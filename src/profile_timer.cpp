@@ -0,0 +1,329 @@
+/*
+	Copyright (C) 2013-2014 by Kristina Simpson <sweet.kristas@gmail.com>
+	
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	   1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+
+	   2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+
+	   3. This notice may not be removed or altered from any source
+	   distribution.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "asserts.hpp"
+#include "profile_timer.hpp"
+#include "WorkerPool.hpp"
+
+namespace profile
+{
+	namespace 
+	{
+		// Events kept per thread between end_frame() calls, to bound memory when nobody is collecting frames.
+		const std::size_t max_thread_events = 65536;
+
+		struct thread_buffer
+		{
+			thread_buffer(int tid) : id(tid), depth(0), dropped(0) {}
+			int id;
+			// Only touched by the owning thread.
+			int depth;
+			std::mutex guard;
+			std::vector<zone_event> events;
+			int dropped;
+		};
+
+		struct profiler_state
+		{
+			profiler_state() : enabled(true), capacity(120), frames(), next_frame(0), frame_number(0), frame_start(0), epoch(SDL_GetPerformanceCounter()) {
+				for(auto& c : counters) {
+					c = 0;
+				}
+			}
+			std::atomic<bool> enabled;
+			std::array<std::atomic<int64_t>, static_cast<int>(Counter::MAX_COUNTERS)> counters;
+
+			std::mutex threads_guard;
+			std::vector<std::unique_ptr<thread_buffer>> threads;
+
+			std::mutex frames_guard;
+			std::size_t capacity;
+			// Ring buffer, next_frame is the slot to be written next.
+			std::vector<frame_record> frames;
+			std::size_t next_frame;
+			uint64_t frame_number;
+			Uint64 frame_start;
+			Uint64 epoch;
+		};
+
+		profiler_state& get_state()
+		{
+			static profiler_state res;
+			return res;
+		}
+
+		KRE_THREAD_LOCAL thread_buffer* current_thread_buffer = nullptr;
+
+		thread_buffer& get_thread_buffer()
+		{
+			if(current_thread_buffer == nullptr) {
+				// Buffers are never freed, so events from threads that have exited are still collected.
+				auto& state = get_state();
+				std::lock_guard<std::mutex> lock(state.threads_guard);
+				state.threads.emplace_back(new thread_buffer(static_cast<int>(state.threads.size())));
+				current_thread_buffer = state.threads.back().get();
+			}
+			return *current_thread_buffer;
+		}
+
+		double to_ms(Uint64 ticks)
+		{
+			return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+		}
+
+		double to_us(Uint64 ticks)
+		{
+			return ticks * 1000000.0 / SDL_GetPerformanceFrequency();
+		}
+
+		void write_json_string(std::ostream& os, const char* str)
+		{
+			os << '"';
+			for(; *str != '\0'; ++str) {
+				if(*str == '"' || *str == '\\') {
+					os << '\\';
+				}
+				os << *str;
+			}
+			os << '"';
+		}
+	}
+
+	const char* get_counter_name(Counter c)
+	{
+		switch(c) {
+			case Counter::DRAW_CALLS:		return "draw_calls";
+			case Counter::PARTICLES:		return "particles";
+			case Counter::BYTES_UPLOADED:	return "bytes_uploaded";
+			default: break;
+		}
+		ASSERT_LOG(false, "Unrecognised counter: " << static_cast<int>(c));
+		return nullptr;
+	}
+
+	double frame_record::ms() const
+	{
+		return to_ms(end - start);
+	}
+
+	zone::zone(const char* name)
+		: name_(name),
+		  start_(0),
+		  active_(get_state().enabled)
+	{
+		if(active_) {
+			++get_thread_buffer().depth;
+			start_ = SDL_GetPerformanceCounter();
+		}
+	}
+
+	zone::~zone()
+	{
+		if(!active_) {
+			return;
+		}
+		const Uint64 end = SDL_GetPerformanceCounter();
+		auto& tb = get_thread_buffer();
+		const int depth = --tb.depth;
+		std::lock_guard<std::mutex> lock(tb.guard);
+		if(tb.events.size() >= max_thread_events) {
+			++tb.dropped;
+			return;
+		}
+		zone_event ev = { name_, start_, end, tb.id, depth };
+		tb.events.emplace_back(ev);
+	}
+
+	void set_enabled(bool en)
+	{
+		get_state().enabled = en;
+	}
+
+	bool is_enabled()
+	{
+		return get_state().enabled;
+	}
+
+	void add_counter(Counter c, int64_t value)
+	{
+		get_state().counters[static_cast<int>(c)].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	void begin_frame()
+	{
+		auto& state = get_state();
+		std::lock_guard<std::mutex> lock(state.frames_guard);
+		state.frame_start = SDL_GetPerformanceCounter();
+	}
+
+	void end_frame()
+	{
+		auto& state = get_state();
+		const Uint64 end = SDL_GetPerformanceCounter();
+
+		std::lock_guard<std::mutex> lock(state.frames_guard);
+		if(state.frames.size() < state.capacity) {
+			state.frames.resize(state.frames.size() + 1);
+		}
+		// Recycle the oldest record so its vectors keep their storage.
+		if(state.next_frame >= state.frames.size()) {
+			state.next_frame = 0;
+		}
+		frame_record& frame = state.frames[state.next_frame];
+		state.next_frame = (state.next_frame + 1) % state.capacity;
+
+		frame.number = state.frame_number++;
+		frame.start = state.frame_start != 0 ? state.frame_start : end;
+		frame.end = end;
+		frame.dropped = 0;
+		frame.events.clear();
+		frame.summary.clear();
+		{
+			std::lock_guard<std::mutex> tlock(state.threads_guard);
+			for(auto& tb : state.threads) {
+				std::lock_guard<std::mutex> block(tb->guard);
+				frame.events.insert(frame.events.end(), tb->events.begin(), tb->events.end());
+				frame.dropped += tb->dropped;
+				tb->events.clear();
+				tb->dropped = 0;
+			}
+		}
+		for(int n = 0; n != static_cast<int>(Counter::MAX_COUNTERS); ++n) {
+			frame.counters[n] = state.counters[n].exchange(0, std::memory_order_relaxed);
+		}
+
+		for(auto& ev : frame.events) {
+			// Zone names are literals, so comparing pointers is enough here.
+			auto it = std::find_if(frame.summary.begin(), frame.summary.end(), [&ev](const zone_summary& zs) { return zs.name == ev.name; });
+			if(it == frame.summary.end()) {
+				zone_summary zs = { ev.name, 0.0, 0 };
+				frame.summary.emplace_back(zs);
+				it = frame.summary.end() - 1;
+			}
+			it->total_ms += to_ms(ev.end - ev.start);
+			++it->calls;
+		}
+		state.frame_start = end;
+	}
+
+	void set_frame_capacity(std::size_t frames)
+	{
+		ASSERT_LOG(frames > 0, "Profiler frame capacity must be at least one frame.");
+		auto& state = get_state();
+		std::lock_guard<std::mutex> lock(state.frames_guard);
+		auto ordered = std::vector<frame_record>(state.frames.begin() + state.next_frame, state.frames.end());
+		ordered.insert(ordered.end(), state.frames.begin(), state.frames.begin() + state.next_frame);
+		if(ordered.size() > frames) {
+			ordered.erase(ordered.begin(), ordered.end() - frames);
+		}
+		state.frames.swap(ordered);
+		state.capacity = frames;
+		state.next_frame = state.frames.size() % frames;
+	}
+
+	std::vector<frame_record> get_frames()
+	{
+		auto& state = get_state();
+		std::lock_guard<std::mutex> lock(state.frames_guard);
+		std::vector<frame_record> res(state.frames.begin() + state.next_frame, state.frames.end());
+		res.insert(res.end(), state.frames.begin(), state.frames.begin() + state.next_frame);
+		return res;
+	}
+
+	frame_record get_last_frame()
+	{
+		auto& state = get_state();
+		std::lock_guard<std::mutex> lock(state.frames_guard);
+		if(state.frames.empty()) {
+			return frame_record();
+		}
+		return state.frames[(state.next_frame + state.frames.size() - 1) % state.frames.size()];
+	}
+
+	void write_chrome_trace(std::ostream& os)
+	{
+		auto& state = get_state();
+		const auto frames = get_frames();
+		int num_threads = 0;
+		{
+			std::lock_guard<std::mutex> lock(state.threads_guard);
+			num_threads = static_cast<int>(state.threads.size());
+		}
+
+		// Frames go on their own track, after the threads.
+		const int frame_tid = num_threads;
+		os << "{\"traceEvents\":[\n";
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << frame_tid << ",\"args\":{\"name\":\"frames\"}}";
+		for(int n = 0; n != num_threads; ++n) {
+			os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << n << ",\"args\":{\"name\":\"thread " << n << "\"}}";
+		}
+		for(auto& frame : frames) {
+			const double ts = to_us(frame.start - state.epoch);
+			os << ",\n{\"name\":\"frame " << frame.number << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":" << frame_tid 
+				<< ",\"ts\":" << ts << ",\"dur\":" << to_us(frame.end - frame.start) << "}";
+			for(auto& ev : frame.events) {
+				os << ",\n{\"name\":";
+				write_json_string(os, ev.name);
+				os << ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ev.thread 
+					<< ",\"ts\":" << to_us(ev.start - state.epoch) << ",\"dur\":" << to_us(ev.end - ev.start) << "}";
+			}
+			for(int n = 0; n != static_cast<int>(Counter::MAX_COUNTERS); ++n) {
+				os << ",\n{\"name\":\"" << get_counter_name(static_cast<Counter>(n)) << "\",\"ph\":\"C\",\"pid\":0,\"ts\":" << ts 
+					<< ",\"args\":{\"value\":" << frame.counters[n] << "}}";
+			}
+		}
+		os << "\n]}\n";
+	}
+
+	bool write_chrome_trace(const std::string& filename)
+	{
+		std::ofstream file(filename);
+		if(!file.is_open()) {
+			LOG_ERROR("Unable to open file for writing trace: " << filename);
+			return false;
+		}
+		write_chrome_trace(file);
+		return true;
+	}
+
+	std::ostream& operator<<(std::ostream& os, const frame_record& frame)
+	{
+		os << "frame " << frame.number << ": " << frame.ms() << "ms";
+		for(int n = 0; n != static_cast<int>(Counter::MAX_COUNTERS); ++n) {
+			os << ", " << get_counter_name(static_cast<Counter>(n)) << " " << frame.counters[n];
+		}
+		for(auto& zs : frame.summary) {
+			os << "\n\t" << zs.name << ": " << zs.total_ms << "ms (" << zs.calls << ")";
+		}
+		if(frame.dropped > 0) {
+			os << "\n\t" << frame.dropped << " events dropped";
+		}
+		return os;
+	}
+}
@@ -23,39 +23,112 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "SDL.h"
 
+// Zones and counters are compiled in only when USE_PROFILER is defined, so that
+// instrumented code costs nothing in a normal build.
+#if defined(USE_PROFILER)
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// name must be a string literal, or otherwise outlive the profiler.
+#define PROFILE_ZONE(name) profile::zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_COUNTER_ADD(counter, value) profile::add_counter(profile::Counter::counter, static_cast<int64_t>(value))
+#define PROFILE_FRAME_BEGIN() profile::begin_frame()
+#define PROFILE_FRAME_END() profile::end_frame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_COUNTER_ADD(counter, value)
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END()
+#endif
+
 namespace profile 
 {
-	struct manager
+	struct timer
 	{
 		Uint64 frequency;
 		Uint64 t1, t2;
-		double elapsedTime;
+		timer()			{ frequency = SDL_GetPerformanceFrequency(); }
+		void start()	{ t1 = SDL_GetPerformanceCounter(); }
+		double check()	{ t2 = SDL_GetPerformanceCounter(); return (t2 - t1) / double(frequency); }
+	};
+
+	enum class Counter {
+		DRAW_CALLS,
+		PARTICLES,
+		BYTES_UPLOADED,
+		MAX_COUNTERS,
+	};
+	const char* get_counter_name(Counter c);
+
+	struct zone_event
+	{
 		const char* name;
+		Uint64 start;
+		Uint64 end;
+		int thread;
+		int depth;
+	};
 
-		manager(const char* const str) : name(str)
-		{
-			frequency = SDL_GetPerformanceFrequency();
-			t1 = SDL_GetPerformanceCounter();
-		}
-
-		~manager()
-		{
-			t2 = SDL_GetPerformanceCounter();
-			elapsedTime = (t2 - t1) * 1000.0 / frequency;
-			std::cerr << name << ": " << elapsedTime << " milliseconds" << std::endl;
-		}
+	// Time spent in each distinct zone over a frame.
+	struct zone_summary
+	{
+		const char* name;
+		double total_ms;
+		int calls;
 	};
 
-	struct timer
+	struct frame_record
 	{
-		Uint64 frequency;
-		Uint64 t1, t2;
-		timer()			{ frequency = SDL_GetPerformanceFrequency(); }
-		void start()	{ t1 = SDL_GetPerformanceCounter(); }
-		double check()	{ t2 = SDL_GetPerformanceCounter(); return (t2 - t1) / double(frequency); }
+		frame_record() : number(0), start(0), end(0), dropped(0), events(), summary(), counters() {}
+		double ms() const;
+		uint64_t number;
+		Uint64 start;
+		Uint64 end;
+		// Number of events lost because a thread's buffer filled up.
+		int dropped;
+		std::vector<zone_event> events;
+		std::vector<zone_summary> summary;
+		std::array<int64_t, static_cast<int>(Counter::MAX_COUNTERS)> counters;
+	};
+
+	// Times the enclosing scope. Use through PROFILE_ZONE() so that it can be compiled out.
+	class zone
+	{
+	public:
+		explicit zone(const char* name);
+		~zone();
+	private:
+		const char* name_;
+		Uint64 start_;
+		bool active_;
+		zone(const zone&);
+		void operator=(const zone&);
 	};
+
+	void set_enabled(bool en);
+	bool is_enabled();
+
+	void add_counter(Counter c, int64_t value);
+
+	// Collects the zones and counters recorded since the last end_frame() into the frame ring buffer.
+	void begin_frame();
+	void end_frame();
+
+	void set_frame_capacity(std::size_t frames);
+	// Frames in the ring buffer, oldest first.
+	std::vector<frame_record> get_frames();
+	frame_record get_last_frame();
+
+	// Writes the frames in the ring buffer in the Chrome trace event format, 
+	// which can be loaded in chrome://tracing or Perfetto.
+	void write_chrome_trace(std::ostream& os);
+	bool write_chrome_trace(const std::string& filename);
+
+	std::ostream& operator<<(std::ostream& os, const frame_record& frame);
 }